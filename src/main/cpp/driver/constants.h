@@ -11,10 +11,6 @@ namespace steamvrbridge {
 	static const int k_touchpadTouchMapping = (vr::EVRButtonId)31;
 	static const float k_defaultThumbstickDeadZoneRadius = 0.1f;
 
-	static const float DEFAULT_HAPTIC_DURATION = 0.f;
-	static const float DEFAULT_HAPTIC_AMPLITUDE = 1.f;
-	static const float DEFAULT_HAPTIC_FREQUENCY = 200.f;
-
 	/* PSMoveService button IDs*/
 	enum ePSMButtonID {
 		/* Special-Case System Button (bound to PS button by default) */
@@ -88,10 +88,13 @@ namespace steamvrbridge {
 	//-- Controller -----
 	Controller::Controller() 
 	: TrackableDevice()
-	, m_config(nullptr) {
+	, m_config(nullptr)
+	, m_dataStreamFlags(PSMStreamFlags_defaultStreamOptions) {
 	}
 
 	Controller::~Controller() {
+		CServerDriver_PSMoveService::getInstance()->UnregisterHapticComponents(this);
+
 		if (m_config != nullptr) {
 			delete m_config;
 		}
@@ -131,6 +134,57 @@ namespace steamvrbridge {
 			delete m_config;
 			m_config= nullptr;
 		}
+
+		if (m_outlierGate.GetRejectedSampleCount() > 0) {
+			Logger::Info("Controller::Deactivate - %s rejected %d outlier pose samples\n",
+				GetSteamVRIdentifier(), m_outlierGate.GetRejectedSampleCount());
+		}
+
+		if (m_posePublisher.GetSuppressedPoseCount() > 0) {
+			Logger::Info("Controller::Deactivate - %s skipped %d idle pose updates\n",
+				GetSteamVRIdentifier(), m_posePublisher.GetSuppressedPoseCount());
+		}
+
+		m_poseHistory.Clear();
+		m_outlierGate.Reset();
+		m_occlusionPolicy.Reset();
+	}
+
+	void Controller::DebugRequest(const char *pchRequest, char *pchResponseBuffer, uint32_t unResponseBufferSize) {
+		// Haptic event to rumble command latency since the last update timing log
+		if (strcmp(pchRequest, "haptic_latency") == 0) {
+			if (pchResponseBuffer == nullptr || unResponseBufferSize == 0)
+				return;
+
+			const HapticLatencyStats *stats = GetHapticLatencyStats();
+			if (stats != nullptr) {
+				stats->Format(pchResponseBuffer, unResponseBufferSize);
+			} else {
+				snprintf(pchResponseBuffer, unResponseBufferSize, "log_update_timing is not enabled");
+			}
+			return;
+		}
+
+		TrackableDevice::DebugRequest(pchRequest, pchResponseBuffer, unResponseBufferSize);
+	}
+
+	void Controller::Update() {
+		TrackableDevice::Update();
+
+		const ServerDriverConfig &serverConfig = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		if (serverConfig.log_update_timing) {
+			const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+			m_updateTiming.LogIfDue(GetSteamVRIdentifier(), now, serverConfig.update_timing_log_interval_seconds);
+			m_hapticLatency.LogIfDue(GetSteamVRIdentifier(), now, serverConfig.update_timing_log_interval_seconds);
+		}
+	}
+
+	UpdateTimingStats *Controller::GetUpdateTimingStats() {
+		return CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig().log_update_timing ? &m_updateTiming : nullptr;
+	}
+
+	HapticLatencyStats *Controller::GetHapticLatencyStats() {
+		return CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig().log_update_timing ? &m_hapticLatency : nullptr;
 	}
 
 	bool Controller::CreateButtonComponent(ePSMButtonID button_id)
@@ -199,15 +253,11 @@ namespace steamvrbridge {
 
 			if (result_code == vr::EVRInputError::VRInputError_None)
 			{
-				HapticState hapticState;
+				// std::map never moves its elements, so the route can point straight at the scheduler
+				HapticState &hapticState= m_hapticStates[haptic_id];
 				hapticState.hapticComponentHandle= hapticComponentHandle;
-				hapticState.pendingHapticDurationSecs= DEFAULT_HAPTIC_DURATION;
-				hapticState.pendingHapticAmplitude= DEFAULT_HAPTIC_AMPLITUDE;
-				hapticState.pendingHapticFrequency= DEFAULT_HAPTIC_FREQUENCY;
-				hapticState.lastTimeRumbleSent= std::chrono::time_point<std::chrono::high_resolution_clock>();
-				hapticState.lastTimeRumbleSentValid= false;
-
-				m_hapticStates[haptic_id]= hapticState;
+				CServerDriver_PSMoveService::getInstance()->RegisterHapticComponent(
+					hapticComponentHandle, this, haptic_id, &hapticState.scheduler);
 			}
 
 			return result_code == vr::EVRInputError::VRInputError_None;
@@ -236,20 +286,16 @@ namespace steamvrbridge {
 		}
 	}
 
-	void Controller::UpdateHaptics(const vr::VREvent_HapticVibration_t &hapticData) {
-		for (auto &it : m_hapticStates)
-		{
-			HapticState &state= it.second;
-
-			if (state.hapticComponentHandle == hapticData.componentHandle)
-			{
-				state.pendingHapticDurationSecs = hapticData.fDurationSeconds;
-				state.pendingHapticAmplitude = hapticData.fAmplitude;
-				state.pendingHapticFrequency = hapticData.fFrequency;
-
-				break;
-			}
+	void Controller::UpdateHaptics(ePSMHapicID haptic_id, HapticScheduler &scheduler, const vr::VREvent_HapticVibration_t &hapticData) {
+		// Games can send an event every frame for as long as something rumbles
+		static LogRateLimit s_hapticLogLimit("Controller::UpdateHaptics", 10);
+		if (s_hapticLogLimit.Allow(LogLevel_Debug)) {
+			Logger::Debug("Controller::UpdateHaptics - %s %s: duration=%.3fs, frequency=%.1fHz, amplitude=%.2f\n",
+				GetSteamVRIdentifier(), k_PSMHapticPaths[haptic_id],
+				hapticData.fDurationSeconds, hapticData.fFrequency, hapticData.fAmplitude);
 		}
+
+		scheduler.Queue(hapticData, std::chrono::high_resolution_clock::now());
 	}
 
 
@@ -298,4 +344,106 @@ namespace steamvrbridge {
 
 		return nullptr;
 	}
+
+	bool Controller::UpsampleTrackingState(float extend_Y_meters, float extend_Z_meters, bool z_rotate_90_degrees)
+	{
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_UpsampleTrackingState);
+
+		CServerDriver_PSMoveService *server = CServerDriver_PSMoveService::getInstance();
+		const ServerDriverConfig &serverConfig = server->GetServerDriverConfig();
+
+		// Nothing sensible to predict from an invalid pose
+		if (!serverConfig.upsample_controller_poses || !m_Pose.poseIsValid)
+			return false;
+
+		// The history holds raw poses, which don't include the occlusion hold or recovery blend
+		if (m_occlusionPolicy.IsOccluded() || m_occlusionPolicy.IsRecovering())
+			return false;
+
+		PSMPosef predictedPose;
+		float unpredictedSecs;
+		if (!m_poseHistory.ExtrapolatePose(
+				std::chrono::high_resolution_clock::now(),
+				serverConfig.upsample_max_horizon_seconds,
+				&predictedPose,
+				&unpredictedSecs))
+			return false;
+
+		// Same service latency as a fresh sample, plus whatever lies beyond the prediction horizon
+		m_Pose.poseTimeOffset = -0.016f - unpredictedSecs;
+
+		SolveHandOrientation(&predictedPose);
+
+		server->GetPoseBatch().Enqueue(
+			predictedPose,
+			extend_Y_meters,
+			extend_Z_meters,
+			z_rotate_90_degrees,
+			m_unSteamVRTrackedDeviceId,
+			&m_Pose,
+			&m_posePublisher);
+
+		return true;
+	}
+
+	void Controller::StartHMDAlignment(const HMDAlignmentParams &params)
+	{
+		const ServerDriverConfig &serverConfig = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+
+		if (serverConfig.hmd_alignment_sample_count > 1) {
+			Logger::Info("Controller::StartHMDAlignment - %s collecting %d alignment samples\n",
+				GetSteamVRIdentifier(), serverConfig.hmd_alignment_sample_count);
+
+			m_hmdAlignmentCollector.Begin(
+				params,
+				serverConfig.hmd_alignment_sample_count,
+				serverConfig.hmd_alignment_max_duration_seconds,
+				std::chrono::high_resolution_clock::now());
+			return;
+		}
+
+		// Take the snapshot now, the solve itself runs off the frame
+		HMDAlignmentSample sample;
+		if (CServerDriver_PSMoveService::getInstance()->GetHMDPoseCache().GetHMDPose(&sample.hmdPoseMeters)) {
+			PSM_GetControllerPose(GetPSMControllerView()->ControllerID, &sample.controllerPose);
+
+			CServerDriver_PSMoveService::getInstance()->RequestHMDAlignment(GetSteamVRIdentifier(), &sample, 1, params);
+		} else {
+			// Log an error message and safely carry on
+			Logger::Error("Controller::StartHMDAlignment - Failed to get HMD Pose\n");
+		}
+	}
+
+	void Controller::UpdateHMDAlignment()
+	{
+		if (!m_hmdAlignmentCollector.IsCollecting())
+			return;
+
+		const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+		bool bIsComplete = m_hmdAlignmentCollector.HasTimedOut(now);
+
+		// Pair the newest controller sample with the HMD pose of this frame
+		PoseHistorySample controllerSample;
+		HMDAlignmentSample sample;
+		if (!bIsComplete &&
+			m_poseHistory.GetLatestSample(&controllerSample) &&
+			controllerSample.bIsPositionValid && controllerSample.bIsOrientationValid &&
+			CServerDriver_PSMoveService::getInstance()->GetHMDPoseCache().GetHMDPose(&sample.hmdPoseMeters)) {
+			sample.controllerPose = controllerSample.pose;
+
+			bIsComplete = m_hmdAlignmentCollector.AddSample(sample, now);
+		}
+
+		if (!bIsComplete)
+			return;
+
+		CServerDriver_PSMoveService::getInstance()->RequestHMDAlignment(
+			GetSteamVRIdentifier(),
+			m_hmdAlignmentCollector.GetSamples(),
+			m_hmdAlignmentCollector.GetSampleCount(),
+			m_hmdAlignmentCollector.GetParams());
+
+		m_hmdAlignmentCollector.Cancel();
+	}
 }
\ No newline at end of file
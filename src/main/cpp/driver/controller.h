@@ -3,7 +3,13 @@
 #include "constants.h"
 #include "config.h"
 #include "trackable_device.h"
+#include "occlusion_policy.h"
+#include "pose_outlier_gate.h"
+#include "haptic_scheduler.h"
+#include "hmd_alignment.h"
+#include "update_timing.h"
 
+#include <chrono>
 #include <map>
 
 namespace steamvrbridge {
@@ -51,11 +57,7 @@ namespace steamvrbridge {
 		struct HapticState
 		{
 			vr::VRInputComponentHandle_t hapticComponentHandle;
-			float pendingHapticDurationSecs;
-			float pendingHapticAmplitude;
-			float pendingHapticFrequency;
-			std::chrono::time_point<std::chrono::high_resolution_clock> lastTimeRumbleSent;
-			bool lastTimeRumbleSentValid;
+			HapticScheduler scheduler;
 		};
 
 	public:
@@ -70,12 +72,15 @@ namespace steamvrbridge {
 
 		void UpdateButton(ePSMButtonID button_id, PSMButtonState button_state, double time_offset=0.0);
 		void UpdateAxis(ePSMAxisID axis_id, float axis_value, double time_offset=0.0);
-		void UpdateHaptics(const vr::VREvent_HapticVibration_t &hapticData);
+		void UpdateHaptics(ePSMHapicID haptic_id, HapticScheduler &scheduler, const vr::VREvent_HapticVibration_t &hapticData);
 
 		bool HasButton(ePSMButtonID button_id) const;
 		bool HasAxis(ePSMAxisID axis_id) const;
 		bool HasHapticState(ePSMHapicID haptic_id) const;
 
+		// Number of optical samples dropped by the outlier gate since the driver started
+		inline int GetRejectedPoseSampleCount() const { return m_outlierGate.GetRejectedSampleCount(); }
+
 		bool GetButtonState(ePSMButtonID button_id, PSMButtonState &out_button_state) const;
 		bool GetAxisState(ePSMAxisID axis_id, float &out_axis_value) const;
 		HapticState * GetHapticState(ePSMHapicID haptic_id);
@@ -98,10 +103,33 @@ namespace steamvrbridge {
 		/** TrackableDevice Interface */
 		vr::EVRInitError Activate(vr::TrackedDeviceIndex_t unObjectId) override;
 		void Deactivate() override;
+		void DebugRequest(const char *pchRequest, char *pchResponseBuffer, uint32_t unResponseBufferSize) override;
+		void Update() override;
 
 	protected:
 		virtual ControllerConfig *AllocateControllerConfig() { return new ControllerConfig(); }
 
+		// Re-posts the last pose predicted forward to the current time when upsampling is enabled and no
+		// new optical sample arrived this frame. Returns false if nothing was posted.
+		bool UpsampleTrackingState(float extend_Y_meters, float extend_Z_meters, bool z_rotate_90_degrees);
+
+		// Fills in the orientation of a raw PSM pose for controllers whose tracker only provides a position.
+		// Called on fresh and upsampled poses alike; does nothing by default.
+		virtual void SolveHandOrientation(PSMPosef * /*inout_pose*/) {}
+
+		// Aligns the PSM tracking space to the HMD's, either from a single snapshot or by collecting
+		// samples over the next frames, depending on the server driver config.
+		void StartHMDAlignment(const HMDAlignmentParams &params);
+
+		// Feeds the latest controller sample to an alignment in progress and applies it once complete.
+		void UpdateHMDAlignment();
+
+		// Per call timing of this controller's update paths, or null when log_update_timing is off.
+		UpdateTimingStats *GetUpdateTimingStats();
+
+		// Haptic event to rumble command latency of this controller, or null when log_update_timing is off.
+		HapticLatencyStats *GetHapticLatencyStats();
+
 	private:
 		struct ButtonState
 		{
@@ -122,5 +150,20 @@ namespace steamvrbridge {
 
 	protected:
 		ControllerConfig *m_config;
+
+		// Flags the PSMoveService data stream was started with
+		unsigned int m_dataStreamFlags;
+
+		// Drops optical samples that jump further than a hand can move
+		PoseOutlierGate m_outlierGate;
+
+		// Holds the pose through short optical occlusions
+		OcclusionPolicy m_occlusionPolicy;
+
+		// Samples of a multi-sample HMD alignment in progress
+		HMDAlignmentCollector m_hmdAlignmentCollector;
+
+		UpdateTimingStats m_updateTiming;
+		HapticLatencyStats m_hapticLatency;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "facing_handsolver.h"
 #include "PSMoveClient_CAPI.h"
+#include "constants.h"
+#include "logger.h"
+#include "psm_math.h"
+#include "utils.h"
+#include <math.h>
 
 /*
  IK Model - Adapted from https://github.com/LastFreeUsername/qufIK/blob/master/cFABRIK.cpp
@@ -7,6 +12,9 @@
 
 namespace steamvrbridge {
 
+	// Below this the hand is treated as sitting on the shoulder, or pointing straight up or down
+	static const float k_fDegenerateLength = 1e-3f;
+
 	// right-handed system
 	// +y is up
 	// +x is to the right
@@ -16,73 +24,178 @@ namespace steamvrbridge {
 	{
 	}
 
-	PSMQuatf CFacingHandOrientationSolver::solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation)
+	PSMQuatf CFacingHandOrientationSolver::solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f & /*handLocation*/)
 	{
 		// Use the orientation of the HMD as the hand orientation
 		return hmdPose.Orientation;
 	}
 
-	// TODO - Doesn't work yet
-#if 0
-	class CRadialHandOrientationSolver : public IHandOrientationSolver
+	// right-handed system
+	// +y is up
+	// +x is to the right
+	// -z is going away from you
+	// Distance unit is  meters
+	CRadialHandOrientationSolver::CRadialHandOrientationSolver(vr::ETrackedControllerRole hand, float neckLength, float halfShoulderLength)
+		: m_hand(hand)
+		, m_neckLength(neckLength)
+		, m_halfShoulderLength(halfShoulderLength)
 	{
-	public:
-		// right-handed system
-		// +y is up
-		// +x is to the right
-		// -z is going away from you
-		// Distance unit is  meters
-		CRadialHandOrientationSolver(vr::ETrackedControllerRole hand, float neckLength, float halfShoulderLength)
-			: m_hand(hand)
-			, m_neckLength(neckLength)
-			, m_halfShoulderLength(halfShoulderLength)
-		{
+	}
+
+	PSMQuatf CRadialHandOrientationSolver::solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation)
+	{
+		// Assume the left/right shoulder is always pointing perpendicular to HMD forward.
+		// This isn't always true, but it's generally the more comfortable default pose.
+		const PSMPosef shoulderPose = solveWorldShoulderPose(hmdPose);
+
+		const PSMVector3f bodyRight = PSMMath::QuatfRotateVector(shoulderPose.Orientation, *k_psm_float_vector3_i);
+		const PSMVector3f bodyForward = PSMMath::Vector3fScale(*k_psm_float_vector3_k, -1.f);
+		const PSMVector3f worldBodyForward = PSMMath::QuatfRotateVector(shoulderPose.Orientation, bodyForward);
+
+		// Direction from the shoulder to the hand. A hand right at the shoulder points the way the body faces.
+		const PSMVector3f shoulderToHand = PSMMath::Vector3fSubtract(handLocation, shoulderPose.Position);
+		const PSMVector3f handForward = PSMMath::Vector3fNormalizeWithDefault(shoulderToHand, worldBodyForward);
+
+		// Create ortho-normal basis vectors (forward, up, and right) for the hand
+		// from the shoulder position and hand position
+		const PSMVector3f up = *k_psm_float_vector3_j;
+		PSMVector3f handRight = PSMMath::Vector3fCross(handForward, up);
+
+		// Pointing straight up or down leaves no horizontal right vector, use the body's right instead
+		// with the part along the pointing direction removed (Gram-Schmidt)
+		if (PSMMath::Vector3fLength(handRight) < k_fDegenerateLength) {
+			const float alongForward = PSMMath::Vector3fDot(bodyRight, handForward);
+			handRight = PSMMath::Vector3fScaleAndAdd(handForward, -alongForward, bodyRight);
 		}
+		handRight = PSMMath::Vector3fNormalizeWithDefault(handRight, bodyRight);
+		const PSMVector3f handUp = PSMMath::Vector3fCross(handRight, handForward);
 
-		PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation) override
-		{
-			// Assume the left/right shoulder is always pointing perpendicular to HMD forward.
-			// This isn't always true, but it's generally the more comfortable default pose.
-			const PSMPosef shoulderPose = solveWorldShoulderPose(&hmdPose);
+		// Convert basis vectors into a 3x3 matrix
+		const PSMVector3f negatedHandForward = PSMMath::Vector3fScale(handForward, -1.f);
+		const PSMMatrix3f handMat = PSM_Matrix3fCreate(&handRight, &handUp, &negatedHandForward);
 
-			// Compute the world space locations of the elbow and hand
-			const PSMVector3f shoulderToHand = PSM_Vector3fSubtract(&handLocation, &shoulderPose.Position);
+		// Convert the hand orientation into a quaternion
+		const PSMQuatf handOrientation = Utils::psmMatrix3fToPSMQuatf(handMat);
+
+		return PSMMath::QuatfNormalizeWithDefault(handOrientation, *k_psm_quaternion_identity);
+	}
+
+	PSMPosef CRadialHandOrientationSolver::solveWorldShoulderPose(const PSMPosef &hmdPose) const
+	{
+		// Only the heading of the HMD moves the shoulders
+		PSMPosef bodyPose = hmdPose;
+		bodyPose.Orientation = Utils::ExtractHMDYawQuaternion(hmdPose.Orientation);
+
+		PSMVector3f localShoulderOffset = {
+			(m_hand == vr::ETrackedControllerRole::TrackedControllerRole_RightHand) ? m_halfShoulderLength : -m_halfShoulderLength,
+			-m_neckLength,
+			0.f };
+		PSMPosef localShoulderPose = PSMMath::PosefCreate(localShoulderOffset, *k_psm_quaternion_identity);
+		PSMPosef worldShoulderPose = PSMMath::PosefConcat(localShoulderPose, bodyPose);
+
+		return worldShoulderPose;
+	}
+
+	//-- HandOrientationSolverFactory -----
+	static IHandOrientationSolver *createFacingSolver(const HandOrientationSolverParams & /*params*/)
+	{
+		return new CFacingHandOrientationSolver();
+	}
+
+	static IHandOrientationSolver *createRadialSolver(const HandOrientationSolverParams &params)
+	{
+		return new CRadialHandOrientationSolver(params.hand, params.neckLength, params.halfShoulderLength);
+	}
 
-			// Create ortho-normal basis vectors (forward, up, and right) for the hand
-			// from the shoulder position and hand position
-			const PSMVector3f handForward = PSM_Vector3fNormalizeWithDefault(&shoulderToHand, k_psm_float_vector3_k);
-			const PSMVector3f up = *k_psm_float_vector3_j;
-			PSMVector3f handRight = PSM_Vector3fCross(&handForward, &up);
-			handRight = PSM_Vector3fNormalizeWithDefault(&handRight, k_psm_float_vector3_i);
-			const PSMVector3f handUp = PSM_Vector3fCross(&handRight, &handForward);
+	struct HandOrientationSolverEntry {
+		const char *name;
+		IHandOrientationSolver *(*create)(const HandOrientationSolverParams &params);
+	};
 
-			// Convert basis vectors into a 3x3 matrix
-			const PSMVector3f negatedHandForward = PSM_Vector3fScale(&handForward, -1.f);
-			const PSMMatrix3f handMat = PSM_Matrix3fCreate(&handRight, &handUp, &negatedHandForward);
+	static const HandOrientationSolverEntry k_handOrientationSolvers[] = {
+		{ "facing", createFacingSolver },
+		{ "radial", createRadialSolver },
+	};
 
-			// Convert the hand orientation into a quaternion
-			PSMQuatf handOrientation = psmMatrix3fToPSMQuatf(handMat);
+	IHandOrientationSolver *HandOrientationSolverFactory::createSolver(const std::string &name, const HandOrientationSolverParams &params)
+	{
+		if (name.empty() || name == "none")
+			return nullptr;
 
-			return handOrientation;
+		for (const HandOrientationSolverEntry &entry : k_handOrientationSolvers) {
+			if (name == entry.name)
+				return entry.create(params);
 		}
 
-	protected:
-		PSMPosef solveWorldShoulderPose(const PSMPosef *hmdPose)
-		{
-			PSMVector3f localShoulderOffset = {
-				(m_hand == vr::ETrackedControllerRole::TrackedControllerRole_RightHand) ? m_halfShoulderLength : -m_halfShoulderLength,
-				-m_neckLength,
-				0.f };
-			PSMPosef localShoulderPose = PSM_PosefCreate(&localShoulderOffset, k_psm_quaternion_identity);
-			PSMPosef worldShoulderPose = PSM_PosefConcat(&localShoulderPose, hmdPose);
-
-			return worldShoulderPose;
+		Logger::Info("HandOrientationSolverFactory::createSolver - Unknown hand orientation solver: %s\n", name.c_str());
+		return nullptr;
+	}
+
+	//-- CachedHandOrientationSolver -----
+	const float CachedHandOrientationSolver::k_fHMDPositionEpsilonMeters = 0.0005f;
+	const float CachedHandOrientationSolver::k_fHMDRotationEpsilonRadians = 0.1f / k_fRadiansToDegrees;
+
+	CachedHandOrientationSolver::CachedHandOrientationSolver(IHandOrientationSolver *solver)
+		: m_solver(solver)
+		, m_bHasCachedOrientation(false)
+		, m_sampleSequence(0)
+		, m_worldFromDriverVersion(0)
+		, m_hmdPose(*k_psm_pose_identity)
+		, m_cachedOrientation(*k_psm_quaternion_identity)
+		, m_nHitCount(0)
+		, m_nMissCount(0)
+	{
+	}
+
+	CachedHandOrientationSolver::~CachedHandOrientationSolver()
+	{
+		delete m_solver;
+	}
+
+	PSMQuatf CachedHandOrientationSolver::solveHandOrientation(
+		int sampleSequence,
+		unsigned int worldFromDriverVersion,
+		const PSMPosef &hmdPose,
+		const PSMVector3f &handLocation)
+	{
+		if (m_bHasCachedOrientation &&
+			sampleSequence == m_sampleSequence &&
+			worldFromDriverVersion == m_worldFromDriverVersion &&
+			isHMDPoseCached(hmdPose)) {
+			++m_nHitCount;
+			return m_cachedOrientation;
 		}
 
-	private:
-		vr::ETrackedControllerRole m_hand;
-		float m_neckLength;
-		float m_halfShoulderLength;
-	};
-#endif
-}
\ No newline at end of file
+		// Compared against the pose the orientation was solved for, so slow drift still adds up
+		m_cachedOrientation = m_solver->solveHandOrientation(hmdPose, handLocation);
+		m_sampleSequence = sampleSequence;
+		m_worldFromDriverVersion = worldFromDriverVersion;
+		m_hmdPose = hmdPose;
+		m_bHasCachedOrientation = true;
+		++m_nMissCount;
+
+		return m_cachedOrientation;
+	}
+
+	bool CachedHandOrientationSolver::isHMDPoseCached(const PSMPosef &hmdPose) const
+	{
+		const PSMVector3f &a = hmdPose.Position;
+		const PSMVector3f &b = m_hmdPose.Position;
+		const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+		if (dx*dx + dy*dy + dz*dz > k_fHMDPositionEpsilonMeters*k_fHMDPositionEpsilonMeters)
+			return false;
+
+		// The angle between two unit quaternions is 2*acos(|dot|)
+		const PSMQuatf &p = hmdPose.Orientation;
+		const PSMQuatf &q = m_hmdPose.Orientation;
+		const float dot = fabsf(p.w*q.w + p.x*q.x + p.y*q.y + p.z*q.z);
+		static const float k_fMinDot = cosf(0.5f * k_fHMDRotationEpsilonRadians);
+
+		return dot >= k_fMinDot;
+	}
+
+	void CachedHandOrientationSolver::invalidate()
+	{
+		m_bHasCachedOrientation = false;
+	}
+}
@@ -1,10 +1,13 @@
 #pragma once
 #include "PSMoveClient_CAPI.h"
+#include <openvr_driver.h>
+#include <string>
 
 namespace steamvrbridge {
 	class IHandOrientationSolver
 	{
 	public:
+		virtual ~IHandOrientationSolver() {}
 		virtual PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation) = 0;
 	};
 
@@ -12,6 +15,83 @@ namespace steamvrbridge {
 	{
 	public:
 		CFacingHandOrientationSolver();
-		PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation);
+		PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation) override;
 	};
-}
\ No newline at end of file
+
+	/* Points the hand along the line from its shoulder to the hand. The shoulders are placed below the
+	HMD and to either side of it, facing the way the HMD faces (yaw only, so nodding or tilting the head
+	doesn't swing the shoulders around). The hand's up vector stays as close to world up as the pointing
+	direction allows.*/
+	class CRadialHandOrientationSolver : public IHandOrientationSolver
+	{
+	public:
+		CRadialHandOrientationSolver(vr::ETrackedControllerRole hand, float neckLength, float halfShoulderLength);
+		PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f &handLocation) override;
+
+	protected:
+		PSMPosef solveWorldShoulderPose(const PSMPosef &hmdPose) const;
+
+	private:
+		vr::ETrackedControllerRole m_hand;
+		float m_neckLength;
+		float m_halfShoulderLength;
+	};
+
+	// Everything a solver may need to know about the controller it solves for
+	struct HandOrientationSolverParams {
+		vr::ETrackedControllerRole hand;
+		float neckLength;
+		float halfShoulderLength;
+	};
+
+	/* Creates hand orientation solvers by the name used in the controller config.*/
+	class HandOrientationSolverFactory
+	{
+	public:
+		// Returns nullptr for "none" and for names that don't match a solver
+		static IHandOrientationSolver *createSolver(const std::string &name, const HandOrientationSolverParams &params);
+	};
+
+	/* Wraps a solver and remembers its last result, so the solver only runs again once one of its inputs
+	changed: the controller sample, the world-from-driver calibration that places the hand in world space,
+	or the HMD pose by more than a small epsilon. Frames upsampled from the same sample reuse the
+	orientation solved for it as long as the head holds still. Keeps heavier solvers affordable when
+	asked for an orientation every frame.*/
+	class CachedHandOrientationSolver
+	{
+	public:
+		// HMD motion below these reuses the cached orientation
+		static const float k_fHMDPositionEpsilonMeters;
+		static const float k_fHMDRotationEpsilonRadians;
+
+		// Takes ownership of the solver
+		explicit CachedHandOrientationSolver(IHandOrientationSolver *solver);
+		~CachedHandOrientationSolver();
+
+		PSMQuatf solveHandOrientation(
+			int sampleSequence,
+			unsigned int worldFromDriverVersion,
+			const PSMPosef &hmdPose,
+			const PSMVector3f &handLocation);
+
+		void invalidate();
+
+		// Calls answered from the cache and calls that ran the solver
+		inline unsigned int getHitCount() const { return m_nHitCount; }
+		inline unsigned int getMissCount() const { return m_nMissCount; }
+
+	private:
+		bool isHMDPoseCached(const PSMPosef &hmdPose) const;
+
+		IHandOrientationSolver *m_solver;
+
+		bool m_bHasCachedOrientation;
+		int m_sampleSequence;
+		unsigned int m_worldFromDriverVersion;
+		PSMPosef m_hmdPose;
+		PSMQuatf m_cachedOrientation;
+
+		unsigned int m_nHitCount;
+		unsigned int m_nMissCount;
+	};
+}
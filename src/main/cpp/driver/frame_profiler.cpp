@@ -0,0 +1,295 @@
+#include "frame_profiler.h"
+#include "logger.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdio.h>
+
+namespace steamvrbridge {
+
+	// Windows are written to this many files in turn, so the profiler can run for a whole session
+	static const int k_nProfileFileCount = 4;
+
+	// Spans one thread can record per window, the rest are dropped and counted
+	static const size_t k_nMaxSpansPerThread = 64 * 1024;
+
+	// Windows waiting for the writer thread; when it falls further behind new windows are dropped
+	static const size_t k_nMaxPendingWindows = 2;
+
+	struct ProfileSpan {
+		const char *name;
+		long long startNanos;
+		long long durationNanos;
+		int arg;
+		unsigned int threadId;
+	};
+
+	// Spans recorded by one thread since the last window was gathered. Only its own thread and the
+	// RunFrame thread gathering the window take the mutex, so it's hardly ever contended.
+	struct ProfileThreadBuffer {
+		std::mutex mutex;
+		std::vector<ProfileSpan> spans;
+		unsigned int droppedCount;
+		unsigned int threadId;
+		const char *threadName;
+	};
+
+	struct ProfileWindow {
+		int index;
+		int frameCount;
+		unsigned int droppedCount;
+		std::vector<ProfileSpan> spans;
+		std::vector<std::pair<unsigned int, const char *> > threadNames;
+	};
+
+	std::atomic<bool> FrameProfiler::s_bEnabled(false);
+
+	static std::atomic<bool> s_bDumpRequested(false);
+	static std::chrono::time_point<std::chrono::high_resolution_clock> s_profileStartTime;
+	static std::string s_profileDirectory;
+	static int s_nWindowFrames = 0;
+
+	// Only touched by the RunFrame thread (and Start()/Stop()); the frame count includes the running frame
+	static int s_nWindowIndex = 0;
+	static int s_nWindowFrameCount = 0;
+
+	// Every thread that ever recorded a span; buffers are kept until the driver is unloaded since the
+	// driver only runs a handful of threads
+	static std::mutex s_threadBuffersMutex;
+	static std::vector<std::unique_ptr<ProfileThreadBuffer> > s_threadBuffers;
+	static thread_local ProfileThreadBuffer *t_pThreadBuffer = nullptr;
+	static thread_local const char *t_threadName = nullptr;
+
+	static std::thread *s_pWriterThread = nullptr;
+	static std::mutex s_writerMutex;
+	static std::condition_variable s_writerWakeCondition;
+	static std::vector<ProfileWindow> s_pendingWindows;
+	static bool s_bWriterExitSignaled = false;
+
+	static ProfileThreadBuffer *GetThreadBuffer() {
+		if (t_pThreadBuffer == nullptr) {
+			std::lock_guard<std::mutex> guard(s_threadBuffersMutex);
+
+			std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+			buffer->droppedCount = 0;
+			buffer->threadId = (unsigned int)s_threadBuffers.size() + 1;
+			buffer->threadName = t_threadName;
+
+			t_pThreadBuffer = buffer.get();
+			s_threadBuffers.push_back(std::move(buffer));
+		}
+
+		return t_pThreadBuffer;
+	}
+
+	// Moves every thread's spans into a window, leaving the buffers empty (but allocated) for the next one
+	static void GatherWindow(ProfileWindow &window) {
+		window.index = s_nWindowIndex++;
+		window.frameCount = s_nWindowFrameCount;
+		window.droppedCount = 0;
+		s_nWindowFrameCount = 0;
+
+		std::lock_guard<std::mutex> guard(s_threadBuffersMutex);
+		for (auto it = s_threadBuffers.begin(); it != s_threadBuffers.end(); ++it) {
+			ProfileThreadBuffer &buffer = **it;
+			std::lock_guard<std::mutex> bufferGuard(buffer.mutex);
+
+			if (buffer.spans.empty() && buffer.droppedCount == 0)
+				continue;
+
+			window.spans.insert(window.spans.end(), buffer.spans.begin(), buffer.spans.end());
+			window.droppedCount += buffer.droppedCount;
+			window.threadNames.push_back(std::make_pair(buffer.threadId, buffer.threadName));
+
+			buffer.spans.clear();
+			buffer.droppedCount = 0;
+		}
+	}
+
+	static void SubmitWindow() {
+		ProfileWindow window;
+		GatherWindow(window);
+
+		{
+			std::lock_guard<std::mutex> guard(s_writerMutex);
+			if (s_pendingWindows.size() >= k_nMaxPendingWindows) {
+				Logger::Warn("FrameProfiler - Writer is behind, dropped window %d\n", window.index);
+				return;
+			}
+			s_pendingWindows.push_back(std::move(window));
+		}
+		s_writerWakeCondition.notify_one();
+	}
+
+	static void WriteWindow(const ProfileWindow &window) {
+		const std::string path = s_profileDirectory + "/frame_profile_" + std::to_string(window.index % k_nProfileFileCount) + ".json";
+
+		FILE *file = fopen(path.c_str(), "w");
+		if (file == nullptr) {
+			Logger::Error("FrameProfiler - Failed to open %s\n", path.c_str());
+			return;
+		}
+
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"window\":%d,\"frames\":%d,\"droppedSpans\":%u},\"traceEvents\":[\n",
+			window.index, window.frameCount, window.droppedCount);
+
+		bool bFirstEvent = true;
+		for (auto it = window.threadNames.begin(); it != window.threadNames.end(); ++it) {
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				bFirstEvent ? "" : ",\n", it->first, it->second != nullptr ? it->second : "Unnamed");
+			bFirstEvent = false;
+		}
+
+		// Complete events: one begin/end pair each, timestamps in microseconds
+		for (auto it = window.spans.begin(); it != window.spans.end(); ++it) {
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld.%03lld,\"dur\":%lld.%03lld",
+				bFirstEvent ? "" : ",\n", it->name, it->threadId,
+				it->startNanos / 1000, it->startNanos % 1000, it->durationNanos / 1000, it->durationNanos % 1000);
+			if (it->arg >= 0) {
+				fprintf(file, ",\"args\":{\"device\":%d}", it->arg);
+			}
+			fprintf(file, "}");
+			bFirstEvent = false;
+		}
+
+		fprintf(file, "\n]}\n");
+		fclose(file);
+
+		Logger::Info("FrameProfiler - Wrote %d frames (%u spans, %u dropped) to %s\n",
+			window.frameCount, (unsigned int)window.spans.size(), window.droppedCount, path.c_str());
+	}
+
+	static void WriterThreadFunction() {
+		std::unique_lock<std::mutex> lock(s_writerMutex);
+
+		while (true) {
+			s_writerWakeCondition.wait(lock, [] { return s_bWriterExitSignaled || !s_pendingWindows.empty(); });
+
+			if (!s_pendingWindows.empty()) {
+				ProfileWindow window = std::move(s_pendingWindows.front());
+				s_pendingWindows.erase(s_pendingWindows.begin());
+
+				lock.unlock();
+				WriteWindow(window);
+				lock.lock();
+			} else if (s_bWriterExitSignaled) {
+				break;
+			}
+		}
+	}
+
+	bool FrameProfiler::Start(const std::string &directory, int windowFrames) {
+		if (s_pWriterThread != nullptr)
+			return true;
+
+		if (windowFrames <= 0) {
+			Logger::Error("FrameProfiler::Start - A window of %d frames can't hold anything\n", windowFrames);
+			return false;
+		}
+
+		s_profileDirectory = directory;
+		s_nWindowFrames = windowFrames;
+		s_nWindowIndex = 0;
+		s_nWindowFrameCount = 0;
+		s_bDumpRequested = false;
+		s_profileStartTime = std::chrono::high_resolution_clock::now();
+
+		// Leftovers from a previous run would have timestamps from its start time
+		{
+			std::lock_guard<std::mutex> guard(s_threadBuffersMutex);
+			for (auto it = s_threadBuffers.begin(); it != s_threadBuffers.end(); ++it) {
+				std::lock_guard<std::mutex> bufferGuard((*it)->mutex);
+				(*it)->spans.clear();
+				(*it)->droppedCount = 0;
+			}
+		}
+
+		s_bWriterExitSignaled = false;
+		s_pWriterThread = new std::thread(WriterThreadFunction);
+
+		Logger::Info("FrameProfiler::Start - Writing windows of %d frames to %s\n", windowFrames, directory.c_str());
+
+		s_bEnabled = true;
+		return true;
+	}
+
+	void FrameProfiler::Stop() {
+		if (s_pWriterThread == nullptr)
+			return;
+
+		s_bEnabled = false;
+
+		if (s_nWindowFrameCount > 0) {
+			SubmitWindow();
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(s_writerMutex);
+			s_bWriterExitSignaled = true;
+		}
+		s_writerWakeCondition.notify_one();
+
+		s_pWriterThread->join();
+		delete s_pWriterThread;
+		s_pWriterThread = nullptr;
+	}
+
+	void FrameProfiler::RequestDump() {
+		s_bDumpRequested = true;
+	}
+
+	void FrameProfiler::BeginFrame() {
+		if (!IsEnabled())
+			return;
+
+		if (t_threadName == nullptr) {
+			SetThreadName("RunFrame");
+		}
+
+		if (s_nWindowFrameCount >= s_nWindowFrames || s_bDumpRequested.exchange(false)) {
+			SubmitWindow();
+		}
+		++s_nWindowFrameCount;
+	}
+
+	void FrameProfiler::SetThreadName(const char *name) {
+		t_threadName = name;
+
+		if (t_pThreadBuffer != nullptr) {
+			std::lock_guard<std::mutex> guard(t_pThreadBuffer->mutex);
+			t_pThreadBuffer->threadName = name;
+		}
+	}
+
+	void FrameProfiler::AddSpan(
+		const char *name,
+		int arg,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &startTime,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &endTime) {
+		if (!IsEnabled())
+			return;
+
+		ProfileThreadBuffer *buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> guard(buffer->mutex);
+
+		if (buffer->spans.size() >= k_nMaxSpansPerThread) {
+			++buffer->droppedCount;
+			return;
+		}
+
+		// A span that began before a restart of the profiler belongs to no window
+		if (startTime < s_profileStartTime)
+			return;
+
+		ProfileSpan span;
+		span.name = name;
+		span.startNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(startTime - s_profileStartTime).count();
+		span.durationNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+		span.arg = arg;
+		span.threadId = buffer->threadId;
+		buffer->spans.push_back(span);
+	}
+}
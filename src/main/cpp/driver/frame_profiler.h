@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace steamvrbridge {
+
+	/* Timeline profiler for the driver's frames. ScopedProfileSpan records the begin and end of a scope
+	into a buffer owned by the calling thread, so threads never wait on each other while recording. The
+	spans are gathered into a window of frame_profiler_window_frames frames; when the window is full, or a
+	dump was requested, the RunFrame thread hands it to a writer thread which saves it as Chrome
+	trace-event JSON (frame_profile_<n>.json next to the config, cycling through a few files) that opens
+	in chrome://tracing or Perfetto. Costs one relaxed atomic load per span while stopped.*/
+	class FrameProfiler {
+	public:
+		// Starts recording, writing windows of the given number of frames into the directory.
+		static bool Start(const std::string &directory, int windowFrames);
+
+		// Writes the window recorded so far and waits for the writer thread to finish.
+		static void Stop();
+
+		static inline bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+		// Ends the current window at the next BeginFrame() and writes it. Safe to call from any thread.
+		static void RequestDump();
+
+		// Called by RunFrame() once per frame before it records any span: hands the window of the previous
+		// frames to the writer when it's full or a dump was requested.
+		static void BeginFrame();
+
+		// Names the calling thread in the timeline. The name must be a string literal.
+		static void SetThreadName(const char *name);
+
+		// Records a span on the calling thread; arg is shown with it unless negative (e.g. a device index).
+		static void AddSpan(
+			const char *name,
+			int arg,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &startTime,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &endTime);
+
+	private:
+		static std::atomic<bool> s_bEnabled;
+	};
+
+	// Records the enclosing scope as a span when the profiler is running. The name must be a string literal.
+	class ScopedProfileSpan {
+	public:
+		explicit ScopedProfileSpan(const char *name, int arg = -1)
+			: m_name(FrameProfiler::IsEnabled() ? name : nullptr)
+			, m_arg(arg) {
+			if (m_name != nullptr)
+				m_startTime = std::chrono::high_resolution_clock::now();
+		}
+
+		~ScopedProfileSpan() {
+			if (m_name != nullptr)
+				FrameProfiler::AddSpan(m_name, m_arg, m_startTime, std::chrono::high_resolution_clock::now());
+		}
+
+	private:
+		const char *m_name;
+		int m_arg;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_startTime;
+	};
+}
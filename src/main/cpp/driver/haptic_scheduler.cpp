@@ -0,0 +1,221 @@
+#include "haptic_scheduler.h"
+#include <math.h>
+
+namespace steamvrbridge {
+
+	// Legacy TriggerHapticPulse() events encode their strength as a duration of up to 5ms
+	static const float k_fLegacyPulseMaxSeconds = 0.005f;
+
+	// Shortest on time; anything shorter doesn't spin the motor up enough to be felt
+	static const float k_fMinPulseSeconds = 0.02f;
+
+	// Motor values below this aren't noticeable, so any non-zero strength starts here
+	static const float k_fMinNoticeableStrength = 0.35f;
+
+	// Half a period has to span at least a couple of frames for the modulation to be rendered
+	static const float k_fMaxModulatedFrequency = 30.f;
+
+	// Pulses at or below this frequency only drive the low frequency motor, at or above the upper one
+	// only the high frequency motor; in between they fade across on a log scale
+	static const float k_fLowFrequencyMotorMaxHz = 50.f;
+	static const float k_fHighFrequencyMotorMinHz = 200.f;
+
+	// PSM rumble values are sent as a byte
+	static const int k_nOutputLevels = 255;
+
+	HapticScheduler::HapticScheduler()
+		: m_nPulseCount(0)
+		, m_lastOutputLevel(0)
+		, m_bHasPendingEvent(false) {
+	}
+
+	void HapticScheduler::Queue(
+		const vr::VREvent_HapticVibration_t &hapticData,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		if (!m_bHasPendingEvent) {
+			m_bHasPendingEvent = true;
+			m_pendingEventArrivalTime = now;
+		}
+
+		if (hapticData.fDurationSeconds <= 0.f || hapticData.fAmplitude <= 0.f) {
+			Clear();
+			return;
+		}
+
+		float strength = fminf(hapticData.fAmplitude, 1.f);
+		float durationSeconds = hapticData.fDurationSeconds;
+		if (durationSeconds < k_fLegacyPulseMaxSeconds) {
+			strength *= durationSeconds / k_fLegacyPulseMaxSeconds;
+		}
+		durationSeconds = fmaxf(durationSeconds, k_fMinPulseSeconds);
+
+		Pulse pulse;
+		pulse.startTime = now;
+		pulse.endTime = now + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+			std::chrono::duration<float>(durationSeconds));
+		pulse.strength = k_fMinNoticeableStrength + (1.f - k_fMinNoticeableStrength)*strength;
+		pulse.frequency = hapticData.fFrequency;
+
+		if (m_nPulseCount < k_nMaxPulses) {
+			m_pulses[m_nPulseCount++] = pulse;
+			return;
+		}
+
+		// Full: the new pulse replaces the one that would have ended first
+		int soonestIndex = 0;
+		for (int i = 1; i < m_nPulseCount; ++i) {
+			if (m_pulses[i].endTime < m_pulses[soonestIndex].endTime)
+				soonestIndex = i;
+		}
+		m_pulses[soonestIndex] = pulse;
+	}
+
+	void HapticScheduler::Clear() {
+		m_nPulseCount = 0;
+	}
+
+	bool HapticScheduler::Update(const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float *out_rumble_fraction) {
+		ExpirePulses(now);
+
+		const int level = QuantizeLevel(Evaluate(now));
+		if (level == m_lastOutputLevel) {
+			m_bHasPendingEvent = false;
+			return false;
+		}
+
+		m_lastOutputLevel = level;
+		*out_rumble_fraction = static_cast<float>(level) / k_nOutputLevels;
+		return true;
+	}
+
+	bool HapticScheduler::TakePendingEventArrival(std::chrono::time_point<std::chrono::high_resolution_clock> *out_arrival_time) {
+		if (!m_bHasPendingEvent)
+			return false;
+
+		*out_arrival_time = m_pendingEventArrivalTime;
+		m_bHasPendingEvent = false;
+		return true;
+	}
+
+	float HapticScheduler::Evaluate(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) const {
+		float value = 0.f;
+
+		for (int i = 0; i < m_nPulseCount; ++i) {
+			value = fmaxf(value, EvaluatePulse(m_pulses[i], now));
+		}
+
+		return fminf(value, 1.f);
+	}
+
+	void HapticScheduler::EvaluateBands(
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		float *out_low_frequency_value,
+		float *out_high_frequency_value) const {
+		static const float k_fLogCrossoverStart = log2f(k_fLowFrequencyMotorMaxHz);
+		static const float k_fLogCrossoverWidth = log2f(k_fHighFrequencyMotorMinHz) - k_fLogCrossoverStart;
+
+		float lowValue = 0.f;
+		float highValue = 0.f;
+
+		for (int i = 0; i < m_nPulseCount; ++i) {
+			const Pulse &pulse = m_pulses[i];
+			const float value = EvaluatePulse(pulse, now);
+			if (value <= 0.f)
+				continue;
+
+			float highWeight = 1.f;
+			float lowWeight = 1.f;
+			if (pulse.frequency > 0.f) {
+				highWeight = fminf(fmaxf((log2f(pulse.frequency) - k_fLogCrossoverStart) / k_fLogCrossoverWidth, 0.f), 1.f);
+				lowWeight = 1.f - highWeight;
+			}
+
+			lowValue = fmaxf(lowValue, value * lowWeight);
+			highValue = fmaxf(highValue, value * highWeight);
+		}
+
+		*out_low_frequency_value = fminf(lowValue, 1.f);
+		*out_high_frequency_value = fminf(highValue, 1.f);
+	}
+
+	int HapticScheduler::QuantizeLevel(float value) {
+		return static_cast<int>(fminf(fmaxf(value, 0.f), 1.f) * k_nOutputLevels + 0.5f);
+	}
+
+	float HapticScheduler::EvaluatePulse(const Pulse &pulse, const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		if (now < pulse.startTime || now >= pulse.endTime)
+			return 0.f;
+
+		// Off during the second half of each period of a slow pulse
+		if (pulse.frequency > 0.f && pulse.frequency <= k_fMaxModulatedFrequency) {
+			const float elapsedPeriods = std::chrono::duration<float>(now - pulse.startTime).count() * pulse.frequency;
+			if (elapsedPeriods - floorf(elapsedPeriods) >= 0.5f)
+				return 0.f;
+		}
+
+		return pulse.strength;
+	}
+
+	void HapticScheduler::ExpirePulses(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		int keptCount = 0;
+
+		for (int i = 0; i < m_nPulseCount; ++i) {
+			if (now < m_pulses[i].endTime) {
+				m_pulses[keptCount++] = m_pulses[i];
+			}
+		}
+
+		m_nPulseCount = keptCount;
+	}
+
+	DualMotorHapticMixer::DualMotorHapticMixer()
+		: m_lastLowFrequencyLevel(0)
+		, m_lastHighFrequencyLevel(0) {
+	}
+
+	bool DualMotorHapticMixer::Update(
+		HapticScheduler *const *schedulers,
+		int schedulerCount,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		Output *out_output) {
+		float lowValue = 0.f;
+		float highValue = 0.f;
+		out_output->bHasEventArrival = false;
+
+		for (int i = 0; i < schedulerCount; ++i) {
+			if (schedulers[i] == nullptr)
+				continue;
+
+			float schedulerLow, schedulerHigh;
+			schedulers[i]->ExpirePulses(now);
+			schedulers[i]->EvaluateBands(now, &schedulerLow, &schedulerHigh);
+
+			lowValue = fmaxf(lowValue, schedulerLow);
+			highValue = fmaxf(highValue, schedulerHigh);
+
+			// Always taken, so events that end up changing nothing don't linger until a later change
+			std::chrono::time_point<std::chrono::high_resolution_clock> arrivalTime;
+			if (schedulers[i]->TakePendingEventArrival(&arrivalTime) &&
+				(!out_output->bHasEventArrival || arrivalTime < out_output->eventArrivalTime)) {
+				out_output->bHasEventArrival = true;
+				out_output->eventArrivalTime = arrivalTime;
+			}
+		}
+
+		const int lowLevel = HapticScheduler::QuantizeLevel(lowValue);
+		const int highLevel = HapticScheduler::QuantizeLevel(highValue);
+
+		out_output->lowFrequencyValue = static_cast<float>(lowLevel) / k_nOutputLevels;
+		out_output->highFrequencyValue = static_cast<float>(highLevel) / k_nOutputLevels;
+		out_output->bLowFrequencyChanged = lowLevel != m_lastLowFrequencyLevel;
+		out_output->bHighFrequencyChanged = highLevel != m_lastHighFrequencyLevel;
+		if (!out_output->bLowFrequencyChanged && !out_output->bHighFrequencyChanged) {
+			out_output->bHasEventArrival = false;
+		}
+
+		m_lastLowFrequencyLevel = lowLevel;
+		m_lastHighFrequencyLevel = highLevel;
+
+		return out_output->bLowFrequencyChanged || out_output->bHighFrequencyChanged;
+	}
+}
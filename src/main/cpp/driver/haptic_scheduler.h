@@ -0,0 +1,105 @@
+#pragma once
+#include <openvr_driver.h>
+#include <chrono>
+
+namespace steamvrbridge {
+
+	/* Turns the haptic vibration events of one haptic component into a rumble motor value over time.
+	Each event becomes a pulse on a timeline from its arrival until its duration has elapsed, and
+	overlapping pulses combine by taking the strongest. Pulses with a frequency slow enough to be
+	rendered at the frame rate are pulse-width modulated at that frequency; faster ones play as a
+	steady rumble. Update() only reports a value when the quantized motor output changes, so the
+	caller sends a rumble command on the frames where it starts, pulses or stops and never in between.*/
+	class HapticScheduler {
+	public:
+		HapticScheduler();
+
+		// Adds a vibration event to the timeline. A zero duration or amplitude stops all pulses.
+		void Queue(
+			const vr::VREvent_HapticVibration_t &hapticData,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		// Drops all pending pulses; the next Update() turns the motor off if it was on.
+		void Clear();
+
+		// Returns true with the motor value (0 to 1) in out_rumble_fraction when it differs from the
+		// last value returned. Events that didn't change the value are no longer pending afterwards.
+		bool Update(const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float *out_rumble_fraction);
+
+		// Takes the arrival time of the oldest event queued since the motor value last changed, for
+		// measuring how long it took that event to reach the motor. Returns false when there is none.
+		bool TakePendingEventArrival(std::chrono::time_point<std::chrono::high_resolution_clock> *out_arrival_time);
+
+		// Motor value of the pulses active at the given time, without expiring or reporting anything.
+		float Evaluate(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) const;
+
+		// Same as Evaluate() but split between a low and a high frequency motor by each pulse's frequency.
+		// Pulses without a frequency drive both motors.
+		void EvaluateBands(
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+			float *out_low_frequency_value,
+			float *out_high_frequency_value) const;
+
+		// Drops the pulses that have ended. Update() does this itself.
+		void ExpirePulses(const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		inline bool HasActivePulses() const { return m_nPulseCount > 0; }
+
+		// Motor value rounded to the byte PSM sends, as a level from 0 to 255
+		static int QuantizeLevel(float value);
+
+	private:
+		struct Pulse {
+			std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
+			std::chrono::time_point<std::chrono::high_resolution_clock> endTime;
+			float strength;
+			float frequency;
+		};
+
+		static const int k_nMaxPulses = 8;
+
+		// Value of a pulse at the given time, zero outside of it and in the off half of a modulation period
+		static float EvaluatePulse(const Pulse &pulse, const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		Pulse m_pulses[k_nMaxPulses];
+		int m_nPulseCount;
+
+		// Last motor value handed out by Update(), in 1/255 steps
+		int m_lastOutputLevel;
+
+		// Oldest event that hasn't been reflected in a motor value change yet
+		bool m_bHasPendingEvent;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_pendingEventArrivalTime;
+	};
+
+	/* Drives a controller with a heavy low frequency motor and a light high frequency one (the DS4)
+	from the haptic schedulers of all of its haptic components. Every pulse is routed to the motors by
+	its frequency, overlapping pulses combine per motor, and a motor is only reported when its output
+	changes. When both change to the same value they can be sent as one command for both channels.*/
+	class DualMotorHapticMixer {
+	public:
+		struct Output {
+			float lowFrequencyValue;
+			float highFrequencyValue;
+			bool bLowFrequencyChanged;
+			bool bHighFrequencyChanged;
+
+			// Arrival time of the oldest haptic event behind the change, if it was caused by one
+			bool bHasEventArrival;
+			std::chrono::time_point<std::chrono::high_resolution_clock> eventArrivalTime;
+		};
+
+		DualMotorHapticMixer();
+
+		// Returns true when either motor changed since the last call, with both values in out_output.
+		bool Update(
+			HapticScheduler *const *schedulers,
+			int schedulerCount,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+			Output *out_output);
+
+	private:
+		int m_lastLowFrequencyLevel;
+		int m_lastHighFrequencyLevel;
+	};
+}
@@ -0,0 +1,162 @@
+#include "hmd_alignment.h"
+#include "constants.h"
+#include "psm_math.h"
+#include "utils.h"
+#include <math.h>
+
+namespace steamvrbridge {
+
+	// Horizontal RMS spread the controller positions need before their layout says anything about yaw
+	static const float k_fMinSpreadForRotationFitMeters = 0.05f;
+
+	// Samples taken right after the chord still see the orientation from before the reset
+	static const float k_fAlignmentSettleSecs = 0.1f;
+
+	//-- HMDAlignmentSolver -----
+	bool HMDAlignmentSolver::Solve(
+		const HMDAlignmentSample *samples,
+		int sampleCount,
+		const HMDAlignmentParams &params,
+		HMDAlignmentResult *out_result) {
+		if (sampleCount <= 0)
+			return false;
+
+		// Controller positions in driver space (p) and where they should be in world space (q)
+		PSMVector3f driverCentroid = { 0.f, 0.f, 0.f };
+		PSMVector3f worldCentroid = { 0.f, 0.f, 0.f };
+		for (int i = 0; i < sampleCount; ++i) {
+			const PSMVector3f p = PSMMath::Vector3fScale(samples[i].controllerPose.Position, k_fScalePSMoveAPIToMeters);
+			const PSMVector3f q = Utils::GetExpectedControllerWorldPose(
+				params.controllerOrientationInHmdSpace, params.controllerLocalOffsetFromHmdPosition, samples[i].hmdPoseMeters).Position;
+
+			driverCentroid = PSMMath::Vector3fAdd(driverCentroid, p);
+			worldCentroid = PSMMath::Vector3fAdd(worldCentroid, q);
+		}
+		driverCentroid = PSMMath::Vector3fScale(driverCentroid, 1.f / sampleCount);
+		worldCentroid = PSMMath::Vector3fScale(worldCentroid, 1.f / sampleCount);
+
+		// Accumulate the yaw-only cross covariance and the horizontal spread of the driver positions
+		float sumDot = 0.f;
+		float sumCross = 0.f;
+		float sumSpreadSqr = 0.f;
+		for (int i = 0; i < sampleCount; ++i) {
+			const PSMVector3f p = PSMMath::Vector3fScale(samples[i].controllerPose.Position, k_fScalePSMoveAPIToMeters);
+			const PSMVector3f q = Utils::GetExpectedControllerWorldPose(
+				params.controllerOrientationInHmdSpace, params.controllerLocalOffsetFromHmdPosition, samples[i].hmdPoseMeters).Position;
+
+			const float px = p.x - driverCentroid.x, pz = p.z - driverCentroid.z;
+			const float qx = q.x - worldCentroid.x, qz = q.z - worldCentroid.z;
+
+			sumDot += qx*px + qz*pz;
+			sumCross += qx*pz - qz*px;
+			sumSpreadSqr += px*px + pz*pz;
+		}
+
+		PSMQuatf rotation;
+		const float spread = sqrtf(sumSpreadSqr / sampleCount);
+		out_result->bRotationFromPositions = sampleCount >= 3 && spread >= k_fMinSpreadForRotationFitMeters;
+
+		if (out_result->bRotationFromPositions) {
+			// The yaw maximizing sum(q . R*p) for a rotation about +Y
+			const float halfYaw = 0.5f * atan2f(sumCross, sumDot);
+
+			rotation = PSMMath::QuatfCreate(cosf(halfYaw), 0.f, sinf(halfYaw), 0.f);
+		} else {
+			// Held still: average the rotation of the one-shot alignment of every sample
+			PSMQuatf sum = { 0.f, 0.f, 0.f, 0.f };
+			PSMQuatf reference = *k_psm_quaternion_identity;
+			for (int i = 0; i < sampleCount; ++i) {
+				PSMQuatf q = Utils::ComputeWorldFromDriverPose(
+					params.controllerOrientationInHmdSpace,
+					params.controllerLocalOffsetFromHmdPosition,
+					samples[i].controllerPose,
+					samples[i].hmdPoseMeters,
+					params.useControllerOrientation).Orientation;
+
+				if (i == 0)
+					reference = q;
+
+				// q and -q are the same rotation, keep them all in the same hemisphere
+				const float sign = (q.w*reference.w + q.x*reference.x + q.y*reference.y + q.z*reference.z) < 0.f ? -1.f : 1.f;
+				sum.w += sign*q.w;
+				sum.x += sign*q.x;
+				sum.y += sign*q.y;
+				sum.z += sign*q.z;
+			}
+
+			rotation = PSMMath::QuatfNormalizeWithDefault(sum, *k_psm_quaternion_identity);
+		}
+
+		// With the rotation fixed, the least-squares translation maps one centroid onto the other
+		const PSMVector3f rotatedDriverCentroid = PSMMath::QuatfRotateVector(rotation, driverCentroid);
+		const PSMVector3f translation = PSMMath::Vector3fSubtract(worldCentroid, rotatedDriverCentroid);
+
+		float sumErrorSqr = 0.f;
+		for (int i = 0; i < sampleCount; ++i) {
+			const PSMVector3f p = PSMMath::Vector3fScale(samples[i].controllerPose.Position, k_fScalePSMoveAPIToMeters);
+			const PSMVector3f q = Utils::GetExpectedControllerWorldPose(
+				params.controllerOrientationInHmdSpace, params.controllerLocalOffsetFromHmdPosition, samples[i].hmdPoseMeters).Position;
+
+			const PSMVector3f rotated = PSMMath::QuatfRotateVector(rotation, p);
+			const PSMVector3f fitted = PSMMath::Vector3fAdd(rotated, translation);
+			const float error = Utils::psmVector3fDistance(fitted, q);
+
+			sumErrorSqr += error*error;
+		}
+
+		out_result->worldFromDriverPose = PSMMath::PosefCreate(translation, rotation);
+		out_result->rmsErrorMeters = sqrtf(sumErrorSqr / sampleCount);
+		out_result->sampleCount = sampleCount;
+
+		return true;
+	}
+
+	//-- HMDAlignmentCollector -----
+	HMDAlignmentCollector::HMDAlignmentCollector()
+		: m_bIsCollecting(false)
+		, m_nTargetSampleCount(0)
+		, m_fMaxDurationSecs(0.f)
+		, m_nSampleCount(0) {
+	}
+
+	void HMDAlignmentCollector::Begin(
+		const HMDAlignmentParams &params,
+		int targetSampleCount,
+		float maxDurationSecs,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		m_bIsCollecting = true;
+		m_params = params;
+		m_nTargetSampleCount = targetSampleCount < k_nMaxSamples ? targetSampleCount : k_nMaxSamples;
+		m_fMaxDurationSecs = maxDurationSecs;
+		m_startTime = now;
+		m_nSampleCount = 0;
+	}
+
+	void HMDAlignmentCollector::Cancel() {
+		m_bIsCollecting = false;
+		m_nSampleCount = 0;
+	}
+
+	bool HMDAlignmentCollector::AddSample(
+		const HMDAlignmentSample &sample,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		if (!m_bIsCollecting)
+			return false;
+
+		const float elapsedSecs = std::chrono::duration<float>(now - m_startTime).count();
+		if (elapsedSecs >= k_fAlignmentSettleSecs && m_nSampleCount < m_nTargetSampleCount) {
+			m_samples[m_nSampleCount++] = sample;
+		}
+
+		if (m_nSampleCount >= m_nTargetSampleCount || HasTimedOut(now)) {
+			m_bIsCollecting = false;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool HMDAlignmentCollector::HasTimedOut(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) const {
+		return std::chrono::duration<float>(now - m_startTime).count() >= k_fAlignmentSettleSecs + m_fMaxDurationSecs;
+	}
+}
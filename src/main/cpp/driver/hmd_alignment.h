@@ -0,0 +1,88 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+
+namespace steamvrbridge {
+
+	// One synchronized pair of HMD and controller poses taken while the controller is held against the HMD
+	struct HMDAlignmentSample {
+		// HMD pose in OpenVR tracking space, in meters
+		PSMPosef hmdPoseMeters;
+
+		// Raw controller pose in PSM tracking space, in PSM units (cm)
+		PSMPosef controllerPose;
+	};
+
+	// How the controller is held relative to the HMD during the alignment
+	struct HMDAlignmentParams {
+		PSMQuatf controllerOrientationInHmdSpace;
+		PSMVector3f controllerLocalOffsetFromHmdPosition;
+		bool useControllerOrientation;
+	};
+
+	struct HMDAlignmentResult {
+		PSMPosef worldFromDriverPose;
+
+		// RMS distance in meters between the expected controller positions and the fitted ones
+		float rmsErrorMeters;
+		int sampleCount;
+
+		// True when the rotation was fitted from the spread of the positions rather than averaged from
+		// the per-sample controller orientations
+		bool bRotationFromPositions;
+	};
+
+	/* Least-squares fit of the world-from-driver transform over several alignment samples. Both tracking
+	spaces are gravity aligned so the rotation between them is a yaw about +Y; with enough horizontal
+	spread in the samples that yaw is fitted from the positions (a Kabsch fit restricted to the XZ
+	plane), otherwise it is the average of the one-shot alignment of every sample. The translation is
+	then the least-squares fit for that rotation.*/
+	class HMDAlignmentSolver {
+	public:
+		static bool Solve(
+			const HMDAlignmentSample *samples,
+			int sampleCount,
+			const HMDAlignmentParams &params,
+			HMDAlignmentResult *out_result);
+	};
+
+	/* Gathers alignment samples over a short window, one per new controller sample.*/
+	class HMDAlignmentCollector {
+	public:
+		static const int k_nMaxSamples = 120;
+
+		HMDAlignmentCollector();
+
+		void Begin(
+			const HMDAlignmentParams &params,
+			int targetSampleCount,
+			float maxDurationSecs,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+		void Cancel();
+
+		inline bool IsCollecting() const { return m_bIsCollecting; }
+
+		// Adds a sample if collecting and the settle time has passed. Returns true once collection is
+		// finished, either because enough samples were taken or because the window ran out.
+		bool AddSample(
+			const HMDAlignmentSample &sample,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		// Returns true once the window ran out, even if no sample could be taken.
+		bool HasTimedOut(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) const;
+
+		inline const HMDAlignmentSample *GetSamples() const { return m_samples; }
+		inline int GetSampleCount() const { return m_nSampleCount; }
+		inline const HMDAlignmentParams &GetParams() const { return m_params; }
+
+	private:
+		bool m_bIsCollecting;
+		HMDAlignmentParams m_params;
+		int m_nTargetSampleCount;
+		float m_fMaxDurationSecs;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_startTime;
+
+		HMDAlignmentSample m_samples[k_nMaxSamples];
+		int m_nSampleCount;
+	};
+}
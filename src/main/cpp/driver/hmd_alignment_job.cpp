@@ -0,0 +1,161 @@
+#include "hmd_alignment_job.h"
+#include "frame_profiler.h"
+#include "logger.h"
+#include "trace_log.h"
+#include "utils.h"
+#include <string.h>
+
+namespace steamvrbridge {
+
+	HMDAlignmentJobQueue::HMDAlignmentJobQueue()
+		: m_bExitSignaled({ false })
+		, m_pWorkerThread(nullptr)
+		, m_bHasSolveJob(false)
+		, m_nSolveSampleCount(0)
+		, m_bHasSaveJob(false)
+		, m_bHasResult(false) {
+	}
+
+	HMDAlignmentJobQueue::~HMDAlignmentJobQueue() {
+		Stop();
+	}
+
+	void HMDAlignmentJobQueue::Start() {
+		if (m_pWorkerThread != nullptr)
+			return;
+
+		m_bExitSignaled = false;
+		m_pWorkerThread = new std::thread(&HMDAlignmentJobQueue::WorkerThreadFunction, this);
+	}
+
+	void HMDAlignmentJobQueue::Stop() {
+		if (m_pWorkerThread == nullptr)
+			return;
+
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_bExitSignaled = true;
+		}
+		m_wakeCondition.notify_one();
+
+		m_pWorkerThread->join();
+		delete m_pWorkerThread;
+		m_pWorkerThread = nullptr;
+	}
+
+	void HMDAlignmentJobQueue::SubmitSolve(
+		const char *requester,
+		const HMDAlignmentSample *samples,
+		int sampleCount,
+		const HMDAlignmentParams &params) {
+		if (sampleCount > HMDAlignmentCollector::k_nMaxSamples)
+			sampleCount = HMDAlignmentCollector::k_nMaxSamples;
+
+		if (m_pWorkerThread == nullptr) {
+			RunSolve(requester, samples, sampleCount, params);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_bHasSolveJob = true;
+			m_solveRequester = requester;
+			memcpy(m_solveSamples, samples, sampleCount * sizeof(HMDAlignmentSample));
+			m_nSolveSampleCount = sampleCount;
+			m_solveParams = params;
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	void HMDAlignmentJobQueue::SubmitSave(const ServerDriverConfig &config) {
+		if (m_pWorkerThread == nullptr) {
+			ServerDriverConfig snapshot = config;
+			snapshot.save();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_bHasSaveJob = true;
+			m_saveConfig = config;
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	bool HMDAlignmentJobQueue::TryTakeResult(HMDAlignmentResult *out_result) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		if (!m_bHasResult)
+			return false;
+
+		*out_result = m_result;
+		m_bHasResult = false;
+		return true;
+	}
+
+	void HMDAlignmentJobQueue::WorkerThreadFunction() {
+		FrameProfiler::SetThreadName("HMDAlignmentJobQueue");
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (true) {
+			m_wakeCondition.wait(lock, [this] { return m_bExitSignaled || m_bHasSolveJob || m_bHasSaveJob; });
+
+			if (m_bHasSolveJob) {
+				const std::string requester = m_solveRequester;
+				const int sampleCount = m_nSolveSampleCount;
+				const HMDAlignmentParams params = m_solveParams;
+				memcpy(m_workerSamples, m_solveSamples, sampleCount * sizeof(HMDAlignmentSample));
+				m_bHasSolveJob = false;
+
+				lock.unlock();
+				{
+					ScopedProfileSpan span("HMD Alignment Solve");
+					RunSolve(requester, m_workerSamples, sampleCount, params);
+				}
+				lock.lock();
+			} else if (m_bHasSaveJob) {
+				ServerDriverConfig snapshot = m_saveConfig;
+				m_bHasSaveJob = false;
+
+				lock.unlock();
+				{
+					ScopedProfileSpan span("Config Save");
+					snapshot.save();
+				}
+				lock.lock();
+			} else if (m_bExitSignaled) {
+				break;
+			}
+		}
+	}
+
+	void HMDAlignmentJobQueue::RunSolve(
+		const std::string &requester,
+		const HMDAlignmentSample *samples,
+		int sampleCount,
+		const HMDAlignmentParams &params) {
+		HMDAlignmentResult result;
+		if (!HMDAlignmentSolver::Solve(samples, sampleCount, params, &result)) {
+			Logger::Error("HMDAlignmentJobQueue::RunSolve - %s got no usable samples, alignment unchanged\n", requester.c_str());
+			return;
+		}
+
+		Logger::Info("HMDAlignmentJobQueue::RunSolve - %s aligned from %d samples (%s), RMS error %.1fmm\n",
+			requester.c_str(), result.sampleCount,
+			result.bRotationFromPositions ? "rotation fitted" : "rotation averaged",
+			result.rmsErrorMeters * 1000.f);
+		Logger::Info("  hmd_pose_meters: %s \n", Utils::PSMPosefToString(samples[sampleCount - 1].hmdPoseMeters).c_str());
+		Logger::Info("  controller_pose_raw: %s \n", Utils::PSMPosefToString(samples[sampleCount - 1].controllerPose).c_str());
+		Logger::Info("  driver_pose_to_world_pose: %s \n", Utils::PSMPosefToString(result.worldFromDriverPose).c_str());
+
+		static TraceFormat s_solveTrace("HMDAlignment - hmd {} controller {} -> world_from_driver {}, rms error {}m over {} samples");
+		TraceLog::Record(s_solveTrace,
+			samples[sampleCount - 1].hmdPoseMeters, samples[sampleCount - 1].controllerPose,
+			result.worldFromDriverPose, result.rmsErrorMeters, result.sampleCount);
+
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_result = result;
+		m_bHasResult = true;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "hmd_alignment.h"
+#include "settings_util.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace steamvrbridge {
+
+	/* Runs the HMD alignment solve and the config save on a worker thread, so the frame that finishes an
+	alignment doesn't stall on the fit, its logging or the disk write. The frame only copies the samples
+	in; the solved transform is picked up by RunFrame on a later frame and applied in one step. Without
+	a running worker thread every job runs inline on the submitting thread.*/
+	class HMDAlignmentJobQueue {
+	public:
+		HMDAlignmentJobQueue();
+		~HMDAlignmentJobQueue();
+
+		void Start();
+
+		// Finishes any queued jobs, so a pending config save still reaches the disk, then stops the thread.
+		void Stop();
+
+		// Queues a solve of the given samples. A newer solve replaces one that hasn't started yet.
+		void SubmitSolve(
+			const char *requester,
+			const HMDAlignmentSample *samples,
+			int sampleCount,
+			const HMDAlignmentParams &params);
+
+		// Queues writing a snapshot of the config to disk. A newer snapshot replaces an unsaved one.
+		void SubmitSave(const ServerDriverConfig &config);
+
+		// Takes the result of the newest finished solve. Returns false when there is none.
+		bool TryTakeResult(HMDAlignmentResult *out_result);
+
+	private:
+		void WorkerThreadFunction();
+		void RunSolve(const std::string &requester, const HMDAlignmentSample *samples, int sampleCount, const HMDAlignmentParams &params);
+
+		std::mutex m_mutex;
+		std::condition_variable m_wakeCondition;
+		std::atomic_bool m_bExitSignaled;
+		std::thread *m_pWorkerThread;
+
+		// Queued solve, guarded by m_mutex
+		bool m_bHasSolveJob;
+		std::string m_solveRequester;
+		HMDAlignmentSample m_solveSamples[HMDAlignmentCollector::k_nMaxSamples];
+		int m_nSolveSampleCount;
+		HMDAlignmentParams m_solveParams;
+
+		// Queued save, guarded by m_mutex
+		bool m_bHasSaveJob;
+		ServerDriverConfig m_saveConfig;
+
+		// Finished solve waiting to be applied, guarded by m_mutex
+		bool m_bHasResult;
+		HMDAlignmentResult m_result;
+
+		// Only touched by the worker thread
+		HMDAlignmentSample m_workerSamples[HMDAlignmentCollector::k_nMaxSamples];
+	};
+}
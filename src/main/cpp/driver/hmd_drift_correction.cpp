@@ -0,0 +1,260 @@
+#include "hmd_drift_correction.h"
+#include "constants.h"
+#include "hmd_pose_cache.h"
+#include "logger.h"
+#include "psm_command_queue.h"
+#include "psm_math.h"
+#include "settings_util.h"
+#include "trace_log.h"
+#include "utils.h"
+#include <math.h>
+#include <string.h>
+
+namespace steamvrbridge {
+
+	// Controller samples averaged to find where it sits on the HMD
+	static const int k_nLeverArmSampleCount = 60;
+
+	// Pairs taken while the head moves quickly are skewed by the latency difference of the two trackers
+	static const float k_fMaxSampleSpeedMetersPerSec = 0.3f;
+
+	// Gaps longer than this restart the speed estimate instead of weighting a stale pair
+	static const float k_fMaxSampleGapSecs = 0.1f;
+
+	// Fraction of the full moment weight (about 2.3 time constants) needed before fitting
+	static const float k_fMinFitWeight = 0.9f;
+
+	// Horizontal RMS spread the controller needs to have covered before its layout says anything about yaw
+	static const float k_fMinSpreadForYawFitMeters = 0.05f;
+
+	HMDDriftCorrector::HMDDriftCorrector(PSMCommandQueue &commands)
+		: m_commands(commands)
+		, m_controller(nullptr)
+		, m_lastSequenceNum(-1)
+		, m_bHasLastDriverPosition(false)
+		, m_referenceWorldFromDriverPose(*k_psm_pose_identity)
+		, m_nAppliedCorrectionCount(0) {
+		ResetLeverArm();
+	}
+
+	HMDDriftCorrector::~HMDDriftCorrector() {
+		Detach();
+	}
+
+	void HMDDriftCorrector::Attach(PSMControllerID controllerId, const std::string &serial) {
+		if (m_controller != nullptr) {
+			if (m_controller->ControllerID == controllerId)
+				return;
+
+			Detach();
+		}
+
+		Logger::Info("HMDDriftCorrector::Attach - Using controller id: %d, serial: %s for drift correction\n", controllerId, serial.c_str());
+
+		PSM_AllocateControllerListener(controllerId);
+		m_controller = PSM_GetController(controllerId);
+		m_serial = serial;
+
+		m_commands.StartControllerDataStream(controllerId, PSMStreamFlags_includePositionData, nullptr, nullptr);
+
+		m_lastSequenceNum = -1;
+		m_bHasLastDriverPosition = false;
+		ResetLeverArm();
+	}
+
+	void HMDDriftCorrector::Detach() {
+		if (m_controller == nullptr)
+			return;
+
+		Logger::Info("HMDDriftCorrector::Detach - Stopped drift correction with controller serial: %s (%d corrections applied)\n",
+			m_serial.c_str(), m_nAppliedCorrectionCount);
+
+		m_commands.StopControllerDataStream(m_controller->ControllerID);
+		PSM_FreeControllerListener(m_controller->ControllerID);
+		m_controller = nullptr;
+	}
+
+	bool HMDDriftCorrector::Update(
+		const ServerDriverConfig &config,
+		HMDPoseCache &hmdPoseCache,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		PSMPosef *out_world_from_driver_pose) {
+		if (!config.continuous_hmd_alignment || !config.has_calibrated_world_from_driver_pose)
+			return false;
+
+		if (m_controller == nullptr || !m_controller->IsConnected)
+			return false;
+
+		// A manual realignment moved the reference, whatever was learned against the old one is stale
+		if (memcmp(&m_referenceWorldFromDriverPose, &config.world_from_driver_pose, sizeof(PSMPosef)) != 0) {
+			m_referenceWorldFromDriverPose = config.world_from_driver_pose;
+			ResetLeverArm();
+		}
+
+		if (m_controller->OutputSequenceNum == m_lastSequenceNum)
+			return false;
+		m_lastSequenceNum = m_controller->OutputSequenceNum;
+
+		bool bIsTracking = false;
+		switch (m_controller->ControllerType) {
+			case PSMController_Move:
+				bIsTracking = m_controller->ControllerState.PSMoveState.bIsCurrentlyTracking &&
+					m_controller->ControllerState.PSMoveState.bIsPositionValid;
+				break;
+			case PSMController_DualShock4:
+				bIsTracking = m_controller->ControllerState.PSDS4State.bIsCurrentlyTracking &&
+					m_controller->ControllerState.PSDS4State.bIsPositionValid;
+				break;
+			case PSMController_Virtual:
+				bIsTracking = m_controller->ControllerState.VirtualController.bIsCurrentlyTracking &&
+					m_controller->ControllerState.VirtualController.bIsPositionValid;
+				break;
+			default:
+				break;
+		}
+
+		if (!bIsTracking) {
+			m_bHasLastDriverPosition = false;
+			return false;
+		}
+
+		PSMPosef hmdPose;
+		if (!hmdPoseCache.GetHMDPose(&hmdPose))
+			return false;
+
+		PSMPosef controllerPoseRaw;
+		if (PSM_GetControllerPose(m_controller->ControllerID, &controllerPoseRaw) != PSMResult_Success)
+			return false;
+
+		// Controller position in world space according to the current calibration
+		const PSMVector3f driverPositionMeters = PSMMath::Vector3fScale(controllerPoseRaw.Position, k_fScalePSMoveAPIToMeters);
+		const PSMVector3f p = PSMMath::PosefTransformPoint(m_referenceWorldFromDriverPose, driverPositionMeters);
+
+		const float dt = std::chrono::duration<float>(now - m_lastSampleTime).count();
+		const bool bHadLastDriverPosition = m_bHasLastDriverPosition;
+		const PSMVector3f lastDriverPosition = m_lastDriverPosition;
+
+		m_lastDriverPosition = p;
+		m_bHasLastDriverPosition = true;
+		m_lastSampleTime = now;
+
+		if (!bHadLastDriverPosition || dt <= 0.f || dt > k_fMaxSampleGapSecs)
+			return false;
+
+		if (Utils::psmVector3fDistance(p, lastDriverPosition) / dt > k_fMaxSampleSpeedMetersPerSec)
+			return false;
+
+		if (m_nLeverArmSampleCount < k_nLeverArmSampleCount) {
+			const PSMVector3f local = PSMMath::PosefInverseTransformPoint(hmdPose, p);
+
+			m_leverArmSum = PSMMath::Vector3fAdd(m_leverArmSum, local);
+			++m_nLeverArmSampleCount;
+
+			if (m_nLeverArmSampleCount == k_nLeverArmSampleCount) {
+				m_leverArm = PSMMath::Vector3fScale(m_leverArmSum, 1.f / k_nLeverArmSampleCount);
+
+				Logger::Info("HMDDriftCorrector::Update - Learned controller offset from HMD: (%f, %f, %f)m\n",
+					m_leverArm.x, m_leverArm.y, m_leverArm.z);
+			}
+
+			return false;
+		}
+
+		// Where the controller should be if the two tracking spaces still agreed
+		const PSMVector3f q = PSMMath::PosefTransformPoint(hmdPose, m_leverArm);
+
+		const float timeConstant = config.drift_correction_time_constant_seconds > 0.f ? config.drift_correction_time_constant_seconds : 1.f;
+		AccumulateMoments(p, q, 1.f - expf(-dt / timeConstant));
+
+		if (m_moments.weight < k_fMinFitWeight)
+			return false;
+
+		if (std::chrono::duration<float>(now - m_lastCorrectionTime).count() < config.drift_correction_min_interval_seconds)
+			return false;
+
+		// Normalize the moments and center them on the means, still relative to the moment origin
+		const float invWeight = 1.f / m_moments.weight;
+		const PSMVector3f pm = PSMMath::Vector3fScale(m_moments.meanDriver, invWeight);
+		const PSMVector3f qm = PSMMath::Vector3fScale(m_moments.meanExpected, invWeight);
+
+		const float dotXZ = m_moments.dotXZ*invWeight - (qm.x*pm.x + qm.z*pm.z);
+		const float crossXZ = m_moments.crossXZ*invWeight - (qm.x*pm.z - qm.z*pm.x);
+		const float dotY = m_moments.dotY*invWeight - qm.y*pm.y;
+		const float varianceP = m_moments.driverLengthSqr*invWeight - PSMMath::Vector3fDot(pm, pm);
+		const float varianceQ = m_moments.expectedLengthSqr*invWeight - PSMMath::Vector3fDot(qm, qm);
+		const float varianceXZ = m_moments.driverLengthSqrXZ*invWeight - (pm.x*pm.x + pm.z*pm.z);
+
+		// Mean squared residual of the current calibration: E|p - q|^2
+		const float currentErrorSqr = m_moments.residualLengthSqr * invWeight;
+
+		// Mean squared residual after the best yaw + translation correction. For a yaw about +Y by angle a
+		// the centered cross term is dotY + cos(a)*dotXZ + sin(a)*crossXZ, maximized at atan2(crossXZ, dotXZ).
+		// Without enough horizontal spread the yaw is left alone and only the translation is corrected.
+		float yaw = 0.f;
+		float correctedErrorSqr = varianceP + varianceQ - 2.f*(dotY + dotXZ);
+		if (varianceXZ >= k_fMinSpreadForYawFitMeters*k_fMinSpreadForYawFitMeters) {
+			yaw = atan2f(crossXZ, dotXZ);
+			correctedErrorSqr = varianceP + varianceQ - 2.f*(dotY + sqrtf(dotXZ*dotXZ + crossXZ*crossXZ));
+		}
+
+		const float currentRms = sqrtf(fmaxf(currentErrorSqr, 0.f));
+		const float correctedRms = sqrtf(fmaxf(correctedErrorSqr, 0.f));
+		if (currentRms - correctedRms < config.drift_correction_min_improvement_meters)
+			return false;
+
+		const PSMQuatf rotation = PSMMath::QuatfCreate(cosf(0.5f*yaw), 0.f, sinf(0.5f*yaw), 0.f);
+		const PSMVector3f rotatedMean = PSMMath::QuatfRotateVector(rotation, PSMMath::Vector3fAdd(pm, m_moments.origin));
+		const PSMVector3f translation = PSMMath::Vector3fSubtract(PSMMath::Vector3fAdd(qm, m_moments.origin), rotatedMean);
+		const PSMPosef correction = PSMMath::PosefCreate(translation, rotation);
+
+		*out_world_from_driver_pose = PSMMath::PosefConcat(m_referenceWorldFromDriverPose, correction);
+
+		Logger::Info("HMDDriftCorrector::Update - Correcting drift of %.1fmm / %.2fdeg (RMS error %.1fmm -> %.1fmm)\n",
+			PSMMath::Vector3fLength(translation) * 1000.f, yaw * k_fRadiansToDegrees, currentRms * 1000.f, correctedRms * 1000.f);
+
+		static TraceFormat s_correctionTrace("HMDDriftCorrector - translation {}m yaw {}rad, rms error {}m -> {}m");
+		TraceLog::Record(s_correctionTrace, translation, yaw, currentRms, correctedRms);
+
+		// The moments were measured in the old calibration; the lever arm stays as it was learned
+		m_referenceWorldFromDriverPose = *out_world_from_driver_pose;
+		m_bHasLastDriverPosition = false;
+		m_lastCorrectionTime = now;
+		ResetMoments();
+		++m_nAppliedCorrectionCount;
+
+		return true;
+	}
+
+	void HMDDriftCorrector::ResetMoments() {
+		memset(&m_moments, 0, sizeof(Moments));
+	}
+
+	void HMDDriftCorrector::ResetLeverArm() {
+		m_leverArmSum = { 0.f, 0.f, 0.f };
+		m_leverArm = { 0.f, 0.f, 0.f };
+		m_nLeverArmSampleCount = 0;
+		ResetMoments();
+	}
+
+	void HMDDriftCorrector::AccumulateMoments(const PSMVector3f &worldP, const PSMVector3f &worldQ, float gain) {
+		if (m_moments.weight == 0.f) {
+			m_moments.origin = worldQ;
+		}
+
+		const PSMVector3f p = PSMMath::Vector3fSubtract(worldP, m_moments.origin);
+		const PSMVector3f q = PSMMath::Vector3fSubtract(worldQ, m_moments.origin);
+		const PSMVector3f r = PSMMath::Vector3fSubtract(p, q);
+		const float keep = 1.f - gain;
+
+		m_moments.weight = keep*m_moments.weight + gain;
+		m_moments.meanDriver = { keep*m_moments.meanDriver.x + gain*p.x, keep*m_moments.meanDriver.y + gain*p.y, keep*m_moments.meanDriver.z + gain*p.z };
+		m_moments.meanExpected = { keep*m_moments.meanExpected.x + gain*q.x, keep*m_moments.meanExpected.y + gain*q.y, keep*m_moments.meanExpected.z + gain*q.z };
+		m_moments.driverLengthSqr = keep*m_moments.driverLengthSqr + gain*(p.x*p.x + p.y*p.y + p.z*p.z);
+		m_moments.driverLengthSqrXZ = keep*m_moments.driverLengthSqrXZ + gain*(p.x*p.x + p.z*p.z);
+		m_moments.expectedLengthSqr = keep*m_moments.expectedLengthSqr + gain*(q.x*q.x + q.y*q.y + q.z*q.z);
+		m_moments.dotXZ = keep*m_moments.dotXZ + gain*(q.x*p.x + q.z*p.z);
+		m_moments.crossXZ = keep*m_moments.crossXZ + gain*(q.x*p.z - q.z*p.x);
+		m_moments.dotY = keep*m_moments.dotY + gain*q.y*p.y;
+		m_moments.residualLengthSqr = keep*m_moments.residualLengthSqr + gain*PSMMath::Vector3fDot(r, r);
+	}
+}
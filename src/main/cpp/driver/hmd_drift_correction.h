@@ -0,0 +1,85 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+#include <string>
+
+namespace steamvrbridge {
+
+	class ServerDriverConfig;
+	class HMDPoseCache;
+	class PSMCommandQueue;
+
+	/* Keeps the world-from-driver transform aligned during long sessions using the PSM controller that is
+	mounted on the HMD (filter_virtual_hmd_serial). When the corrector first sees both poses it learns
+	where the controller sits relative to the HMD under the current calibration. From then on every new
+	controller sample is paired with where that lever arm says it should be, and a yaw + translation
+	correction is fitted over exponentially weighted moments of those pairs. The correction is only
+	returned once it improves the residual by more than the configured threshold, so small noise never
+	causes the tracking space to jump or the config to be rewritten.*/
+	class HMDDriftCorrector {
+	public:
+		explicit HMDDriftCorrector(PSMCommandQueue &commands);
+		~HMDDriftCorrector();
+
+		// Starts streaming the HMD mounted controller. Safe to call again for the same controller.
+		void Attach(PSMControllerID controllerId, const std::string &serial);
+		void Detach();
+
+		inline bool IsAttached() const { return m_controller != nullptr; }
+
+		// Feeds the newest controller and HMD poses into the fit. Returns true with the corrected
+		// world-from-driver pose in out_world_from_driver_pose when it should be applied.
+		bool Update(
+			const ServerDriverConfig &config,
+			HMDPoseCache &hmdPoseCache,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+			PSMPosef *out_world_from_driver_pose);
+
+		inline int GetAppliedCorrectionCount() const { return m_nAppliedCorrectionCount; }
+
+	private:
+		// Exponentially weighted sums over the (controller in world space, expected position) pairs.
+		// They start from zero, so each one divided by weight gives the weighted mean. Positions are
+		// taken relative to the first expected position, keeping the float sums small next to the
+		// millimeter residuals they are compared against.
+		struct Moments {
+			float weight;
+			PSMVector3f origin;
+			PSMVector3f meanDriver;
+			PSMVector3f meanExpected;
+			float driverLengthSqr;
+			float driverLengthSqrXZ;
+			float expectedLengthSqr;
+			float dotXZ;
+			float crossXZ;
+			float dotY;
+			float residualLengthSqr;
+		};
+
+		void ResetMoments();
+		void ResetLeverArm();
+		void AccumulateMoments(const PSMVector3f &worldP, const PSMVector3f &worldQ, float gain);
+
+		// Where the stream start/stop requests go
+		PSMCommandQueue &m_commands;
+
+		PSMController *m_controller;
+		std::string m_serial;
+		int m_lastSequenceNum;
+		PSMVector3f m_lastDriverPosition;
+		bool m_bHasLastDriverPosition;
+
+		// Transform the lever arm and the moments were measured against
+		PSMPosef m_referenceWorldFromDriverPose;
+
+		// Controller position in the HMD's local frame, averaged over the first samples
+		PSMVector3f m_leverArmSum;
+		int m_nLeverArmSampleCount;
+		PSMVector3f m_leverArm;
+
+		Moments m_moments;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_lastSampleTime;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_lastCorrectionTime;
+		int m_nAppliedCorrectionCount;
+	};
+}
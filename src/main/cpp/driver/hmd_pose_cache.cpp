@@ -0,0 +1,69 @@
+#include "hmd_pose_cache.h"
+#include "logger.h"
+#include "utils.h"
+
+namespace steamvrbridge {
+
+	// Don't rescan all property containers every frame while there is no HMD
+	static const float k_fFailedScanRetrySecs = 1.f;
+
+	HMDPoseCache::HMDPoseCache()
+		: m_bHasDeviceIndex(false)
+		, m_hmdDeviceIndex(vr::k_unTrackedDeviceIndexInvalid)
+		, m_bHasFailedScan(false)
+		, m_bIsPoseFetched(false)
+		, m_bIsPoseValid(false)
+		, m_hmdPose(*k_psm_pose_identity) {
+	}
+
+	void HMDPoseCache::BeginFrame() {
+		m_bIsPoseFetched = false;
+	}
+
+	void HMDPoseCache::InvalidateDeviceIndex() {
+		m_bHasDeviceIndex = false;
+		m_hmdDeviceIndex = vr::k_unTrackedDeviceIndexInvalid;
+		m_bHasFailedScan = false;
+		m_bIsPoseFetched = false;
+	}
+
+	bool HMDPoseCache::GetHMDDeviceIndex(vr::TrackedDeviceIndex_t *out_hmd_device_index) {
+		if (!m_bHasDeviceIndex) {
+			const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+			if (m_bHasFailedScan &&
+				std::chrono::duration<float>(now - m_lastFailedScanTime).count() < k_fFailedScanRetrySecs)
+				return false;
+
+			if (Utils::GetHMDDeviceIndex(&m_hmdDeviceIndex)) {
+				Logger::Info("HMDPoseCache::GetHMDDeviceIndex - HMD Device Index= %u\n", m_hmdDeviceIndex);
+				m_bHasDeviceIndex = true;
+				m_bHasFailedScan = false;
+			} else {
+				m_bHasFailedScan = true;
+				m_lastFailedScanTime = now;
+				return false;
+			}
+		}
+
+		*out_hmd_device_index = m_hmdDeviceIndex;
+		return true;
+	}
+
+	bool HMDPoseCache::GetHMDPose(PSMPosef *out_hmd_pose_meters) {
+		if (!m_bIsPoseFetched) {
+			vr::TrackedDeviceIndex_t hmdDeviceIndex;
+
+			m_bIsPoseFetched = true;
+			m_bIsPoseValid =
+				GetHMDDeviceIndex(&hmdDeviceIndex) &&
+				Utils::GetTrackedDevicePose(hmdDeviceIndex, &m_hmdPose);
+		}
+
+		if (m_bIsPoseValid) {
+			*out_hmd_pose_meters = m_hmdPose;
+		}
+
+		return m_bIsPoseValid;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <openvr_driver.h>
+#include <chrono>
+
+namespace steamvrbridge {
+
+	/* Remembers which tracked device is the HMD and fetches its pose at most once per frame, so alignment,
+	drift correction and the hand solvers of the virtual controllers can all ask for it without each
+	scanning every property container or pulling every raw device pose. The device index is looked up
+	again whenever a device is added or removed; must only be used from the thread that runs the frame.*/
+	class HMDPoseCache {
+	public:
+		HMDPoseCache();
+
+		// Marks the cached pose stale. Called at the start of each RunFrame().
+		void BeginFrame();
+
+		// Forgets the HMD device index, e.g. when a device was added or removed.
+		void InvalidateDeviceIndex();
+
+		bool GetHMDDeviceIndex(vr::TrackedDeviceIndex_t *out_hmd_device_index);
+
+		// HMD pose in OpenVR tracking space, in meters
+		bool GetHMDPose(PSMPosef *out_hmd_pose_meters);
+
+	private:
+		bool m_bHasDeviceIndex;
+		vr::TrackedDeviceIndex_t m_hmdDeviceIndex;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_lastFailedScanTime;
+		bool m_bHasFailedScan;
+
+		bool m_bIsPoseFetched;
+		bool m_bIsPoseValid;
+		PSMPosef m_hmdPose;
+	};
+}
@@ -2,7 +2,16 @@
 #include "logger.h"
 
 #include <stdio.h>
-#include <stdarg.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if _MSC_VER
+#define strcasecmp(a, b) stricmp(a,b)
+#endif
 
 /** Provides printf-style line logging via the vr::IVRDriverLog interface provided by SteamVR
 * during initialization.  Client logging ends up in vrclient_appname.txt and server logging
@@ -14,10 +23,126 @@ namespace steamvrbridge {
 
 	static vr::IVRDriverLog * s_pLogFile = NULL;
 
-	#if !defined( WIN32)
-	#define vsnprintf_s vsnprintf
+	#ifdef _DEBUG
+	std::atomic<int> Logger::s_logLevel(LogLevel_Debug);
+	#else
+	std::atomic<int> Logger::s_logLevel(LogLevel_Info);
 	#endif
 
+	static const char *k_LogLevelNames[] = { "debug", "info", "warn", "error", "off" };
+	static const char *k_LogLevelPrefixes[] = { "DEBUG - ", "INFO - ", "WARN - ", "ERROR - ", "" };
+
+	// Length of a rate limit window
+	static const long long k_nLogRateLimitWindowMs = 1000;
+
+	// Longest line, level prefix included; longer ones are truncated
+	static const int k_nMaxLogLineLength = 1024;
+
+	// Lines the async ring buffer holds, a power of two
+	static const unsigned int k_nLogRingSize = 512;
+	static const unsigned int k_nLogRingMask = k_nLogRingSize - 1;
+
+	// How long the flush thread sleeps when it wasn't woken up by a new line
+	static const std::chrono::milliseconds k_logFlushIdleInterval(50);
+
+	// Bounded multi-producer queue (after Dmitry Vyukov): a slot is free for the producer whose position
+	// equals its sequence, and holds a line for the consumer when its sequence is one past that.
+	struct LogSlot {
+		std::atomic<unsigned int> sequence;
+		char text[k_nMaxLogLineLength];
+	};
+
+	static LogSlot s_logRing[k_nLogRingSize];
+	static std::atomic<unsigned int> s_nLogRingEnqueuePos(0);
+	static unsigned int s_nLogRingDequeuePos = 0; // only touched by the flush thread
+
+	static std::atomic<bool> s_bAsyncLogging(false);
+	static std::atomic<int> s_nActiveLogProducerCount(0); // threads between reading s_bAsyncLogging and committing their line
+	static std::atomic<bool> s_bFlushThreadExitSignaled(false);
+	static std::atomic<unsigned int> s_nDroppedMessageCount(0);
+	static std::thread *s_pFlushThread = nullptr;
+
+	// Only used to sleep on; producers notify without taking it
+	static std::mutex s_flushWakeMutex;
+	static std::condition_variable s_flushWakeCondition;
+
+	// Writes the level prefix and the formatted message into buffer, truncating at its end.
+	static void FormatLogLine(char *buffer, size_t bufferSize, const char *logLevel, const char *pMsgFormat, va_list args) {
+		int prefixLength = snprintf(buffer, bufferSize, "%s", logLevel);
+		if (prefixLength < 0)
+			prefixLength = 0;
+		else if ((size_t)prefixLength >= bufferSize)
+			return;
+
+		vsnprintf(buffer + prefixLength, bufferSize - prefixLength, pMsgFormat, args);
+	}
+
+	// Formats the line straight into a free ring slot. Returns false when the ring is full.
+	static bool EnqueueLogLine(const char *logLevel, const char *pMsgFormat, va_list args) {
+		unsigned int pos = s_nLogRingEnqueuePos.load(std::memory_order_relaxed);
+		LogSlot *slot;
+
+		for (;;) {
+			slot = &s_logRing[pos & k_nLogRingMask];
+			const int diff = (int)(slot->sequence.load(std::memory_order_acquire) - pos);
+
+			if (diff == 0) {
+				if (s_nLogRingEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = s_nLogRingEnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		FormatLogLine(slot->text, sizeof(slot->text), logLevel, pMsgFormat, args);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	static bool HasQueuedLogLine() {
+		const LogSlot &slot = s_logRing[s_nLogRingDequeuePos & k_nLogRingMask];
+		return slot.sequence.load(std::memory_order_acquire) == s_nLogRingDequeuePos + 1;
+	}
+
+	// Writes the oldest queued line to the driver log. Returns false when there is none.
+	static bool WriteNextLogLine() {
+		if (!HasQueuedLogLine())
+			return false;
+
+		LogSlot &slot = s_logRing[s_nLogRingDequeuePos & k_nLogRingMask];
+		if (s_pLogFile)
+			s_pLogFile->Log(slot.text);
+
+		slot.sequence.store(s_nLogRingDequeuePos + k_nLogRingSize, std::memory_order_release);
+		++s_nLogRingDequeuePos;
+		return true;
+	}
+
+	static void FlushThreadFunction() {
+		unsigned int reportedDropCount = s_nDroppedMessageCount.load();
+
+		for (;;) {
+			while (WriteNextLogLine()) {
+			}
+
+			const unsigned int dropCount = s_nDroppedMessageCount.load();
+			if (dropCount != reportedDropCount && s_pLogFile) {
+				char buf[128];
+				snprintf(buf, sizeof(buf), "WARN - Logger - Dropped %u log lines, the log buffer was full\n", dropCount - reportedDropCount);
+				s_pLogFile->Log(buf);
+				reportedDropCount = dropCount;
+			}
+
+			if (s_bFlushThreadExitSignaled)
+				break;
+
+			std::unique_lock<std::mutex> lock(s_flushWakeMutex);
+			s_flushWakeCondition.wait_for(lock, k_logFlushIdleInterval, [] { return s_bFlushThreadExitSignaled || HasQueuedLogLine(); });
+		}
+	}
+
 	// Initialises the IVRDriverLog logger.
 	bool Logger::InitDriverLog(vr::IVRDriverLog *pDriverLog) {
 		if (s_pLogFile)
@@ -28,26 +153,106 @@ namespace steamvrbridge {
 
 	// Cleans up the IVRDriverLog logger.
 	void Logger::CleanupDriverLog() {
+		StopAsyncLogging();
 		s_pLogFile = NULL;
 	}
 
+	void Logger::StartAsyncLogging() {
+		if (s_pFlushThread != nullptr)
+			return;
+
+		for (unsigned int i = 0; i < k_nLogRingSize; ++i) {
+			s_logRing[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		s_nLogRingEnqueuePos = 0;
+		s_nLogRingDequeuePos = 0;
+
+		s_bFlushThreadExitSignaled = false;
+		s_pFlushThread = new std::thread(FlushThreadFunction);
+		s_bAsyncLogging = true;
+	}
 
-	// Takes a given message and using vsprint
-	void Logger::DriverLogVarArgs(const char *pMsgFormat, va_list args, std::string logLevel) {
-		char buf[1024];
-		#if defined( WIN32 )
-		vsprintf_s(buf, pMsgFormat, args);
-		#else
-		vsnprintf(buf, sizeof(buf), pMsgFormat, args);
-		#endif
+	void Logger::StopAsyncLogging() {
+		if (s_pFlushThread == nullptr)
+			return;
+
+		// New lines go straight to the log from here on. A producer that still saw async logging enabled
+		// may be formatting into a slot, so wait for it to commit before the thread does its final drain.
+		s_bAsyncLogging = false;
+		while (s_nActiveLogProducerCount.load() != 0) {
+			std::this_thread::yield();
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(s_flushWakeMutex);
+			s_bFlushThreadExitSignaled = true;
+		}
+		s_flushWakeCondition.notify_one();
+
+		s_pFlushThread->join();
+		delete s_pFlushThread;
+		s_pFlushThread = nullptr;
+	}
+
+	unsigned int Logger::GetDroppedMessageCount() {
+		return s_nDroppedMessageCount.load();
+	}
+
+	void Logger::SetLogLevel(eLogLevel level) {
+		s_logLevel.store(level, std::memory_order_relaxed);
+	}
+
+	eLogLevel Logger::ParseLogLevel(const char *name, eLogLevel default_level) {
+		for (int level = LogLevel_Debug; level <= LogLevel_Off; ++level) {
+			if (strcasecmp(name, k_LogLevelNames[level]) == 0)
+				return static_cast<eLogLevel>(level);
+		}
+
+		return default_level;
+	}
+
+	// Formats the message behind the level prefix and writes it to the driver log, or queues it for the
+	// flush thread when async logging is running.
+	void Logger::DriverLogVarArgs(const char *pMsgFormat, va_list args, const char *logLevel) {
+		// Sequentially consistent with StopAsyncLogging(): either it sees this producer active, or this
+		// producer sees async logging stopped
+		s_nActiveLogProducerCount.fetch_add(1);
+		if (s_bAsyncLogging.load()) {
+			if (EnqueueLogLine(logLevel, pMsgFormat, args)) {
+				s_flushWakeCondition.notify_one();
+			} else {
+				s_nDroppedMessageCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			s_nActiveLogProducerCount.fetch_sub(1);
+			return;
+		}
+		s_nActiveLogProducerCount.fetch_sub(1);
+
+		char buf[k_nMaxLogLineLength];
+		FormatLogLine(buf, sizeof(buf), logLevel, pMsgFormat, args);
 
 		if (s_pLogFile)
-			s_pLogFile->Log((logLevel + buf).c_str());
+			s_pLogFile->Log(buf);
+	}
+
+	/** Logs a printf-style line at the given level.
+	*/
+	void Logger::Log(eLogLevel level, const char *pMsgFormat, ...) {
+		if (level == LogLevel_Off || !IsEnabled(level))
+			return;
+
+		va_list args;
+		va_start(args, pMsgFormat);
+		Logger::DriverLogVarArgs(pMsgFormat, args, k_LogLevelPrefixes[level]);
+		va_end(args);
 	}
 
 	/** Logs a printf-style info line logging.
 	*/
 	void Logger::Info(const char *pMsgFormat, ...) {
+		if (!IsEnabled(LogLevel_Info))
+			return;
+
 		va_list args;
 		va_start(args, pMsgFormat);
 		Logger::DriverLogVarArgs(pMsgFormat, args, "INFO - ");
@@ -57,6 +262,9 @@ namespace steamvrbridge {
 	/** Logs a printf-style warn line logging.
 	*/
 	void Logger::Warn(const char *pMsgFormat, ...) {
+		if (!IsEnabled(LogLevel_Warn))
+			return;
+
 		va_list args;
 		va_start(args, pMsgFormat);
 		Logger::DriverLogVarArgs(pMsgFormat, args, "WARN - ");
@@ -66,6 +274,9 @@ namespace steamvrbridge {
 	/** Logs a printf-style error line logging.
 	*/
 	void Logger::Error(const char *pMsgFormat, ...) {
+		if (!IsEnabled(LogLevel_Error))
+			return;
+
 		va_list args;
 		va_start(args, pMsgFormat);
 		Logger::DriverLogVarArgs(pMsgFormat, args, "ERROR - ");
@@ -75,11 +286,46 @@ namespace steamvrbridge {
 	/** Logs a printf-style debug line logging.
 	*/
 	void Logger::Debug(const char *pMsgFormat, ...) {
-		#ifdef _DEBUG
+		if (!IsEnabled(LogLevel_Debug))
+			return;
+
 		va_list args;
 		va_start(args, pMsgFormat);
 		Logger::DriverLogVarArgs(pMsgFormat, args, "DEBUG - ");
 		va_end(args);
-		#endif
+	}
+
+	LogRateLimit::LogRateLimit(const char *name, int maxPerSecond)
+		: m_name(name)
+		, m_nMaxPerSecond(maxPerSecond)
+		, m_windowStartMs(0)
+		, m_nWindowCount(0)
+		, m_nSuppressedCount(0) {
+	}
+
+	bool LogRateLimit::Allow(eLogLevel level) {
+		if (level == LogLevel_Off || !Logger::IsEnabled(level))
+			return false;
+
+		const long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		// Whoever starts the new window reports what the last ones suppressed
+		long long windowStartMs = m_windowStartMs.load(std::memory_order_relaxed);
+		if (nowMs - windowStartMs >= k_nLogRateLimitWindowMs &&
+			m_windowStartMs.compare_exchange_strong(windowStartMs, nowMs, std::memory_order_relaxed)) {
+			m_nWindowCount.store(0, std::memory_order_relaxed);
+
+			const unsigned int suppressedCount = m_nSuppressedCount.exchange(0, std::memory_order_relaxed);
+			if (suppressedCount > 0) {
+				Logger::Log(level, "%s - Suppressed %u similar lines (limit %d per second)\n", m_name, suppressedCount, m_nMaxPerSecond);
+			}
+		}
+
+		if (m_nWindowCount.fetch_add(1, std::memory_order_relaxed) < m_nMaxPerSecond)
+			return true;
+
+		m_nSuppressedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
 	}
 }
\ No newline at end of file
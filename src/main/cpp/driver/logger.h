@@ -1,19 +1,71 @@
 //========= Copyright Valve Corporation ============//
 #pragma once
 
-#include <string>
+#include <stdarg.h>
+#include <atomic>
 #include <openvr_driver.h>
 
 namespace steamvrbridge
 {
+	enum eLogLevel {
+		LogLevel_Debug,
+		LogLevel_Info,
+		LogLevel_Warn,
+		LogLevel_Error,
+		LogLevel_Off
+	};
+
 	class Logger {
 	public:
 		static bool InitDriverLog(vr::IVRDriverLog *pDriverLog);
 		static void CleanupDriverLog();
-		static void DriverLogVarArgs(const char *pMsgFormat, va_list args, std::string logLevel);
+
+		// Hands formatted lines to a background thread that writes them to the driver log, so the calling
+		// thread never waits on IVRDriverLog::Log() or a lock. Lines are dropped (and counted) while the
+		// ring buffer is full.
+		static void StartAsyncLogging();
+
+		// Writes out everything still queued, stops the thread and goes back to logging synchronously.
+		static void StopAsyncLogging();
+
+		// Lines dropped because the ring buffer was full since logging started
+		static unsigned int GetDroppedMessageCount();
+
+		// Lines below the log level are discarded before anything is formatted
+		static void SetLogLevel(eLogLevel level);
+		static inline eLogLevel GetLogLevel() { return static_cast<eLogLevel>(s_logLevel.load(std::memory_order_relaxed)); }
+		static inline bool IsEnabled(eLogLevel level) { return level >= s_logLevel.load(std::memory_order_relaxed); }
+
+		// Parses "debug", "info", "warn", "error" or "off" (any case). Returns the default for anything else.
+		static eLogLevel ParseLogLevel(const char *name, eLogLevel default_level);
+
+		static void DriverLogVarArgs(const char *pMsgFormat, va_list args, const char *logLevel);
+		static void Log(eLogLevel level, const char *pchFormat, ...);
 		static void Info(const char *pchFormat, ...);
 		static void Debug(const char *pchFormat, ...);
 		static void Warn(const char *pchFormat, ...);
 		static void Error(const char *pchFormat, ...);
+
+	private:
+		static std::atomic<int> s_logLevel;
+	};
+
+	/* Limits a logging call site to a number of lines per second. Declare one as a function static next
+	to the call and only log when Allow() says so. Lines over the limit are counted instead, and the
+	count is logged the next time the site is allowed to log in a new second.*/
+	class LogRateLimit {
+	public:
+		LogRateLimit(const char *name, int maxPerSecond);
+
+		// False when the level is disabled or the site already logged its share this second.
+		bool Allow(eLogLevel level);
+
+	private:
+		const char *m_name;
+		const int m_nMaxPerSecond;
+
+		std::atomic<long long> m_windowStartMs;
+		std::atomic<int> m_nWindowCount;
+		std::atomic<unsigned int> m_nSuppressedCount;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,101 @@
+#include "occlusion_policy.h"
+#include "settings_util.h"
+#include <math.h>
+
+namespace steamvrbridge {
+
+	OcclusionPolicy::OcclusionPolicy() {
+		Reset();
+	}
+
+	void OcclusionPolicy::Reset() {
+		m_lastTrackedPosition = { 0.f, 0.f, 0.f };
+		m_lastTrackedVelocity = { 0.f, 0.f, 0.f };
+		m_bHasLastTrackedPosition = false;
+		m_bIsOccluded = false;
+		m_lastOccludedPosition = { 0.f, 0.f, 0.f };
+		m_recoveryOffset = { 0.f, 0.f, 0.f };
+		m_bIsRecovering = false;
+	}
+
+	bool OcclusionPolicy::Apply(
+		const PSMPosef &rawPose,
+		const PSMPhysicsData *physics,
+		bool bIsPositionValid,
+		bool bIsOrientationValid,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		const ServerDriverConfig &config,
+		PSMPosef *out_pose,
+		bool *out_bIsOccluded) {
+		*out_pose = rawPose;
+		*out_bIsOccluded = false;
+
+		// Without the IMU there is nothing to hold on to
+		if (!bIsOrientationValid) {
+			Reset();
+			return false;
+		}
+
+		if (bIsPositionValid) {
+			// Tracking just came back while still holding, start blending out the jump from the held position
+			const bool bWasHolding = m_bIsOccluded &&
+				std::chrono::duration<float>(now - m_occlusionStartTime).count() <= config.occlusion_timeout_seconds;
+			if (bWasHolding && config.occlusion_recovery_blend_seconds > 0.f) {
+				m_recoveryOffset.x = m_lastOccludedPosition.x - rawPose.Position.x;
+				m_recoveryOffset.y = m_lastOccludedPosition.y - rawPose.Position.y;
+				m_recoveryOffset.z = m_lastOccludedPosition.z - rawPose.Position.z;
+				m_recoveryStartTime = now;
+				m_bIsRecovering = true;
+			}
+			m_bIsOccluded = false;
+
+			if (m_bIsRecovering) {
+				const float t = std::chrono::duration<float>(now - m_recoveryStartTime).count();
+				const float remaining = 1.f - t / config.occlusion_recovery_blend_seconds;
+
+				if (remaining > 0.f) {
+					out_pose->Position.x += m_recoveryOffset.x * remaining;
+					out_pose->Position.y += m_recoveryOffset.y * remaining;
+					out_pose->Position.z += m_recoveryOffset.z * remaining;
+				} else {
+					m_bIsRecovering = false;
+				}
+			}
+
+			m_lastTrackedPosition = out_pose->Position;
+			m_lastTrackedVelocity = physics != nullptr ? physics->LinearVelocityCmPerSec : PSMVector3f{ 0.f, 0.f, 0.f };
+			m_bHasLastTrackedPosition = true;
+
+			return true;
+		}
+
+		// Position lost: hold it for a while if the policy is enabled and we have something to hold
+		if (!m_bHasLastTrackedPosition || config.occlusion_timeout_seconds <= 0.f)
+			return false;
+
+		if (!m_bIsOccluded) {
+			m_bIsOccluded = true;
+			m_bIsRecovering = false;
+			m_occlusionStartTime = now;
+		}
+
+		const float occludedSecs = std::chrono::duration<float>(now - m_occlusionStartTime).count();
+		if (occludedSecs > config.occlusion_timeout_seconds)
+			return false;
+
+		// Coast on the last velocity, decaying exponentially, for at most the dead reckoning window:
+		//   d(t) = v0 * (1 - e^(-k*t)) / k
+		const float coastSecs = fminf(occludedSecs, config.occlusion_dead_reckoning_seconds);
+		const float decayRate = config.occlusion_velocity_decay_rate;
+		const float coastFactor = decayRate > 0.f ? (1.f - expf(-decayRate * coastSecs)) / decayRate : coastSecs;
+
+		out_pose->Position.x = m_lastTrackedPosition.x + m_lastTrackedVelocity.x * coastFactor;
+		out_pose->Position.y = m_lastTrackedPosition.y + m_lastTrackedVelocity.y * coastFactor;
+		out_pose->Position.z = m_lastTrackedPosition.z + m_lastTrackedVelocity.z * coastFactor;
+
+		m_lastOccludedPosition = out_pose->Position;
+		*out_bIsOccluded = true;
+
+		return true;
+	}
+}
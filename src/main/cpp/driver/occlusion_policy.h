@@ -0,0 +1,50 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+
+namespace steamvrbridge {
+
+	class ServerDriverConfig;
+
+	/* Keeps a controller usable through short optical occlusions. While the bulb is hidden the last
+	position is held (optionally coasting on its last velocity, decaying to a stop) and the IMU keeps
+	driving the orientation. The pose is only invalidated once the occlusion outlasts the configured
+	timeout. When tracking returns, the jump between the held and the real position is blended out.*/
+	class OcclusionPolicy {
+	public:
+		OcclusionPolicy();
+
+		// Forget any occlusion in progress, e.g. when the controller reconnects.
+		void Reset();
+
+		// Filters a raw PSM pose (in PSM units). Returns whether the pose should be reported as valid
+		// and sets out_bIsOccluded while the pose is being held or dead reckoned.
+		bool Apply(
+			const PSMPosef &rawPose,
+			const PSMPhysicsData *physics,
+			bool bIsPositionValid,
+			bool bIsOrientationValid,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+			const ServerDriverConfig &config,
+			PSMPosef *out_pose,
+			bool *out_bIsOccluded);
+
+		inline bool IsOccluded() const { return m_bIsOccluded; }
+		inline bool IsRecovering() const { return m_bIsRecovering; }
+
+	private:
+		// Last position reported while optically tracked, in PSM units
+		PSMVector3f m_lastTrackedPosition;
+		PSMVector3f m_lastTrackedVelocity;
+		bool m_bHasLastTrackedPosition;
+
+		bool m_bIsOccluded;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_occlusionStartTime;
+
+		// Position last reported during the occlusion, blended out after recovery
+		PSMVector3f m_lastOccludedPosition;
+		PSMVector3f m_recoveryOffset;
+		bool m_bIsRecovering;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_recoveryStartTime;
+	};
+}
@@ -0,0 +1,204 @@
+#include "pose_batch.h"
+#include "constants.h"
+#include "psm_math.h"
+#include "trace_log.h"
+#include <assert.h>
+
+#if POSE_BATCH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace steamvrbridge {
+
+	PoseBatch::PoseBatch()
+		: m_nCount(0) {
+	}
+
+	void PoseBatch::Reset() {
+		m_nCount = 0;
+	}
+
+	void PoseBatch::Enqueue(
+		const PSMPosef &raw_pose,
+		float extend_Y_meters,
+		float extend_Z_meters,
+		bool z_rotate_90_degrees,
+		vr::TrackedDeviceIndex_t device_index,
+		vr::DriverPose_t *out_pose,
+		PosePublisher *publisher) {
+		assert(out_pose != nullptr);
+		assert(publisher != nullptr);
+
+		static TraceFormat s_rawPoseTrace("PoseBatch - device {} raw pose {}");
+		TraceLog::Record(s_rawPoseTrace, (unsigned int)device_index, raw_pose);
+
+		// Can only happen if the same device is queued more than once in a frame
+		if (m_nCount >= k_nMaxBatchSize) {
+			TransformPoseScalar(raw_pose, extend_Y_meters, extend_Z_meters, z_rotate_90_degrees, out_pose);
+			publisher->Publish(device_index, *out_pose);
+			return;
+		}
+
+		const int i = m_nCount++;
+		m_posX[i] = raw_pose.Position.x;
+		m_posY[i] = raw_pose.Position.y;
+		m_posZ[i] = raw_pose.Position.z;
+		m_quatW[i] = raw_pose.Orientation.w;
+		m_quatX[i] = raw_pose.Orientation.x;
+		m_quatY[i] = raw_pose.Orientation.y;
+		m_quatZ[i] = raw_pose.Orientation.z;
+		m_extendY[i] = extend_Y_meters;
+		m_extendZ[i] = extend_Z_meters;
+		m_rotateSign[i] = z_rotate_90_degrees ? -1.f : 1.f;
+		m_deviceIndices[i] = device_index;
+		m_outPoses[i] = out_pose;
+		m_publishers[i] = publisher;
+	}
+
+	void PoseBatch::Flush() {
+		if (m_nCount == 0)
+			return;
+
+		TransformBatch();
+
+		for (int i = 0; i < m_nCount; ++i) {
+			vr::DriverPose_t &pose = *m_outPoses[i];
+
+			pose.vecPosition[0] = m_outPosX[i];
+			pose.vecPosition[1] = m_outPosY[i];
+			pose.vecPosition[2] = m_outPosZ[i];
+
+			pose.qRotation.w = m_outQuatW[i];
+			pose.qRotation.x = m_quatX[i];
+			pose.qRotation.y = m_quatY[i];
+			pose.qRotation.z = m_outQuatZ[i];
+
+			m_publishers[i]->Publish(m_deviceIndices[i], pose);
+		}
+
+		m_nCount = 0;
+	}
+
+	void PoseBatch::TransformPoseScalar(
+		const PSMPosef &raw_pose,
+		float extend_Y_meters,
+		float extend_Z_meters,
+		bool z_rotate_90_degrees,
+		vr::DriverPose_t *out_pose) {
+		const PSMVector3f &position = raw_pose.Position;
+		const PSMQuatf &orientation = raw_pose.Orientation;
+
+		// Set position
+		PSMVector3f shift = {
+			position.x * k_fScalePSMoveAPIToMeters,
+			position.y * k_fScalePSMoveAPIToMeters,
+			position.z * k_fScalePSMoveAPIToMeters };
+
+		// virtual extend controllers
+		if (extend_Z_meters != 0.0f) {
+			PSMVector3f local_forward = { 0, 0, -1 };
+			PSMVector3f global_forward = PSMMath::QuatfRotateVector(orientation, local_forward);
+
+			shift = PSMMath::Vector3fScaleAndAdd(global_forward, extend_Z_meters, shift);
+		}
+
+		if (extend_Y_meters != 0.0f) {
+			PSMVector3f local_forward = { 0, -1, 0 };
+			PSMVector3f global_forward = PSMMath::QuatfRotateVector(orientation, local_forward);
+
+			shift = PSMMath::Vector3fScaleAndAdd(global_forward, extend_Y_meters, shift);
+		}
+
+		out_pose->vecPosition[0] = shift.x;
+		out_pose->vecPosition[1] = shift.y;
+		out_pose->vecPosition[2] = shift.z;
+
+		// Set rotational coordinates
+		out_pose->qRotation.w = z_rotate_90_degrees ? -orientation.w : orientation.w;
+		out_pose->qRotation.x = orientation.x;
+		out_pose->qRotation.y = orientation.y;
+		out_pose->qRotation.z = z_rotate_90_degrees ? -orientation.z : orientation.z;
+	}
+
+	// Scalar fallback of the batch kernel. Rotating the local -Z and -Y axes by a unit quaternion is the
+	// same as negating the third and second columns of its rotation matrix, so both extends collapse to:
+	//   p' = p*scale - extend_Z*col2(q) - extend_Y*col1(q)
+	void PoseBatch::TransformRange(int start, int end) {
+		for (int i = start; i < end; ++i) {
+			const float w = m_quatW[i], x = m_quatX[i], y = m_quatY[i], z = m_quatZ[i];
+
+			const float col1X = 2.f*(x*y - w*z);
+			const float col1Y = 1.f - 2.f*(x*x + z*z);
+			const float col1Z = 2.f*(y*z + w*x);
+
+			const float col2X = 2.f*(x*z + w*y);
+			const float col2Y = 2.f*(y*z - w*x);
+			const float col2Z = 1.f - 2.f*(x*x + y*y);
+
+			m_outPosX[i] = m_posX[i] * k_fScalePSMoveAPIToMeters - m_extendZ[i]*col2X - m_extendY[i]*col1X;
+			m_outPosY[i] = m_posY[i] * k_fScalePSMoveAPIToMeters - m_extendZ[i]*col2Y - m_extendY[i]*col1Y;
+			m_outPosZ[i] = m_posZ[i] * k_fScalePSMoveAPIToMeters - m_extendZ[i]*col2Z - m_extendY[i]*col1Z;
+
+			m_outQuatW[i] = w * m_rotateSign[i];
+			m_outQuatZ[i] = z * m_rotateSign[i];
+		}
+	}
+
+	void PoseBatch::TransformBatch() {
+#if POSE_BATCH_USE_SSE
+		const __m128 scale = _mm_set1_ps(k_fScalePSMoveAPIToMeters);
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 two = _mm_set1_ps(2.f);
+
+		const int simdEnd = m_nCount & ~3;
+		for (int i = 0; i < simdEnd; i += 4) {
+			const __m128 w = _mm_load_ps(&m_quatW[i]);
+			const __m128 x = _mm_load_ps(&m_quatX[i]);
+			const __m128 y = _mm_load_ps(&m_quatY[i]);
+			const __m128 z = _mm_load_ps(&m_quatZ[i]);
+
+			const __m128 xx = _mm_mul_ps(x, x);
+			const __m128 yy = _mm_mul_ps(y, y);
+			const __m128 zz = _mm_mul_ps(z, z);
+			const __m128 xy = _mm_mul_ps(x, y);
+			const __m128 xz = _mm_mul_ps(x, z);
+			const __m128 yz = _mm_mul_ps(y, z);
+			const __m128 wx = _mm_mul_ps(w, x);
+			const __m128 wy = _mm_mul_ps(w, y);
+			const __m128 wz = _mm_mul_ps(w, z);
+
+			const __m128 col1X = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+			const __m128 col1Y = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+			const __m128 col1Z = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+
+			const __m128 col2X = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+			const __m128 col2Y = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+			const __m128 col2Z = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+			const __m128 extY = _mm_load_ps(&m_extendY[i]);
+			const __m128 extZ = _mm_load_ps(&m_extendZ[i]);
+
+			__m128 px = _mm_mul_ps(_mm_load_ps(&m_posX[i]), scale);
+			__m128 py = _mm_mul_ps(_mm_load_ps(&m_posY[i]), scale);
+			__m128 pz = _mm_mul_ps(_mm_load_ps(&m_posZ[i]), scale);
+
+			px = _mm_sub_ps(px, _mm_add_ps(_mm_mul_ps(extZ, col2X), _mm_mul_ps(extY, col1X)));
+			py = _mm_sub_ps(py, _mm_add_ps(_mm_mul_ps(extZ, col2Y), _mm_mul_ps(extY, col1Y)));
+			pz = _mm_sub_ps(pz, _mm_add_ps(_mm_mul_ps(extZ, col2Z), _mm_mul_ps(extY, col1Z)));
+
+			_mm_store_ps(&m_outPosX[i], px);
+			_mm_store_ps(&m_outPosY[i], py);
+			_mm_store_ps(&m_outPosZ[i], pz);
+
+			const __m128 sign = _mm_load_ps(&m_rotateSign[i]);
+			_mm_store_ps(&m_outQuatW[i], _mm_mul_ps(w, sign));
+			_mm_store_ps(&m_outQuatZ[i], _mm_mul_ps(z, sign));
+		}
+
+		// Remaining controllers that don't fill a full SSE register
+		TransformRange(simdEnd, m_nCount);
+#else
+		TransformRange(0, m_nCount);
+#endif
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <openvr_driver.h>
+#include "pose_publisher.h"
+
+// Use the SSE kernel wherever SSE2 is guaranteed to be available. Can be forced to 0 to build the
+// scalar kernel (the tests build both).
+#ifndef POSE_BATCH_USE_SSE
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POSE_BATCH_USE_SSE 1
+#else
+#define POSE_BATCH_USE_SSE 0
+#endif
+#endif
+
+namespace steamvrbridge {
+
+	/* Converts the raw PSM poses of all tracked controllers into driver space in a single pass.
+	Controllers enqueue their raw pose and extend/rotate settings during their Update(), the server then
+	transforms the whole batch at the end of the frame and posts each result to vrserver. Inputs are
+	kept as structure-of-arrays so the transform runs four controllers at a time when SSE is available.*/
+	class PoseBatch {
+	public:
+		// One slot per possible tracked device
+		static const int k_nMaxBatchSize = vr::k_unMaxTrackedDeviceCount;
+
+		PoseBatch();
+
+		// Drops any pending entries. Called at the start of each frame.
+		void Reset();
+
+		// Queues a raw PSM pose (in PSM units) for transform. The position and rotation of out_pose are
+		// written and the pose is posted for device_index through publisher on the next Flush().
+		void Enqueue(
+			const PSMPosef &raw_pose,
+			float extend_Y_meters,
+			float extend_Z_meters,
+			bool z_rotate_90_degrees,
+			vr::TrackedDeviceIndex_t device_index,
+			vr::DriverPose_t *out_pose,
+			PosePublisher *publisher);
+
+		// Transforms all queued poses, writes them back to their DriverPose_t and posts them to vrserver.
+		void Flush();
+
+		inline int GetPendingCount() const { return m_nCount; }
+
+		// Reference implementation for a single pose, matches the per-controller transform.
+		static void TransformPoseScalar(
+			const PSMPosef &raw_pose,
+			float extend_Y_meters,
+			float extend_Z_meters,
+			bool z_rotate_90_degrees,
+			vr::DriverPose_t *out_pose);
+
+	private:
+		void TransformRange(int start, int end);
+		void TransformBatch();
+
+		int m_nCount;
+
+		// Structure-of-arrays inputs
+		alignas(16) float m_posX[k_nMaxBatchSize];
+		alignas(16) float m_posY[k_nMaxBatchSize];
+		alignas(16) float m_posZ[k_nMaxBatchSize];
+		alignas(16) float m_quatW[k_nMaxBatchSize];
+		alignas(16) float m_quatX[k_nMaxBatchSize];
+		alignas(16) float m_quatY[k_nMaxBatchSize];
+		alignas(16) float m_quatZ[k_nMaxBatchSize];
+		alignas(16) float m_extendY[k_nMaxBatchSize];
+		alignas(16) float m_extendZ[k_nMaxBatchSize];
+		alignas(16) float m_rotateSign[k_nMaxBatchSize];
+
+		// Structure-of-arrays outputs
+		alignas(16) float m_outPosX[k_nMaxBatchSize];
+		alignas(16) float m_outPosY[k_nMaxBatchSize];
+		alignas(16) float m_outPosZ[k_nMaxBatchSize];
+		alignas(16) float m_outQuatW[k_nMaxBatchSize];
+		alignas(16) float m_outQuatZ[k_nMaxBatchSize];
+
+		// Where each result gets scattered to
+		vr::TrackedDeviceIndex_t m_deviceIndices[k_nMaxBatchSize];
+		vr::DriverPose_t *m_outPoses[k_nMaxBatchSize];
+		PosePublisher *m_publishers[k_nMaxBatchSize];
+	};
+}
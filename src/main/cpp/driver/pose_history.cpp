@@ -0,0 +1,229 @@
+#include "pose_history.h"
+#include "psm_math.h"
+#include <math.h>
+#include <string.h>
+
+namespace steamvrbridge {
+
+	static PSMQuatf psmQuatfNlerp(const PSMQuatf &a, const PSMQuatf &b, float u) {
+		// Take the short way around
+		const float dot = a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z;
+		const float sign = dot < 0.f ? -1.f : 1.f;
+
+		PSMQuatf result;
+		result.w = a.w + (sign*b.w - a.w)*u;
+		result.x = a.x + (sign*b.x - a.x)*u;
+		result.y = a.y + (sign*b.y - a.y)*u;
+		result.z = a.z + (sign*b.z - a.z)*u;
+
+		const float length = sqrtf(result.w*result.w + result.x*result.x + result.y*result.y + result.z*result.z);
+		if (length <= 0.f)
+			return a;
+
+		result.w /= length;
+		result.x /= length;
+		result.y /= length;
+		result.z /= length;
+
+		return result;
+	}
+
+	static bool psmVector3fIsZero(const PSMVector3f &v) {
+		return v.x == 0.f && v.y == 0.f && v.z == 0.f;
+	}
+
+	const PSMPhysicsData *GetStreamedPhysics(unsigned int dataStreamFlags, const PSMPhysicsData &physics) {
+		if ((dataStreamFlags & PSMStreamFlags_includePhysicsData) == 0)
+			return nullptr;
+
+		const bool bIsEmpty =
+			physics.TimeInSeconds == 0.0 &&
+			psmVector3fIsZero(physics.LinearVelocityCmPerSec) &&
+			psmVector3fIsZero(physics.LinearAccelerationCmPerSecSqr) &&
+			psmVector3fIsZero(physics.AngularVelocityRadPerSec) &&
+			psmVector3fIsZero(physics.AngularAccelerationRadPerSecSqr);
+
+		return bIsEmpty ? nullptr : &physics;
+	}
+
+	PoseHistory::PoseHistory()
+		: m_writeCount(0)
+		, m_firstSample(0) {
+		for (int i = 0; i < k_nCapacity; ++i) {
+			m_slots[i].version.store(0, std::memory_order_relaxed);
+			m_slots[i].sample = PoseHistorySample();
+		}
+	}
+
+	void PoseHistory::Push(
+		const PSMPosef &pose,
+		const PSMPhysicsData *physics,
+		bool bIsPositionValid,
+		bool bIsOrientationValid,
+		int sequenceNum,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp) {
+		const unsigned int writeCount = m_writeCount.load(std::memory_order_relaxed);
+		Slot &slot = m_slots[writeCount % k_nCapacity];
+
+		// Mark the slot as being written so readers discard a torn copy
+		const unsigned int version = slot.version.load(std::memory_order_relaxed);
+		slot.version.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot.sample.timestamp = timestamp;
+		slot.sample.pose = pose;
+		slot.sample.bHasPhysics = physics != nullptr;
+		if (physics != nullptr)
+			slot.sample.physics = *physics;
+		else
+			memset(&slot.sample.physics, 0, sizeof(PSMPhysicsData));
+		slot.sample.bIsPositionValid = bIsPositionValid;
+		slot.sample.bIsOrientationValid = bIsOrientationValid;
+		slot.sample.sequenceNum = sequenceNum;
+
+		slot.version.store(version + 2, std::memory_order_release);
+		m_writeCount.store(writeCount + 1, std::memory_order_release);
+	}
+
+	void PoseHistory::Clear() {
+		m_firstSample.store(m_writeCount.load(std::memory_order_relaxed), std::memory_order_release);
+	}
+
+	int PoseHistory::GetCount() const {
+		const unsigned int writeCount = m_writeCount.load(std::memory_order_acquire);
+		const unsigned int count = writeCount - m_firstSample.load(std::memory_order_acquire);
+
+		return count < (unsigned int)k_nCapacity ? (int)count : k_nCapacity;
+	}
+
+	bool PoseHistory::GetSample(int age, PoseHistorySample *out_sample) const {
+		if (age < 0 || age >= GetCount())
+			return false;
+
+		const unsigned int writeCount = m_writeCount.load(std::memory_order_acquire);
+		if (!ReadSlot((writeCount - 1 - (unsigned int)age) % k_nCapacity, out_sample))
+			return false;
+
+		// The writer lapped us while we were copying
+		const unsigned int pushedSince = m_writeCount.load(std::memory_order_acquire) - writeCount;
+		return pushedSince < (unsigned int)(k_nCapacity - age);
+	}
+
+	bool PoseHistory::GetPoseAtTime(
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &time,
+		PSMPosef *out_pose) const {
+		PoseHistorySample newer;
+		if (!GetSample(0, &newer))
+			return false;
+
+		// Past the newest sample, hold the newest pose
+		if (newer.timestamp <= time) {
+			*out_pose = newer.pose;
+			return true;
+		}
+
+		const int count = GetCount();
+		for (int age = 1; age < count; ++age) {
+			PoseHistorySample older;
+			if (!GetSample(age, &older))
+				return false;
+
+			if (older.timestamp <= time) {
+				const float span = std::chrono::duration<float>(newer.timestamp - older.timestamp).count();
+				const float u = span > 0.f ? std::chrono::duration<float>(time - older.timestamp).count() / span : 0.f;
+
+				out_pose->Position.x = older.pose.Position.x + (newer.pose.Position.x - older.pose.Position.x)*u;
+				out_pose->Position.y = older.pose.Position.y + (newer.pose.Position.y - older.pose.Position.y)*u;
+				out_pose->Position.z = older.pose.Position.z + (newer.pose.Position.z - older.pose.Position.z)*u;
+				out_pose->Orientation = psmQuatfNlerp(older.pose.Orientation, newer.pose.Orientation, u);
+				return true;
+			}
+
+			newer = older;
+		}
+
+		// Older than anything we still have
+		return false;
+	}
+
+	bool PoseHistory::ExtrapolatePose(
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &time,
+		float maxHorizonSecs,
+		PSMPosef *out_pose,
+		float *out_unpredictedSecs) const {
+		PoseHistorySample latest;
+		if (!GetSample(0, &latest) || !latest.bIsPositionValid || !latest.bIsOrientationValid)
+			return false;
+
+		const float elapsedSecs = std::chrono::duration<float>(time - latest.timestamp).count();
+		const float horizonSecs = fmaxf(fminf(elapsedSecs, maxHorizonSecs), 0.f);
+
+		PSMVector3f linearVelocity;
+		PSMVector3f angularVelocity;
+		if (latest.bHasPhysics) {
+			linearVelocity = latest.physics.LinearVelocityCmPerSec;
+			angularVelocity = latest.physics.AngularVelocityRadPerSec;
+		} else {
+			// No physics from the service, fall back to the motion between the last two samples
+			PoseHistorySample previous;
+			if (!GetSample(1, &previous) || !previous.bIsPositionValid || !previous.bIsOrientationValid)
+				return false;
+
+			const float dt = std::chrono::duration<float>(latest.timestamp - previous.timestamp).count();
+			if (dt <= 0.f)
+				return false;
+
+			linearVelocity.x = (latest.pose.Position.x - previous.pose.Position.x) / dt;
+			linearVelocity.y = (latest.pose.Position.y - previous.pose.Position.y) / dt;
+			linearVelocity.z = (latest.pose.Position.z - previous.pose.Position.z) / dt;
+
+			// Rotation from previous to latest, as a small angle world space rate
+			PSMQuatf previousInverse = { previous.pose.Orientation.w, -previous.pose.Orientation.x, -previous.pose.Orientation.y, -previous.pose.Orientation.z };
+			PSMQuatf delta = PSMMath::QuatfMultiply(latest.pose.Orientation, previousInverse);
+			const float sign = delta.w < 0.f ? -1.f : 1.f;
+
+			angularVelocity.x = 2.f * sign * delta.x / dt;
+			angularVelocity.y = 2.f * sign * delta.y / dt;
+			angularVelocity.z = 2.f * sign * delta.z / dt;
+		}
+
+		out_pose->Position.x = latest.pose.Position.x + linearVelocity.x*horizonSecs;
+		out_pose->Position.y = latest.pose.Position.y + linearVelocity.y*horizonSecs;
+		out_pose->Position.z = latest.pose.Position.z + linearVelocity.z*horizonSecs;
+
+		// Integrate the world space angular velocity over the horizon
+		const float angularSpeed = sqrtf(
+			angularVelocity.x*angularVelocity.x +
+			angularVelocity.y*angularVelocity.y +
+			angularVelocity.z*angularVelocity.z);
+		const float halfAngle = 0.5f * angularSpeed * horizonSecs;
+
+		if (angularSpeed > 0.f && halfAngle > 0.f) {
+			const float s = sinf(halfAngle) / angularSpeed;
+			PSMQuatf step = { cosf(halfAngle), angularVelocity.x*s, angularVelocity.y*s, angularVelocity.z*s };
+
+			out_pose->Orientation = PSMMath::QuatfMultiply(step, latest.pose.Orientation);
+		} else {
+			out_pose->Orientation = latest.pose.Orientation;
+		}
+
+		*out_unpredictedSecs = elapsedSecs - horizonSecs;
+
+		return true;
+	}
+
+	bool PoseHistory::ReadSlot(unsigned int index, PoseHistorySample *out_sample) const {
+		const Slot &slot = m_slots[index];
+
+		const unsigned int versionBefore = slot.version.load(std::memory_order_acquire);
+		if ((versionBefore & 1) != 0)
+			return false;
+
+		*out_sample = slot.sample;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const unsigned int versionAfter = slot.version.load(std::memory_order_relaxed);
+
+		return versionBefore == versionAfter;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <atomic>
+#include <chrono>
+
+namespace steamvrbridge {
+
+	// A single pose sample as received from PSMoveService
+	struct PoseHistorySample {
+		std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
+
+		// Raw pose in PSM units (cm), before any driver space transform
+		PSMPosef pose;
+		PSMPhysicsData physics;
+		bool bHasPhysics;
+
+		bool bIsPositionValid;
+		bool bIsOrientationValid;
+
+		// The OutputSequenceNum the sample was taken from
+		int sequenceNum;
+	};
+
+	// The physics to record with a sample: null unless the data stream was started with physics and
+	// PSMoveService actually filled it in (it leaves it zeroed for devices it can't compute it for).
+	// PoseHistory and OcclusionPolicy then fall back to the motion between samples.
+	const PSMPhysicsData *GetStreamedPhysics(unsigned int dataStreamFlags, const PSMPhysicsData &physics);
+
+	/* Fixed-capacity history of the most recent poses of a tracked device. Samples are written by the
+	thread that runs the driver frame and can be read from any thread. Writers never block or allocate;
+	readers detect samples that were overwritten while being copied and skip them.*/
+	class PoseHistory {
+	public:
+		// Enough for about two seconds of samples at the PS3Eye's 60Hz
+		static const int k_nCapacity = 128;
+
+		PoseHistory();
+
+		// Appends a new sample, overwriting the oldest once the history is full.
+		// Must only be called from a single thread.
+		void Push(
+			const PSMPosef &pose,
+			const PSMPhysicsData *physics,
+			bool bIsPositionValid,
+			bool bIsOrientationValid,
+			int sequenceNum,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &timestamp);
+
+		// Forgets all samples, e.g. when the device is deactivated.
+		void Clear();
+
+		// Number of samples currently held, at most k_nCapacity.
+		int GetCount() const;
+
+		// Copies the sample that is age samples old (0 = newest). Returns false when no such
+		// sample exists or it was overwritten during the copy.
+		bool GetSample(int age, PoseHistorySample *out_sample) const;
+		bool GetLatestSample(PoseHistorySample *out_sample) const { return GetSample(0, out_sample); }
+
+		// Interpolates the pose at the given time from the two samples around it. Times past the newest
+		// sample return the newest pose; times before the oldest sample fail.
+		bool GetPoseAtTime(
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &time,
+			PSMPosef *out_pose) const;
+
+		// Predicts the pose at the given time from the newest sample, using its physics data or the
+		// motion between the last two samples. The prediction never runs further than maxHorizonSecs
+		// past the newest sample; out_unpredictedSecs receives how far short of time it stopped.
+		bool ExtrapolatePose(
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &time,
+			float maxHorizonSecs,
+			PSMPosef *out_pose,
+			float *out_unpredictedSecs) const;
+
+	private:
+		struct Slot {
+			// Odd while the slot is being written
+			std::atomic<unsigned int> version;
+			PoseHistorySample sample;
+		};
+
+		bool ReadSlot(unsigned int index, PoseHistorySample *out_sample) const;
+
+		Slot m_slots[k_nCapacity];
+
+		// Total number of samples ever pushed; the newest sample lives at (m_writeCount-1) % k_nCapacity
+		std::atomic<unsigned int> m_writeCount;
+
+		// Value of m_writeCount at the last Clear(), samples before it are ignored
+		std::atomic<unsigned int> m_firstSample;
+	};
+}
@@ -0,0 +1,102 @@
+#include "pose_outlier_gate.h"
+#include "settings_util.h"
+#include "logger.h"
+#include "constants.h"
+#include <math.h>
+
+namespace steamvrbridge {
+
+	// Samples further apart than this are too old to judge the new one against
+	static const float k_fMaxGateIntervalSecs = 0.25f;
+
+	// Guards against samples delivered back to back implying huge speeds
+	static const float k_fMinGateIntervalSecs = 0.005f;
+
+	// Rejections in a row before the new position is trusted anyway
+	static const int k_nMaxConsecutiveRejections = 3;
+
+	PoseOutlierGate::PoseOutlierGate()
+		: m_nRejectedSampleCount(0) {
+		Reset();
+	}
+
+	void PoseOutlierGate::Reset() {
+		m_bHasAcceptedSample = false;
+		m_bHasAcceptedVelocity = false;
+		m_lastAcceptedPosition = { 0.f, 0.f, 0.f };
+		m_lastAcceptedVelocity = { 0.f, 0.f, 0.f };
+		m_lastAcceptedSequenceNum = 0;
+		m_nConsecutiveRejections = 0;
+	}
+
+	bool PoseOutlierGate::Accept(
+		const PSMVector3f &position,
+		int sequenceNum,
+		float sampleRate,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		const ServerDriverConfig &config) {
+		// Gating disabled
+		if (config.outlier_max_speed_meters_per_sec <= 0.f) {
+			return true;
+		}
+
+		const float arrivalDt = std::chrono::duration<float>(now - m_lastAcceptedTime).count();
+		if (!m_bHasAcceptedSample || arrivalDt > k_fMaxGateIntervalSecs || m_nConsecutiveRejections >= k_nMaxConsecutiveRejections) {
+			const PSMVector3f zero = { 0.f, 0.f, 0.f };
+
+			AcceptSample(position, zero, false, sequenceNum, now);
+			return true;
+		}
+
+		// When the samples were taken, not when this frame happened to pick them up
+		const int sequenceDelta = sequenceNum - m_lastAcceptedSequenceNum;
+		const float dt = (sampleRate > 0.f && sequenceDelta > 0) ? (float)sequenceDelta / sampleRate : arrivalDt;
+		const float gateDt = fmaxf(dt, k_fMinGateIntervalSecs);
+		PSMVector3f velocity = {
+			(position.x - m_lastAcceptedPosition.x) / gateDt,
+			(position.y - m_lastAcceptedPosition.y) / gateDt,
+			(position.z - m_lastAcceptedPosition.z) / gateDt };
+
+		const float speedMetersPerSec =
+			sqrtf(velocity.x*velocity.x + velocity.y*velocity.y + velocity.z*velocity.z) * k_fScalePSMoveAPIToMeters;
+
+		const float dvx = velocity.x - m_lastAcceptedVelocity.x;
+		const float dvy = velocity.y - m_lastAcceptedVelocity.y;
+		const float dvz = velocity.z - m_lastAcceptedVelocity.z;
+		const float accelerationMetersPerSecSqr =
+			sqrtf(dvx*dvx + dvy*dvy + dvz*dvz) / gateDt * k_fScalePSMoveAPIToMeters;
+
+		if (speedMetersPerSec > config.outlier_max_speed_meters_per_sec ||
+			(m_bHasAcceptedVelocity && config.outlier_max_acceleration_meters_per_sec_sqr > 0.f &&
+			 accelerationMetersPerSecSqr > config.outlier_max_acceleration_meters_per_sec_sqr)) {
+			++m_nConsecutiveRejections;
+			++m_nRejectedSampleCount;
+
+			// A controller losing tracking can be rejected for many samples in a row
+			static LogRateLimit s_rejectedSampleLogLimit("PoseOutlierGate::Accept", 10);
+			if (s_rejectedSampleLogLimit.Allow(LogLevel_Debug)) {
+				Logger::Debug("PoseOutlierGate::Accept - rejected sample: speed=%.2fm/s, acceleration=%.2fm/s^2, total rejected=%d\n",
+					speedMetersPerSec, accelerationMetersPerSecSqr, m_nRejectedSampleCount);
+			}
+			return false;
+		}
+
+		AcceptSample(position, velocity, true, sequenceNum, now);
+		return true;
+	}
+
+	void PoseOutlierGate::AcceptSample(
+		const PSMVector3f &position,
+		const PSMVector3f &velocity,
+		bool bHasVelocity,
+		int sequenceNum,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		m_bHasAcceptedSample = true;
+		m_bHasAcceptedVelocity = bHasVelocity;
+		m_lastAcceptedPosition = position;
+		m_lastAcceptedVelocity = velocity;
+		m_lastAcceptedSequenceNum = sequenceNum;
+		m_lastAcceptedTime = now;
+		m_nConsecutiveRejections = 0;
+	}
+}
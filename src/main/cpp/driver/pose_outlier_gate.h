@@ -0,0 +1,55 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+
+namespace steamvrbridge {
+
+	class ServerDriverConfig;
+
+	/* Rejects optical position samples that imply physically impossible motion, such as the single
+	frame jumps caused by PSMoveService associating the wrong blob with a controller. A sample is
+	compared against the last accepted one; if the implied speed or acceleration is beyond what a hand
+	can do it is rejected and the caller treats the position as invalid for that frame.*/
+	class PoseOutlierGate {
+	public:
+		PoseOutlierGate();
+
+		// Forget the accepted history, e.g. when the controller reconnects. Keeps the rejection count.
+		void Reset();
+
+		// Returns true if the position (in PSM units) should be used. The time between samples comes
+		// from the difference in sequence numbers at the stream's sample rate; arrival times jitter with
+		// the driver frame rate. Without a sample rate the arrival time is used instead.
+		bool Accept(
+			const PSMVector3f &position,
+			int sequenceNum,
+			float sampleRate,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+			const ServerDriverConfig &config);
+
+		inline int GetRejectedSampleCount() const { return m_nRejectedSampleCount; }
+
+	private:
+		void AcceptSample(
+			const PSMVector3f &position,
+			const PSMVector3f &velocity,
+			bool bHasVelocity,
+			int sequenceNum,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		bool m_bHasAcceptedSample;
+		// The acceleration check needs two accepted samples in a row
+		bool m_bHasAcceptedVelocity;
+		PSMVector3f m_lastAcceptedPosition;
+		PSMVector3f m_lastAcceptedVelocity;
+		int m_lastAcceptedSequenceNum;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_lastAcceptedTime;
+
+		// Rejections since the last accepted sample. Too many in a row means the controller really
+		// did move that far (e.g. while occluded) and the gate re-seeds on the new position.
+		int m_nConsecutiveRejections;
+
+		// Total number of samples rejected for this device
+		int m_nRejectedSampleCount;
+	};
+}
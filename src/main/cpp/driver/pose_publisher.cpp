@@ -0,0 +1,73 @@
+#include "pose_publisher.h"
+#include "server_driver.h"
+#include <math.h>
+
+namespace steamvrbridge {
+
+	PosePublisher::PosePublisher()
+		: m_bHasPublishedPose(false)
+		, m_nSuppressedPoseCount(0) {
+		memset(&m_lastPublishedPose, 0, sizeof(m_lastPublishedPose));
+	}
+
+	bool PosePublisher::Publish(vr::TrackedDeviceIndex_t device_index, const vr::DriverPose_t &pose) {
+		const ServerDriverConfig &config = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+		if (config.suppress_idle_pose_updates && m_bHasPublishedPose && !IsSignificantChange(pose)) {
+			const float secsSincePublish = std::chrono::duration<float>(now - m_lastPublishTime).count();
+
+			// Still send the occasional update so vrserver doesn't consider the device stale
+			if (secsSincePublish < config.idle_heartbeat_seconds) {
+				++m_nSuppressedPoseCount;
+				return false;
+			}
+		}
+
+		// This call posts this pose to shared memory, where all clients will have access to it the next
+		// moment they want to predict a pose.
+		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(device_index, pose, sizeof(vr::DriverPose_t));
+
+		m_lastPublishedPose = pose;
+		m_lastPublishTime = now;
+		m_bHasPublishedPose = true;
+
+		return true;
+	}
+
+	bool PosePublisher::IsSignificantChange(const vr::DriverPose_t &pose) const {
+		const ServerDriverConfig &config = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		const vr::DriverPose_t &last = m_lastPublishedPose;
+
+		// State changes always go out
+		if (pose.poseIsValid != last.poseIsValid ||
+			pose.result != last.result ||
+			pose.deviceIsConnected != last.deviceIsConnected) {
+			return true;
+		}
+
+		// So does a new HMD alignment
+		if (memcmp(&pose.qWorldFromDriverRotation, &last.qWorldFromDriverRotation, sizeof(vr::HmdQuaternion_t)) != 0 ||
+			memcmp(pose.vecWorldFromDriverTranslation, last.vecWorldFromDriverTranslation, sizeof(pose.vecWorldFromDriverTranslation)) != 0) {
+			return true;
+		}
+
+		const double dx = pose.vecPosition[0] - last.vecPosition[0];
+		const double dy = pose.vecPosition[1] - last.vecPosition[1];
+		const double dz = pose.vecPosition[2] - last.vecPosition[2];
+		const double epsilon = config.idle_position_epsilon_meters;
+		if (dx*dx + dy*dy + dz*dz > epsilon*epsilon) {
+			return true;
+		}
+
+		// Angle between the two rotations is 2*acos(|q1.q2|)
+		const double dot = fabs(
+			pose.qRotation.w*last.qRotation.w + pose.qRotation.x*last.qRotation.x +
+			pose.qRotation.y*last.qRotation.y + pose.qRotation.z*last.qRotation.z);
+		if (dot < cos(0.5 * config.idle_rotation_epsilon_radians)) {
+			return true;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <openvr_driver.h>
+#include <chrono>
+
+namespace steamvrbridge {
+
+	/* Posts a device's pose to vrserver, optionally skipping poses that barely differ from the last one
+	sent. Idle devices (trackers, controllers lying on a table) then only cost a periodic heartbeat.
+	Any change in validity, tracking result, connection state or world-from-driver transform is always
+	posted straight away.*/
+	class PosePublisher {
+	public:
+		PosePublisher();
+
+		// Posts the pose unless suppression is enabled and it is close enough to the last one posted.
+		// Returns true if the pose was posted.
+		bool Publish(vr::TrackedDeviceIndex_t device_index, const vr::DriverPose_t &pose);
+
+		// Makes the next Publish() post unconditionally.
+		void Invalidate() { m_bHasPublishedPose = false; }
+
+		inline int GetSuppressedPoseCount() const { return m_nSuppressedPoseCount; }
+
+	private:
+		bool IsSignificantChange(const vr::DriverPose_t &pose) const;
+
+		bool m_bHasPublishedPose;
+		vr::DriverPose_t m_lastPublishedPose;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_lastPublishTime;
+
+		// Number of poses skipped since the device was created
+		int m_nSuppressedPoseCount;
+	};
+}
@@ -6,15 +6,17 @@
 #include "settings_util.h"
 #include "driver.h"
 #include "facing_handsolver.h"
+#include "frame_profiler.h"
 #include "ps_ds4_controller.h"
 #include "trackable_device.h"
 #include <assert.h>
+#include <math.h>
 
 namespace steamvrbridge {
 
 	// -- PSDualshock4ControllerConfig -----
 	configuru::Config PSDualshock4ControllerConfig::WriteToJSON() {
-		configuru::Config &pt= ControllerConfig::WriteToJSON();
+		configuru::Config pt= ControllerConfig::WriteToJSON();
 
 		// Throwing power settings
 		pt["linear_velocity_multiplier"] = linear_velocity_multiplier;
@@ -150,13 +152,11 @@ namespace steamvrbridge {
 				CServerDriver_PSMoveService::getInstance()->LaunchPSMoveMonitor();
 			}
 
-			PSMRequestID requestId;
-			if (PSM_StartControllerDataStreamAsync(
+			m_dataStreamFlags = PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData;
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StartControllerDataStream(
 				m_PSMServiceController->ControllerID,
-				PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData,
-				&requestId) != PSMResult_Error) {
-				PSM_RegisterCallback(requestId, PSDualshock4Controller::start_controller_response_callback, this);
-			}
+				m_dataStreamFlags,
+				PSDualshock4Controller::start_controller_response_callback, this);
 
 			// Setup controller properties
 			{
@@ -253,11 +253,13 @@ namespace steamvrbridge {
 
 	void PSDualshock4Controller::Deactivate() {
 		Logger::Info("PSDualshock4Controller::Deactivate - Controller stream stopped\n");
-		PSM_StopControllerDataStreamAsync(m_PSMServiceController->ControllerID, nullptr);
+		CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StopControllerDataStream(m_PSMServiceController->ControllerID);
 		Controller::Deactivate();
 	}
 
 	void PSDualshock4Controller::UpdateControllerState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_ControllerState);
+
 		static const uint64_t s_kTouchpadButtonMask = vr::ButtonMaskFromId(vr::k_EButton_SteamVR_Touchpad);
 
 		assert(m_PSMServiceController != nullptr);
@@ -308,7 +310,7 @@ namespace steamvrbridge {
 		{
 			Logger::Info("PSDualshock4Controller::UpdateControllerState(): Calling StartRealignHMDTrackingSpace() in response to controller chord.\n");
 
-			PSM_ResetControllerOrientationAsync(m_PSMServiceController->ControllerID, k_psm_quaternion_identity, nullptr);
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().ResetControllerOrientation(m_PSMServiceController->ControllerID, *k_psm_quaternion_identity);
 			m_bResetPoseRequestSent = true;
 
 			// We have the transform of the HMD in world space. 
@@ -316,18 +318,11 @@ namespace steamvrbridge {
 			PSMVector3f controllerLocalOffsetFromHmdPosition = *k_psm_float_vector3_zero;
 			controllerLocalOffsetFromHmdPosition = { 0.0f, 0.0f, -1.0f * getConfig()->calibration_offset_meters };
 
-			try {
-				PSMPosef hmdPose = Utils::GetHMDPoseInMeters();
-				PSMPosef realignedPose = Utils::RealignHMDTrackingSpace(*k_psm_quaternion_identity,
-																		controllerLocalOffsetFromHmdPosition,
-																		m_PSMServiceController->ControllerID,
-																		hmdPose,
-																		getConfig()->use_orientation_in_hmd_alignment);
-				CServerDriver_PSMoveService::getInstance()->SetHMDTrackingSpace(realignedPose);
-			} catch (std::exception & e) {
-				// Log an error message and safely carry on
-				Logger::Error(e.what());
-			}
+			HMDAlignmentParams alignmentParams;
+			alignmentParams.controllerOrientationInHmdSpace = *k_psm_quaternion_identity;
+			alignmentParams.controllerLocalOffsetFromHmdPosition = controllerLocalOffsetFromHmdPosition;
+			alignmentParams.useControllerOrientation = getConfig()->use_orientation_in_hmd_alignment;
+			StartHMDAlignment(alignmentParams);
 
 			m_bResetAlignRequestSent = true;
 		}
@@ -335,7 +330,7 @@ namespace steamvrbridge {
 		{
 			Logger::Info("PSDualshock4Controller::UpdateControllerState(): Calling ClientPSMoveAPI::reset_orientation() in response to controller button press.\n");
 
-			PSM_ResetControllerOrientationAsync(m_PSMServiceController->ControllerID, k_psm_quaternion_identity, nullptr);
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().ResetControllerOrientation(m_PSMServiceController->ControllerID, *k_psm_quaternion_identity);
 			m_bResetPoseRequestSent = true;
 		}
 		else
@@ -528,6 +523,8 @@ namespace steamvrbridge {
 	}
 
 	void PSDualshock4Controller::UpdateTrackingState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_TrackingState);
+
 		assert(m_PSMServiceController != nullptr);
 		assert(m_PSMServiceController->IsConnected);
 
@@ -555,51 +552,6 @@ namespace steamvrbridge {
 		m_Pose.vecDriverFromHeadTranslation[1] = 0.f;
 		m_Pose.vecDriverFromHeadTranslation[2] = 0.f;
 
-		// Set position
-		{
-			const PSMVector3f &position = view.Pose.Position;
-			m_Pose.vecPosition[0] = position.x * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[1] = position.y * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[2] = position.z * k_fScalePSMoveAPIToMeters;
-		}
-
-		// virtual extend controllers
-		if (getConfig()->extend_Y_meters != 0.0f || getConfig()->extend_Z_meters != 0.0f) {
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			PSMVector3f shift = { (float)m_Pose.vecPosition[0], (float)m_Pose.vecPosition[1], (float)m_Pose.vecPosition[2] };
-
-			if (getConfig()->extend_Z_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, 0, -1 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Z_meters, &shift);
-			}
-
-			if (getConfig()->extend_Y_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, -1, 0 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Y_meters, &shift);
-			}
-
-			m_Pose.vecPosition[0] = shift.x;
-			m_Pose.vecPosition[1] = shift.y;
-			m_Pose.vecPosition[2] = shift.z;
-		}
-
-		// Set rotational coordinates
-		{
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			m_Pose.qRotation.w = getConfig()->z_rotate_90_degrees ? -orientation.w : orientation.w;
-			m_Pose.qRotation.x = orientation.x;
-			m_Pose.qRotation.y = orientation.y;
-			m_Pose.qRotation.z = getConfig()->z_rotate_90_degrees ? -orientation.z : orientation.z;
-		}
-
 		// Set the physics state of the controller
 		/*{
 			const PSMPhysicsData &physicsData = view.PhysicsData;
@@ -627,94 +579,83 @@ namespace steamvrbridge {
 			m_Pose.vecAngularAcceleration[2] = physicsData.AngularAccelerationRadPerSecSqr.z;
 		}*/
 
-		m_Pose.poseIsValid = view.bIsPositionValid && view.bIsOrientationValid;
-
-		// This call posts this pose to shared memory, where all clients will have access to it the next
-		// moment they want to predict a pose.
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unSteamVRTrackedDeviceId, m_Pose, sizeof(vr::DriverPose_t));
+		const ServerDriverConfig &serverConfig = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+		// Treat glitched optical samples like a momentary occlusion
+		const bool bIsPositionValid = view.bIsPositionValid && m_outlierGate.Accept(
+			view.Pose.Position,
+			m_PSMServiceController->OutputSequenceNum, m_PSMServiceController->DataFrameAverageFPS,
+			now, serverConfig);
+
+		// The history gets the gated validity so that upsampling never extrapolates from a rejected sample
+		m_poseHistory.Push(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			m_PSMServiceController->OutputSequenceNum, now);
+
+		// Hold the pose through short optical occlusions instead of dropping it straight away
+		PSMPosef pose;
+		bool bIsOccluded;
+		m_Pose.poseIsValid = m_occlusionPolicy.Apply(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			now, serverConfig,
+			&pose, &bIsOccluded);
+
+		if (bIsOccluded && m_Pose.result == vr::TrackingResult_Running_OK)
+			m_Pose.result = vr::TrackingResult_Running_OutOfRange;
+
+		// Position and rotation are filled in and the pose is posted once the whole frame has been batched
+		CServerDriver_PSMoveService::getInstance()->GetPoseBatch().Enqueue(
+			pose,
+			getConfig()->extend_Y_meters,
+			getConfig()->extend_Z_meters,
+			getConfig()->z_rotate_90_degrees,
+			m_unSteamVRTrackedDeviceId,
+			&m_Pose,
+			&m_posePublisher);
 	}
 
-	// TODO - Make use of amplitude and frequency for Buffered Haptics, will give us patterning and panning vibration
-	// See: https://developer.oculus.com/documentation/pcsdk/latest/concepts/dg-input-touch-haptic/
-	void PSDualshock4Controller::UpdateRumbleState(PSMControllerRumbleChannel channel) {
-		Controller::HapticState *haptic_state= 
-			GetHapticState(
-				channel == PSMControllerRumbleChannel_Left
-				? k_PSMHapticID_LeftRumble
-				: k_PSMHapticID_RightRumble);
-
-		if (haptic_state == nullptr)
-			return;
-
-		if (!getConfig()->rumble_suppressed) {
-			// pulse duration - the length of each pulse
-			// amplitude - strength of vibration
-			// frequency - speed of each pulse
-
-			// convert to microseconds, the max duration received from OpenVR appears to be 5 micro seconds
-			uint16_t pendingHapticPulseDurationMicroSecs = 
-				static_cast<uint16_t>(haptic_state->pendingHapticDurationSecs * 1000000);
-
-			const float k_max_rumble_update_rate = 33.f; // Don't bother trying to update the rumble faster than 30fps (33ms)
-			const float k_max_pulse_microseconds = 5000.f; // Docs suggest max pulse duration of 5ms, but we'll call 1ms max
+	void PSDualshock4Controller::UpdateRumbleState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_RumbleState);
+		ScopedProfileSpan span("Rumble Update", (int)m_unSteamVRTrackedDeviceId);
 
-			std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
-			bool bTimoutElapsed = true;
+		Controller::HapticState *haptic_states[2]= {
+			GetHapticState(k_PSMHapticID_LeftRumble),
+			GetHapticState(k_PSMHapticID_RightRumble)
+		};
 
-			if (haptic_state->lastTimeRumbleSentValid) {
-				std::chrono::duration<double, std::milli> timeSinceLastSend = now - haptic_state->lastTimeRumbleSent;
+		HapticScheduler *schedulers[2];
+		for (int i = 0; i < 2; ++i) {
+			schedulers[i]= haptic_states[i] != nullptr ? &haptic_states[i]->scheduler : nullptr;
 
-				bTimoutElapsed = timeSinceLastSend.count() >= k_max_rumble_update_rate;
+			// Drop anything queued while rumble is suppressed, which also stops a rumble in progress
+			if (schedulers[i] != nullptr && getConfig()->rumble_suppressed) {
+				schedulers[i]->Clear();
 			}
+		}
 
-			// See if a rumble request hasn't come too recently
-			if (bTimoutElapsed) {
-				float rumble_fraction = 
-					(static_cast<float>(pendingHapticPulseDurationMicroSecs) / k_max_pulse_microseconds) 
-					* haptic_state->pendingHapticAmplitude;
-
-				if (rumble_fraction > 0)
-				{
-					steamvrbridge::Logger::Debug(
-						"PSDualshock4Controller::UpdateRumble: m_pendingHapticPulseDurationSecs=%f, pendingHapticPulseDurationMicroSecs=%d, rumble_fraction=%f\n", 
-						haptic_state->pendingHapticDurationSecs, pendingHapticPulseDurationMicroSecs, rumble_fraction);
-				}
+		// Only talk to the server when a motor value actually changes
+		DualMotorHapticMixer::Output output;
+		if (!m_rumbleMixer.Update(schedulers, 2, std::chrono::high_resolution_clock::now(), &output))
+			return;
 
-				// Unless a zero rumble intensity was explicitly set, 
-				// don't rumble less than 35% (no enough to feel)
-				if (haptic_state->pendingHapticDurationSecs != 0) {
-					if (rumble_fraction < 0.35f) {
-						// rumble values less 35% isn't noticeable
-						rumble_fraction = 0.35f;
-					}
-				}
+		PSMCommandQueue &commands = CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue();
+		const PSMControllerID controllerId = m_PSMServiceController->ControllerID;
 
-				// Keep the pulse intensity within reasonable bounds
-				if (rumble_fraction > 1.f) {
-					rumble_fraction = 1.f;
-				}
+		// Changes caused by a haptic event are timed from its arrival, the rest (pulse ends, modulation) aren't
+		HapticLatencyStats *latencyStats = output.bHasEventArrival ? GetHapticLatencyStats() : nullptr;
 
-				// Actually send the rumble to the server
-				PSM_SetControllerRumble(m_PSMServiceController->ControllerID, channel, rumble_fraction);
-
-				// Remember the last rumble we went and when we sent it
-				haptic_state->lastTimeRumbleSent = now;
-				haptic_state->lastTimeRumbleSentValid = true;
-
-				// Reset the pending haptic pulse duration.
-				// If another call to TriggerHapticPulse() is made later, it will stomp this value.
-				// If no future haptic event is received by ServerDriver then the next call to UpdateRumbleState()
-				// in k_max_rumble_update_rate milliseconds will set the rumble_fraction to 0.f
-				// This effectively makes the shortest rumble pulse k_max_rumble_update_rate milliseconds.
-				haptic_state->pendingHapticDurationSecs = DEFAULT_HAPTIC_DURATION;
-				haptic_state->pendingHapticAmplitude = DEFAULT_HAPTIC_AMPLITUDE;
-				haptic_state->pendingHapticFrequency = DEFAULT_HAPTIC_FREQUENCY;
-			}
+		if (output.bLowFrequencyChanged && output.bHighFrequencyChanged && output.lowFrequencyValue == output.highFrequencyValue) {
+			commands.SetControllerRumble(controllerId, PSMControllerRumbleChannel_All, output.lowFrequencyValue, output.eventArrivalTime, latencyStats);
 		} else {
-			// Reset the pending haptic pulse duration since rumble is suppressed.
-			haptic_state->pendingHapticDurationSecs = DEFAULT_HAPTIC_DURATION;
-			haptic_state->pendingHapticAmplitude = DEFAULT_HAPTIC_AMPLITUDE;
-			haptic_state->pendingHapticFrequency = DEFAULT_HAPTIC_FREQUENCY;
+			if (output.bLowFrequencyChanged) {
+				commands.SetControllerRumble(controllerId, PSMControllerRumbleChannel_Left, output.lowFrequencyValue, output.eventArrivalTime, latencyStats);
+			}
+			if (output.bHighFrequencyChanged) {
+				commands.SetControllerRumble(controllerId, PSMControllerRumbleChannel_Right, output.highFrequencyValue, output.eventArrivalTime, latencyStats);
+			}
 		}
 	}
 
@@ -730,11 +671,14 @@ namespace steamvrbridge {
 
 				UpdateTrackingState();
 				UpdateControllerState();
+				UpdateHMDAlignment();
+			} else {
+				// Fill in the frames between optical samples if enabled
+				UpsampleTrackingState(getConfig()->extend_Y_meters, getConfig()->extend_Z_meters, getConfig()->z_rotate_90_degrees);
 			}
 
 			// Update the outgoing state
-			UpdateRumbleState(PSMControllerRumbleChannel_Left);
-			UpdateRumbleState(PSMControllerRumbleChannel_Right);
+			UpdateRumbleState();
 		}
 	}
 
@@ -98,7 +98,7 @@ namespace steamvrbridge {
 		void UpdateEmulatedTrackpad();
 		void UpdateControllerState();
 		void UpdateTrackingState();
-		void UpdateRumbleState(PSMControllerRumbleChannel channel);
+		void UpdateRumbleState();
 
 		// Parent controller to send button events to
 		Controller *m_parentController;
@@ -131,6 +131,9 @@ namespace steamvrbridge {
 		float m_lastSanitizedRightThumbstick_X;
 		float m_lastSanitizedRightThumbstick_Y;
 
+		// Combines both haptic components into the heavy (left) and light (right) motor
+		DualMotorHapticMixer m_rumbleMixer;
+
 		// Callbacks
 		static void start_controller_response_callback(const PSMResponseMessage *response, void *userdata);
 	};
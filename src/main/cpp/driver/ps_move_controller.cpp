@@ -6,9 +6,12 @@
 #include "settings_util.h"
 #include "driver.h"
 #include "facing_handsolver.h"
+#include "frame_profiler.h"
+#include "psm_math.h"
 #include "ps_move_controller.h"
 #include "trackable_device.h"
 #include <assert.h>
+#include <math.h>
 
 #if _MSC_VER
 #define strcasecmp(a, b) stricmp(a,b)
@@ -20,7 +23,7 @@ namespace steamvrbridge {
 
 	// -- PSMoveControllerConfig -----
 	configuru::Config PSMoveControllerConfig::WriteToJSON() {
-		configuru::Config &pt= ControllerConfig::WriteToJSON();
+		configuru::Config pt= ControllerConfig::WriteToJSON();
 
 		// Touch pad settings
 		pt["delay_after_touchpad_press"] = delay_after_touchpad_press;
@@ -144,13 +147,11 @@ namespace steamvrbridge {
 				CServerDriver_PSMoveService::getInstance()->LaunchPSMoveMonitor();
 			}
 
-			PSMRequestID requestId;
-			if (PSM_StartControllerDataStreamAsync(
+			m_dataStreamFlags = PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData;
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StartControllerDataStream(
 				m_PSMServiceController->ControllerID,
-				PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData,
-				&requestId) != PSMResult_Error) {
-				PSM_RegisterCallback(requestId, PSMoveController::start_controller_response_callback, this);
-			}
+				m_dataStreamFlags,
+				PSMoveController::start_controller_response_callback, this);
 
 			// Setup controller properties
 			{
@@ -231,12 +232,14 @@ namespace steamvrbridge {
 
 	void PSMoveController::Deactivate() {
 		Logger::Info("CPSMoveControllerLatest::Deactivate - Controller stream stopped\n");
-		PSM_StopControllerDataStreamAsync(m_PSMServiceController->ControllerID, nullptr);
+		CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StopControllerDataStream(m_PSMServiceController->ControllerID);
 
 		Controller::Deactivate();
 	}
 
 	void PSMoveController::UpdateControllerState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_ControllerState);
+
 		static const uint64_t s_kSystemButtonMask = vr::ButtonMaskFromId(vr::k_EButton_System);
 
 		assert(m_PSMServiceController != nullptr);
@@ -294,11 +297,11 @@ namespace steamvrbridge {
 		// recenter the controller orientation pose and start the realignment of the controller to HMD tracking space.
 		if (bStartRealignHMDTriggered && !getConfig()->disable_alignment_gesture) {
 			PSMVector3f controllerBallPointedUpEuler = { (float)M_PI_2, 0.0f, 0.0f };
-			PSMQuatf controllerBallPointedUpQuat = PSM_QuatfCreateFromAngles(&controllerBallPointedUpEuler);
+			PSMQuatf controllerBallPointedUpQuat = PSMMath::QuatfCreateFromAngles(controllerBallPointedUpEuler);
 
 			Logger::Info("PSMoveController::UpdateControllerState(): Calling StartRealignHMDTrackingSpace() in response to controller chord.\n");
 
-			PSM_ResetControllerOrientationAsync(m_PSMServiceController->ControllerID, &controllerBallPointedUpQuat, nullptr);
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().ResetControllerOrientation(m_PSMServiceController->ControllerID, controllerBallPointedUpQuat);
 			m_bResetPoseRequestSent = true;
 
 			// We have the transform of the HMD in world space. 
@@ -309,27 +312,20 @@ namespace steamvrbridge {
 			//    in the direction of the HMD's local +Y axis, 
 			// Translation) The controller's position is a few inches ahead of the HMD's on the HMD's local -Z axis. 
 			PSMVector3f eulerPitch = { (float)M_PI_2, 0.0f, 0.0f };
-			controllerOrientationInHmdSpaceQuat = PSM_QuatfCreateFromAngles(&eulerPitch);
+			controllerOrientationInHmdSpaceQuat = PSMMath::QuatfCreateFromAngles(eulerPitch);
 			controllerLocalOffsetFromHmdPosition = { 0.0f, 0.0f, -1.0f * getConfig()->calibration_offset_meters };
 
-			try {
-				PSMPosef hmdPose = Utils::GetHMDPoseInMeters();
-				PSMPosef realignedPose = Utils::RealignHMDTrackingSpace(controllerOrientationInHmdSpaceQuat,
-																		controllerLocalOffsetFromHmdPosition,
-																		m_PSMServiceController->ControllerID,
-																		hmdPose,
-																		getConfig()->use_orientation_in_hmd_alignment);
-				CServerDriver_PSMoveService::getInstance()->SetHMDTrackingSpace(realignedPose);
-			} catch (std::exception & e) {
-				// Log an error message and safely carry on
-				Logger::Error(e.what());
-			}
+			HMDAlignmentParams alignmentParams;
+			alignmentParams.controllerOrientationInHmdSpace = controllerOrientationInHmdSpaceQuat;
+			alignmentParams.controllerLocalOffsetFromHmdPosition = controllerLocalOffsetFromHmdPosition;
+			alignmentParams.useControllerOrientation = getConfig()->use_orientation_in_hmd_alignment;
+			StartHMDAlignment(alignmentParams);
 
 			m_bResetAlignRequestSent = true;
 		} else if (bRecenterRequestTriggered) {
 			Logger::Info("PSMoveController::UpdateControllerState(): Calling ClientPSMoveAPI::reset_orientation() in response to controller button press.\n");
 
-			PSM_ResetControllerOrientationAsync(m_PSMServiceController->ControllerID, k_psm_quaternion_identity, nullptr);
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().ResetControllerOrientation(m_PSMServiceController->ControllerID, *k_psm_quaternion_identity);
 			m_bResetPoseRequestSent = true;
 		} else {
 
@@ -515,7 +511,7 @@ namespace steamvrbridge {
 					PSMVector3f newPosMeters;
 					Utils::GetMetersPosInRotSpace(&m_driverSpaceRotationAtTouchpadPressTime, &newPosMeters, m_PSMServiceController->ControllerState.PSMoveState);
 
-					PSMVector3f offsetMeters = PSM_Vector3fSubtract(&newPosMeters, &m_posMetersAtTouchpadPressTime);
+					PSMVector3f offsetMeters = PSMMath::Vector3fSubtract(newPosMeters, m_posMetersAtTouchpadPressTime);
 
 					#if LOG_TOUCHPAD_EMULATION != 0
 					Logger::Info("Touchpad held! Relative position (%f, %f, %f) meters\n",
@@ -543,6 +539,8 @@ namespace steamvrbridge {
 	}
 
 	void PSMoveController::UpdateTrackingState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_TrackingState);
+
 		assert(m_PSMServiceController != nullptr);
 		assert(m_PSMServiceController->IsConnected);
 
@@ -570,51 +568,6 @@ namespace steamvrbridge {
 		m_Pose.vecDriverFromHeadTranslation[1] = 0.f;
 		m_Pose.vecDriverFromHeadTranslation[2] = 0.f;
 
-		// Set position
-		{
-			const PSMVector3f &position = view.Pose.Position;
-			m_Pose.vecPosition[0] = position.x * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[1] = position.y * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[2] = position.z * k_fScalePSMoveAPIToMeters;
-		}
-
-		// virtual extend controllers
-		if (getConfig()->extend_Y_meters != 0.0f || getConfig()->extend_Z_meters != 0.0f) {
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			PSMVector3f shift = { (float)m_Pose.vecPosition[0], (float)m_Pose.vecPosition[1], (float)m_Pose.vecPosition[2] };
-
-			if (getConfig()->extend_Z_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, 0, -1 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Z_meters, &shift);
-			}
-
-			if (getConfig()->extend_Y_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, -1, 0 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Y_meters, &shift);
-			}
-
-			m_Pose.vecPosition[0] = shift.x;
-			m_Pose.vecPosition[1] = shift.y;
-			m_Pose.vecPosition[2] = shift.z;
-		}
-
-		// Set rotational coordinates
-		{
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			m_Pose.qRotation.w = getConfig()->z_rotate_90_degrees ? -orientation.w : orientation.w;
-			m_Pose.qRotation.x = orientation.x;
-			m_Pose.qRotation.y = orientation.y;
-			m_Pose.qRotation.z = getConfig()->z_rotate_90_degrees ? -orientation.z : orientation.z;
-		}
-
 		// Set the physics state of the controller
 		/*{
 			const PSMPhysicsData &physicsData = view.PhysicsData;
@@ -642,90 +595,70 @@ namespace steamvrbridge {
 			m_Pose.vecAngularAcceleration[2] = physicsData.AngularAccelerationRadPerSecSqr.z;
 		}*/
 
-		m_Pose.poseIsValid = view.bIsPositionValid && view.bIsOrientationValid;
-
-		// This call posts this pose to shared memory, where all clients will have access to it the next
-		// moment they want to predict a pose.
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unSteamVRTrackedDeviceId, m_Pose, sizeof(vr::DriverPose_t));
+		const ServerDriverConfig &serverConfig = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+		// Treat glitched optical samples like a momentary occlusion
+		const bool bIsPositionValid = view.bIsPositionValid && m_outlierGate.Accept(
+			view.Pose.Position,
+			m_PSMServiceController->OutputSequenceNum, m_PSMServiceController->DataFrameAverageFPS,
+			now, serverConfig);
+
+		// The history gets the gated validity so that upsampling never extrapolates from a rejected sample
+		m_poseHistory.Push(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			m_PSMServiceController->OutputSequenceNum, now);
+
+		// Hold the pose through short optical occlusions instead of dropping it straight away
+		PSMPosef pose;
+		bool bIsOccluded;
+		m_Pose.poseIsValid = m_occlusionPolicy.Apply(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			now, serverConfig,
+			&pose, &bIsOccluded);
+
+		if (bIsOccluded && m_Pose.result == vr::TrackingResult_Running_OK)
+			m_Pose.result = vr::TrackingResult_Running_OutOfRange;
+
+		// Position and rotation are filled in and the pose is posted once the whole frame has been batched
+		CServerDriver_PSMoveService::getInstance()->GetPoseBatch().Enqueue(
+			pose,
+			getConfig()->extend_Y_meters,
+			getConfig()->extend_Z_meters,
+			getConfig()->z_rotate_90_degrees,
+			m_unSteamVRTrackedDeviceId,
+			&m_Pose,
+			&m_posePublisher);
 	}
 
-	// TODO - Make use of amplitude and frequency for Buffered Haptics, will give us patterning and panning vibration (for ds4?).
-	// See: https://developer.oculus.com/documentation/pcsdk/latest/concepts/dg-input-touch-haptic/
 	void PSMoveController::UpdateRumbleState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_RumbleState);
+		ScopedProfileSpan span("Rumble Update", (int)m_unSteamVRTrackedDeviceId);
+
 		Controller::HapticState *haptic_state= GetHapticState(k_PSMHapticID_Rumble);
 
 		if (haptic_state == nullptr)
 			return;
 
-		if (!getConfig()->rumble_suppressed) {
-			// pulse duration - the length of each pulse
-			// amplitude - strength of vibration
-			// frequency - speed of each pulse
-
-			// convert to microseconds, the max duration received from OpenVR appears to be 5 micro seconds
-			uint16_t pendingHapticPulseDurationMicroSecs = 
-				static_cast<uint16_t>(haptic_state->pendingHapticDurationSecs * 1000000);
-
-			const float k_max_rumble_update_rate = 33.f; // Don't bother trying to update the rumble faster than 30fps (33ms)
-			const float k_max_pulse_microseconds = 5000.f; // Docs suggest max pulse duration of 5ms, but we'll call 1ms max
-
-			std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
-			bool bTimoutElapsed = true;
-
-			if (haptic_state->lastTimeRumbleSentValid) {
-				std::chrono::duration<double, std::milli> timeSinceLastSend = now - haptic_state->lastTimeRumbleSent;
-
-				bTimoutElapsed = timeSinceLastSend.count() >= k_max_rumble_update_rate;
-			}
-
-			// See if a rumble request hasn't come too recently
-			if (bTimoutElapsed) {
-				float rumble_fraction = 
-					(static_cast<float>(pendingHapticPulseDurationMicroSecs) / k_max_pulse_microseconds) 
-					* haptic_state->pendingHapticAmplitude;
-
-				if (rumble_fraction > 0)
-				{
-					steamvrbridge::Logger::Debug(
-						"PSMoveController::UpdateRumble: m_pendingHapticPulseDurationSecs=%f, pendingHapticPulseDurationMicroSecs=%d, rumble_fraction=%f\n", 
-						haptic_state->pendingHapticDurationSecs, pendingHapticPulseDurationMicroSecs, rumble_fraction);
-				}
-
-				// Unless a zero rumble intensity was explicitly set, 
-				// don't rumble less than 35% (no enough to feel)
-				if (haptic_state->pendingHapticDurationSecs != 0) {
-					if (rumble_fraction < 0.35f) {
-						// rumble values less 35% isn't noticeable
-						rumble_fraction = 0.35f;
-					}
-				}
+		// Drop anything queued while rumble is suppressed, which also stops a rumble in progress
+		if (getConfig()->rumble_suppressed) {
+			haptic_state->scheduler.Clear();
+		}
 
-				// Keep the pulse intensity within reasonable bounds
-				if (rumble_fraction > 1.f) {
-					rumble_fraction = 1.f;
-				}
+		// Only talk to the server when the motor value actually changes
+		float rumble_fraction;
+		if (haptic_state->scheduler.Update(std::chrono::high_resolution_clock::now(), &rumble_fraction)) {
+			PSMCommandQueue &commands = CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue();
 
-				// Actually send the rumble to the server
-				PSM_SetControllerRumble(m_PSMServiceController->ControllerID, PSMControllerRumbleChannel_All, rumble_fraction);
-
-				// Remember the last rumble we went and when we sent it
-				haptic_state->lastTimeRumbleSent = now;
-				haptic_state->lastTimeRumbleSentValid = true;
-
-				// Reset the pending haptic pulse duration.
-				// If another call to TriggerHapticPulse() is made later, it will stomp this value.
-				// If no future haptic event is received by ServerDriver then the next call to UpdateRumbleState()
-				// in k_max_rumble_update_rate milliseconds will set the rumble_fraction to 0.f
-				// This effectively makes the shortest rumble pulse k_max_rumble_update_rate milliseconds.
-				haptic_state->pendingHapticDurationSecs = DEFAULT_HAPTIC_DURATION;
-				haptic_state->pendingHapticAmplitude = DEFAULT_HAPTIC_AMPLITUDE;
-				haptic_state->pendingHapticFrequency = DEFAULT_HAPTIC_FREQUENCY;
+			// Changes caused by a haptic event are timed from its arrival, the rest (pulse ends, modulation) aren't
+			std::chrono::time_point<std::chrono::high_resolution_clock> eventArrivalTime;
+			if (haptic_state->scheduler.TakePendingEventArrival(&eventArrivalTime)) {
+				commands.SetControllerRumble(m_PSMServiceController->ControllerID, PSMControllerRumbleChannel_All, rumble_fraction, eventArrivalTime, GetHapticLatencyStats());
+			} else {
+				commands.SetControllerRumble(m_PSMServiceController->ControllerID, PSMControllerRumbleChannel_All, rumble_fraction);
 			}
-		} else {
-			// Reset the pending haptic pulse duration since rumble is suppressed.
-			haptic_state->pendingHapticDurationSecs = DEFAULT_HAPTIC_DURATION;
-			haptic_state->pendingHapticAmplitude = DEFAULT_HAPTIC_AMPLITUDE;
-			haptic_state->pendingHapticFrequency = DEFAULT_HAPTIC_FREQUENCY;
 		}
 	}
 
@@ -792,6 +725,10 @@ namespace steamvrbridge {
 
 				UpdateTrackingState();
 				UpdateControllerState();
+				UpdateHMDAlignment();
+			} else {
+				// Fill in the frames between optical samples if enabled
+				UpsampleTrackingState(getConfig()->extend_Y_meters, getConfig()->extend_Z_meters, getConfig()->z_rotate_90_degrees);
 			}
 
 			// Update the outgoing state
@@ -9,6 +9,7 @@
 #include "ps_navi_controller.h"
 #include "trackable_device.h"
 #include <assert.h>
+#include <math.h>
 
 #if _MSC_VER
 #define strcasecmp(a, b) stricmp(a,b)
@@ -20,7 +21,7 @@ namespace steamvrbridge {
 
 	// -- PSNaviControllerConfig -----
 	configuru::Config PSNaviControllerConfig::WriteToJSON() {
-		configuru::Config &pt= ControllerConfig::WriteToJSON();
+		configuru::Config pt= ControllerConfig::WriteToJSON();
 
 		// General Settings
 		pt["thumbstick_deadzone"] = thumbstick_deadzone;
@@ -110,13 +111,10 @@ namespace steamvrbridge {
 			m_parentController= parent_controller;
 			m_ulPropertyContainer = parent_controller->getPropertyContainerHandle();
 
-			PSMRequestID requestId;
-			if (PSM_StartControllerDataStreamAsync(
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StartControllerDataStream(
 				m_PSMServiceController->ControllerID,
 				PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData,
-				&requestId) != PSMResult_Error) {
-				PSM_RegisterCallback(requestId, PSNaviController::start_controller_response_callback, this);
-			}
+				PSNaviController::start_controller_response_callback, this);
 		}
 		else
 		{
@@ -137,13 +135,10 @@ namespace steamvrbridge {
 		if (result == vr::VRInitError_None) {
 			Logger::Info("PSNaviController::Activate - Controller %d Activated\n", unObjectId);
 
-			PSMRequestID requestId;
-			if (PSM_StartControllerDataStreamAsync(
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StartControllerDataStream(
 				m_PSMServiceController->ControllerID,
 				PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData,
-				&requestId) != PSMResult_Error) {
-				PSM_RegisterCallback(requestId, PSNaviController::start_controller_response_callback, this);
-			}
+				PSNaviController::start_controller_response_callback, this);
 
 			// Setup controller properties
 			{
@@ -226,11 +221,13 @@ namespace steamvrbridge {
 
 	void PSNaviController::Deactivate() {
 		Logger::Info("PSNaviController::Deactivate - Controller stream stopped\n");
-		PSM_StopControllerDataStreamAsync(m_PSMServiceController->ControllerID, nullptr);
+		CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StopControllerDataStream(m_PSMServiceController->ControllerID);
 		Controller::Deactivate();
 	}
 
 	void PSNaviController::UpdateControllerState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_ControllerState);
+
 		static const uint64_t s_kTouchpadButtonMask = vr::ButtonMaskFromId(vr::k_EButton_SteamVR_Touchpad);
 
 		assert(m_PSMServiceController != nullptr);
@@ -402,6 +399,8 @@ namespace steamvrbridge {
 	}
 
 	void PSNaviController::UpdateTrackingState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_TrackingState);
+
 		assert(m_PSMServiceController != nullptr);
 		assert(m_PSMServiceController->IsConnected);
 
@@ -441,9 +440,8 @@ namespace steamvrbridge {
 
 		m_Pose.poseIsValid = false;
 
-		// This call posts this pose to shared memory, where all clients will have access to it the next
-		// moment they want to predict a pose.
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unSteamVRTrackedDeviceId, m_Pose, sizeof(vr::DriverPose_t));
+		// Posts this pose to shared memory unless it hasn't meaningfully changed since the last post
+		m_posePublisher.Publish(m_unSteamVRTrackedDeviceId, m_Pose);
 	}
 
 	void PSNaviController::Update() {
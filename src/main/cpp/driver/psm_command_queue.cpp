@@ -0,0 +1,206 @@
+#include "psm_command_queue.h"
+#include "logger.h"
+#include "update_timing.h"
+
+namespace steamvrbridge {
+
+	PSMCommandQueue::PSMCommandQueue()
+		: m_bCollecting(false)
+		, m_nRequestedCount(0)
+		, m_nSentCount(0)
+		, m_intervalStartTime(std::chrono::high_resolution_clock::now()) {
+		m_pendingControllers.reserve(PSMOVESERVICE_MAX_CONTROLLER_COUNT);
+	}
+
+	void PSMCommandQueue::BeginFrame() {
+		m_bCollecting = true;
+	}
+
+	void PSMCommandQueue::Flush() {
+		m_bCollecting = false;
+
+		for (auto it = m_pendingControllers.begin(); it != m_pendingControllers.end(); ++it) {
+			const ControllerCommands &commands = *it;
+
+			if (commands.streamCommand == StreamCommand_Start) {
+				SendStartStream(commands.controllerId, commands.streamFlags, commands.streamCallback, commands.streamUserdata);
+			}
+
+			if (commands.bHasOrientationReset) {
+				SendOrientationReset(commands.controllerId, commands.resetOrientation);
+			}
+
+			// Both channels first, so a single channel queued after it still has the final say
+			for (int channel = PSMControllerRumbleChannel_All; channel <= PSMControllerRumbleChannel_Right; ++channel) {
+				if (commands.bHasRumble[channel]) {
+					SendRumble(commands.controllerId, static_cast<PSMControllerRumbleChannel>(channel), commands.rumbleFraction[channel]);
+				}
+			}
+
+			if (commands.rumbleLatencyStats != nullptr) {
+				commands.rumbleLatencyStats->AddSample(std::chrono::high_resolution_clock::now() - commands.rumbleEventArrivalTime);
+			}
+
+			if (commands.streamCommand == StreamCommand_Stop) {
+				SendStopStream(commands.controllerId);
+			}
+		}
+
+		m_pendingControllers.clear();
+	}
+
+	void PSMCommandQueue::Clear() {
+		m_pendingControllers.clear();
+	}
+
+	void PSMCommandQueue::SetControllerRumble(PSMControllerID controllerId, PSMControllerRumbleChannel channel, float rumbleFraction) {
+		++m_nRequestedCount;
+
+		if (!m_bCollecting) {
+			SendRumble(controllerId, channel, rumbleFraction);
+			return;
+		}
+
+		ControllerCommands &commands = FindOrAddController(controllerId);
+
+		// Setting both channels overrides anything queued for either of them
+		if (channel == PSMControllerRumbleChannel_All) {
+			commands.bHasRumble[PSMControllerRumbleChannel_Left] = false;
+			commands.bHasRumble[PSMControllerRumbleChannel_Right] = false;
+		}
+
+		commands.bHasRumble[channel] = true;
+		commands.rumbleFraction[channel] = rumbleFraction;
+	}
+
+	void PSMCommandQueue::SetControllerRumble(
+		PSMControllerID controllerId,
+		PSMControllerRumbleChannel channel,
+		float rumbleFraction,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &eventArrivalTime,
+		HapticLatencyStats *latencyStats) {
+		SetControllerRumble(controllerId, channel, rumbleFraction);
+
+		if (latencyStats == nullptr)
+			return;
+
+		if (!m_bCollecting) {
+			latencyStats->AddSample(std::chrono::high_resolution_clock::now() - eventArrivalTime);
+			return;
+		}
+
+		ControllerCommands &commands = FindOrAddController(controllerId);
+		if (commands.rumbleLatencyStats == nullptr || eventArrivalTime < commands.rumbleEventArrivalTime) {
+			commands.rumbleLatencyStats = latencyStats;
+			commands.rumbleEventArrivalTime = eventArrivalTime;
+		}
+	}
+
+	void PSMCommandQueue::ResetControllerOrientation(PSMControllerID controllerId, const PSMQuatf &orientation) {
+		++m_nRequestedCount;
+
+		if (!m_bCollecting) {
+			SendOrientationReset(controllerId, orientation);
+			return;
+		}
+
+		ControllerCommands &commands = FindOrAddController(controllerId);
+		commands.bHasOrientationReset = true;
+		commands.resetOrientation = orientation;
+	}
+
+	void PSMCommandQueue::StartControllerDataStream(
+		PSMControllerID controllerId,
+		unsigned int streamFlags,
+		PSMResponseCallback callback,
+		void *userdata) {
+		++m_nRequestedCount;
+
+		if (!m_bCollecting) {
+			SendStartStream(controllerId, streamFlags, callback, userdata);
+			return;
+		}
+
+		ControllerCommands &commands = FindOrAddController(controllerId);
+		commands.streamCommand = StreamCommand_Start;
+		commands.streamFlags = streamFlags;
+		commands.streamCallback = callback;
+		commands.streamUserdata = userdata;
+	}
+
+	void PSMCommandQueue::StopControllerDataStream(PSMControllerID controllerId) {
+		++m_nRequestedCount;
+
+		if (!m_bCollecting) {
+			SendStopStream(controllerId);
+			return;
+		}
+
+		// The stream ends up stopped either way, so a start queued earlier this frame is dropped
+		ControllerCommands &commands = FindOrAddController(controllerId);
+		commands.streamCommand = StreamCommand_Stop;
+		commands.streamCallback = nullptr;
+		commands.streamUserdata = nullptr;
+	}
+
+	void PSMCommandQueue::LogIfDue(const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float interval_seconds) {
+		const float elapsedSeconds = std::chrono::duration<float>(now - m_intervalStartTime).count();
+		if (elapsedSeconds < interval_seconds || elapsedSeconds <= 0.f)
+			return;
+
+		Logger::Info("PSMCommandQueue - %.1f commands/sec sent, %.1f commands/sec requested\n",
+			m_nSentCount / elapsedSeconds, m_nRequestedCount / elapsedSeconds);
+
+		m_nRequestedCount = 0;
+		m_nSentCount = 0;
+		m_intervalStartTime = now;
+	}
+
+	PSMCommandQueue::ControllerCommands &PSMCommandQueue::FindOrAddController(PSMControllerID controllerId) {
+		for (auto it = m_pendingControllers.begin(); it != m_pendingControllers.end(); ++it) {
+			if (it->controllerId == controllerId)
+				return *it;
+		}
+
+		ControllerCommands commands;
+		commands.controllerId = controllerId;
+		for (int channel = 0; channel < 3; ++channel) {
+			commands.bHasRumble[channel] = false;
+			commands.rumbleFraction[channel] = 0.f;
+		}
+		commands.rumbleLatencyStats = nullptr;
+		commands.bHasOrientationReset = false;
+		commands.resetOrientation = *k_psm_quaternion_identity;
+		commands.streamCommand = StreamCommand_None;
+		commands.streamFlags = 0;
+		commands.streamCallback = nullptr;
+		commands.streamUserdata = nullptr;
+
+		m_pendingControllers.push_back(commands);
+		return m_pendingControllers.back();
+	}
+
+	void PSMCommandQueue::SendRumble(PSMControllerID controllerId, PSMControllerRumbleChannel channel, float rumbleFraction) {
+		++m_nSentCount;
+		PSM_SetControllerRumble(controllerId, channel, rumbleFraction);
+	}
+
+	void PSMCommandQueue::SendOrientationReset(PSMControllerID controllerId, const PSMQuatf &orientation) {
+		++m_nSentCount;
+		PSM_ResetControllerOrientationAsync(controllerId, &orientation, nullptr);
+	}
+
+	void PSMCommandQueue::SendStartStream(PSMControllerID controllerId, unsigned int streamFlags, PSMResponseCallback callback, void *userdata) {
+		++m_nSentCount;
+
+		PSMRequestID requestId;
+		if (PSM_StartControllerDataStreamAsync(controllerId, streamFlags, &requestId) != PSMResult_Error && callback != nullptr) {
+			PSM_RegisterCallback(requestId, callback, userdata);
+		}
+	}
+
+	void PSMCommandQueue::SendStopStream(PSMControllerID controllerId) {
+		++m_nSentCount;
+		PSM_StopControllerDataStreamAsync(controllerId, nullptr);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+#include <vector>
+
+namespace steamvrbridge {
+
+	class HapticLatencyStats;
+
+	/* Collects the commands the driver sends to PSMoveService during a frame (rumble, orientation resets
+	and controller stream start/stop) and sends them together when the frame is flushed. Commands for the
+	same controller are coalesced, so only the newest rumble value per channel, the newest orientation
+	reset and the newest stream request make it to the service. Outside of BeginFrame()/Flush() every
+	command is sent straight away, which keeps activation and shutdown paths working as before.*/
+	class PSMCommandQueue {
+	public:
+		PSMCommandQueue();
+
+		// Starts collecting commands until the next Flush()
+		void BeginFrame();
+
+		// Sends everything collected since BeginFrame() and goes back to sending commands immediately.
+		void Flush();
+
+		// Drops everything collected, e.g. when the connection they were meant for is being replaced.
+		void Clear();
+
+		void SetControllerRumble(PSMControllerID controllerId, PSMControllerRumbleChannel channel, float rumbleFraction);
+
+		// Same as above for a rumble caused by a haptic event. The time from the event's arrival to the
+		// command actually being sent is added to latencyStats, when given.
+		void SetControllerRumble(
+			PSMControllerID controllerId,
+			PSMControllerRumbleChannel channel,
+			float rumbleFraction,
+			const std::chrono::time_point<std::chrono::high_resolution_clock> &eventArrivalTime,
+			HapticLatencyStats *latencyStats);
+
+		void ResetControllerOrientation(PSMControllerID controllerId, const PSMQuatf &orientation);
+
+		// The callback, when given, is registered for the response to the stream request once it is sent.
+		void StartControllerDataStream(PSMControllerID controllerId, unsigned int streamFlags, PSMResponseCallback callback, void *userdata);
+		void StopControllerDataStream(PSMControllerID controllerId);
+
+		// Logs the requested and sent commands per second once the interval has passed, then resets.
+		void LogIfDue(const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float interval_seconds);
+
+	private:
+		enum eStreamCommand {
+			StreamCommand_None,
+			StreamCommand_Start,
+			StreamCommand_Stop
+		};
+
+		// Pending commands of one controller, indexed by PSMControllerRumbleChannel for the rumble
+		struct ControllerCommands {
+			PSMControllerID controllerId;
+
+			bool bHasRumble[3];
+			float rumbleFraction[3];
+
+			// Oldest haptic event behind the queued rumble, measured once it is sent
+			HapticLatencyStats *rumbleLatencyStats;
+			std::chrono::time_point<std::chrono::high_resolution_clock> rumbleEventArrivalTime;
+
+			bool bHasOrientationReset;
+			PSMQuatf resetOrientation;
+
+			eStreamCommand streamCommand;
+			unsigned int streamFlags;
+			PSMResponseCallback streamCallback;
+			void *streamUserdata;
+		};
+
+		ControllerCommands &FindOrAddController(PSMControllerID controllerId);
+
+		void SendRumble(PSMControllerID controllerId, PSMControllerRumbleChannel channel, float rumbleFraction);
+		void SendOrientationReset(PSMControllerID controllerId, const PSMQuatf &orientation);
+		void SendStartStream(PSMControllerID controllerId, unsigned int streamFlags, PSMResponseCallback callback, void *userdata);
+		void SendStopStream(PSMControllerID controllerId);
+
+		bool m_bCollecting;
+
+		// Controllers with pending commands this frame, keeps its capacity between frames
+		std::vector<ControllerCommands> m_pendingControllers;
+
+		// Counts since the start of the current log interval
+		int m_nRequestedCount;
+		int m_nSentCount;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_intervalStartTime;
+	};
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <float.h>
+#include <math.h>
+
+namespace steamvrbridge {
+
+	/* Inline versions of the PSM_* vector, quaternion and pose helpers used on the per-frame paths.
+	They operate directly on PSMVector3f, PSMQuatf and PSMPosef, take references instead of pointers
+	and follow the same argument order and conventions as the C API they replace, so a call site
+	converts by dropping the PSM_ prefix and the address-of operators. Unlike the exported functions
+	these can be inlined and vectorized by the compiler. Everything that doesn't need sqrt or trig
+	is constexpr (C++11 single expression form).*/
+	namespace PSMMath {
+
+		// Lengths at or below this normalize to the supplied default, same threshold as the C API
+		static const float k_fNormalizeEpsilon = FLT_EPSILON;
+
+		//-- Vector3f --
+		inline constexpr PSMVector3f Vector3fCreate(float x, float y, float z) {
+			return PSMVector3f{ x, y, z };
+		}
+
+		inline constexpr PSMVector3f Vector3fAdd(const PSMVector3f &a, const PSMVector3f &b) {
+			return PSMVector3f{ a.x + b.x, a.y + b.y, a.z + b.z };
+		}
+
+		inline constexpr PSMVector3f Vector3fSubtract(const PSMVector3f &a, const PSMVector3f &b) {
+			return PSMVector3f{ a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		inline constexpr PSMVector3f Vector3fScale(const PSMVector3f &v, float s) {
+			return PSMVector3f{ v.x*s, v.y*s, v.z*s };
+		}
+
+		// a*s + b
+		inline constexpr PSMVector3f Vector3fScaleAndAdd(const PSMVector3f &a, float s, const PSMVector3f &b) {
+			return PSMVector3f{ a.x*s + b.x, a.y*s + b.y, a.z*s + b.z };
+		}
+
+		inline constexpr float Vector3fDot(const PSMVector3f &a, const PSMVector3f &b) {
+			return a.x*b.x + a.y*b.y + a.z*b.z;
+		}
+
+		inline constexpr PSMVector3f Vector3fCross(const PSMVector3f &a, const PSMVector3f &b) {
+			return PSMVector3f{ a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x };
+		}
+
+		inline float Vector3fLength(const PSMVector3f &v) {
+			return sqrtf(Vector3fDot(v, v));
+		}
+
+		inline PSMVector3f Vector3fNormalizeWithDefault(const PSMVector3f &v, const PSMVector3f &default_result) {
+			const float length = Vector3fLength(v);
+
+			return length > k_fNormalizeEpsilon ? Vector3fScale(v, 1.f / length) : default_result;
+		}
+
+		//-- Quatf --
+		inline constexpr PSMQuatf QuatfCreate(float w, float x, float y, float z) {
+			return PSMQuatf{ w, x, y, z };
+		}
+
+		// Same convention as PSM_QuatfCreateFromAngles: x = bank, y = heading, z = attitude, in radians
+		inline PSMQuatf QuatfCreateFromAngles(const PSMVector3f &euler_angles) {
+			const float c1 = cosf(euler_angles.y * 0.5f);
+			const float s1 = sinf(euler_angles.y * 0.5f);
+			const float c2 = cosf(euler_angles.z * 0.5f);
+			const float s2 = sinf(euler_angles.z * 0.5f);
+			const float c3 = cosf(euler_angles.x * 0.5f);
+			const float s3 = sinf(euler_angles.x * 0.5f);
+			const float c1c2 = c1*c2;
+			const float s1s2 = s1*s2;
+
+			return PSMQuatf{
+				c1c2*c3 - s1s2*s3,
+				c1c2*s3 + s1s2*c3,
+				s1*c2*c3 + c1*s2*s3,
+				c1*s2*c3 - s1*c2*s3 };
+		}
+
+		// Hamilton product a*b
+		inline constexpr PSMQuatf QuatfMultiply(const PSMQuatf &a, const PSMQuatf &b) {
+			return PSMQuatf{
+				a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+				a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+				a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+				a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w };
+		}
+
+		// Rotation that applies first, then second (second*first), like PSM_QuatfConcat
+		inline constexpr PSMQuatf QuatfConcat(const PSMQuatf &first, const PSMQuatf &second) {
+			return QuatfMultiply(second, first);
+		}
+
+		inline constexpr PSMQuatf QuatfConjugate(const PSMQuatf &q) {
+			return PSMQuatf{ q.w, -q.x, -q.y, -q.z };
+		}
+
+		inline constexpr PSMVector3f QuatfRotateVectorWithCross(const PSMQuatf &q, const PSMVector3f &v, const PSMVector3f &t) {
+			return PSMVector3f{
+				v.x + q.w*t.x + (q.y*t.z - q.z*t.y),
+				v.y + q.w*t.y + (q.z*t.x - q.x*t.z),
+				v.z + q.w*t.z + (q.x*t.y - q.y*t.x) };
+		}
+
+		// q*v*q' for a unit quaternion, as v + w*t + (q.xyz x t) with t = 2*(q.xyz x v)
+		inline constexpr PSMVector3f QuatfRotateVector(const PSMQuatf &q, const PSMVector3f &v) {
+			return QuatfRotateVectorWithCross(q, v, PSMVector3f{
+				2.f*(q.y*v.z - q.z*v.y),
+				2.f*(q.z*v.x - q.x*v.z),
+				2.f*(q.x*v.y - q.y*v.x) });
+		}
+
+		inline PSMQuatf QuatfNormalizeWithDefault(const PSMQuatf &q, const PSMQuatf &default_result) {
+			const float length = sqrtf(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+			if (length <= k_fNormalizeEpsilon)
+				return default_result;
+
+			const float inv_length = 1.f / length;
+			return PSMQuatf{ q.w*inv_length, q.x*inv_length, q.y*inv_length, q.z*inv_length };
+		}
+
+		//-- Posef --
+		inline constexpr PSMPosef PosefCreate(const PSMVector3f &position, const PSMQuatf &orientation) {
+			return PSMPosef{ position, orientation };
+		}
+
+		// Pose that applies first, then second, like PSM_PosefConcat
+		inline constexpr PSMPosef PosefConcat(const PSMPosef &first, const PSMPosef &second) {
+			return PSMPosef{
+				Vector3fAdd(QuatfRotateVector(second.Orientation, first.Position), second.Position),
+				QuatfConcat(first.Orientation, second.Orientation) };
+		}
+
+		inline constexpr PSMPosef PosefInverse(const PSMPosef &pose) {
+			return PSMPosef{
+				Vector3fScale(QuatfRotateVector(QuatfConjugate(pose.Orientation), pose.Position), -1.f),
+				QuatfConjugate(pose.Orientation) };
+		}
+
+		inline constexpr PSMVector3f PosefTransformPoint(const PSMPosef &pose, const PSMVector3f &p) {
+			return Vector3fAdd(QuatfRotateVector(pose.Orientation, p), pose.Position);
+		}
+
+		inline constexpr PSMVector3f PosefInverseTransformPoint(const PSMPosef &pose, const PSMVector3f &p) {
+			return QuatfRotateVector(QuatfConjugate(pose.Orientation), Vector3fSubtract(p, pose.Position));
+		}
+	}
+}
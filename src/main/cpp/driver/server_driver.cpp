@@ -3,6 +3,8 @@
 #include "ps_move_controller.h"
 #include "ps_navi_controller.h"
 #include "virtual_controller.h"
+#include "frame_profiler.h"
+#include "trace_log.h"
 #include "utils.h"
 
 #include <ctime>
@@ -18,7 +20,8 @@ namespace steamvrbridge {
 	CServerDriver_PSMoveService::CServerDriver_PSMoveService()
 		: m_bLaunchedPSMoveMonitor(false)
 		, m_bLaunchedPSMoveService(false)
-		, m_bInitialized(false) {
+		, m_bInitialized(false)
+		, m_hmdDriftCorrector(m_psmCommands) {
 	}
 
 	CServerDriver_PSMoveService::~CServerDriver_PSMoveService() {
@@ -47,6 +50,32 @@ namespace steamvrbridge {
 			// Save the config back out in case the config didn't exist or was upgraded
 			m_config.save();
 
+			const eLogLevel logLevel = Logger::ParseLogLevel(m_config.log_level.c_str(), LogLevel_Info);
+			Logger::Info("CServerDriver_PSMoveService::Init - Log level: %s.\n", m_config.log_level.c_str());
+			Logger::SetLogLevel(logLevel);
+
+			if (m_config.async_logging) {
+				Logger::StartAsyncLogging();
+			}
+
+			if ((m_config.trace_log && m_config.trace_log_size_mb > 0) || m_config.frame_profiler) {
+				const std::string trace_dir = Utils::Path_GetHomeDirectory() + "/PSMoveSteamVRBridge";
+				if (Utils::Path_CreateDirectory(trace_dir)) {
+					if (m_config.trace_log && m_config.trace_log_size_mb > 0) {
+						TraceLog::Open(trace_dir + "/driver_trace.psmtrace", (size_t)m_config.trace_log_size_mb * 1024 * 1024);
+					}
+					if (m_config.frame_profiler) {
+						FrameProfiler::Start(trace_dir, m_config.frame_profiler_window_frames);
+					}
+				} else {
+					Logger::Error("CServerDriver_PSMoveService::Init - Failed to create trace directory: %s\n", trace_dir.c_str());
+				}
+			}
+
+			m_worldFromDriver.Publish(m_config.world_from_driver_pose, m_config.has_calibrated_world_from_driver_pose);
+
+			m_alignmentJobs.Start();
+
 			// Launch PSMoveService automatically if it's not already running
 			LaunchPSMoveService();
 
@@ -68,23 +97,37 @@ namespace steamvrbridge {
 	}
 
 	bool CServerDriver_PSMoveService::ReconnectToPSMoveService() {
-		Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - called.\n");
+		// A service that isn't running fails every attempt, which retries straight away
+		static LogRateLimit s_reconnectLogLimit("CServerDriver_PSMoveService::ReconnectToPSMoveService", 1);
+		const bool bLog = s_reconnectLogLimit.Allow(LogLevel_Info);
+
+		if (bLog)
+			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - called.\n");
+
+		// Commands queued for the old connection refer to its controller ids
+		m_psmCommands.Clear();
 
 		if (PSM_GetIsInitialized()) {
-			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection active. Shutting down...\n");
+			if (bLog)
+				Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection active. Shutting down...\n");
 			PSM_Shutdown();
-			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection stopped.\n");
+			if (bLog)
+				Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection stopped.\n");
 		} else {
-			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection NOT active.\n");
+			if (bLog)
+				Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Existing PSMoveService connection NOT active.\n");
 		}
 
-		Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Starting PSMoveService connection...\n");
+		if (bLog)
+			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Starting PSMoveService connection...\n");
 		bool bSuccess = PSM_InitializeAsync(m_config.server_address.c_str(), m_config.server_port.c_str()) != PSMResult_Error;
 
 		if (bSuccess) {
-			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Successfully requested connection\n");
+			if (bLog)
+				Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Successfully requested connection\n");
 		} else {
-			Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Failed to request connection!\n");
+			if (bLog)
+				Logger::Info("CServerDriver_PSMoveService::ReconnectToPSMoveService - Failed to request connection!\n");
 		}
 
 		return bSuccess;
@@ -92,10 +135,19 @@ namespace steamvrbridge {
 
 	void CServerDriver_PSMoveService::Cleanup() {
 		if (m_bInitialized) {
+			m_hmdDriftCorrector.Detach();
+
 			Logger::Info("CServerDriver_PSMoveService::Cleanup - Shutting down connection...\n");
 			PSM_Shutdown();
 			Logger::Info("CServerDriver_PSMoveService::Cleanup - Shutdown complete\n");
 
+			m_alignmentJobs.Stop();
+			FrameProfiler::Stop();
+			TraceLog::Close();
+
+			// Everything logged above still reaches the log before the driver can be unloaded
+			Logger::StopAsyncLogging();
+
 			m_bInitialized = false;
 		}
 	}
@@ -115,71 +167,126 @@ namespace steamvrbridge {
 		return nullptr;
 	}
 
-	void CServerDriver_PSMoveService::RunFrame() {
-
-		// Update any controllers that are currently listening
-		PSM_UpdateNoPollMessages();
+	void CServerDriver_PSMoveService::RegisterHapticComponent(
+		vr::VRInputComponentHandle_t componentHandle,
+		Controller *controller,
+		ePSMHapicID haptic_id,
+		HapticScheduler *scheduler) {
+		HapticRoute route;
+		route.controller = controller;
+		route.hapticId = haptic_id;
+		route.scheduler = scheduler;
+
+		m_hapticRoutes[componentHandle] = route;
+	}
 
-		// Poll events queued up by the call to PSM_UpdateNoPollMessages()
-		PSMMessage mesg;
-		while (PSM_PollNextMessage(&mesg, sizeof(PSMMessage)) == PSMResult_Success) {
-			switch (mesg.payload_type) {
-				case PSMMessage::_messagePayloadType_Response:
-					HandleClientPSMoveResponse(&mesg);
-					break;
-				case PSMMessage::_messagePayloadType_Event:
-					HandleClientPSMoveEvent(&mesg);
-					break;
+	void CServerDriver_PSMoveService::UnregisterHapticComponents(const Controller *controller) {
+		for (auto it = m_hapticRoutes.begin(); it != m_hapticRoutes.end();) {
+			if (it->second.controller == controller) {
+				it = m_hapticRoutes.erase(it);
+			} else {
+				++it;
 			}
 		}
+	}
 
-		// Check for any OpenVR TrackedDeviceProvider events
-		vr::VREvent_t event;
-		while (vr::VRServerDriverHost()->PollNextEvent(&event, sizeof(event))) {
-			switch (event.eventType) {
-				case vr::VREvent_Input_HapticVibration:
+	void CServerDriver_PSMoveService::RunFrame() {
+		if (m_config.log_update_timing) {
+			m_frameTiming.LogIfDue("CServerDriver_PSMoveService", std::chrono::high_resolution_clock::now(), m_config.update_timing_log_interval_seconds);
+		}
+		if (m_config.log_psm_command_rate) {
+			m_psmCommands.LogIfDue(std::chrono::high_resolution_clock::now(), m_config.update_timing_log_interval_seconds);
+		}
+		FrameProfiler::BeginFrame();
+		ScopedUpdateTimer frameTimer(m_config.log_update_timing ? &m_frameTiming : nullptr, UpdateTimingPath_Frame);
+		ScopedProfileSpan frameSpan("RunFrame");
 
-					// haptic event details
-					vr::VREvent_HapticVibration_t hapticData = event.data.hapticVibration;
-					vr::TrackedDeviceIndex_t trackedDeviceIndex = event.trackedDeviceIndex;
-					uint64_t handle = hapticData.containerHandle;
+		m_hmdPoseCache.BeginFrame();
+		m_psmCommands.BeginFrame();
 
-					//Logger::Debug("CServerDriver_PSMoveService::RunFrame: haptic event, trackedDeviceIndex=%d, durationSecs=%f, amplitude=%f, frequency=%f\n"
-					//				, &trackedDeviceIndex, durationSecs, amplitude, frequency);
+		{
+			ScopedProfileSpan psmSpan("PSMoveService Messages");
+
+			// Update any controllers that are currently listening
+			PSM_UpdateNoPollMessages();
 
-					// find the trackable device this vibration event is intended for by property container handle
-					auto it= std::find_if(
-						m_vecTrackedDevices.begin(), m_vecTrackedDevices.end(), 
-						[handle](const TrackableDevice *pTrackedDevice)->bool {
-							return 
-								pTrackedDevice->GetTrackedDeviceClass() == vr::TrackedDeviceClass_Controller
-								&& pTrackedDevice->getPropertyContainerHandle() == handle;
-						});
+			// Poll events queued up by the call to PSM_UpdateNoPollMessages()
+			PSMMessage mesg;
+			while (PSM_PollNextMessage(&mesg, sizeof(PSMMessage)) == PSMResult_Success) {
+				switch (mesg.payload_type) {
+					case PSMMessage::_messagePayloadType_Response:
+						HandleClientPSMoveResponse(&mesg);
+						break;
+					case PSMMessage::_messagePayloadType_Event:
+						HandleClientPSMoveEvent(&mesg);
+						break;
+				}
+			}
+		}
 
-					// If the appropriate device is found, pass on the haptic event
-					if (it != m_vecTrackedDevices.end())
+		{
+			ScopedProfileSpan vrEventSpan("OpenVR Events");
+
+			// Check for any OpenVR TrackedDeviceProvider events
+			vr::VREvent_t event;
+			while (vr::VRServerDriverHost()->PollNextEvent(&event, sizeof(event))) {
+				switch (event.eventType) {
+					case vr::VREvent_TrackedDeviceActivated:
+					case vr::VREvent_TrackedDeviceDeactivated:
+					case vr::VREvent_TrackedDeviceUpdated:
+						// The HMD may have come, gone or moved to another index
+						m_hmdPoseCache.InvalidateDeviceIndex();
+						break;
+					case vr::VREvent_Input_HapticVibration:
 					{
-						Controller *pController = static_cast<Controller *>(*it);
+						const vr::VREvent_HapticVibration_t &hapticData = event.data.hapticVibration;
+
+						// Look up the controller and haptic slot this vibration event is intended for by component handle
+						auto it = m_hapticRoutes.find(hapticData.componentHandle);
+						if (it != m_hapticRoutes.end()) {
+							ScopedProfileSpan hapticSpan("Haptic Event", (int)it->second.controller->getTrackedDeviceIndex());
+							it->second.controller->UpdateHaptics(it->second.hapticId, *it->second.scheduler, hapticData);
+						}
+					} break;
+				}
+			}
+		}
 
-						pController->UpdateHaptics(hapticData);
-					}
+		// Apply any alignment finished by the worker thread and refine the tracking space alignment
+		// before this frame's poses are transformed with it
+		{
+			ScopedProfileSpan trackingSpaceSpan("Tracking Space");
+
+			HMDAlignmentResult alignmentResult;
+			if (m_alignmentJobs.TryTakeResult(&alignmentResult)) {
+				SetHMDTrackingSpace(alignmentResult.worldFromDriverPose);
+			}
+
+			PSMPosef correctedWorldFromDriverPose;
+			if (m_hmdDriftCorrector.Update(m_config, m_hmdPoseCache, std::chrono::high_resolution_clock::now(), &correctedWorldFromDriverPose)) {
+				SetHMDTrackingSpace(correctedWorldFromDriverPose);
 			}
 		}
 
 		// Update all active tracked devices
+		m_poseBatch.Reset();
 		for (auto it = m_vecTrackedDevices.begin(); it != m_vecTrackedDevices.end(); ++it) {
 			TrackableDevice *pTrackedDevice = *it;
 
+			pTrackedDevice->SyncWorldFromDriverPose();
+
 			switch (pTrackedDevice->GetTrackedDeviceClass()) {
 				case vr::TrackedDeviceClass_Controller:
 				{
 					PSMoveController *pController = static_cast<PSMoveController *>(pTrackedDevice);
+					ScopedProfileSpan updateSpan("Controller Update", (int)pTrackedDevice->getTrackedDeviceIndex());
 
 					pController->Update();
 				} break;
 				case vr::TrackedDeviceClass_TrackingReference:
 				{
 					PSMServiceTracker *pTracker = static_cast<PSMServiceTracker *>(pTrackedDevice);
+					ScopedProfileSpan updateSpan("Tracker Update", (int)pTrackedDevice->getTrackedDeviceIndex());
 
 					pTracker->Update();
 				} break;
@@ -187,6 +294,18 @@ namespace steamvrbridge {
 					assert(0 && "unreachable");
 			}
 		}
+
+		// Transform and post the controller poses queued by the updates above
+		{
+			ScopedProfileSpan poseSpan("Pose Publication");
+			m_poseBatch.Flush();
+		}
+
+		// Send the commands the frame produced to PSMoveService in one go
+		{
+			ScopedProfileSpan commandSpan("PSMoveService Commands");
+			m_psmCommands.Flush();
+		}
 	}
 
 
@@ -282,7 +401,9 @@ namespace steamvrbridge {
 
 
 	void CServerDriver_PSMoveService::HandleFailedToConnectToPSMoveService() {
-		Logger::Info("CServerDriver_PSMoveService::HandleFailedToConnectToPSMoveService - Called\n");
+		static LogRateLimit s_failedToConnectLogLimit("CServerDriver_PSMoveService::HandleFailedToConnectToPSMoveService", 1);
+		if (s_failedToConnectLogLimit.Allow(LogLevel_Info))
+			Logger::Info("CServerDriver_PSMoveService::HandleFailedToConnectToPSMoveService - Called\n");
 
 		// Immediately attempt to reconnect to the service
 		ReconnectToPSMoveService();
@@ -291,6 +412,8 @@ namespace steamvrbridge {
 	void CServerDriver_PSMoveService::HandleDisconnectedFromPSMoveService() {
 		Logger::Info("CServerDriver_PSMoveService::HandleDisconnectedFromPSMoveService - Called\n");
 
+		m_hmdDriftCorrector.Detach();
+
 		for (auto it = m_vecTrackedDevices.begin(); it != m_vecTrackedDevices.end(); ++it) {
 			TrackableDevice *pDevice = *it;
 
@@ -337,7 +460,11 @@ namespace steamvrbridge {
 				HandleTrackerListReponse(&message->response_data.payload.tracker_list);
 				break;
 			default:
-				Logger::Info("NotifyClientPSMoveResponse - Unhandled response (request id %d).\n", message->response_data.request_id);
+			{
+				static LogRateLimit s_unhandledResponseLogLimit("NotifyClientPSMoveResponse", 5);
+				if (s_unhandledResponseLogLimit.Allow(LogLevel_Info))
+					Logger::Info("NotifyClientPSMoveResponse - Unhandled response (request id %d).\n", message->response_data.request_id);
+			}
 		}
 	}
 
@@ -410,15 +537,27 @@ namespace steamvrbridge {
 
 		m_config.has_calibrated_world_from_driver_pose= true;
 		m_config.world_from_driver_pose = origin_pose;
-		m_config.save();
 
-		// Tell all the devices that the relationship between the psmove and the OpenVR
-		// tracking spaces changed
-		for (auto it = m_vecTrackedDevices.begin(); it != m_vecTrackedDevices.end(); ++it) {
-			TrackableDevice *pDevice = *it;
+		// Writing the config can take a while, leave it to the worker thread
+		m_alignmentJobs.SubmitSave(m_config);
 
-			pDevice->RefreshWorldFromDriverPose();
-		}
+		// The devices pick up the new relationship between the psmove and the OpenVR tracking
+		// spaces before their next update
+		m_worldFromDriver.Publish(origin_pose, true);
+
+		static TraceFormat s_trackingSpaceTrace("SetHMDTrackingSpace - world_from_driver {} (version {})");
+		TraceLog::Record(s_trackingSpaceTrace, origin_pose, (unsigned int)m_worldFromDriver.GetVersion());
+
+		Logger::Info("CServerDriver_PSMoveService::SetHMDTrackingSpace() - worldFromDriverPose: %s (version %u)\n",
+			Utils::PSMPosefToString(origin_pose).c_str(), m_worldFromDriver.GetVersion());
+	}
+
+	void CServerDriver_PSMoveService::RequestHMDAlignment(
+		const char *requester,
+		const HMDAlignmentSample *samples,
+		int sampleCount,
+		const HMDAlignmentParams &params) {
+		m_alignmentJobs.SubmitSolve(requester, samples, sampleCount, params);
 	}
 
 	vr::ETrackedControllerRole CServerDriver_PSMoveService::AllocateControllerRole(PSMControllerHand psmControllerHand)
@@ -468,6 +607,10 @@ namespace steamvrbridge {
 				}
 			} else {
 				Logger::Info("skipped new psmove controller as configured for HMD tracking, serial: %s\n", psmSerialNo.c_str());
+
+				if (m_config.continuous_hmd_alignment) {
+					m_hmdDriftCorrector.Attach(psmControllerID, psmSerialNo);
+				}
 			}
 		}
 	}
@@ -494,6 +637,10 @@ namespace steamvrbridge {
 				}
 			} else {
 				Logger::Info("skipped new virtual controller as configured for HMD tracking, serial: %s\n", psmSerialNo.c_str());
+
+				if (m_config.continuous_hmd_alignment) {
+					m_hmdDriftCorrector.Attach(psmControllerID, psmSerialNo);
+				}
 			}
 		}
 	}
@@ -520,6 +667,10 @@ namespace steamvrbridge {
 				}
 			} else {
 				Logger::Info("skipped new dualshock4 controller as configured for HMD tracking, serial: %s\n", psmSerialNo.c_str());
+
+				if (m_config.continuous_hmd_alignment) {
+					m_hmdDriftCorrector.Attach(psmControllerID, psmSerialNo);
+				}
 			}
 		}
 	}
@@ -592,6 +743,10 @@ namespace steamvrbridge {
 				}
 			} else {
 				Logger::Info("skipped new virtual controller as configured for HMD tracking, serial: %s\n", psmSerialNo.c_str());
+
+				if (m_config.continuous_hmd_alignment) {
+					m_hmdDriftCorrector.Attach(psmControllerID, psmSerialNo);
+				}
 			}
 		}
 	}
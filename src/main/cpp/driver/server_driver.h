@@ -2,10 +2,20 @@
 #include "PSMoveClient_CAPI.h"
 #include <openvr_driver.h>
 #include "config.h"
+#include "constants.h"
 #include "trackable_device.h"
 #include "tracker.h"
 #include "logger.h"
 #include "settings_util.h"
+#include "pose_batch.h"
+#include "haptic_scheduler.h"
+#include "hmd_alignment_job.h"
+#include "hmd_drift_correction.h"
+#include "hmd_pose_cache.h"
+#include "psm_command_queue.h"
+#include "update_timing.h"
+#include <unordered_map>
+#include <vector>
 
 // Platform specific includes
 #if defined( _WIN32 )
@@ -18,6 +28,8 @@
 
 namespace steamvrbridge {
 
+	class Controller;
+
 	/* 
 		IServerTrackedDeviceProvider implementation as per:
 		https://github.com/ValveSoftware/openvr/wiki/IServerTrackedDeviceProvider_Overview 
@@ -48,9 +60,28 @@ namespace steamvrbridge {
 		void LaunchPSMoveService();
 		void LaunchPSMoveMonitor();
 
+		inline const ServerDriverConfig &GetServerDriverConfig() const { return m_config; }
+
 		bool IsHMDTrackingSpaceCalibrated() const { return m_config.has_calibrated_world_from_driver_pose; }
 		void SetHMDTrackingSpace(const PSMPosef &origin_pose);
+
+		// Solves the alignment on the worker thread; the result is applied on a later RunFrame()
+		void RequestHMDAlignment(const char *requester, const HMDAlignmentSample *samples, int sampleCount, const HMDAlignmentParams &params);
 		inline PSMPosef GetWorldFromDriverPose() const { return m_config.world_from_driver_pose; }
+		inline const WorldFromDriverTransform &GetWorldFromDriverTransform() const { return m_worldFromDriver; }
+
+		// HMD device index and pose, fetched at most once per frame
+		inline HMDPoseCache &GetHMDPoseCache() { return m_hmdPoseCache; }
+
+		// Controller poses queued this frame, transformed and posted at the end of RunFrame()
+		inline PoseBatch &GetPoseBatch() { return m_poseBatch; }
+
+		// Commands for PSMoveService, collected during RunFrame() and sent at its end
+		inline PSMCommandQueue &GetPSMCommandQueue() { return m_psmCommands; }
+
+		// Haptic events are routed straight to the controller and slot that created their component
+		void RegisterHapticComponent(vr::VRInputComponentHandle_t componentHandle, Controller *controller, ePSMHapicID haptic_id, HapticScheduler *scheduler);
+		void UnregisterHapticComponents(const Controller *controller);
 
 	private:
 		vr::ITrackedDeviceServerDriver * FindTrackedDeviceDriver(const char * pchId);
@@ -78,12 +109,39 @@ namespace steamvrbridge {
 
 		ServerDriverConfig m_config;
 
+		// Published copy of the calibrated world-from-driver pose that the devices read from
+		WorldFromDriverTransform m_worldFromDriver;
+
 		bool m_bLaunchedPSMoveMonitor;
 		bool m_bLaunchedPSMoveService;
 		bool m_bInitialized;
 
 		std::vector< TrackableDevice * > m_vecTrackedDevices;
 
+		PoseBatch m_poseBatch;
+		HMDPoseCache m_hmdPoseCache;
+
+		// Alignment solves and config saves that are kept off the frame
+		HMDAlignmentJobQueue m_alignmentJobs;
+
+		// Declared before everything that sends through it, so it outlives them
+		PSMCommandQueue m_psmCommands;
+
+		// Streams the HMD mounted controller when continuous_hmd_alignment is enabled
+		HMDDriftCorrector m_hmdDriftCorrector;
+
+		struct HapticRoute {
+			Controller *controller;
+			ePSMHapicID hapticId;
+			HapticScheduler *scheduler;
+		};
+
+		// Haptic component handle -> owning controller, slot and the slot's scheduler, filled by CreateHapticComponent()
+		std::unordered_map<vr::VRInputComponentHandle_t, HapticRoute> m_hapticRoutes;
+
+		// Per frame timing, logged when log_update_timing is enabled
+		UpdateTimingStats m_frameTiming;
+
 		// Singleton instance of CServerDriver_PSMoveService
 		static CServerDriver_PSMoveService *m_instance;
 	};
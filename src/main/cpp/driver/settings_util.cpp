@@ -1,5 +1,6 @@
 #include "settings_util.h"
 #include "SharedConstants.h"
+#include "constants.h"
 
 namespace steamvrbridge {
 
@@ -14,6 +15,33 @@ namespace steamvrbridge {
 		, server_port(PSMOVESERVICE_DEFAULT_PORT)
 		, auto_launch_psmove_service(true) 
 		, use_installation_path(true)
+		, upsample_controller_poses(false)
+		, upsample_max_horizon_seconds(0.033f)
+		, occlusion_timeout_seconds(0.5f)
+		, occlusion_dead_reckoning_seconds(0.1f)
+		, occlusion_velocity_decay_rate(10.f)
+		, occlusion_recovery_blend_seconds(0.15f)
+		, outlier_max_speed_meters_per_sec(15.f)
+		, outlier_max_acceleration_meters_per_sec_sqr(0.f)
+		, suppress_idle_pose_updates(false)
+		, idle_position_epsilon_meters(0.0005f)
+		, idle_rotation_epsilon_radians(0.1f / k_fRadiansToDegrees)
+		, idle_heartbeat_seconds(0.5f)
+		, hmd_alignment_sample_count(1)
+		, hmd_alignment_max_duration_seconds(1.5f)
+		, continuous_hmd_alignment(false)
+		, drift_correction_time_constant_seconds(10.f)
+		, drift_correction_min_improvement_meters(0.005f)
+		, drift_correction_min_interval_seconds(5.f)
+		, log_update_timing(false)
+		, update_timing_log_interval_seconds(10.f)
+		, log_psm_command_rate(false)
+		, async_logging(true)
+		, log_level("info")
+		, trace_log(false)
+		, trace_log_size_mb(64)
+		, frame_profiler(false)
+		, frame_profiler_window_frames(900)
 		, has_calibrated_world_from_driver_pose(false)
 		, world_from_driver_pose(*k_psm_pose_identity) {
 	};
@@ -27,6 +55,33 @@ namespace steamvrbridge {
 			{"server_port", server_port},
 			{"auto_launch_psmove_service", auto_launch_psmove_service},
 			{"use_installation_path", use_installation_path},
+			{"upsample_controller_poses", upsample_controller_poses},
+			{"upsample_max_horizon_ms", upsample_max_horizon_seconds * 1000.f},
+			{"occlusion_timeout_ms", occlusion_timeout_seconds * 1000.f},
+			{"occlusion_dead_reckoning_ms", occlusion_dead_reckoning_seconds * 1000.f},
+			{"occlusion_velocity_decay_rate", occlusion_velocity_decay_rate},
+			{"occlusion_recovery_blend_ms", occlusion_recovery_blend_seconds * 1000.f},
+			{"outlier_max_speed_m_per_sec", outlier_max_speed_meters_per_sec},
+			{"outlier_max_acceleration_m_per_sec_sqr", outlier_max_acceleration_meters_per_sec_sqr},
+			{"suppress_idle_pose_updates", suppress_idle_pose_updates},
+			{"idle_position_epsilon_mm", idle_position_epsilon_meters * 1000.f},
+			{"idle_rotation_epsilon_degrees", idle_rotation_epsilon_radians * k_fRadiansToDegrees},
+			{"idle_heartbeat_ms", idle_heartbeat_seconds * 1000.f},
+			{"hmd_alignment_sample_count", hmd_alignment_sample_count},
+			{"hmd_alignment_max_duration_ms", hmd_alignment_max_duration_seconds * 1000.f},
+			{"continuous_hmd_alignment", continuous_hmd_alignment},
+			{"drift_correction_time_constant_ms", drift_correction_time_constant_seconds * 1000.f},
+			{"drift_correction_min_improvement_mm", drift_correction_min_improvement_meters * 1000.f},
+			{"drift_correction_min_interval_ms", drift_correction_min_interval_seconds * 1000.f},
+			{"log_update_timing", log_update_timing},
+			{"update_timing_log_interval_ms", update_timing_log_interval_seconds * 1000.f},
+			{"log_psm_command_rate", log_psm_command_rate},
+			{"async_logging", async_logging},
+			{"log_level", log_level},
+			{"trace_log", trace_log},
+			{"trace_log_size_mb", trace_log_size_mb},
+			{"frame_profiler", frame_profiler},
+			{"frame_profiler_window_frames", frame_profiler_window_frames},
 			{"has_calibrated_world_from_driver_pose", has_calibrated_world_from_driver_pose},
 			{"world_from_driver_pose.orientation.w", world_from_driver_pose.Orientation.w},
 			{"world_from_driver_pose.orientation.x", world_from_driver_pose.Orientation.x},
@@ -48,6 +103,33 @@ namespace steamvrbridge {
 			server_port= pt.get_or<std::string>("server_port", server_port);
 			auto_launch_psmove_service= pt.get_or<bool>("auto_launch_psmove_service", auto_launch_psmove_service);
 			use_installation_path= pt.get_or<bool>("use_installation_path", use_installation_path);
+			upsample_controller_poses= pt.get_or<bool>("upsample_controller_poses", upsample_controller_poses);
+			upsample_max_horizon_seconds= pt.get_or<float>("upsample_max_horizon_ms", upsample_max_horizon_seconds * 1000.f) / 1000.f;
+			occlusion_timeout_seconds= pt.get_or<float>("occlusion_timeout_ms", occlusion_timeout_seconds * 1000.f) / 1000.f;
+			occlusion_dead_reckoning_seconds= pt.get_or<float>("occlusion_dead_reckoning_ms", occlusion_dead_reckoning_seconds * 1000.f) / 1000.f;
+			occlusion_velocity_decay_rate= pt.get_or<float>("occlusion_velocity_decay_rate", occlusion_velocity_decay_rate);
+			occlusion_recovery_blend_seconds= pt.get_or<float>("occlusion_recovery_blend_ms", occlusion_recovery_blend_seconds * 1000.f) / 1000.f;
+			outlier_max_speed_meters_per_sec= pt.get_or<float>("outlier_max_speed_m_per_sec", outlier_max_speed_meters_per_sec);
+			outlier_max_acceleration_meters_per_sec_sqr= pt.get_or<float>("outlier_max_acceleration_m_per_sec_sqr", outlier_max_acceleration_meters_per_sec_sqr);
+			suppress_idle_pose_updates= pt.get_or<bool>("suppress_idle_pose_updates", suppress_idle_pose_updates);
+			idle_position_epsilon_meters= pt.get_or<float>("idle_position_epsilon_mm", idle_position_epsilon_meters * 1000.f) / 1000.f;
+			idle_rotation_epsilon_radians= pt.get_or<float>("idle_rotation_epsilon_degrees", idle_rotation_epsilon_radians * k_fRadiansToDegrees) / k_fRadiansToDegrees;
+			idle_heartbeat_seconds= pt.get_or<float>("idle_heartbeat_ms", idle_heartbeat_seconds * 1000.f) / 1000.f;
+			hmd_alignment_sample_count= pt.get_or<int>("hmd_alignment_sample_count", hmd_alignment_sample_count);
+			hmd_alignment_max_duration_seconds= pt.get_or<float>("hmd_alignment_max_duration_ms", hmd_alignment_max_duration_seconds * 1000.f) / 1000.f;
+			continuous_hmd_alignment= pt.get_or<bool>("continuous_hmd_alignment", continuous_hmd_alignment);
+			drift_correction_time_constant_seconds= pt.get_or<float>("drift_correction_time_constant_ms", drift_correction_time_constant_seconds * 1000.f) / 1000.f;
+			drift_correction_min_improvement_meters= pt.get_or<float>("drift_correction_min_improvement_mm", drift_correction_min_improvement_meters * 1000.f) / 1000.f;
+			drift_correction_min_interval_seconds= pt.get_or<float>("drift_correction_min_interval_ms", drift_correction_min_interval_seconds * 1000.f) / 1000.f;
+			log_update_timing= pt.get_or<bool>("log_update_timing", log_update_timing);
+			update_timing_log_interval_seconds= pt.get_or<float>("update_timing_log_interval_ms", update_timing_log_interval_seconds * 1000.f) / 1000.f;
+			log_psm_command_rate= pt.get_or<bool>("log_psm_command_rate", log_psm_command_rate);
+			async_logging= pt.get_or<bool>("async_logging", async_logging);
+			log_level= pt.get_or<std::string>("log_level", log_level);
+			trace_log= pt.get_or<bool>("trace_log", trace_log);
+			trace_log_size_mb= pt.get_or<int>("trace_log_size_mb", trace_log_size_mb);
+			frame_profiler= pt.get_or<bool>("frame_profiler", frame_profiler);
+			frame_profiler_window_frames= pt.get_or<int>("frame_profiler_window_frames", frame_profiler_window_frames);
 			
 			// By default, assume the psmove and openvr tracking spaces are the same
 			has_calibrated_world_from_driver_pose= pt.get_or<bool>("has_calibrated_world_from_driver_pose", false);
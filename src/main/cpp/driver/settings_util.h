@@ -24,6 +24,70 @@ namespace steamvrbridge {
 		bool auto_launch_psmove_service;
 		bool use_installation_path;
 
+		// Controller pose upsampling on frames without a new optical sample
+		bool upsample_controller_poses;
+		float upsample_max_horizon_seconds;
+
+		// How long a controller that lost optical tracking is held before its pose is invalidated.
+		// Zero invalidates the pose immediately.
+		float occlusion_timeout_seconds;
+		// How long an occluded controller keeps moving on its last velocity, and how fast it slows down
+		float occlusion_dead_reckoning_seconds;
+		float occlusion_velocity_decay_rate;
+		// Time taken to blend from the held position back to the tracked one
+		float occlusion_recovery_blend_seconds;
+
+		// Optical samples implying motion faster than this are rejected as tracking glitches.
+		// A max speed of zero disables the check.
+		float outlier_max_speed_meters_per_sec;
+		// Zero (the default) disables the acceleration check
+		float outlier_max_acceleration_meters_per_sec_sqr;
+
+		// Skip posting poses that moved less than the epsilons since the last post, apart from a
+		// periodic heartbeat.
+		bool suppress_idle_pose_updates;
+		float idle_position_epsilon_meters;
+		float idle_rotation_epsilon_radians;
+		float idle_heartbeat_seconds;
+
+		// Number of HMD/controller sample pairs fitted by the alignment gesture (1 = single snapshot, the default)
+		// and the longest the gesture waits to collect them.
+		int hmd_alignment_sample_count;
+		float hmd_alignment_max_duration_seconds;
+
+		// Continuously correct the drift between the PSM and HMD tracking spaces using the controller
+		// mounted on the HMD (filter_virtual_hmd_serial). The fit averages over the time constant and a
+		// correction is only applied when it lowers the RMS error by the min improvement.
+		bool continuous_hmd_alignment;
+		float drift_correction_time_constant_seconds;
+		float drift_correction_min_improvement_meters;
+		float drift_correction_min_interval_seconds;
+
+		// Log the ns per call of each controller update path and of the whole frame, and each controller's
+		// haptic event to rumble command latency histogram, once per interval
+		bool log_update_timing;
+		float update_timing_log_interval_seconds;
+
+		// Log how many commands per second are sent to PSMoveService, once per update timing log interval
+		bool log_psm_command_rate;
+
+		// Write the driver log from a background thread instead of the thread that logs
+		bool async_logging;
+
+		// Lowest level written to the driver log: "debug", "info", "warn", "error" or "off"
+		std::string log_level;
+
+		// Record pose, alignment and drift correction values to a binary trace file (driver_trace.psmtrace
+		// next to the config), read back with trace_decoder_psmove. The trace stops once it reaches its size.
+		bool trace_log;
+		int trace_log_size_mb;
+
+		// Record a timeline of each frame's phases, device updates and worker thread jobs, written as
+		// Chrome trace-event JSON (frame_profile_<n>.json next to the config) every window of frames or
+		// when requested with the "dump_frame_profile" driver debug request
+		bool frame_profiler;
+		int frame_profiler_window_frames;
+
 		// HMD Tracking Space
 		bool has_calibrated_world_from_driver_pose;
 		PSMPosef world_from_driver_pose;
@@ -0,0 +1,246 @@
+// trace_decoder.cpp : Turns a binary trace file written by the driver's TraceLog back into text
+//
+
+#include "trace_log_format.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+using namespace steamvrbridge;
+
+struct TraceFormatDefinition
+{
+	std::string argTypes;
+	std::string format;
+};
+
+static size_t GetTraceArgSize(char argType)
+{
+	switch (argType)
+	{
+	case TraceArg_Int32:
+	case TraceArg_UInt32:
+	case TraceArg_Float:
+		return 4;
+	case TraceArg_Int64:
+	case TraceArg_Double:
+		return 8;
+	case TraceArg_Bool:
+		return 1;
+	case TraceArg_Vector3f:
+		return 3 * sizeof(float);
+	case TraceArg_Quatf:
+		return 4 * sizeof(float);
+	case TraceArg_Posef:
+		return 7 * sizeof(float);
+	default:
+		return 0;
+	}
+}
+
+// Appends the text of one argument, returns false when its type is unknown
+static bool AppendTraceArg(char argType, const uint8_t *data, std::string &out)
+{
+	char buffer[256];
+	float f[7];
+
+	switch (argType)
+	{
+	case TraceArg_Int32:
+		{
+			int32_t value;
+			memcpy(&value, data, sizeof(value));
+			snprintf(buffer, sizeof(buffer), "%d", (int)value);
+		} break;
+	case TraceArg_UInt32:
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			snprintf(buffer, sizeof(buffer), "%u", (unsigned int)value);
+		} break;
+	case TraceArg_Int64:
+		{
+			int64_t value;
+			memcpy(&value, data, sizeof(value));
+			snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+		} break;
+	case TraceArg_Bool:
+		snprintf(buffer, sizeof(buffer), "%s", data[0] != 0 ? "true" : "false");
+		break;
+	case TraceArg_Float:
+		memcpy(f, data, sizeof(float));
+		snprintf(buffer, sizeof(buffer), "%f", f[0]);
+		break;
+	case TraceArg_Double:
+		{
+			double value;
+			memcpy(&value, data, sizeof(value));
+			snprintf(buffer, sizeof(buffer), "%f", value);
+		} break;
+	case TraceArg_Vector3f:
+		memcpy(f, data, 3 * sizeof(float));
+		snprintf(buffer, sizeof(buffer), "(%f, %f, %f)", f[0], f[1], f[2]);
+		break;
+	case TraceArg_Quatf:
+		memcpy(f, data, 4 * sizeof(float));
+		snprintf(buffer, sizeof(buffer), "(w=%f, x=%f, y=%f, z=%f)", f[0], f[1], f[2], f[3]);
+		break;
+	case TraceArg_Posef:
+		memcpy(f, data, 7 * sizeof(float));
+		snprintf(buffer, sizeof(buffer), "[pos (%f, %f, %f), rot (w=%f, x=%f, y=%f, z=%f)]",
+			f[0], f[1], f[2], f[3], f[4], f[5], f[6]);
+		break;
+	default:
+		return false;
+	}
+
+	out += buffer;
+	return true;
+}
+
+// Substitutes the event's arguments for the "{}" in its format string
+static bool FormatTraceEvent(const TraceFormatDefinition &definition, const uint8_t *payload, size_t payloadSize, std::string &out)
+{
+	const char *format = definition.format.c_str();
+	size_t argIndex = 0;
+	size_t payloadOffset = 0;
+
+	while (*format != '\0')
+	{
+		if (format[0] == '{' && format[1] == '}' && argIndex < definition.argTypes.size())
+		{
+			const char argType = definition.argTypes[argIndex++];
+			const size_t argSize = GetTraceArgSize(argType);
+			if (argSize == 0 || payloadOffset + argSize > payloadSize)
+				return false;
+
+			AppendTraceArg(argType, payload + payloadOffset, out);
+			payloadOffset += argSize;
+			format += 2;
+		}
+		else
+		{
+			out += *format++;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: trace_decoder_psmove <trace file>\n");
+		return -1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return -1;
+	}
+
+	std::vector<uint8_t> data;
+	uint8_t chunk[64 * 1024];
+	size_t readSize;
+	while ((readSize = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		data.insert(data.end(), chunk, chunk + readSize);
+	}
+	fclose(file);
+
+	TraceFileHeader header;
+	if (data.size() < sizeof(header))
+	{
+		fprintf(stderr, "%s is too small to be a trace file\n", argv[1]);
+		return -1;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+
+	if (memcmp(header.magic, k_TraceFileMagic, sizeof(header.magic)) != 0)
+	{
+		fprintf(stderr, "%s is not a trace file\n", argv[1]);
+		return -1;
+	}
+
+	if (header.version != k_nTraceFileVersion)
+	{
+		fprintf(stderr, "%s has trace version %u, expected %u\n", argv[1], header.version, k_nTraceFileVersion);
+		return -1;
+	}
+
+	// A trace that wasn't closed has no used size, its records end at the first zero record type
+	size_t endOffset = data.size();
+	if (header.usedBytes != 0 && header.usedBytes < endOffset)
+	{
+		endOffset = (size_t)header.usedBytes;
+	}
+
+	printf("Trace started at unix time %llu.%03llu\n",
+		(unsigned long long)(header.startTimeUnixMs / 1000), (unsigned long long)(header.startTimeUnixMs % 1000));
+
+	std::map<uint32_t, TraceFormatDefinition> formats;
+	size_t offset = (header.headerSize + k_nTraceRecordAlignment - 1) & ~(size_t)(k_nTraceRecordAlignment - 1);
+	unsigned long long eventCount = 0;
+
+	while (offset + sizeof(TraceRecordHeader) <= endOffset)
+	{
+		TraceRecordHeader record;
+		memcpy(&record, data.data() + offset, sizeof(record));
+		if (record.recordType == TraceRecord_End)
+			break;
+
+		const uint8_t *payload = data.data() + offset + sizeof(record);
+		const size_t payloadSize = record.payloadSize;
+		if (offset + sizeof(record) + payloadSize > endOffset)
+		{
+			fprintf(stderr, "Record at offset %llu runs past the end of the trace\n", (unsigned long long)offset);
+			break;
+		}
+
+		if (record.recordType == TraceRecord_Format)
+		{
+			// Argument type codes and format string, each zero terminated
+			const char *argTypes = reinterpret_cast<const char *>(payload);
+			const size_t argTypesLength = strnlen(argTypes, payloadSize);
+			if (argTypesLength < payloadSize)
+			{
+				const char *format = argTypes + argTypesLength + 1;
+				TraceFormatDefinition &definition = formats[record.formatId];
+				definition.argTypes.assign(argTypes, argTypesLength);
+				definition.format.assign(format, strnlen(format, payloadSize - argTypesLength - 1));
+			}
+		}
+		else if (record.recordType == TraceRecord_Event)
+		{
+			std::string text;
+			auto it = formats.find(record.formatId);
+			if (it == formats.end())
+			{
+				char buffer[64];
+				snprintf(buffer, sizeof(buffer), "<unknown format %u>", (unsigned int)record.formatId);
+				text = buffer;
+			}
+			else if (!FormatTraceEvent(it->second, payload, payloadSize, text))
+			{
+				text += " <malformed arguments>";
+			}
+
+			printf("[%llu.%06llu] %s\n",
+				(unsigned long long)(record.timestampNs / 1000000000ull),
+				(unsigned long long)((record.timestampNs / 1000ull) % 1000000ull),
+				text.c_str());
+			++eventCount;
+		}
+
+		offset += (sizeof(record) + payloadSize + k_nTraceRecordAlignment - 1) & ~(size_t)(k_nTraceRecordAlignment - 1);
+	}
+
+	printf("%llu events, %llu records dropped\n", eventCount, (unsigned long long)header.droppedRecordCount);
+
+	return 0;
+}
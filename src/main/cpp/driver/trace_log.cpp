@@ -0,0 +1,230 @@
+#include "trace_log.h"
+#include "logger.h"
+#include <chrono>
+#include <mutex>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace steamvrbridge {
+
+	std::atomic<bool> TraceLog::s_bEnabled(false);
+
+	// Mapped file, only changed by Open() and Close()
+	#if defined( _WIN32 )
+	static HANDLE s_hTraceFile = INVALID_HANDLE_VALUE;
+	static HANDLE s_hTraceMapping = NULL;
+	#else
+	static int s_nTraceFileDescriptor = -1;
+	#endif
+	static uint8_t *s_pTraceData = nullptr;
+	static size_t s_nTraceCapacity = 0;
+	static std::chrono::steady_clock::time_point s_traceStartTime;
+
+	// Next free byte in the file; grows past the capacity once it's full
+	static std::atomic<uint64_t> s_nTraceWriteOffset(0);
+	static std::atomic<uint64_t> s_nTraceDroppedCount(0);
+
+	// Guards handing out format ids, which only happens the first time a call site records
+	static std::mutex s_traceFormatMutex;
+	static uint32_t s_nNextTraceFormatId = 1;
+	static std::atomic<uint32_t> s_nTraceGeneration(0);
+
+	static inline size_t AlignTraceRecordSize(size_t size) {
+		return (size + k_nTraceRecordAlignment - 1) & ~(size_t)(k_nTraceRecordAlignment - 1);
+	}
+
+	static bool MapTraceFile(const std::string &path, size_t capacityBytes) {
+		#if defined( _WIN32 )
+		s_hTraceFile = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (s_hTraceFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		const unsigned long long size = capacityBytes;
+		s_hTraceMapping = CreateFileMappingA(s_hTraceFile, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+		if (s_hTraceMapping != NULL) {
+			s_pTraceData = static_cast<uint8_t *>(MapViewOfFile(s_hTraceMapping, FILE_MAP_WRITE, 0, 0, capacityBytes));
+		}
+		#else
+		s_nTraceFileDescriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (s_nTraceFileDescriptor < 0)
+			return false;
+
+		if (ftruncate(s_nTraceFileDescriptor, (off_t)capacityBytes) == 0) {
+			void *data = mmap(nullptr, capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, s_nTraceFileDescriptor, 0);
+			s_pTraceData = data != MAP_FAILED ? static_cast<uint8_t *>(data) : nullptr;
+		}
+		#endif
+
+		return s_pTraceData != nullptr;
+	}
+
+	// Unmaps the file and cuts it down to the given size
+	static void UnmapTraceFile(size_t usedBytes) {
+		#if defined( _WIN32 )
+		if (s_pTraceData != nullptr) {
+			FlushViewOfFile(s_pTraceData, 0);
+			UnmapViewOfFile(s_pTraceData);
+		}
+		if (s_hTraceMapping != NULL) {
+			CloseHandle(s_hTraceMapping);
+			s_hTraceMapping = NULL;
+		}
+		if (s_hTraceFile != INVALID_HANDLE_VALUE) {
+			LARGE_INTEGER fileSize;
+			fileSize.QuadPart = (LONGLONG)usedBytes;
+			if (SetFilePointerEx(s_hTraceFile, fileSize, NULL, FILE_BEGIN)) {
+				SetEndOfFile(s_hTraceFile);
+			}
+			CloseHandle(s_hTraceFile);
+			s_hTraceFile = INVALID_HANDLE_VALUE;
+		}
+		#else
+		if (s_pTraceData != nullptr) {
+			msync(s_pTraceData, s_nTraceCapacity, MS_SYNC);
+			munmap(s_pTraceData, s_nTraceCapacity);
+		}
+		if (s_nTraceFileDescriptor >= 0) {
+			if (ftruncate(s_nTraceFileDescriptor, (off_t)usedBytes) != 0) {
+				Logger::Warn("TraceLog::Close - Failed to shrink the trace file\n");
+			}
+			close(s_nTraceFileDescriptor);
+			s_nTraceFileDescriptor = -1;
+		}
+		#endif
+
+		s_pTraceData = nullptr;
+	}
+
+	bool TraceLog::Open(const std::string &path, size_t capacityBytes) {
+		if (s_pTraceData != nullptr)
+			Close();
+
+		capacityBytes = AlignTraceRecordSize(capacityBytes);
+		if (capacityBytes < sizeof(TraceFileHeader)) {
+			Logger::Error("TraceLog::Open - A trace of %u bytes can't hold anything\n", (unsigned int)capacityBytes);
+			return false;
+		}
+
+		if (!MapTraceFile(path, capacityBytes)) {
+			Logger::Error("TraceLog::Open - Failed to map trace file %s\n", path.c_str());
+			UnmapTraceFile(0);
+			return false;
+		}
+
+		s_nTraceCapacity = capacityBytes;
+		s_traceStartTime = std::chrono::steady_clock::now();
+
+		TraceFileHeader *header = reinterpret_cast<TraceFileHeader *>(s_pTraceData);
+		memset(header, 0, sizeof(TraceFileHeader));
+		memcpy(header->magic, k_TraceFileMagic, sizeof(header->magic));
+		header->version = k_nTraceFileVersion;
+		header->headerSize = sizeof(TraceFileHeader);
+		header->capacityBytes = capacityBytes;
+		header->startTimeUnixMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		s_nTraceWriteOffset = AlignTraceRecordSize(sizeof(TraceFileHeader));
+		s_nTraceDroppedCount = 0;
+		{
+			std::lock_guard<std::mutex> guard(s_traceFormatMutex);
+			s_nNextTraceFormatId = 1;
+			++s_nTraceGeneration;
+		}
+
+		Logger::Info("TraceLog::Open - Recording up to %u KB of trace to %s\n", (unsigned int)(capacityBytes / 1024), path.c_str());
+
+		s_bEnabled = true;
+		return true;
+	}
+
+	void TraceLog::Close() {
+		if (s_pTraceData == nullptr)
+			return;
+
+		s_bEnabled = false;
+
+		const uint64_t writeOffset = s_nTraceWriteOffset.load();
+		const uint64_t usedBytes = writeOffset < s_nTraceCapacity ? writeOffset : s_nTraceCapacity;
+
+		TraceFileHeader *header = reinterpret_cast<TraceFileHeader *>(s_pTraceData);
+		header->usedBytes = usedBytes;
+		header->droppedRecordCount = s_nTraceDroppedCount.load();
+
+		Logger::Info("TraceLog::Close - Wrote %u KB of trace, %u records dropped\n",
+			(unsigned int)(usedBytes / 1024), (unsigned int)header->droppedRecordCount);
+
+		UnmapTraceFile((size_t)usedBytes);
+	}
+
+	uint32_t TraceLog::GetFormatId(TraceFormat &format, const char *argTypes) {
+		const uint64_t generation = s_nTraceGeneration.load(std::memory_order_relaxed);
+
+		uint64_t registration = format.m_registration.load(std::memory_order_acquire);
+		if ((registration >> 32) == generation)
+			return static_cast<uint32_t>(registration);
+
+		std::lock_guard<std::mutex> guard(s_traceFormatMutex);
+
+		// Another thread may have registered it while this one waited
+		registration = format.m_registration.load(std::memory_order_relaxed);
+		if ((registration >> 32) == generation)
+			return static_cast<uint32_t>(registration);
+
+		const uint32_t formatId = s_nNextTraceFormatId;
+
+		const size_t argTypesLength = strlen(argTypes) + 1;
+		const size_t formatLength = strlen(format.m_format) + 1;
+		uint8_t *payload = BeginRecord(formatId, argTypesLength + formatLength);
+		if (payload == nullptr) {
+			// Without its format record the event can't be decoded, so it's dropped too. The call site
+			// stays unregistered and tries again next time.
+			s_nTraceDroppedCount.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+
+		memcpy(payload, argTypes, argTypesLength);
+		memcpy(payload + argTypesLength, format.m_format, formatLength);
+		EndRecord(payload, TraceRecord_Format);
+
+		++s_nNextTraceFormatId;
+		format.m_registration.store((generation << 32) | formatId, std::memory_order_release);
+		return formatId;
+	}
+
+	uint8_t *TraceLog::BeginRecord(uint32_t formatId, size_t payloadSize) {
+		if (payloadSize > 0xFFFF) {
+			s_nTraceDroppedCount.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		const size_t recordSize = AlignTraceRecordSize(sizeof(TraceRecordHeader) + payloadSize);
+		const uint64_t offset = s_nTraceWriteOffset.fetch_add(recordSize, std::memory_order_relaxed);
+		if (offset + recordSize > s_nTraceCapacity) {
+			s_nTraceDroppedCount.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		// The record type stays zero (TraceRecord_End) until EndRecord(), so a reader of the file after a
+		// crash stops in front of a half written record instead of decoding it
+		TraceRecordHeader *header = reinterpret_cast<TraceRecordHeader *>(s_pTraceData + offset);
+		header->payloadSize = static_cast<uint16_t>(payloadSize);
+		header->formatId = formatId;
+		header->timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_traceStartTime).count();
+
+		return reinterpret_cast<uint8_t *>(header + 1);
+	}
+
+	void TraceLog::EndRecord(uint8_t *payload, eTraceRecordType recordType) {
+		TraceRecordHeader *header = reinterpret_cast<TraceRecordHeader *>(payload) - 1;
+
+		std::atomic_thread_fence(std::memory_order_release);
+		header->recordType = static_cast<uint16_t>(recordType);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include "trace_log_format.h"
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+namespace steamvrbridge {
+
+	// Type code of each argument type TraceLog::Record() accepts
+	template <typename T> struct TraceArgTypeOf;
+	template <> struct TraceArgTypeOf<int> { static const char k_code = TraceArg_Int32; };
+	template <> struct TraceArgTypeOf<unsigned int> { static const char k_code = TraceArg_UInt32; };
+	template <> struct TraceArgTypeOf<long long> { static const char k_code = TraceArg_Int64; };
+	template <> struct TraceArgTypeOf<bool> { static const char k_code = TraceArg_Bool; };
+	template <> struct TraceArgTypeOf<float> { static const char k_code = TraceArg_Float; };
+	template <> struct TraceArgTypeOf<double> { static const char k_code = TraceArg_Double; };
+	template <> struct TraceArgTypeOf<PSMVector3f> { static const char k_code = TraceArg_Vector3f; };
+	template <> struct TraceArgTypeOf<PSMQuatf> { static const char k_code = TraceArg_Quatf; };
+	template <> struct TraceArgTypeOf<PSMPosef> { static const char k_code = TraceArg_Posef; };
+
+	static_assert(sizeof(bool) == 1, "trace files store bools as one byte");
+	static_assert(sizeof(PSMVector3f) == 3 * sizeof(float), "trace files store vectors as 3 packed floats");
+	static_assert(sizeof(PSMQuatf) == 4 * sizeof(float), "trace files store quaternions as 4 packed floats");
+	static_assert(sizeof(PSMPosef) == 7 * sizeof(float), "trace files store poses as 7 packed floats");
+
+	// Total raw size of an argument list
+	template <typename... Args> struct TracePayloadSize;
+	template <> struct TracePayloadSize<> { static const size_t value = 0; };
+	template <typename T, typename... Rest> struct TracePayloadSize<T, Rest...> {
+		static const size_t value = sizeof(T) + TracePayloadSize<Rest...>::value;
+	};
+
+	inline void TracePackArgs(uint8_t *) {
+	}
+
+	template <typename T, typename... Rest>
+	inline void TracePackArgs(uint8_t *out, const T &arg, const Rest &... rest) {
+		memcpy(out, &arg, sizeof(T));
+		TracePackArgs(out + sizeof(T), rest...);
+	}
+
+	/* A trace call site: the format string, with one "{}" per argument, and the id it gets in the trace
+	file the first time it is recorded. Declare one as a function static next to the TraceLog::Record()
+	call that uses it, and always record the same argument types with it.*/
+	class TraceFormat {
+	public:
+		explicit TraceFormat(const char *format)
+			: m_format(format)
+			, m_registration(0) {
+		}
+
+	private:
+		friend class TraceLog;
+
+		const char *m_format;
+
+		// Format id in the low 32 bits, the trace file (counted up by every Open()) it was written to in
+		// the high ones, so a reopened trace defines it again
+		std::atomic<uint64_t> m_registration;
+	};
+
+	/* Binary trace written to a memory mapped file. Instead of formatting text, a record stores the id of
+	its format string, a timestamp and the raw bytes of its arguments, which costs a reservation with one
+	atomic add and a few copies into the mapped pages. Format strings are written once per trace, the
+	first time their call site records. The trace_decoder tool turns a trace file back into text. When
+	the file is full further records are dropped and counted. Record() may be called from any thread, but
+	not while Open() or Close() runs.*/
+	class TraceLog {
+	public:
+		// Creates (or overwrites) the trace file with the given size and starts recording into it.
+		static bool Open(const std::string &path, size_t capacityBytes);
+
+		// Stops recording, writes the used size into the header and shrinks the file to it.
+		static void Close();
+
+		static inline bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+		template <typename... Args>
+		static void Record(TraceFormat &format, const Args &... args) {
+			if (!IsEnabled())
+				return;
+
+			static const char k_argTypes[] = { TraceArgTypeOf<Args>::k_code..., '\0' };
+			const uint32_t formatId = GetFormatId(format, k_argTypes);
+			if (formatId == 0)
+				return;
+
+			uint8_t *payload = BeginRecord(formatId, TracePayloadSize<Args...>::value);
+			if (payload != nullptr) {
+				TracePackArgs(payload, args...);
+				EndRecord(payload, TraceRecord_Event);
+			}
+		}
+
+	private:
+		// Id of the format, writing its format record first if this is the first time it's used. Returns 0
+		// when the format record had to be dropped, counting the caller's record as dropped as well.
+		static uint32_t GetFormatId(TraceFormat &format, const char *argTypes);
+
+		// Reserves a record and returns where its payload goes, or null when the file is full.
+		// EndRecord() publishes it by writing its record type last.
+		static uint8_t *BeginRecord(uint32_t formatId, size_t payloadSize);
+		static void EndRecord(uint8_t *payload, eTraceRecordType recordType);
+
+		static std::atomic<bool> s_bEnabled;
+	};
+}
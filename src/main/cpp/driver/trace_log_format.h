@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+
+/* Layout of the binary trace files written by TraceLog and read by trace_decoder. Shared by both, so it
+only uses fixed width types and nothing from OpenVR or PSMoveService.
+
+A file starts with a TraceFileHeader followed by 8 byte aligned records, each a TraceRecordHeader and
+its payload. A format record (TraceRecord_Format) defines a format id: its payload is the argument type
+codes, a terminating zero, then the format string with one "{}" per argument and a terminating zero. An
+event record (TraceRecord_Event) refers to a format id defined earlier and carries the raw argument bytes,
+packed back to back in the order of the type codes. Unused space is zero, so a record type of zero marks
+the end of the records when the header's used size wasn't written (e.g. after a crash).*/
+
+namespace steamvrbridge {
+
+	static const char k_TraceFileMagic[8] = { 'P', 'S', 'M', 'T', 'R', 'A', 'C', 'E' };
+	static const uint32_t k_nTraceFileVersion = 1;
+
+	// Records start on multiples of this
+	static const uint32_t k_nTraceRecordAlignment = 8;
+
+	enum eTraceRecordType {
+		TraceRecord_End = 0,
+		TraceRecord_Format = 1,
+		TraceRecord_Event = 2
+	};
+
+	// Argument type codes and the size of their raw bytes
+	enum eTraceArgType {
+		TraceArg_Int32 = 'i',    // int32_t
+		TraceArg_UInt32 = 'u',   // uint32_t
+		TraceArg_Int64 = 'l',    // int64_t
+		TraceArg_Bool = 'b',     // one byte, 0 or 1
+		TraceArg_Float = 'f',    // float
+		TraceArg_Double = 'd',   // double
+		TraceArg_Vector3f = 'v', // 3 floats: x, y, z
+		TraceArg_Quatf = 'q',    // 4 floats: w, x, y, z
+		TraceArg_Posef = 'p'     // 7 floats: position x, y, z then orientation w, x, y, z
+	};
+
+	struct TraceFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+
+		// Size of the file including this header, and how much of it holds records. The used size is
+		// only filled in when the trace is closed; zero means scan until a TraceRecord_End.
+		uint64_t capacityBytes;
+		uint64_t usedBytes;
+
+		// Wall clock time the trace was opened at, record timestamps count from there
+		uint64_t startTimeUnixMs;
+
+		// Records that didn't fit any more
+		uint64_t droppedRecordCount;
+
+		uint8_t reserved[16];
+	};
+
+	struct TraceRecordHeader {
+		uint16_t recordType;
+		uint16_t payloadSize;
+		uint32_t formatId;
+		uint64_t timestampNs;
+	};
+}
@@ -1,4 +1,5 @@
 #include "trackable_device.h"
+#include "frame_profiler.h"
 #include "utils.h"
 #include "logger.h"
 #include "driver.h"
@@ -6,7 +7,8 @@
 namespace steamvrbridge {
 	TrackableDevice::TrackableDevice()
 		: m_ulPropertyContainer(vr::k_ulInvalidPropertyContainer)
-		, m_unSteamVRTrackedDeviceId(vr::k_unTrackedDeviceIndexInvalid) {
+		, m_unSteamVRTrackedDeviceId(vr::k_unTrackedDeviceIndexInvalid)
+		, m_worldFromDriverVersion(0) {
 		memset(&m_Pose, 0, sizeof(m_Pose));
 		m_Pose.result = vr::TrackingResult_Uninitialized;
 
@@ -34,6 +36,9 @@ namespace steamvrbridge {
 		m_ulPropertyContainer = properties->TrackedDeviceToPropertyContainer(unObjectId);
 		m_unSteamVRTrackedDeviceId = unObjectId;
 
+		// The new device index gets its first pose no matter how close it is to the last one posted
+		m_posePublisher.Invalidate();
+
 		properties->SetBoolProperty(m_ulPropertyContainer, vr::Prop_Firmware_UpdateAvailable_Bool, false);
 		properties->SetBoolProperty(m_ulPropertyContainer, vr::Prop_Firmware_ManualUpdate_Bool, false);
 		properties->SetBoolProperty(m_ulPropertyContainer, vr::Prop_ContainsProximitySensor_Bool, false);
@@ -54,6 +59,7 @@ namespace steamvrbridge {
 	void TrackableDevice::Deactivate() {
 		steamvrbridge::Logger::Info("CPSMoveTrackedDeviceLatest::Deactivate: %s was object id %d\n", GetSteamVRIdentifier(), m_unSteamVRTrackedDeviceId);
 		m_unSteamVRTrackedDeviceId = vr::k_unTrackedDeviceIndexInvalid;
+		m_poseHistory.Clear();
 	}
 
 	void TrackableDevice::EnterStandby() {
@@ -65,7 +71,21 @@ namespace steamvrbridge {
 	}
 
 	void TrackableDevice::DebugRequest(const char * pchRequest, char * pchResponseBuffer, uint32_t unResponseBufferSize) {
+		const char *response = "unknown request";
+
+		// Any of the driver's devices can be asked, e.g. with vrcmd or IVRSystem::DriverDebugRequest()
+		if (strcmp(pchRequest, "dump_frame_profile") == 0) {
+			if (FrameProfiler::IsEnabled()) {
+				FrameProfiler::RequestDump();
+				response = "frame profile dump requested";
+			} else {
+				response = "frame_profiler is not enabled";
+			}
+		}
 
+		if (pchResponseBuffer != nullptr && unResponseBufferSize > 0) {
+			snprintf(pchResponseBuffer, unResponseBufferSize, "%s", response);
+		}
 	}
 
 	vr::DriverPose_t TrackableDevice::GetPose() {
@@ -96,11 +116,11 @@ namespace steamvrbridge {
 	}
 
 	void TrackableDevice::RefreshWorldFromDriverPose() {
+		WorldFromDriverSnapshot snapshot;
+		CServerDriver_PSMoveService::getInstance()->GetWorldFromDriverTransform().GetSnapshot(&snapshot);
 
-		const PSMPosef worldFromDriverPose = CServerDriver_PSMoveService::getInstance()->GetWorldFromDriverPose();
-
-		steamvrbridge::Logger::Info("CServerDriver_PSMoveService::RefreshWorldFromDriverPose() for device %s\n", GetSteamVRIdentifier());
-		steamvrbridge::Logger::Info("  worldFromDriverPose: %s \n", steamvrbridge::Utils::PSMPosefToString(worldFromDriverPose).c_str());
+		const PSMPosef &worldFromDriverPose = snapshot.pose;
+		m_worldFromDriverVersion = snapshot.version;
 
 		// Transform used to convert from PSMove Tracking space to OpenVR Tracking Space
 		m_Pose.qWorldFromDriverRotation.w = worldFromDriverPose.Orientation.w;
@@ -121,12 +141,28 @@ namespace steamvrbridge {
 			(float)m_Pose.qWorldFromDriverRotation.w,
 			(float)m_Pose.qWorldFromDriverRotation.x,
 			(float)m_Pose.qWorldFromDriverRotation.y,
-			(float)m_Pose.qWorldFromDriverRotation.x);
+			(float)m_Pose.qWorldFromDriverRotation.z);
 		PSMPosef psmToOpenVRPose = PSM_PosefCreate(&psmToOpenVRTranslation, &psmToOpenVRRotation);
 
 		return psmToOpenVRPose;
 	}
 
+	void TrackableDevice::SyncWorldFromDriverPose() {
+		const WorldFromDriverTransform &worldFromDriver = CServerDriver_PSMoveService::getInstance()->GetWorldFromDriverTransform();
+
+		// Uncalibrated snapshots are skipped, refreshing also marks a controller's calibration as done
+		if (worldFromDriver.GetVersion() != m_worldFromDriverVersion) {
+			WorldFromDriverSnapshot snapshot;
+			worldFromDriver.GetSnapshot(&snapshot);
+
+			if (snapshot.bIsCalibrated) {
+				RefreshWorldFromDriverPose();
+			} else {
+				m_worldFromDriverVersion = snapshot.version;
+			}
+		}
+	}
+
 	const char *TrackableDevice::GetSteamVRIdentifier() const {
 		return m_strSteamVRSerialNo.c_str();
 	}
@@ -1,5 +1,8 @@
 #pragma once
 #include "PSMoveClient_CAPI.h"
+#include "pose_history.h"
+#include "pose_publisher.h"
+#include "world_from_driver_transform.h"
 #include <openvr_driver.h>
 #include <configuru.hpp>
 
@@ -29,9 +32,13 @@ namespace steamvrbridge {
 		virtual void Update();
 		virtual void RefreshWorldFromDriverPose();
 		PSMPosef GetWorldFromDriverPose();
+
+		// Copies the shared world-from-driver snapshot if a newer calibration was published since the last copy
+		void SyncWorldFromDriverPose();
 		virtual const char *GetSteamVRIdentifier() const;
 		virtual const vr::TrackedDeviceIndex_t getTrackedDeviceIndex();
 		inline vr::PropertyContainerHandle_t getPropertyContainerHandle() const { return m_ulPropertyContainer; }
+		inline const PoseHistory &GetPoseHistory() const { return m_poseHistory; }
 
 	protected:
 		// OpenVR Properties
@@ -48,6 +55,15 @@ namespace steamvrbridge {
 
 		// Cached for answering version queries from vrserver
 		vr::DriverPose_t m_Pose;
+
+		// Version of the world-from-driver snapshot copied into m_Pose
+		unsigned int m_worldFromDriverVersion;
+
+		// Most recent raw poses received from PSMoveService
+		PoseHistory m_poseHistory;
+
+		// Posts m_Pose to vrserver, skipping idle updates if enabled
+		PosePublisher m_posePublisher;
 		unsigned short m_firmware_revision;
 		unsigned short m_hardware_revision;
 	};
@@ -2,6 +2,7 @@
 #include "trackable_device.h"
 #include "utils.h"
 #include "constants.h"
+#include "logger.h"
 
 namespace steamvrbridge {
 
@@ -65,6 +66,10 @@ namespace steamvrbridge {
 
 	void PSMServiceTracker::Deactivate()
 	{
+		if (m_posePublisher.GetSuppressedPoseCount() > 0) {
+			Logger::Info("PSMServiceTracker::Deactivate - %s skipped %d idle pose updates\n",
+				GetSteamVRIdentifier(), m_posePublisher.GetSuppressedPoseCount());
+		}
 	}
 
 	void PSMServiceTracker::SetClientTrackerInfo(
@@ -122,9 +127,8 @@ namespace steamvrbridge {
 	{
 		TrackableDevice::Update();
 
-		// This call posts this pose to shared memory, where all clients will have access to it the next
-		// moment they want to predict a pose.
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unSteamVRTrackedDeviceId, m_Pose, sizeof(vr::DriverPose_t));
+		// Posts this pose to shared memory unless it hasn't meaningfully changed since the last post
+		m_posePublisher.Publish(m_unSteamVRTrackedDeviceId, m_Pose);
 	}
 
 	bool PSMServiceTracker::HasTrackerId(int TrackerID)
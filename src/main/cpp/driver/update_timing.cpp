@@ -0,0 +1,118 @@
+#include "update_timing.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace steamvrbridge {
+
+	static const char *k_UpdateTimingPathNames[UpdateTimingPath_Count] = {
+		"UpdateTrackingState",
+		"UpsampleTrackingState",
+		"UpdateControllerState",
+		"UpdateRumbleState",
+		"RunFrame"
+	};
+
+	// Upper bounds of all but the last haptic latency bucket, which takes everything above
+	static const long long k_HapticLatencyBucketBoundsMs[] = { 1, 2, 4, 8, 16, 33, 66 };
+
+	UpdateTimingStats::UpdateTimingStats() {
+		Reset(std::chrono::high_resolution_clock::now());
+	}
+
+	void UpdateTimingStats::AddSample(eUpdateTimingPath path, std::chrono::high_resolution_clock::duration elapsed) {
+		const long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		PathStats &stats = m_paths[path];
+
+		++stats.callCount;
+		stats.totalNanos += nanos;
+		if (nanos > stats.maxNanos)
+			stats.maxNanos = nanos;
+	}
+
+	void UpdateTimingStats::LogIfDue(
+		const char *owner,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		float interval_seconds) {
+		if (std::chrono::duration<float>(now - m_intervalStartTime).count() < interval_seconds)
+			return;
+
+		for (int path_index = 0; path_index < UpdateTimingPath_Count; ++path_index) {
+			const PathStats &stats = m_paths[path_index];
+			if (stats.callCount == 0)
+				continue;
+
+			Logger::Info("UpdateTiming - %s %s: %lld ns/call avg, %lld ns max over %d calls\n",
+				owner, k_UpdateTimingPathNames[path_index],
+				stats.totalNanos / stats.callCount, stats.maxNanos, stats.callCount);
+		}
+
+		Reset(now);
+	}
+
+	void UpdateTimingStats::Reset(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		memset(m_paths, 0, sizeof(m_paths));
+		m_intervalStartTime = now;
+	}
+
+	HapticLatencyStats::HapticLatencyStats() {
+		Reset(std::chrono::high_resolution_clock::now());
+	}
+
+	void HapticLatencyStats::AddSample(std::chrono::high_resolution_clock::duration latency) {
+		const long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+
+		int bucket = 0;
+		while (bucket < k_nBucketCount - 1 && nanos >= k_HapticLatencyBucketBoundsMs[bucket] * 1000000LL)
+			++bucket;
+
+		++m_bucketCounts[bucket];
+		++m_nSampleCount;
+		m_totalNanos += nanos;
+		if (nanos > m_maxNanos)
+			m_maxNanos = nanos;
+	}
+
+	void HapticLatencyStats::LogIfDue(
+		const char *owner,
+		const std::chrono::time_point<std::chrono::high_resolution_clock> &now,
+		float interval_seconds) {
+		if (std::chrono::duration<float>(now - m_intervalStartTime).count() < interval_seconds)
+			return;
+
+		if (m_nSampleCount > 0) {
+			char summary[320];
+			Format(summary, sizeof(summary));
+			Logger::Info("HapticLatency - %s: %s\n", owner, summary);
+		}
+
+		Reset(now);
+	}
+
+	void HapticLatencyStats::Format(char *buffer, size_t bufferSize) const {
+		if (m_nSampleCount == 0) {
+			snprintf(buffer, bufferSize, "no haptic events");
+			return;
+		}
+
+		char histogram[256];
+		int length = 0;
+		for (int bucket = 0; bucket < k_nBucketCount && length < (int)sizeof(histogram); ++bucket) {
+			length += snprintf(histogram + length, sizeof(histogram) - length, bucket < k_nBucketCount - 1 ? "%s<%lldms: %d" : "%s>=%lldms: %d",
+				bucket > 0 ? ", " : "",
+				k_HapticLatencyBucketBoundsMs[bucket < k_nBucketCount - 1 ? bucket : bucket - 1],
+				m_bucketCounts[bucket]);
+		}
+
+		snprintf(buffer, bufferSize, "%lld us avg, %lld us max over %d events (%s)",
+			m_totalNanos / m_nSampleCount / 1000, m_maxNanos / 1000, m_nSampleCount, histogram);
+	}
+
+	void HapticLatencyStats::Reset(const std::chrono::time_point<std::chrono::high_resolution_clock> &now) {
+		memset(m_bucketCounts, 0, sizeof(m_bucketCounts));
+		m_nSampleCount = 0;
+		m_totalNanos = 0;
+		m_maxNanos = 0;
+		m_intervalStartTime = now;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <stddef.h>
+
+namespace steamvrbridge {
+
+	enum eUpdateTimingPath {
+		UpdateTimingPath_TrackingState,
+		UpdateTimingPath_UpsampleTrackingState,
+		UpdateTimingPath_ControllerState,
+		UpdateTimingPath_RumbleState,
+		UpdateTimingPath_Frame,
+
+		UpdateTimingPath_Count
+	};
+
+	/* Per call timing of the update paths of one device (or of the whole frame for the server driver).
+	Each path keeps a call count, the total and the worst call time. When log_update_timing is set the
+	owner logs the ns per call of every path once per update_timing_log_interval and starts over, so a
+	regression in one of these paths shows up in the driver log as a number.*/
+	class UpdateTimingStats {
+	public:
+		UpdateTimingStats();
+
+		void AddSample(eUpdateTimingPath path, std::chrono::high_resolution_clock::duration elapsed);
+
+		// Logs the paths that were called since the last log once the interval has passed, then resets.
+		void LogIfDue(const char *owner, const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float interval_seconds);
+
+		void Reset(const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+	private:
+		struct PathStats {
+			int callCount;
+			long long totalNanos;
+			long long maxNanos;
+		};
+
+		PathStats m_paths[UpdateTimingPath_Count];
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_intervalStartTime;
+	};
+
+	/* Histogram of the time from a haptic event arriving in RunFrame() to the rumble command it caused being
+	sent to PSMoveService, for one device. Buckets double from 1ms up to two frames at 30Hz, so a delay of
+	a whole frame or a rate limit window stands out. Logged by the owner together with its update timing,
+and returned by the owner's "haptic_latency" debug request.*/
+	class HapticLatencyStats {
+	public:
+		HapticLatencyStats();
+
+		void AddSample(std::chrono::high_resolution_clock::duration latency);
+
+		// Logs the histogram of the events since the last log once the interval has passed, then resets.
+		void LogIfDue(const char *owner, const std::chrono::time_point<std::chrono::high_resolution_clock> &now, float interval_seconds);
+
+		void Reset(const std::chrono::time_point<std::chrono::high_resolution_clock> &now);
+
+		inline int GetSampleCount() const { return m_nSampleCount; }
+
+		// Writes the average, the worst latency and the histogram of the events since the last reset
+		void Format(char *buffer, size_t bufferSize) const;
+
+	private:
+		static const int k_nBucketCount = 8;
+
+		int m_bucketCounts[k_nBucketCount];
+		int m_nSampleCount;
+		long long m_totalNanos;
+		long long m_maxNanos;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_intervalStartTime;
+	};
+
+	// Times the enclosing scope into the given stats. Does nothing when stats is null.
+	class ScopedUpdateTimer {
+	public:
+		ScopedUpdateTimer(UpdateTimingStats *stats, eUpdateTimingPath path)
+			: m_stats(stats)
+			, m_path(path) {
+			if (m_stats != nullptr)
+				m_startTime = std::chrono::high_resolution_clock::now();
+		}
+
+		~ScopedUpdateTimer() {
+			if (m_stats != nullptr)
+				m_stats->AddSample(m_path, std::chrono::high_resolution_clock::now() - m_startTime);
+		}
+
+	private:
+		UpdateTimingStats *m_stats;
+		eUpdateTimingPath m_path;
+		std::chrono::time_point<std::chrono::high_resolution_clock> m_startTime;
+	};
+}
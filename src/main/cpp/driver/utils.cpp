@@ -5,12 +5,14 @@
 #include "constants.h"
 #include "logger.h"
 #include "settings_util.h"
+#include "psm_math.h"
 #include <openvr_driver.h>
 #include <assert.h>
 #include <math.h>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <stdexcept>
 
 #ifdef WIN32
 #include <windows.h>
@@ -18,6 +20,13 @@
 #include <tchar.h>
 
 #define PSM_STEAMVR_BRIDGE_REGISTRY_PATH _T("SOFTWARE\\WOW6432Node\\PSMoveSteamVRBridge\\PSMoveSteamVRBridge")
+#else
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif // WIN32
 
 namespace steamvrbridge {
@@ -56,7 +65,7 @@ namespace steamvrbridge {
 		for (int entry_index = 0; entry_index < string_table_count; ++entry_index) {
 			const char *string_entry = string_table[entry_index];
 
-			if (stricmp(string_entry, string) == 0) {
+			if (strcasecmp(string_entry, string) == 0) {
 				result_index = entry_index;
 				break;
 			}
@@ -113,7 +122,7 @@ namespace steamvrbridge {
 		delete[] pchPath;
 		return sPath;
 
-		#elif defined( OSX ) || defined( LINUX )
+		#else
 			// get the addr of a function in vrclient.so and then ask the dlopen system about it
 		Dl_info info;
 		dladdr((void *)Path_GetThisModulePath, &info);
@@ -140,7 +149,7 @@ namespace steamvrbridge {
         }
         else
         {
-            homedir = getenv("HOME");
+            home_dir = getenv("HOME");
         }
 #endif
         return home_dir;
@@ -286,6 +295,8 @@ namespace steamvrbridge {
 
 	bool Utils::IsProcessRunning(const std::string &processName) {
 		bool exists = false;
+
+		#if defined( _WIN32 ) || defined( _WIN64 )
 		PROCESSENTRY32 entry;
 		entry.dwSize = sizeof(PROCESSENTRY32);
 
@@ -293,7 +304,7 @@ namespace steamvrbridge {
 
 		if (Process32First(snapshot, &entry)) {
 			while (Process32Next(snapshot, &entry)) {
-				if (!stricmp(entry.szExeFile, processName.c_str())) {
+				if (!strcasecmp(entry.szExeFile, processName.c_str())) {
 					exists = true;
 					break;
 				}
@@ -301,6 +312,28 @@ namespace steamvrbridge {
 		}
 
 		CloseHandle(snapshot);
+		#else
+		// Every numbered directory in /proc is a process, its comm file holds the executable name
+		DIR *procDir = opendir("/proc");
+
+		if (procDir != nullptr) {
+			struct dirent *entry;
+
+			while (!exists && (entry = readdir(procDir)) != nullptr) {
+				if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+					continue;
+
+				std::ifstream commFile(std::string("/proc/") + entry->d_name + "/comm");
+				std::string commName;
+				if (std::getline(commFile, commName) && !strcasecmp(commName.c_str(), processName.c_str())) {
+					exists = true;
+				}
+			}
+
+			closedir(procDir);
+		}
+		#endif
+
 		return exists;
 	}
 
@@ -343,34 +376,35 @@ namespace steamvrbridge {
 				Logger::Error("Utils::LaunchProcess() - CreateProcessA() failed: %s.\n", LastErrorString);
 			}
 		}
-		#elif defined(__APPLE__) 
+		#elif defined(__APPLE__) || defined(__linux__)
 		{
-			pid_t processId;
-
-			if ((processId = fork()) == 0) {
-				std::string path_and_executable= processPath;
-				path_and_executable+= "/";
-				path_and_executable+= processName;
-
-				Logger::Info("Utils::LaunchProcess() process path: %s\n", path_and_executable.c_str());
-
-				const char * argv[] = new char *[args.size() + 2];			
-				argv[0]= processName.c_str();
-				for (size_t arg_index= 0; arg_index < args.size(); ++arg_index) {
-					Logger::Info("Utils::LaunchProcess() process args[%d]: %s\n", arg_index, args[arg_index].c_str());
-					argv[arg_index+1]= args[arg_index].c_str();
-				}
-				argv[args.size()+1]= NULL;
+			std::string path_and_executable= processPath;
+			path_and_executable+= "/";
+			path_and_executable+= processName;
 
-				if (execv(path_and_executable.c_str(), argv) == 0) {
-					bLaunchedProcess= true;
-					Logger::Info("Utils::LaunchProcess() - execv() succeeded.\n");
-				} else {
-					Logger::Error("Utils::LaunchProcess() - Failed to exec child process!\n");
-				}
+			Logger::Info("Utils::LaunchProcess() process path: %s\n", path_and_executable.c_str());
 
-				delete[] argv;
-			} else if (processId < 0) {
+			// Everything the child needs is built before the fork. The driver runs other threads (the
+			// alignment worker, the log flush thread), so the child may only call execv and _exit: any
+			// allocation or log call could block forever on a lock one of them held at fork time.
+			std::vector<char *> argv;
+			argv.reserve(args.size() + 2);
+			argv.push_back(const_cast<char *>(processName.c_str()));
+			for (size_t arg_index= 0; arg_index < args.size(); ++arg_index) {
+				Logger::Info("Utils::LaunchProcess() process args[%d]: %s\n", arg_index, args[arg_index].c_str());
+				argv.push_back(const_cast<char *>(args[arg_index].c_str()));
+			}
+			argv.push_back(nullptr);
+
+			const pid_t processId = fork();
+			if (processId == 0) {
+				// execv only returns on failure. Leave without running the parent's atexit handlers.
+				execv(path_and_executable.c_str(), argv.data());
+				_exit(127);
+			} else if (processId > 0) {
+				bLaunchedProcess= true;
+				Logger::Info("Utils::LaunchProcess() - fork() succeeded.\n");
+			} else {
 				Logger::Error("Utils::LaunchProcess() - Failed to fork child process!\n");
 			}
 		}
@@ -412,9 +446,10 @@ namespace steamvrbridge {
 		bool bSuccess = false;
 		vr::IVRServerDriverHost *driver_host_interface = vr::VRServerDriverHost();
 
-		if (driver_host_interface != nullptr && device_index != vr::k_unTrackedDeviceIndexInvalid) {
+		if (driver_host_interface != nullptr && device_index < vr::k_unMaxTrackedDeviceCount) {
+			// Only fetch the poses up to the one we want
 			vr::TrackedDevicePose_t trackedDevicePoses[vr::k_unMaxTrackedDeviceCount];
-			vr::VRServerDriverHost()->GetRawTrackedDevicePoses(0.f, trackedDevicePoses, vr::k_unMaxTrackedDeviceCount);
+			vr::VRServerDriverHost()->GetRawTrackedDevicePoses(0.f, trackedDevicePoses, device_index + 1);
 
 			const vr::TrackedDevicePose_t &device_pose = trackedDevicePoses[device_index];
 			if (device_pose.bDeviceIsConnected && device_pose.bPoseIsValid) {
@@ -426,76 +461,84 @@ namespace steamvrbridge {
 		return bSuccess;
 	}
 
-	PSMQuatf Utils::ExtractHMDYawQuaternion(const PSMQuatf &q) {
-		// Convert the quaternion to a basis matrix
-		const PSMMatrix3f hmd_orientation = PSM_Matrix3fCreateFromQuatf(&q);
-
-		// Extract the forward (z-axis) vector from the basis
-		const PSMVector3f forward = PSM_Matrix3fBasisZ(&hmd_orientation);
-		PSMVector3f forward2d = { forward.x, 0.f, forward.z };
-		forward2d = PSM_Vector3fNormalizeWithDefault(&forward2d, k_psm_float_vector3_k);
-
-		// Compute the yaw angle (amount the z-axis has been rotated to it's current facing)
-		const float cos_yaw = PSM_Vector3fDot(&forward, k_psm_float_vector3_k);
-		float half_yaw = acosf(fminf(fmaxf(cos_yaw, -1.f), 1.f)) / 2.f;
-
-		// Flip the sign of the yaw angle depending on if forward2d is to the left or right of global forward
-		PSMVector3f yaw_axis = PSM_Vector3fCross(k_psm_float_vector3_k, &forward2d);
-		if (PSM_Vector3fDot(&yaw_axis, k_psm_float_vector3_j) < 0) {
-			half_yaw = -half_yaw;
-		}
+	// Yaw about +Y that turns the reference heading (x, z) = (0, 1) toward the given horizontal heading.
+	// Uses the half-angle vector (|h| + h.z, h.x) instead of acos/atan2. Facing away from the reference
+	// |h| + h.z cancels, so there the same direction is taken as (h.x, |h| - h.z), picked with a select
+	// rather than a branch. A zero heading gives the identity.
+	static inline PSMQuatf yawQuaternionFromHeading(float heading_x, float heading_z) {
+		const float length = sqrtf(heading_x*heading_x + heading_z*heading_z);
+		const bool bIsFacingAway = heading_z < 0.f;
+
+		const float half_w = bIsFacingAway ? heading_x : length + heading_z;
+		const float half_y = bIsFacingAway ? length - heading_z : heading_x;
 
-		// Convert this yaw rotation back into a quaternion
-		PSMQuatf yaw_quaternion =
-			PSM_QuatfCreate(
-			cosf(half_yaw), // w = cos(theta/2)
-			0.f, sinf(half_yaw), 0.f); // (x, y, z) = sin(theta/2)*axis, where axis = (0, 1, 0)
+		// Keep w >= 0 like the rest of the conversions
+		const float half_length = sqrtf(half_w*half_w + half_y*half_y);
+		const bool bIsZero = !(half_length > 0.f);
+		const float scale = bIsZero ? 0.f : (half_w < 0.f ? -1.f : 1.f) / half_length;
 
-		return yaw_quaternion;
+		return PSMMath::QuatfCreate(bIsZero ? 1.f : half_w * scale, 0.f, half_y * scale, 0.f);
 	}
 
-	PSMQuatf Utils::ExtractPSMoveYawQuaternion(const PSMQuatf &q) {
-		// Convert the quaternion to a basis matrix
-		const PSMMatrix3f psmove_basis = PSM_Matrix3fCreateFromQuatf(&q);
-
-		// Extract the forward (negative z-axis) vector from the basis
-		const PSMVector3f global_forward = { 0.f, 0.f, -1.f };
-		const PSMVector3f &forward = PSM_Matrix3fBasisY(&psmove_basis);
-		PSMVector3f forward2d = { forward.x, 0.f, forward.z };
-		forward2d = PSM_Vector3fNormalizeWithDefault(&forward2d, &global_forward);
-
-		// Compute the yaw angle (amount the z-axis has been rotated to it's current facing)
-		const float cos_yaw = PSM_Vector3fDot(&forward, &global_forward);
-		float yaw = acosf(fminf(fmaxf(cos_yaw, -1.f), 1.f));
-
-		// Flip the sign of the yaw angle depending on if forward2d is to the left or right of global forward
-		const PSMVector3f &global_up = *k_psm_float_vector3_j;
-		PSMVector3f yaw_axis = PSM_Vector3fCross(&global_forward, &forward2d);
-		if (PSM_Vector3fDot(&yaw_axis, &global_up) < 0) {
-			yaw = -yaw;
-		}
+	// Horizontal part of the forward basis vector, or when forward is within a hair of vertical (gimbal lock)
+	// the horizontal part of the basis vector a quarter turn away from it, flipped to continue the same heading.
+	static inline void selectHeading(
+		const PSMVector3f &forward,
+		const PSMVector3f &fallback,
+		float fallback_sign,
+		float *out_heading_x,
+		float *out_heading_z) {
+		const bool bIsVertical = forward.x*forward.x + forward.z*forward.z < 1e-6f;
+
+		*out_heading_x = bIsVertical ? fallback_sign * fallback.x : forward.x;
+		*out_heading_z = bIsVertical ? fallback_sign * fallback.z : forward.z;
+	}
 
-		// Convert this yaw rotation back into a quaternion
-		PSMVector3f eulerPitch = { (float)1.57079632679489661923, 0.f, 0.f }; // pitch 90 up first
-		PSMVector3f eulerYaw = { 0, yaw, 0 };
-		PSMQuatf quatPitch = PSM_QuatfCreateFromAngles(&eulerPitch);
-		PSMQuatf quatYaw = PSM_QuatfCreateFromAngles(&eulerYaw);
-		PSMQuatf yaw_quaternion =
-			PSM_QuatfConcat(
-			&quatPitch, // pitch 90 up first
-			&quatYaw); // Then apply the yaw
+	PSMQuatf Utils::ExtractHMDYawQuaternion(const PSMQuatf &q) {
+		// Forward (z-axis) and up (y-axis) columns of the rotation matrix, built straight from the quaternion
+		const PSMVector3f forward = {
+			2.f*(q.x*q.z + q.w*q.y), 2.f*(q.y*q.z - q.w*q.x), 1.f - 2.f*(q.x*q.x + q.y*q.y) };
+		const PSMVector3f up = {
+			2.f*(q.x*q.y - q.w*q.z), 1.f - 2.f*(q.x*q.x + q.z*q.z), 2.f*(q.y*q.z + q.w*q.x) };
+
+		// Yaw is the amount the z-axis has been rotated about +Y to its current facing, read from the z-axis
+		// projected onto the floor so that pitching the head doesn't change it. Looking straight up or down,
+		// the top of the head points along the facing instead.
+		float heading_x, heading_z;
+		selectHeading(forward, up, forward.y > 0.f ? -1.f : 1.f, &heading_x, &heading_z);
+
+		return yawQuaternionFromHeading(heading_x, heading_z);
+	}
 
-		return yaw_quaternion;
+	PSMQuatf Utils::ExtractPSMoveYawQuaternion(const PSMQuatf &q) {
+		// Forward (y-axis) and z-axis columns of the rotation matrix, built straight from the quaternion
+		const PSMVector3f forward = {
+			2.f*(q.x*q.y - q.w*q.z), 1.f - 2.f*(q.x*q.x + q.z*q.z), 2.f*(q.y*q.z + q.w*q.x) };
+		const PSMVector3f back = {
+			2.f*(q.x*q.z + q.w*q.y), 2.f*(q.y*q.z - q.w*q.x), 1.f - 2.f*(q.x*q.x + q.y*q.y) };
+
+		// Same as above, with yaw measured from the global forward (negative z-axis), so the heading is mirrored
+		// into the reference frame of yawQuaternionFromHeading(). Pointing straight up or down, the z-axis lies
+		// along the heading.
+		float heading_x, heading_z;
+		selectHeading(forward, back, forward.y > 0.f ? -1.f : 1.f, &heading_x, &heading_z);
+
+		const PSMQuatf yaw = yawQuaternionFromHeading(-heading_x, -heading_z);
+
+		// Pitch 90 up first, then apply the yaw: yaw * (cos 45, sin 45, 0, 0) expanded
+		const float k_fHalfSqrt2 = 0.70710678f;
+		return PSMMath::QuatfCreate(
+			yaw.w * k_fHalfSqrt2, yaw.w * k_fHalfSqrt2, yaw.y * k_fHalfSqrt2, -yaw.y * k_fHalfSqrt2);
 	}
 
 	void Utils::GetMetersPosInRotSpace(const PSMQuatf *rotation, PSMVector3f* out_position, const PSMPSMove &view) {
 		//const PSMPSMove &view = m_PSMServiceController->ControllerState.PSMoveState;
 		const PSMVector3f &position = view.Pose.Position;
 
-		PSMVector3f unrotatedPositionMeters = PSM_Vector3fScale(&position, k_fScalePSMoveAPIToMeters);
-		PSMQuatf viewOrientationInverse = PSM_QuatfConjugate(rotation);
+		PSMVector3f unrotatedPositionMeters = PSMMath::Vector3fScale(position, k_fScalePSMoveAPIToMeters);
+		PSMQuatf viewOrientationInverse = PSMMath::QuatfConjugate(*rotation);
 
-		*out_position = PSM_QuatfRotateVector(&viewOrientationInverse, &unrotatedPositionMeters);
+		*out_position = PSMMath::QuatfRotateVector(viewOrientationInverse, unrotatedPositionMeters);
 	}
 
 	PSMPosef Utils::GetHMDPoseInMeters() {
@@ -503,14 +546,14 @@ namespace steamvrbridge {
 		if (Utils::GetHMDDeviceIndex(&hmd_device_index)) {
 			Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - HMD Device Index= %u\n", hmd_device_index);
 		} else {
-			throw std::exception("CPSMoveControllerLatest::RealignHMDTrackingSpace() - Failed to get HMD Device Index\n");
+			throw std::runtime_error("CPSMoveControllerLatest::RealignHMDTrackingSpace() - Failed to get HMD Device Index\n");
 		}
 
 		PSMPosef hmdPose;
 		if (Utils::GetTrackedDevicePose(hmd_device_index, &hmdPose)) {
 			Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - hmd_pose_meters: %s \n", Utils::PSMPosefToString(hmdPose).c_str());
 		} else {
-			throw std::exception("CPSMoveControllerLatest::RealignHMDTrackingSpace() - Failed to get HMD Pose\n");
+			throw std::runtime_error("CPSMoveControllerLatest::RealignHMDTrackingSpace() - Failed to get HMD Pose\n");
 		}
 
 		return hmdPose;
@@ -524,20 +567,46 @@ namespace steamvrbridge {
 
 		Logger::Info("Begin CPSMoveControllerLatest::RealignHMDTrackingSpace()\n");
 
+		// Get the current pose from the controller view instead of using the driver's cached
+		// value because the user may have triggered a pose reset, in which case the driver's
+		// cached pose might not yet be up to date by the time this callback is triggered.
+		PSMPosef controller_pose_raw = *k_psm_pose_identity;
+		PSM_GetControllerPose(controllerId, &controller_pose_raw);
+		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_pose(raw): %s \n", Utils::PSMPosefToString(controller_pose_raw).c_str());
+
+		PSMPosef driver_pose_to_world_pose = 
+			ComputeWorldFromDriverPose(
+				controllerOrientationInHmdSpaceQuat,
+				controllerLocalOffsetFromHmdPosition,
+				controller_pose_raw,
+				hmd_pose_meters,
+				useControllerOrientation);
+		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - driver_pose_to_world_pose: %s \n", Utils::PSMPosefToString(driver_pose_to_world_pose).c_str());
+
+		return driver_pose_to_world_pose;
+	}
+
+	PSMPosef Utils::GetExpectedControllerWorldPose(PSMQuatf controllerOrientationInHmdSpaceQuat,
+												   PSMVector3f controllerLocalOffsetFromHmdPosition,
+												   PSMPosef hmd_pose_meters) {
 		// Make the HMD orientation only contain a yaw
 		hmd_pose_meters.Orientation = Utils::ExtractHMDYawQuaternion(hmd_pose_meters.Orientation);
-		Logger::Info("hmd_pose_meters(yaw-only): %s \n", Utils::PSMPosefToString(hmd_pose_meters).c_str());
-
 
 		// Transform the HMD's world space transform to where we expect the controller's world space transform to be.
 		PSMPosef controllerPoseRelativeToHMD =
-			PSM_PosefCreate(&controllerLocalOffsetFromHmdPosition, &controllerOrientationInHmdSpaceQuat);
-
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controllerPoseRelativeToHMD: %s \n", Utils::PSMPosefToString(controllerPoseRelativeToHMD).c_str());
+			PSMMath::PosefCreate(controllerLocalOffsetFromHmdPosition, controllerOrientationInHmdSpaceQuat);
 
 		// Compute the expected controller pose in HMD tracking space (i.e. "World Space")
-		PSMPosef controller_world_space_pose = PSM_PosefConcat(&controllerPoseRelativeToHMD, &hmd_pose_meters);
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_world_space_pose: %s \n", Utils::PSMPosefToString(controller_world_space_pose).c_str());
+		return PSMMath::PosefConcat(controllerPoseRelativeToHMD, hmd_pose_meters);
+	}
+
+	PSMPosef Utils::ComputeWorldFromDriverPose(PSMQuatf controllerOrientationInHmdSpaceQuat,
+											   PSMVector3f controllerLocalOffsetFromHmdPosition,
+											   PSMPosef controller_pose_raw,
+											   PSMPosef hmd_pose_meters,
+											   bool useControllerOrientation) {
+		PSMPosef controller_world_space_pose = 
+			GetExpectedControllerWorldPose(controllerOrientationInHmdSpaceQuat, controllerLocalOffsetFromHmdPosition, hmd_pose_meters);
 
 		/*
 		We now have the transform of the controller in world space -- controller_world_space_pose
@@ -550,140 +619,92 @@ namespace steamvrbridge {
 		driver_pose_to_world_pose = psmove_pose_meters.inverse() * controller_world_space_pose
 		*/
 
-		// Get the current pose from the controller view instead of using the driver's cached
-		// value because the user may have triggered a pose reset, in which case the driver's
-		// cached pose might not yet be up to date by the time this callback is triggered.
-		PSMPosef controller_pose_meters = *k_psm_pose_identity;
-		PSM_GetControllerPose(controllerId, &controller_pose_meters);
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_pose_meters(raw): %s \n", Utils::PSMPosefToString(controller_pose_meters).c_str());
-
 		// PSMove Position is in cm, but OpenVR stores position in meters
-		controller_pose_meters.Position = PSM_Vector3fScale(&controller_pose_meters.Position, k_fScalePSMoveAPIToMeters);
+		PSMPosef controller_pose_meters = controller_pose_raw;
+		controller_pose_meters.Position = PSMMath::Vector3fScale(controller_pose_meters.Position, k_fScalePSMoveAPIToMeters);
 
 		if (useControllerOrientation) {
 			// Extract only the yaw from the controller orientation (assume it's mostly held upright)
 			controller_pose_meters.Orientation = Utils::ExtractPSMoveYawQuaternion(controller_pose_meters.Orientation);
-			Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_pose_meters(yaw-only): %s \n", Utils::PSMPosefToString(controller_pose_meters).c_str());
 		} else {
 			const PSMVector3f eulerPitch = { (float)M_PI_2, 0.0f, 0.0f };
 
-			controller_pose_meters.Orientation = PSM_QuatfCreateFromAngles(&eulerPitch);
-			Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_pose_meters(no-rotation): %s \n", Utils::PSMPosefToString(controller_pose_meters).c_str());
+			controller_pose_meters.Orientation = PSMMath::QuatfCreateFromAngles(eulerPitch);
 		}
 
-		PSMPosef controller_pose_inv = PSM_PosefInverse(&controller_pose_meters);
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - controller_pose_inv: %s \n", Utils::PSMPosefToString(controller_pose_inv).c_str());
+		PSMPosef controller_pose_inv = PSMMath::PosefInverse(controller_pose_meters);
 
-		PSMPosef driver_pose_to_world_pose = PSM_PosefConcat(&controller_pose_inv, &controller_world_space_pose);
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - driver_pose_to_world_pose: %s \n", Utils::PSMPosefToString(driver_pose_to_world_pose).c_str());
-
-		PSMPosef test_composed_controller_world_space = PSM_PosefConcat(&controller_pose_meters, &driver_pose_to_world_pose);
-		Logger::Info("CPSMoveControllerLatest::RealignHMDTrackingSpace() - test_composed_controller_world_space: %s \n", Utils::PSMPosefToString(test_composed_controller_world_space).c_str());
-
-		return driver_pose_to_world_pose;
+		return PSMMath::PosefConcat(controller_pose_inv, controller_world_space_pose);
 	}
 
 	//==================================================================================================
 	// Math Helpers
 	//==================================================================================================
-	// From: http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+	// Shepperd's method without the branches. Each row below is 4*c*q for one pivot component c of q, so
+	// the row with the largest pivot is the well conditioned one; it is chosen with selects and normalized
+	// once. The sign is then fixed so that w >= 0, which keeps the output continuous frame to frame.
+	// See: http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+	static inline PSMQuatf matrixRowsToPSMQuatf(const float *r0, const float *r1, const float *r2) {
+		const float tw = 1.f + r0[0] + r1[1] + r2[2];
+		const float tx = 1.f + r0[0] - r1[1] - r2[2];
+		const float ty = 1.f - r0[0] + r1[1] - r2[2];
+		const float tz = 1.f - r0[0] - r1[1] + r2[2];
+
+		const float d21 = r2[1] - r1[2];
+		const float d02 = r0[2] - r2[0];
+		const float d10 = r1[0] - r0[1];
+		const float s01 = r0[1] + r1[0];
+		const float s02 = r0[2] + r2[0];
+		const float s12 = r1[2] + r2[1];
+
+		// Rows: w pivot { tw, d21, d02, d10 }, x pivot { d21, tx, s01, s02 },
+		//       y pivot { d02, s01, ty, s12 }, z pivot { d10, s02, s12, tz }
+		const bool bXOverW = tx > tw;
+		const bool bZOverY = tz > ty;
+		const bool bYZOverWX = (bZOverY ? tz : ty) > (bXOverW ? tx : tw);
+
+		const float wx_w = bXOverW ? d21 : tw, wx_x = bXOverW ? tx : d21, wx_y = bXOverW ? s01 : d02, wx_z = bXOverW ? s02 : d10;
+		const float yz_w = bZOverY ? d10 : d02, yz_x = bZOverY ? s02 : s01, yz_y = bZOverY ? s12 : ty, yz_z = bZOverY ? tz : s12;
+
+		const float w = bYZOverWX ? yz_w : wx_w;
+		const float x = bYZOverWX ? yz_x : wx_x;
+		const float y = bYZOverWX ? yz_y : wx_y;
+		const float z = bYZOverWX ? yz_z : wx_z;
+
+		// The pivot is at least 1 for any rotation matrix, so this only guards against a zero matrix
+		const float length_sqr = w*w + x*x + y*y + z*z;
+		const bool bIsDegenerate = !(length_sqr > 1e-12f);
+		const float scale = bIsDegenerate ? 0.f : (w < 0.f ? -1.f : 1.f) / sqrtf(length_sqr);
+
+		return PSMMath::QuatfCreate(bIsDegenerate ? 1.f : w * scale, x * scale, y * scale, z * scale);
+	}
 
 	PSMQuatf Utils::openvrMatrixExtractPSMQuatf(const vr::HmdMatrix34_t &openVRTransform) {
-		PSMQuatf q;
-
 		const float(&a)[3][4] = openVRTransform.m;
-		const float trace = a[0][0] + a[1][1] + a[2][2];
-
-		if (trace > 0) {
-			const float s = 0.5f / sqrtf(trace + 1.0f);
-
-			q.w = 0.25f / s;
-			q.x = (a[2][1] - a[1][2]) * s;
-			q.y = (a[0][2] - a[2][0]) * s;
-			q.z = (a[1][0] - a[0][1]) * s;
-		} else {
-			if (a[0][0] > a[1][1] && a[0][0] > a[2][2]) {
-				const float s = 2.0f * sqrtf(1.0f + a[0][0] - a[1][1] - a[2][2]);
-
-				q.w = (a[2][1] - a[1][2]) / s;
-				q.x = 0.25f * s;
-				q.y = (a[0][1] + a[1][0]) / s;
-				q.z = (a[0][2] + a[2][0]) / s;
-			} else if (a[1][1] > a[2][2]) {
-				const float s = 2.0f * sqrtf(1.0f + a[1][1] - a[0][0] - a[2][2]);
-
-				q.w = (a[0][2] - a[2][0]) / s;
-				q.x = (a[0][1] + a[1][0]) / s;
-				q.y = 0.25f * s;
-				q.z = (a[1][2] + a[2][1]) / s;
-			} else {
-				const float s = 2.0f * sqrtf(1.0f + a[2][2] - a[0][0] - a[1][1]);
-
-				q.w = (a[1][0] - a[0][1]) / s;
-				q.x = (a[0][2] + a[2][0]) / s;
-				q.y = (a[1][2] + a[2][1]) / s;
-				q.z = 0.25f * s;
-			}
-		}
-
-		q = PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity);
 
-		return q;
+		return matrixRowsToPSMQuatf(a[0], a[1], a[2]);
 	}
 
 	PSMQuatf Utils::psmMatrix3fToPSMQuatf(const PSMMatrix3f &psmMat) {
-		PSMQuatf q;
-
+		// PSM matrices store the basis vectors in m[0..2], i.e. m[i] is column i of the rotation matrix
 		const float(&a)[3][3] = psmMat.m;
-		const float trace = a[0][0] + a[1][1] + a[2][2];
-
-		if (trace > 0) {
-			const float s = 0.5f / sqrtf(trace + 1.0f);
-
-			q.w = 0.25f / s;
-			q.x = (a[2][1] - a[1][2]) * s;
-			q.y = (a[0][2] - a[2][0]) * s;
-			q.z = (a[1][0] - a[0][1]) * s;
-		} else {
-			if (a[0][0] > a[1][1] && a[0][0] > a[2][2]) {
-				const float s = 2.0f * sqrtf(1.0f + a[0][0] - a[1][1] - a[2][2]);
-
-				q.w = (a[2][1] - a[1][2]) / s;
-				q.x = 0.25f * s;
-				q.y = (a[0][1] + a[1][0]) / s;
-				q.z = (a[0][2] + a[2][0]) / s;
-			} else if (a[1][1] > a[2][2]) {
-				const float s = 2.0f * sqrtf(1.0f + a[1][1] - a[0][0] - a[2][2]);
-
-				q.w = (a[0][2] - a[2][0]) / s;
-				q.x = (a[0][1] + a[1][0]) / s;
-				q.y = 0.25f * s;
-				q.z = (a[1][2] + a[2][1]) / s;
-			} else {
-				const float s = 2.0f * sqrtf(1.0f + a[2][2] - a[0][0] - a[1][1]);
-
-				q.w = (a[1][0] - a[0][1]) / s;
-				q.x = (a[0][2] + a[2][0]) / s;
-				q.y = (a[1][2] + a[2][1]) / s;
-				q.z = 0.25f * s;
-			}
-		}
-
-		q = PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity);
+		const float r0[3] = { a[0][0], a[1][0], a[2][0] };
+		const float r1[3] = { a[0][1], a[1][1], a[2][1] };
+		const float r2[3] = { a[0][2], a[1][2], a[2][2] };
 
-		return q;
+		return matrixRowsToPSMQuatf(r0, r1, r2);
 	}
 
 	float Utils::psmVector3fDistance(const PSMVector3f &a, const PSMVector3f &b) {
-		const PSMVector3f diff = PSM_Vector3fSubtract(&a, &b);
+		const PSMVector3f diff = PSMMath::Vector3fSubtract(a, b);
 
-		return PSM_Vector3fLength(&diff);
+		return PSMMath::Vector3fLength(diff);
 	}
 
 	PSMVector3f Utils::psmVector3fLerp(const PSMVector3f &a, const PSMVector3f &b, float u) {
-		const PSMVector3f scaled_a = PSM_Vector3fScale(&a, 1.f - u);
-		const PSMVector3f scaled_b = PSM_Vector3fScale(&b, u);
-		const PSMVector3f result = PSM_Vector3fAdd(&scaled_a, &scaled_b);
+		const PSMVector3f scaled_a = PSMMath::Vector3fScale(a, 1.f - u);
+		const PSMVector3f scaled_b = PSMMath::Vector3fScale(b, u);
+		const PSMVector3f result = PSMMath::Vector3fAdd(scaled_a, scaled_b);
 
 		return result;
 	}
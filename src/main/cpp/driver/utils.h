@@ -44,16 +44,29 @@ namespace steamvrbridge {
 		static void GetMetersPosInRotSpace(const PSMQuatf * rotation, PSMVector3f * out_position, const PSMPSMove & view);
 
 		// Returns the HMD pose in meters.
-		// Throws a std::exception when HMD index or HMD pose can't be obtained.
-		static PSMPosef Utils::GetHMDPoseInMeters();
+		// Throws a std::runtime_error when HMD index or HMD pose can't be obtained.
+		static PSMPosef GetHMDPoseInMeters();
 
 		// Returns a PSM pose of the controller aligned to the HMD tracking space. Returns NULL pointer when
 		// HMD index or pose can't be obtained.
-		static PSMPosef Utils::RealignHMDTrackingSpace(PSMQuatf controllerOrientationInHmdSpaceQuat,
+		static PSMPosef RealignHMDTrackingSpace(PSMQuatf controllerOrientationInHmdSpaceQuat,
 													   PSMVector3f controllerLocalOffsetFromHmdPosition,
 													   PSMControllerID controllerId,
 													   PSMPosef hmd_pose_meters,
 													   bool useControllerOrientation);
+
+		// Returns where the controller should be in HMD tracking space when held at the given offset from the HMD.
+		static PSMPosef GetExpectedControllerWorldPose(PSMQuatf controllerOrientationInHmdSpaceQuat,
+													   PSMVector3f controllerLocalOffsetFromHmdPosition,
+													   PSMPosef hmd_pose_meters);
+
+		// Same as RealignHMDTrackingSpace() but for a given raw controller pose and without logging.
+		static PSMPosef ComputeWorldFromDriverPose(PSMQuatf controllerOrientationInHmdSpaceQuat,
+												   PSMVector3f controllerLocalOffsetFromHmdPosition,
+												   PSMPosef controller_pose_raw,
+												   PSMPosef hmd_pose_meters,
+												   bool useControllerOrientation);
+
 		static PSMQuatf openvrMatrixExtractPSMQuatf(const vr::HmdMatrix34_t &openVRTransform);
 		static PSMQuatf psmMatrix3fToPSMQuatf(const PSMMatrix3f &psmMat);
 		static float psmVector3fDistance(const PSMVector3f &a, const PSMVector3f &b);
@@ -6,9 +6,11 @@
 #include "settings_util.h"
 #include "driver.h"
 #include "facing_handsolver.h"
+#include "psm_math.h"
 #include "virtual_controller.h"
 #include "trackable_device.h"
 #include <assert.h>
+#include <math.h>
 
 #if _MSC_VER
 #define strcasecmp(a, b) stricmp(a,b)
@@ -20,7 +22,7 @@ namespace steamvrbridge {
 
 	// -- VirtualControllerConfig -----
 	configuru::Config VirtualControllerConfig::WriteToJSON() {
-		configuru::Config &pt= ControllerConfig::WriteToJSON();
+		configuru::Config pt= ControllerConfig::WriteToJSON();
 
 		// Touch pad settings
 		pt["delay_after_touchpad_press"] = delay_after_touchpad_press;
@@ -40,6 +42,11 @@ namespace steamvrbridge {
 		pt["thumbstick_deadzone"] = thumbstick_deadzone;
 		pt["thumbstick_touch_as_press"] = thumbstick_touch_as_press;
 
+		// Hand orientation solver
+		pt["hand_orientation_solver"] = hand_orientation_solver;
+		pt["hand_solver_neck_length_cm"] = hand_solver_neck_length_meters * 100.f;
+		pt["hand_solver_half_shoulder_width_cm"] = hand_solver_half_shoulder_width_meters * 100.f;
+
 		// Axis mapping
 		pt["touchpad_x_axis_index"]= virtual_touchpad_XAxis_index;
 		pt["touchpad_y_axis_index"]= virtual_touchpad_YAxis_index;
@@ -82,6 +89,11 @@ namespace steamvrbridge {
 		thumbstick_deadzone= pt.get_or<float>("thumbstick_deadzone",  thumbstick_deadzone);
 		thumbstick_touch_as_press= pt.get_or<bool>("thumbstick_touch_as_press", thumbstick_touch_as_press);
 
+		// Hand orientation solver
+		hand_orientation_solver = pt.get_or<std::string>("hand_orientation_solver", hand_orientation_solver);
+		hand_solver_neck_length_meters = pt.get_or<float>("hand_solver_neck_length_cm", hand_solver_neck_length_meters * 100.f) / 100.f;
+		hand_solver_half_shoulder_width_meters = pt.get_or<float>("hand_solver_half_shoulder_width_cm", hand_solver_half_shoulder_width_meters * 100.f) / 100.f;
+
 		// Axis mapping
 		virtual_touchpad_XAxis_index = pt.get_or<int>("touchpad_x_axis_index", -1);
 		virtual_touchpad_YAxis_index = pt.get_or<int>("touchpad_y_axis_index", -1);
@@ -148,7 +160,7 @@ namespace steamvrbridge {
 		, m_touchpadDirectionsUsed(false)
 		, m_posMetersAtTouchpadPressTime(*k_psm_float_vector3_zero)
 		, m_driverSpaceRotationAtTouchpadPressTime(*k_psm_quaternion_identity)
-		, m_orientationSolver(new CFacingHandOrientationSolver) {
+		, m_orientationSolver(nullptr) {
 		char svrIdentifier[256];
 		Utils::GenerateControllerSteamVRIdentifier(svrIdentifier, sizeof(svrIdentifier), psmControllerId);
 		m_strSteamVRSerialNo = svrIdentifier;
@@ -185,6 +197,17 @@ namespace steamvrbridge {
 		if (result == vr::VRInitError_None) {
 			Logger::Info("VirtualController::Activate - Controller %d Activated\n", unObjectId);
 
+			// Pick the solver that fills in the orientation the tracker doesn't provide
+			HandOrientationSolverParams solverParams;
+			solverParams.hand = m_TrackedControllerRole;
+			solverParams.neckLength = getConfig()->hand_solver_neck_length_meters;
+			solverParams.halfShoulderLength = getConfig()->hand_solver_half_shoulder_width_meters;
+
+			IHandOrientationSolver *solver = HandOrientationSolverFactory::createSolver(getConfig()->hand_orientation_solver, solverParams);
+			if (solver != nullptr) {
+				m_orientationSolver = new CachedHandOrientationSolver(solver);
+			}
+
 			// If we aren't doing the alignment gesture then just pretend we have tracking
 			// This will suppress the alignment gesture dialog in the monitor
 			if (getConfig()->disable_alignment_gesture || 
@@ -194,13 +217,11 @@ namespace steamvrbridge {
 				CServerDriver_PSMoveService::getInstance()->LaunchPSMoveMonitor();
 			}
 
-			PSMRequestID requestId;
-			if (PSM_StartControllerDataStreamAsync(
+			m_dataStreamFlags = PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData;
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StartControllerDataStream(
 				m_PSMServiceController->ControllerID,
-				PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData,
-				&requestId) != PSMResult_Error) {
-				PSM_RegisterCallback(requestId, VirtualController::start_controller_response_callback, this);
-			}
+				m_dataStreamFlags,
+				VirtualController::start_controller_response_callback, this);
 
 			// Setup controller properties
 			{
@@ -282,12 +303,24 @@ namespace steamvrbridge {
 
 	void VirtualController::Deactivate() {
 		Logger::Info("VirtualController::Deactivate - Controller stream stopped\n");
-		PSM_StopControllerDataStreamAsync(m_PSMServiceController->ControllerID, nullptr);
+		CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().StopControllerDataStream(m_PSMServiceController->ControllerID);
+
+		if (m_orientationSolver != nullptr) {
+			const unsigned int hitCount = m_orientationSolver->getHitCount();
+			const unsigned int callCount = hitCount + m_orientationSolver->getMissCount();
+			Logger::Info("VirtualController::Deactivate - Hand orientation cache hit %u of %u solves (%.1f%%)\n",
+				hitCount, callCount, callCount > 0 ? 100.f * hitCount / callCount : 0.f);
+
+			delete m_orientationSolver;
+			m_orientationSolver = nullptr;
+		}
 
 		Controller::Deactivate();
 	}
 
 	void VirtualController::UpdateControllerState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_ControllerState);
+
 		static const uint64_t s_kTouchpadButtonMask = vr::ButtonMaskFromId(vr::k_EButton_SteamVR_Touchpad);
 
 		assert(m_PSMServiceController != nullptr);
@@ -302,7 +335,7 @@ namespace steamvrbridge {
 		if (bStartRealignHMDTriggered && !getConfig()->disable_alignment_gesture) {
 			Logger::Info("VirtualController::UpdateControllerState(): Calling StartRealignHMDTrackingSpace() in response to controller chord.\n");
 
-			PSM_ResetControllerOrientationAsync(m_PSMServiceController->ControllerID, k_psm_quaternion_identity, nullptr);
+			CServerDriver_PSMoveService::getInstance()->GetPSMCommandQueue().ResetControllerOrientation(m_PSMServiceController->ControllerID, *k_psm_quaternion_identity);
 			m_bResetPoseRequestSent = true;
 
 			// We have the transform of the HMD in world space. 
@@ -311,18 +344,11 @@ namespace steamvrbridge {
 			PSMVector3f controllerLocalOffsetFromHmdPosition = 
 				{ 0.0f, 0.0f, -1.0f * getConfig()->calibration_offset_meters };
 
-			try {
-				PSMPosef hmdPose = Utils::GetHMDPoseInMeters();
-				PSMPosef realignedPose = Utils::RealignHMDTrackingSpace(controllerOrientationInHmdSpaceQuat,
-																		controllerLocalOffsetFromHmdPosition,
-																		m_PSMServiceController->ControllerID,
-																		hmdPose,
-																		false);
-				CServerDriver_PSMoveService::getInstance()->SetHMDTrackingSpace(realignedPose);
-			} catch (std::exception & e) {
-				// Log an error message and safely carry on
-				Logger::Error(e.what());
-			}
+			HMDAlignmentParams alignmentParams;
+			alignmentParams.controllerOrientationInHmdSpace = controllerOrientationInHmdSpaceQuat;
+			alignmentParams.controllerLocalOffsetFromHmdPosition = controllerLocalOffsetFromHmdPosition;
+			alignmentParams.useControllerOrientation = false;
+			StartHMDAlignment(alignmentParams);
 
 			m_bResetAlignRequestSent = true;
 		} else {
@@ -561,7 +587,7 @@ namespace steamvrbridge {
 					PSMVector3f newPosMeters;
 					Utils::GetMetersPosInRotSpace(&m_driverSpaceRotationAtTouchpadPressTime, &newPosMeters, m_PSMServiceController->ControllerState.PSMoveState);
 
-					PSMVector3f offsetMeters = PSM_Vector3fSubtract(&newPosMeters, &m_posMetersAtTouchpadPressTime);
+					PSMVector3f offsetMeters = PSMMath::Vector3fSubtract(newPosMeters, m_posMetersAtTouchpadPressTime);
 
 					#if LOG_TOUCHPAD_EMULATION != 0
 					Logger::Info("Touchpad held! Relative position (%f, %f, %f) meters\n",
@@ -589,6 +615,8 @@ namespace steamvrbridge {
 	}
 
 	void VirtualController::UpdateTrackingState() {
+		ScopedUpdateTimer timer(GetUpdateTimingStats(), UpdateTimingPath_TrackingState);
+
 		assert(m_PSMServiceController != nullptr);
 		assert(m_PSMServiceController->IsConnected);
 
@@ -616,51 +644,6 @@ namespace steamvrbridge {
 		m_Pose.vecDriverFromHeadTranslation[1] = 0.f;
 		m_Pose.vecDriverFromHeadTranslation[2] = 0.f;
 
-		// Set position
-		{
-			const PSMVector3f &position = view.Pose.Position;
-			m_Pose.vecPosition[0] = position.x * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[1] = position.y * k_fScalePSMoveAPIToMeters;
-			m_Pose.vecPosition[2] = position.z * k_fScalePSMoveAPIToMeters;
-		}
-
-		// virtual extend controllers
-		if (getConfig()->extend_Y_meters != 0.0f || getConfig()->extend_Z_meters != 0.0f) {
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			PSMVector3f shift = { (float)m_Pose.vecPosition[0], (float)m_Pose.vecPosition[1], (float)m_Pose.vecPosition[2] };
-
-			if (getConfig()->extend_Z_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, 0, -1 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Z_meters, &shift);
-			}
-
-			if (getConfig()->extend_Y_meters != 0.0f) {
-
-				PSMVector3f local_forward = { 0, -1, 0 };
-				PSMVector3f global_forward = PSM_QuatfRotateVector(&orientation, &local_forward);
-
-				shift = PSM_Vector3fScaleAndAdd(&global_forward, getConfig()->extend_Y_meters, &shift);
-			}
-
-			m_Pose.vecPosition[0] = shift.x;
-			m_Pose.vecPosition[1] = shift.y;
-			m_Pose.vecPosition[2] = shift.z;
-		}
-
-		// Set rotational coordinates
-		{
-			const PSMQuatf &orientation = view.Pose.Orientation;
-
-			m_Pose.qRotation.w = getConfig()->z_rotate_90_degrees ? -orientation.w : orientation.w;
-			m_Pose.qRotation.x = orientation.x;
-			m_Pose.qRotation.y = orientation.y;
-			m_Pose.qRotation.z = getConfig()->z_rotate_90_degrees ? -orientation.z : orientation.z;
-		}
-
 		// Set the physics state of the controller
 		/*{
 			const PSMPhysicsData &physicsData = view.PhysicsData;
@@ -688,13 +671,73 @@ namespace steamvrbridge {
 			m_Pose.vecAngularAcceleration[2] = physicsData.AngularAccelerationRadPerSecSqr.z;
 		}*/
 
-		m_Pose.poseIsValid =
-			m_PSMServiceController->ControllerState.PSMoveState.bIsPositionValid &&
-			m_PSMServiceController->ControllerState.PSMoveState.bIsOrientationValid;
+		const ServerDriverConfig &serverConfig = CServerDriver_PSMoveService::getInstance()->GetServerDriverConfig();
+		const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+
+		// Treat glitched optical samples like a momentary occlusion
+		const bool bIsPositionValid = view.bIsPositionValid && m_outlierGate.Accept(
+			view.Pose.Position,
+			m_PSMServiceController->OutputSequenceNum, m_PSMServiceController->DataFrameAverageFPS,
+			now, serverConfig);
+
+		// The history gets the gated validity so that upsampling never extrapolates from a rejected sample
+		m_poseHistory.Push(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			m_PSMServiceController->OutputSequenceNum, now);
+
+		// Hold the pose through short optical occlusions instead of dropping it straight away
+		PSMPosef pose;
+		bool bIsOccluded;
+		m_Pose.poseIsValid = m_occlusionPolicy.Apply(
+			view.Pose, GetStreamedPhysics(m_dataStreamFlags, view.PhysicsData),
+			bIsPositionValid, view.bIsOrientationValid,
+			now, serverConfig,
+			&pose, &bIsOccluded);
+
+		if (bIsOccluded && m_Pose.result == vr::TrackingResult_Running_OK)
+			m_Pose.result = vr::TrackingResult_Running_OutOfRange;
+
+		if (m_Pose.poseIsValid) {
+			SolveHandOrientation(&pose);
+		}
+
+		// Position and rotation are filled in and the pose is posted once the whole frame has been batched
+		CServerDriver_PSMoveService::getInstance()->GetPoseBatch().Enqueue(
+			pose,
+			getConfig()->extend_Y_meters,
+			getConfig()->extend_Z_meters,
+			getConfig()->z_rotate_90_degrees,
+			m_unSteamVRTrackedDeviceId,
+			&m_Pose,
+			&m_posePublisher);
+	}
+
+	void VirtualController::SolveHandOrientation(PSMPosef *inout_pose) {
+		if (m_orientationSolver == nullptr)
+			return;
+
+		CServerDriver_PSMoveService *server = CServerDriver_PSMoveService::getInstance();
 
-		// This call posts this pose to shared memory, where all clients will have access to it the next
-		// moment they want to predict a pose.
-		vr::VRServerDriverHost()->TrackedDevicePoseUpdated(m_unSteamVRTrackedDeviceId, m_Pose, sizeof(vr::DriverPose_t));
+		PSMPosef hmdPose;
+		if (!server->GetHMDPoseCache().GetHMDPose(&hmdPose))
+			return;
+
+		// The solvers work in OpenVR tracking space, the pose is in PSM tracking space
+		const PSMPosef worldFromDriverPose = GetWorldFromDriverPose();
+		const PSMVector3f driverPositionMeters = PSMMath::Vector3fScale(inout_pose->Position, k_fScalePSMoveAPIToMeters);
+		const PSMVector3f worldHandPosition = PSMMath::PosefTransformPoint(worldFromDriverPose, driverPositionMeters);
+
+		// Only solves again when the optical sample or the calibration changed, or the HMD moved
+		const PSMQuatf worldHandOrientation = m_orientationSolver->solveHandOrientation(
+			m_nPoseSequenceNumber,
+			m_worldFromDriverVersion,
+			hmdPose,
+			worldHandPosition);
+
+		// world = worldFromDriver * driver, so driver = inverse(worldFromDriver) * world
+		const PSMQuatf driverFromWorldOrientation = PSMMath::QuatfConjugate(worldFromDriverPose.Orientation);
+		inout_pose->Orientation = PSMMath::QuatfConcat(worldHandOrientation, driverFromWorldOrientation);
 	}
 
 	void VirtualController::Update() {
@@ -709,6 +752,10 @@ namespace steamvrbridge {
 
 				UpdateTrackingState();
 				UpdateControllerState();
+				UpdateHMDAlignment();
+			} else {
+				// Fill in the frames between optical samples if enabled
+				UpsampleTrackingState(getConfig()->extend_Y_meters, getConfig()->extend_Z_meters, getConfig()->z_rotate_90_degrees);
 			}
 		}
 	}
@@ -30,6 +30,9 @@ namespace steamvrbridge {
 			, linear_velocity_exponent(0.f)
 			, system_button_id(k_PSMButtonID_Virtual_4) // "Start" button on a xbox 360 controller
 			, hmd_align_button_id(k_PSMButtonID_Virtual_5) // "Back" button on a xbox 360 controller
+			, hand_orientation_solver("none")
+			, hand_solver_neck_length_meters(0.2f)
+			, hand_solver_half_shoulder_width_meters(0.18f)
 		{
 		};
 
@@ -82,6 +85,15 @@ namespace steamvrbridge {
 
 		// The button to use for controller hmd alignment
 		ePSMButtonID hmd_align_button_id;
+
+		// How to give the controller an orientation when the tracker only provides a position:
+		// "none", "facing" (HMD orientation) or "radial" (pointing away from the shoulder)
+		std::string hand_orientation_solver;
+
+		// Body measurements used by the radial solver: how far the shoulders sit below the HMD
+		// and how far this controller's shoulder sits to the side of it
+		float hand_solver_neck_length_meters;
+		float hand_solver_half_shoulder_width_meters;
 	};
 
 	/* A trackable Virtual controller (tracking bulb + game pad).
@@ -110,6 +122,8 @@ namespace steamvrbridge {
 		PSMControllerType GetPSMControllerType() const override { return PSMController_Virtual; }
 
 	protected:
+		void SolveHandOrientation(PSMPosef *inout_pose) override;
+
 		const VirtualControllerConfig *getConfig() const { return static_cast<const VirtualControllerConfig *>(m_config); }
 		ControllerConfig *AllocateControllerConfig() override { 
 			std::string fnamebase= std::string("virtual_controller_") + m_strPSMControllerSerialNo;
@@ -153,7 +167,7 @@ namespace steamvrbridge {
 		PSMQuatf m_driverSpaceRotationAtTouchpadPressTime;
 
 		// Optional solver used to determine hand orientation.
-		class IHandOrientationSolver *m_orientationSolver;
+		class CachedHandOrientationSolver *m_orientationSolver;
 
 		// Callbacks
 		static void start_controller_response_callback(const PSMResponseMessage *response, void *userdata);
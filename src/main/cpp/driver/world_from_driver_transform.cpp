@@ -0,0 +1,39 @@
+#include "world_from_driver_transform.h"
+
+namespace steamvrbridge {
+
+	WorldFromDriverTransform::WorldFromDriverTransform()
+		: m_sequence(0)
+		, m_pose(*k_psm_pose_identity)
+		, m_bIsCalibrated(false) {
+	}
+
+	void WorldFromDriverTransform::Publish(const PSMPosef &pose, bool bIsCalibrated) {
+		const unsigned int sequence = m_sequence.load(std::memory_order_relaxed);
+
+		// Mark the snapshot as being written so readers retry instead of taking a torn copy
+		m_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		m_pose = pose;
+		m_bIsCalibrated = bIsCalibrated;
+
+		m_sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	void WorldFromDriverTransform::GetSnapshot(WorldFromDriverSnapshot *out_snapshot) const {
+		while (true) {
+			const unsigned int sequenceBefore = m_sequence.load(std::memory_order_acquire);
+
+			if ((sequenceBefore & 1) == 0) {
+				out_snapshot->pose = m_pose;
+				out_snapshot->bIsCalibrated = m_bIsCalibrated;
+				out_snapshot->version = sequenceBefore >> 1;
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_sequence.load(std::memory_order_relaxed) == sequenceBefore)
+					return;
+			}
+		}
+	}
+}
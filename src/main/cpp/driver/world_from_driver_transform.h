@@ -0,0 +1,40 @@
+#pragma once
+#include "PSMoveClient_CAPI.h"
+#include <atomic>
+
+namespace steamvrbridge {
+
+	// A consistent copy of the transform from PSM tracking space to OpenVR tracking space
+	struct WorldFromDriverSnapshot {
+		PSMPosef pose;
+		bool bIsCalibrated;
+
+		// Bumped on every publish, 0 until the first one
+		unsigned int version;
+	};
+
+	/* The one shared world-from-driver transform. Recalibrating publishes a new versioned snapshot in
+	O(1); each device compares the version it last copied with GetVersion() and only copies the
+	snapshot again when it changed. Published from the thread that runs the frame, readable from any
+	thread without locks; a read that overlaps a publish is retried, so a copy is never half old and
+	half new.*/
+	class WorldFromDriverTransform {
+	public:
+		WorldFromDriverTransform();
+
+		// Must only be called from a single thread
+		void Publish(const PSMPosef &pose, bool bIsCalibrated);
+
+		// Version of the newest complete snapshot, cheap enough to poll every frame
+		inline unsigned int GetVersion() const { return m_sequence.load(std::memory_order_acquire) >> 1; }
+
+		void GetSnapshot(WorldFromDriverSnapshot *out_snapshot) const;
+
+	private:
+		// Twice the version, odd while a publish is in progress
+		std::atomic<unsigned int> m_sequence;
+
+		PSMPosef m_pose;
+		bool m_bIsCalibrated;
+	};
+}
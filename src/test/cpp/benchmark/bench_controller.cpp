@@ -0,0 +1,195 @@
+#include "benchmark_common.h"
+#include "driver_harness.h"
+#include "ps_ds4_controller.h"
+#include "ps_move_controller.h"
+#include "ps_navi_controller.h"
+#include "virtual_controller.h"
+
+using namespace steamvrbridge;
+
+static const PSMPosef k_controllerPose = { { 10.f, 120.f, -30.f }, { 0.9238795f, 0.f, 0.3826834f, 0.f } };
+static const PSMPosef k_hmdPose = { { 0.f, 1.7f, 0.f }, { 1.f, 0.f, 0.f, 0.f } };
+
+template <typename ControllerType>
+static ControllerType *FindDevice() {
+	for (vr::ITrackedDeviceServerDriver *device : stub::VRDevices()) {
+		ControllerType *controller = dynamic_cast<ControllerType *>(device);
+		if (controller != nullptr)
+			return controller;
+	}
+
+	return nullptr;
+}
+
+static vr::VREvent_HapticVibration_t LongVibration() {
+	vr::VREvent_HapticVibration_t vibration = {};
+	vibration.fDurationSeconds = 1000.f;
+	vibration.fFrequency = 160.f;
+	vibration.fAmplitude = 0.5f;
+	return vibration;
+}
+
+// Times Update() on a new optical sample: tracking state, controller state (buttons, axes and the
+// emulated trackpad) and rumble state
+static void MeasureUpdateWithSample(const char *name, PSMControllerID controllerId, Controller &controller) {
+	bench::Measure(name, 1000000, [&]() {
+		stub::PSMPublishFrame(controllerId);
+		controller.Update();
+	});
+}
+
+// Times Update() between optical samples: only the rumble state (upsampling is off by default)
+static void MeasureUpdateWithoutSample(const char *name, Controller &controller) {
+	bench::Measure(name, 1000000, [&]() {
+		controller.Update();
+	});
+}
+
+// Times the rumble update of Update() in the middle of a long vibration on every given motor
+static void MeasureVibratingUpdate(const char *name, Controller &controller, std::initializer_list<ePSMHapicID> haptic_ids) {
+	for (ePSMHapicID haptic_id : haptic_ids) {
+		controller.UpdateHaptics(haptic_id, controller.GetHapticState(haptic_id)->scheduler, LongVibration());
+	}
+	stub::PSMClearRumbleCommands();
+	stub::PSMClearCommandLog();
+
+	MeasureUpdateWithoutSample(name, controller);
+
+	for (ePSMHapicID haptic_id : haptic_ids) {
+		controller.GetHapticState(haptic_id)->scheduler.Clear();
+	}
+	controller.Update();
+	stub::PSMClearRumbleCommands();
+	stub::PSMClearCommandLog();
+}
+
+// One of each controller type, activated by the real server driver against the stubs. The update
+// paths are driven through the public Update() by changing the stub controller state, with trackpad
+// mappings from config files so each emulated trackpad variant is reachable from a button.
+BENCHMARK(controller_update_paths) {
+	test::DriverHarness harness;
+
+	harness.WriteConfigFile("psmove_00_00_00_00_00_01",
+		"{\"is_valid\": true, \"version\": 1, \"trackpad_mappings\": {\"move\": \"touchpad_press\", \"triangle\": \"touchpad_up\"}}");
+	harness.WriteConfigFile("ds4_00_00_00_00_00_02",
+		"{\"is_valid\": true, \"version\": 1, \"trackpad_mappings\": {\"cross\": \"touchpad_press\", \"dpad_up\": \"touchpad_up\", \"joystick_left\": \"touchpad_touch\"}}");
+	harness.WriteConfigFile("psnavi_00:00:00:00:00:03",
+		"{\"is_valid\": true, \"version\": 1, \"trackpad_mappings\": {\"cross\": \"touchpad_press\", \"dpad_up\": \"touchpad_up\"}}");
+	harness.WriteConfigFile("virtual_controller_00_00_00_00_00_04",
+		"{\"is_valid\": true, \"version\": 1, \"trackpad_mappings\": {\"virtual_button_0\": \"touchpad_press\", \"virtual_button_1\": \"touchpad_up\"}}");
+
+	PSMController *psmove = stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:00:00:00:00:01");
+	PSMController *ds4 = stub::PSMAddController(1, PSMController_DualShock4, PSMControllerHand_Any, "00:00:00:00:00:02");
+	PSMController *navi = stub::PSMAddController(2, PSMController_Navi, PSMControllerHand_Any, "00:00:00:00:00:03");
+	PSMController *virt = stub::PSMAddController(3, PSMController_Virtual, PSMControllerHand_Left, "00:00:00:00:00:04");
+
+	PSMPSMove &psmoveState = psmove->ControllerState.PSMoveState;
+	psmoveState.bIsTrackingEnabled = psmoveState.bIsCurrentlyTracking = true;
+	psmoveState.bIsPositionValid = psmoveState.bIsOrientationValid = true;
+	psmoveState.Pose = k_controllerPose;
+
+	PSMDualShock4 &ds4State = ds4->ControllerState.PSDS4State;
+	ds4State.bIsTrackingEnabled = ds4State.bIsCurrentlyTracking = true;
+	ds4State.bIsPositionValid = ds4State.bIsOrientationValid = true;
+	ds4State.Pose = k_controllerPose;
+
+	PSMPSNavi &naviState = navi->ControllerState.PSNaviState;
+
+	PSMVirtualController &virtualState = virt->ControllerState.VirtualController;
+	virtualState.bIsTrackingEnabled = virtualState.bIsCurrentlyTracking = virtualState.bIsPositionValid = true;
+	virtualState.numButtons = 8;
+	virtualState.numAxes = 4;
+	virtualState.Pose = k_controllerPose;
+
+	stub::VRSetHMDPose(k_hmdPose);
+
+	if (!harness.Start() || !harness.RunUntilDeviceCount(4, 20)) {
+		fprintf(stderr, "controller_update_paths: the driver didn't activate the stub controllers\n");
+		return;
+	}
+
+	// Let the stream start responses create the input components
+	for (int controllerId = 0; controllerId < 4; ++controllerId) {
+		stub::PSMPublishFrame(controllerId);
+	}
+	harness.RunFrames(3);
+
+	PSMoveController *psmoveController = FindDevice<PSMoveController>();
+	PSDualshock4Controller *ds4Controller = FindDevice<PSDualshock4Controller>();
+	PSNaviController *naviController = FindDevice<PSNaviController>();
+	VirtualController *virtualController = FindDevice<VirtualController>();
+	if (psmoveController == nullptr || ds4Controller == nullptr || naviController == nullptr || virtualController == nullptr) {
+		fprintf(stderr, "controller_update_paths: missing a controller type\n");
+		return;
+	}
+
+	//-- Controller::UpdateButton / UpdateAxis --
+	bench::Measure("controller_update_button_unchanged", 1000000, [&]() {
+		psmoveController->UpdateButton(k_PSMButtonID_Cross, PSMButtonState_UP);
+	});
+
+	int toggle = 0;
+	bench::Measure("controller_update_button_changed", 1000000, [&]() {
+		toggle ^= 1;
+		psmoveController->UpdateButton(k_PSMButtonID_Cross, toggle ? PSMButtonState_PRESSED : PSMButtonState_UP);
+	});
+	psmoveController->UpdateButton(k_PSMButtonID_Cross, PSMButtonState_UP);
+
+	bench::Measure("controller_update_axis_unchanged", 1000000, [&]() {
+		psmoveController->UpdateAxis(k_PSMAxisID_Trigger, 0.25f);
+	});
+
+	float trigger = 0.f;
+	bench::Measure("controller_update_axis_changed", 1000000, [&]() {
+		trigger = trigger < 1.f ? trigger + 0.001f : 0.f;
+		psmoveController->UpdateAxis(k_PSMAxisID_Trigger, trigger);
+	});
+
+	//-- PSMove: the held press reads the trackpad position from the controller's motion --
+	MeasureUpdateWithSample("psmove_update_sample_idle", 0, *psmoveController);
+	psmoveState.MoveButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("psmove_update_sample_trackpad_press", 0, *psmoveController);
+	psmoveState.MoveButton = PSMButtonState_UP;
+	psmoveState.TriangleButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("psmove_update_sample_trackpad_up", 0, *psmoveController);
+	psmoveState.TriangleButton = PSMButtonState_UP;
+
+	//-- DS4: both thumbsticks are remapped through the dead zone on every sample --
+	MeasureUpdateWithSample("ds4_update_sample_idle", 1, *ds4Controller);
+	ds4State.CrossButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("ds4_update_sample_trackpad_press", 1, *ds4Controller);
+	ds4State.CrossButton = PSMButtonState_UP;
+	ds4State.DPadUpButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("ds4_update_sample_trackpad_up", 1, *ds4Controller);
+	ds4State.DPadUpButton = PSMButtonState_UP;
+	ds4State.LeftAnalogX = 0.6f;
+	ds4State.LeftAnalogY = -0.4f;
+	MeasureUpdateWithSample("ds4_update_sample_trackpad_thumbstick", 1, *ds4Controller);
+	ds4State.LeftAnalogX = ds4State.LeftAnalogY = 0.f;
+
+	//-- Navi --
+	MeasureUpdateWithSample("navi_update_sample_idle", 2, *naviController);
+	naviState.CrossButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("navi_update_sample_trackpad_press", 2, *naviController);
+	naviState.CrossButton = PSMButtonState_UP;
+	naviState.DPadUpButton = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("navi_update_sample_trackpad_up", 2, *naviController);
+	naviState.DPadUpButton = PSMButtonState_UP;
+
+	//-- Virtual --
+	MeasureUpdateWithSample("virtual_update_sample_idle", 3, *virtualController);
+	virtualState.buttonStates[0] = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("virtual_update_sample_trackpad_press", 3, *virtualController);
+	virtualState.buttonStates[0] = PSMButtonState_UP;
+	virtualState.buttonStates[1] = PSMButtonState_DOWN;
+	MeasureUpdateWithSample("virtual_update_sample_trackpad_up", 3, *virtualController);
+	virtualState.buttonStates[1] = PSMButtonState_UP;
+
+	//-- Between samples: the rumble state, idle and vibrating --
+	MeasureUpdateWithoutSample("psmove_update_no_sample", *psmoveController);
+	MeasureVibratingUpdate("psmove_update_no_sample_vibrating", *psmoveController, { k_PSMHapticID_Rumble });
+	MeasureUpdateWithoutSample("ds4_update_no_sample", *ds4Controller);
+	MeasureVibratingUpdate("ds4_update_no_sample_vibrating", *ds4Controller, { k_PSMHapticID_LeftRumble, k_PSMHapticID_RightRumble });
+	MeasureUpdateWithoutSample("navi_update_no_sample", *naviController);
+	MeasureUpdateWithoutSample("virtual_update_no_sample", *virtualController);
+}
@@ -0,0 +1,44 @@
+#include "benchmark_common.h"
+#include "facing_handsolver.h"
+#include "psm_math.h"
+
+using namespace steamvrbridge;
+
+BENCHMARK(radial_hand_solver) {
+	CRadialHandOrientationSolver solver(vr::TrackedControllerRole_RightHand, 0.2f, 0.2f);
+
+	PSMPosef hmdPose = { { 0.f, 1.7f, 0.f }, { 0.9238795f, 0.f, 0.3826834f, 0.f } };
+	PSMVector3f hand = { 0.4f, 1.3f, -0.5f };
+
+	bench::Measure("radial_hand_solver", 1000000, [&]() {
+		// Keep the inputs moving so nothing can be hoisted out of the loop
+		hand.x += 1e-6f;
+		bench::DoNotOptimize(solver.solveHandOrientation(hmdPose, hand));
+	});
+
+	// Pointing straight up takes the Gram-Schmidt fallback
+	PSMVector3f handAbove = { 0.2f, 2.2f, 0.f };
+	bench::Measure("radial_hand_solver_hand_above_shoulder", 1000000, [&]() {
+		hmdPose.Position.y += 1e-7f;
+		handAbove.y += 1e-7f;
+		bench::DoNotOptimize(solver.solveHandOrientation(hmdPose, handAbove));
+	});
+}
+
+BENCHMARK(cached_hand_solver) {
+	CachedHandOrientationSolver cache(new CRadialHandOrientationSolver(vr::TrackedControllerRole_RightHand, 0.2f, 0.2f));
+
+	PSMPosef hmdPose = { { 0.f, 1.7f, 0.f }, { 0.9238795f, 0.f, 0.3826834f, 0.f } };
+	const PSMVector3f hand = { 0.4f, 1.3f, -0.5f };
+
+	// Upsampled frame, head still: answered from the cache
+	bench::Measure("cached_hand_solver_hit", 1000000, [&]() {
+		bench::DoNotOptimize(cache.solveHandOrientation(1, 0, hmdPose, hand));
+	});
+
+	// New sample every call: compare, then solve
+	int sequenceNum = 0;
+	bench::Measure("cached_hand_solver_miss", 1000000, [&]() {
+		bench::DoNotOptimize(cache.solveHandOrientation(++sequenceNum, 0, hmdPose, hand));
+	});
+}
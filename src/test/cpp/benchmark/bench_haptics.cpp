@@ -0,0 +1,180 @@
+#include "benchmark_common.h"
+#include "driver_harness.h"
+#include "ps_ds4_controller.h"
+#include "ps_move_controller.h"
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// A haptic event for one of the replayed haptic components, queued before the given frame
+struct TraceEvent {
+	int frame;
+	int target;
+	vr::VREvent_HapticVibration_t vibration;
+};
+
+// The haptic components the trace drives: the PSMove's motor and both DS4 motors
+static const int k_nTargetCount = 3;
+
+// Fixed seed, so every run replays the same trace
+class TraceRandom {
+public:
+	TraceRandom() : m_state(0x2545F491u) {}
+
+	float Next() {
+		m_state = m_state * 1664525u + 1013904223u;
+		return (float)(m_state >> 8) / (float)(1u << 24);
+	}
+
+private:
+	unsigned int m_state;
+};
+
+// Game style haptics: every component gets an event on roughly every other frame, a mix of legacy
+// pulses, short clicks, long rumbles and stops at every frequency the motors distinguish
+static void BuildHapticTrace(int frameCount, std::vector<TraceEvent> *out_trace) {
+	static const float k_frequencies[] = { 0.f, 4.f, 20.f, 80.f, 160.f, 320.f };
+	TraceRandom random;
+
+	for (int frame = 0; frame < frameCount; ++frame) {
+		for (int target = 0; target < k_nTargetCount; ++target) {
+			if (random.Next() >= 0.4f)
+				continue;
+
+			TraceEvent event = {};
+			event.frame = frame;
+			event.target = target;
+			if (random.Next() >= 0.1f) {
+				event.vibration.fDurationSeconds = 0.001f + 0.15f * random.Next();
+				event.vibration.fAmplitude = 0.05f + 0.95f * random.Next();
+				event.vibration.fFrequency = k_frequencies[(int)(random.Next() * 6.f) % 6];
+			}
+			out_trace->push_back(event);
+		}
+	}
+}
+
+static double Percentile(const std::vector<long long> &sortedNanos, double fraction) {
+	if (sortedNanos.empty())
+		return 0.0;
+
+	const size_t index = (size_t)(fraction * (double)(sortedNanos.size() - 1) + 0.5);
+	return (double)sortedNanos[index];
+}
+
+// Replays a haptic-heavy event trace through the real server driver and reports how long each
+// event takes from being handed to the driver to the rumble command it causes reaching PSMoveService.
+// The harness runs frames back to back, so this is the driver's own share of the latency; a real
+// host adds the wait for the next RunFrame() on top. Events that don't change the motor output send
+// no command and aren't counted.
+BENCHMARK(haptic_event_replay) {
+	test::DriverHarness harness;
+
+	stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:00:00:00:00:01");
+	stub::PSMAddController(1, PSMController_DualShock4, PSMControllerHand_Left, "00:00:00:00:00:02");
+
+	if (!harness.Start() || !harness.RunUntilDeviceCount(2, 20)) {
+		fprintf(stderr, "haptic_event_replay: the driver didn't activate the stub controllers\n");
+		return;
+	}
+
+	// Let the stream start responses create the haptic components
+	stub::PSMPublishFrame(0);
+	stub::PSMPublishFrame(1);
+	harness.RunFrames(3);
+
+	PSMoveController *psmoveController = nullptr;
+	PSDualshock4Controller *ds4Controller = nullptr;
+	for (vr::ITrackedDeviceServerDriver *device : stub::VRDevices()) {
+		if (psmoveController == nullptr)
+			psmoveController = dynamic_cast<PSMoveController *>(device);
+		if (ds4Controller == nullptr)
+			ds4Controller = dynamic_cast<PSDualshock4Controller *>(device);
+	}
+	if (psmoveController == nullptr || ds4Controller == nullptr) {
+		fprintf(stderr, "haptic_event_replay: missing a controller\n");
+		return;
+	}
+
+	const Controller::HapticState *hapticStates[k_nTargetCount] = {
+		psmoveController->GetHapticState(k_PSMHapticID_Rumble),
+		ds4Controller->GetHapticState(k_PSMHapticID_LeftRumble),
+		ds4Controller->GetHapticState(k_PSMHapticID_RightRumble)
+	};
+	const PSMControllerID targetControllerIds[k_nTargetCount] = { 0, 1, 1 };
+	for (const Controller::HapticState *hapticState : hapticStates) {
+		if (hapticState == nullptr) {
+			fprintf(stderr, "haptic_event_replay: missing a haptic component\n");
+			return;
+		}
+	}
+
+	const int frameCount = bench::IterationCount(100000);
+	std::vector<TraceEvent> trace;
+	trace.reserve(frameCount * k_nTargetCount);
+	BuildHapticTrace(frameCount, &trace);
+
+	std::vector<long long> latencyNanos;
+	latencyNanos.reserve(trace.size());
+	size_t absorbedEventCount = 0;
+	size_t commandCount = 0;
+
+	stub::PSMClearRumbleCommands();
+	stub::PSMClearCommandLog();
+	const unsigned long long allocationsBefore = bench::AllocationCount();
+
+	size_t nextEvent = 0;
+	for (int frame = 0; frame < frameCount; ++frame) {
+		// Events per controller this frame; they all arrive together before the frame
+		int controllerEventCounts[2] = { 0, 0 };
+
+		const Clock::time_point queueTime = Clock::now();
+		for (; nextEvent < trace.size() && trace[nextEvent].frame == frame; ++nextEvent) {
+			const TraceEvent &traceEvent = trace[nextEvent];
+
+			vr::VREvent_t event = {};
+			event.eventType = vr::VREvent_Input_HapticVibration;
+			event.data.hapticVibration = traceEvent.vibration;
+			event.data.hapticVibration.componentHandle = hapticStates[traceEvent.target]->hapticComponentHandle;
+			stub::VRQueueEvent(event);
+
+			++controllerEventCounts[targetControllerIds[traceEvent.target]];
+		}
+
+		harness.RunFrame();
+
+		// The first command a controller got this frame is the one its events caused
+		const std::vector<stub::PSMRumbleCommand> &commands = stub::PSMRumbleCommands();
+		for (const stub::PSMRumbleCommand &command : commands) {
+			int &eventCount = controllerEventCounts[command.controllerId];
+			for (; eventCount > 0; --eventCount) {
+				latencyNanos.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(command.sendTime - queueTime).count());
+			}
+		}
+		absorbedEventCount += controllerEventCounts[0] + controllerEventCounts[1];
+		commandCount += commands.size();
+		stub::PSMClearRumbleCommands();
+		stub::PSMClearCommandLog();
+	}
+
+	const double allocationsPerEvent = (double)(bench::AllocationCount() - allocationsBefore) / (double)trace.size();
+
+	long long totalNanos = 0;
+	for (long long nanos : latencyNanos) {
+		totalNanos += nanos;
+	}
+	std::sort(latencyNanos.begin(), latencyNanos.end());
+
+	printf("haptic_event_replay: %d frames, %zu events, %zu rumble commands, %zu events didn't change the motors\n",
+		frameCount, trace.size(), commandCount, absorbedEventCount);
+
+	const double meanNanos = latencyNanos.empty() ? 0.0 : (double)totalNanos / (double)latencyNanos.size();
+	bench::RecordResult("haptic_event_to_command_mean", meanNanos, allocationsPerEvent);
+	bench::RecordResult("haptic_event_to_command_p50", Percentile(latencyNanos, 0.5), 0.0);
+	bench::RecordResult("haptic_event_to_command_p99", Percentile(latencyNanos, 0.99), 0.0);
+	bench::RecordResult("haptic_event_to_command_max", latencyNanos.empty() ? 0.0 : (double)latencyNanos.back(), 0.0);
+}
@@ -0,0 +1,88 @@
+#include "benchmark_common.h"
+#include "psm_math.h"
+#include <math.h>
+
+using namespace steamvrbridge;
+
+// Each pair times the inline PSMMath version against the exported PSM_* function it replaced. The
+// stub C API lives in its own translation unit, so like the service's client library it can't be
+// inlined into the caller.
+
+static const int k_nInputCount = 256;
+
+struct MathInputs {
+	PSMPosef poses[k_nInputCount];
+	PSMVector3f points[k_nInputCount];
+
+	MathInputs() {
+		for (int i = 0; i < k_nInputCount; ++i) {
+			const float angle = 0.1f * i;
+			const PSMVector3f axis = PSMMath::Vector3fNormalizeWithDefault(
+				PSMVector3f{ sinf(angle), cosf(1.3f*angle), 0.5f }, *k_psm_float_vector3_j);
+			const float s = sinf(0.5f*angle);
+
+			poses[i].Orientation = PSMQuatf{ cosf(0.5f*angle), axis.x*s, axis.y*s, axis.z*s };
+			poses[i].Position = PSMVector3f{ 0.01f*i, 1.5f, -0.02f*i };
+			points[i] = PSMVector3f{ cosf(angle), 0.5f*sinf(angle), 0.25f*i };
+		}
+	}
+};
+
+BENCHMARK(psm_math) {
+	const MathInputs inputs;
+	int i = 0;
+
+	bench::Measure("psm_math_quat_rotate_vector", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::QuatfRotateVector(inputs.poses[i].Orientation, inputs.points[i]));
+	});
+	bench::Measure("psm_capi_quat_rotate_vector", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_QuatfRotateVector(&inputs.poses[i].Orientation, &inputs.points[i]));
+	});
+
+	bench::Measure("psm_math_quat_concat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::QuatfConcat(inputs.poses[i].Orientation, inputs.poses[(i + 1) & (k_nInputCount - 1)].Orientation));
+	});
+	bench::Measure("psm_capi_quat_concat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_QuatfConcat(&inputs.poses[i].Orientation, &inputs.poses[(i + 1) & (k_nInputCount - 1)].Orientation));
+	});
+
+	bench::Measure("psm_math_quat_normalize", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::QuatfNormalizeWithDefault(inputs.poses[i].Orientation, *k_psm_quaternion_identity));
+	});
+	bench::Measure("psm_capi_quat_normalize", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_QuatfNormalizeWithDefault(&inputs.poses[i].Orientation, k_psm_quaternion_identity));
+	});
+
+	bench::Measure("psm_math_pose_concat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::PosefConcat(inputs.poses[i], inputs.poses[(i + 1) & (k_nInputCount - 1)]));
+	});
+	bench::Measure("psm_capi_pose_concat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_PosefConcat(&inputs.poses[i], &inputs.poses[(i + 1) & (k_nInputCount - 1)]));
+	});
+
+	bench::Measure("psm_math_pose_inverse", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::PosefInverse(inputs.poses[i]));
+	});
+	bench::Measure("psm_capi_pose_inverse", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_PosefInverse(&inputs.poses[i]));
+	});
+
+	bench::Measure("psm_math_pose_transform_point", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSMMath::PosefTransformPoint(inputs.poses[i], inputs.points[i]));
+	});
+	bench::Measure("psm_capi_pose_transform_point", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(PSM_PosefTransformPoint(&inputs.poses[i], &inputs.points[i]));
+	});
+}
@@ -0,0 +1,119 @@
+#include "benchmark_common.h"
+#include "legacy_rotation.h"
+#include "utils.h"
+#include <math.h>
+
+using namespace steamvrbridge;
+
+static const int k_nInputCount = 256;
+
+// Rotations spread over all orientations, so both the branch-free kernels and the legacy branches see
+// every pivot and every side of the yaw sign test
+struct RotationInputs {
+	PSMQuatf quaternions[k_nInputCount];
+	vr::HmdMatrix34_t openVRMatrices[k_nInputCount];
+	PSMMatrix3f psmMatrices[k_nInputCount];
+
+	RotationInputs() {
+		for (int i = 0; i < k_nInputCount; ++i) {
+			const PSMVector3f angles = { 0.37f * i, 0.11f * i, 0.23f * i };
+			const PSMQuatf q = PSM_QuatfCreateFromAngles(&angles);
+
+			quaternions[i] = q;
+			psmMatrices[i] = PSM_Matrix3fCreateFromQuatf(&q);
+			for (int row = 0; row < 3; ++row) {
+				for (int column = 0; column < 3; ++column) {
+					openVRMatrices[i].m[row][column] = psmMatrices[i].m[column][row];
+				}
+				openVRMatrices[i].m[row][3] = 0.f;
+			}
+		}
+	}
+};
+
+BENCHMARK(utils_rotation_conversion) {
+	const RotationInputs inputs;
+	int i = 0;
+
+	bench::Measure("utils_openvr_matrix_to_quat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::openvrMatrixExtractPSMQuatf(inputs.openVRMatrices[i]));
+	});
+	bench::Measure("legacy_openvr_matrix_to_quat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(legacy::openvrMatrixExtractPSMQuatf(inputs.openVRMatrices[i]));
+	});
+
+	bench::Measure("utils_psm_matrix_to_quat", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::psmMatrix3fToPSMQuatf(inputs.psmMatrices[i]));
+	});
+
+	bench::Measure("utils_hmd_yaw", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::ExtractHMDYawQuaternion(inputs.quaternions[i]));
+	});
+	bench::Measure("legacy_hmd_yaw", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(legacy::ExtractHMDYawQuaternion(inputs.quaternions[i]));
+	});
+
+	bench::Measure("utils_psmove_yaw", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::ExtractPSMoveYawQuaternion(inputs.quaternions[i]));
+	});
+	bench::Measure("legacy_psmove_yaw", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(legacy::ExtractPSMoveYawQuaternion(inputs.quaternions[i]));
+	});
+}
+
+// The vector and pose helpers the controllers call every update
+BENCHMARK(utils_math_helpers) {
+	const RotationInputs inputs;
+	PSMVector3f positions[k_nInputCount];
+	PSMPosef poses[k_nInputCount];
+	PSMPSMove views[k_nInputCount];
+	for (int index = 0; index < k_nInputCount; ++index) {
+		positions[index] = PSMVector3f{ 0.5f * index, -0.25f * index, 0.125f * index };
+		poses[index] = PSMPosef{ positions[index], inputs.quaternions[index] };
+		views[index] = PSMPSMove();
+		views[index].Pose = poses[index];
+	}
+	int i = 0;
+
+	bench::Measure("utils_meters_pos_in_rot_space", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		PSMVector3f position;
+		Utils::GetMetersPosInRotSpace(&inputs.quaternions[i], &position, views[(i + 1) & (k_nInputCount - 1)]);
+		bench::DoNotOptimize(position);
+	});
+
+	bench::Measure("utils_vector_distance", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::psmVector3fDistance(positions[i], positions[(i + 7) & (k_nInputCount - 1)]));
+	});
+	bench::Measure("utils_vector_lerp", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::psmVector3fLerp(positions[i], positions[(i + 7) & (k_nInputCount - 1)], 0.3f));
+	});
+
+	bench::Measure("utils_openvr_matrix_to_position", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::openvrMatrixExtractPSMVector3f(inputs.openVRMatrices[i]));
+	});
+	bench::Measure("utils_openvr_matrix_to_pose", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::openvrMatrixExtractPSMPosef(inputs.openVRMatrices[i]));
+	});
+
+	const PSMVector3f handOffset = { 0.f, -0.2f, -0.3f };
+	bench::Measure("utils_expected_controller_world_pose", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::GetExpectedControllerWorldPose(inputs.quaternions[i], handOffset, poses[(i + 3) & (k_nInputCount - 1)]));
+	});
+	bench::Measure("utils_world_from_driver_pose", 10000000, [&]() {
+		i = (i + 1) & (k_nInputCount - 1);
+		bench::DoNotOptimize(Utils::ComputeWorldFromDriverPose(inputs.quaternions[i], handOffset, poses[i], poses[(i + 3) & (k_nInputCount - 1)], true));
+	});
+}
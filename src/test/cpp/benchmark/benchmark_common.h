@@ -0,0 +1,72 @@
+#pragma once
+// Minimal microbenchmark framework: BENCHMARK registers a function that times its own loop with
+// bench::Measure(). benchmark_main.cpp runs them, prints ns/call and heap allocations/call and
+// compares against a baseline file (see src/test/resources/benchmark_baseline.txt).
+
+#include <chrono>
+#include <string>
+
+namespace bench {
+
+	typedef void(*BenchmarkFunction)();
+
+	struct Registrar {
+		Registrar(const char *name, BenchmarkFunction function);
+	};
+
+	// Heap allocations made by this thread so far (counted by the operator new override)
+	unsigned long long AllocationCount();
+
+	// Keeps the compiler from optimizing away a result or the computation feeding it
+	template <typename T>
+	inline void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void *s_sink;
+		s_sink = &value;
+#endif
+	}
+
+	// Iterations to time per repeat, scaled down by --quick
+	int IterationCount(int iterations);
+
+	// Adds a line to the report, for benchmarks that time themselves
+	void RecordResult(const char *name, double nanosecondsPerCall, double allocationsPerCall);
+
+	// Reports the cost of one call of body, run IterationCount(iterations) times per repeat.
+	// The fastest repeat is reported.
+	template <typename Body>
+	void Measure(const char *name, int iterations, Body body) {
+		const int count = IterationCount(iterations);
+		double bestNsPerCall = 1e300;
+		double allocationsPerCall = 0.0;
+
+		// First repeat warms the caches and lets any lazily built state get built
+		for (int repeat = 0; repeat < 6; ++repeat) {
+			const unsigned long long allocationsBefore = AllocationCount();
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < count; ++i) {
+				body();
+			}
+
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			const unsigned long long allocations = AllocationCount() - allocationsBefore;
+			if (repeat == 0)
+				continue;
+
+			const double nsPerCall = std::chrono::duration<double, std::nano>(end - start).count() / count;
+			if (nsPerCall < bestNsPerCall)
+				bestNsPerCall = nsPerCall;
+			allocationsPerCall = (double)allocations / count;
+		}
+
+		RecordResult(name, bestNsPerCall, allocationsPerCall);
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static bench::Registrar name##_registrar(#name, name); \
+	static void name()
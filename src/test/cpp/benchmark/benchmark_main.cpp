@@ -0,0 +1,216 @@
+// Runs every registered benchmark and prints one line per measurement:
+//   <name> <ns/call> <allocs/call>
+//
+//   benchmark_driver [--quick] [--filter <substring>]
+//                    [--baseline <file>] [--write-baseline <file>] [--max-slowdown <ratio>]
+//
+// With --baseline every result is compared against the baseline file. More allocations per call
+// than the baseline always fails; a slowdown only fails past --max-slowdown (off by default, as
+// timings depend on the machine). --write-baseline saves the results in the same format.
+
+#include "benchmark_common.h"
+#include <atomic>
+#include <map>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Count every heap allocation the benchmarks make
+static thread_local unsigned long long t_allocationCount = 0;
+
+void *operator new(size_t size) {
+	++t_allocationCount;
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	++t_allocationCount;
+	return malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+
+namespace bench {
+
+	struct BenchmarkEntry {
+		const char *name;
+		BenchmarkFunction function;
+	};
+
+	struct Result {
+		std::string name;
+		double nsPerCall;
+		double allocationsPerCall;
+	};
+
+	static std::vector<BenchmarkEntry> &Registry() {
+		static std::vector<BenchmarkEntry> s_registry;
+		return s_registry;
+	}
+
+	static std::vector<Result> s_results;
+	static bool s_bQuick = false;
+
+	Registrar::Registrar(const char *name, BenchmarkFunction function) {
+		BenchmarkEntry entry = { name, function };
+		Registry().push_back(entry);
+	}
+
+	unsigned long long AllocationCount() {
+		return t_allocationCount;
+	}
+
+	int IterationCount(int iterations) {
+		const int count = s_bQuick ? iterations / 100 : iterations;
+		return count > 0 ? count : 1;
+	}
+
+	void RecordResult(const char *name, double nanosecondsPerCall, double allocationsPerCall) {
+		Result result;
+		result.name = name;
+		result.nsPerCall = nanosecondsPerCall;
+		result.allocationsPerCall = allocationsPerCall;
+		s_results.push_back(result);
+
+		printf("%-56s %10.1f ns/call %8.2f allocs/call\n", name, nanosecondsPerCall, allocationsPerCall);
+		fflush(stdout);
+	}
+
+	static bool LoadBaseline(const char *path, std::map<std::string, Result> *out_baseline) {
+		FILE *file = fopen(path, "r");
+		if (file == nullptr)
+			return false;
+
+		char line[512];
+		while (fgets(line, sizeof(line), file) != nullptr) {
+			if (line[0] == '#' || line[0] == '\n')
+				continue;
+
+			char name[256];
+			Result result;
+			if (sscanf(line, "%255s %lf %lf", name, &result.nsPerCall, &result.allocationsPerCall) == 3) {
+				result.name = name;
+				(*out_baseline)[result.name] = result;
+			}
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	static bool WriteBaseline(const char *path) {
+		FILE *file = fopen(path, "w");
+		if (file == nullptr)
+			return false;
+
+		fprintf(file, "# <benchmark> <ns/call> <allocs/call>, written by benchmark_driver --write-baseline\n");
+		for (const Result &result : s_results) {
+			fprintf(file, "%s %.1f %.2f\n", result.name.c_str(), result.nsPerCall, result.allocationsPerCall);
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	static int CompareToBaseline(const std::map<std::string, Result> &baseline, double maxSlowdown) {
+		int failureCount = 0;
+
+		for (const Result &result : s_results) {
+			auto it = baseline.find(result.name);
+			if (it == baseline.end()) {
+				printf("%-56s not in the baseline\n", result.name.c_str());
+				continue;
+			}
+
+			const double ratio = it->second.nsPerCall > 0.0 ? result.nsPerCall / it->second.nsPerCall : 1.0;
+			const bool bMoreAllocations = result.allocationsPerCall > it->second.allocationsPerCall + 0.005;
+			const bool bSlower = maxSlowdown > 0.0 && ratio > maxSlowdown;
+
+			printf("%-56s %6.2fx baseline time, %.2f vs %.2f allocs/call%s\n",
+				result.name.c_str(), ratio, result.allocationsPerCall, it->second.allocationsPerCall,
+				(bMoreAllocations || bSlower) ? "  <-- REGRESSION" : "");
+
+			if (bMoreAllocations || bSlower)
+				++failureCount;
+		}
+
+		return failureCount;
+	}
+}
+
+int main(int argc, char **argv) {
+	const char *filter = nullptr;
+	const char *baselinePath = nullptr;
+	const char *writeBaselinePath = nullptr;
+	double maxSlowdown = 0.0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			bench::s_bQuick = true;
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baselinePath = argv[++i];
+		} else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+			writeBaselinePath = argv[++i];
+		} else if (strcmp(argv[i], "--max-slowdown") == 0 && i + 1 < argc) {
+			maxSlowdown = atof(argv[++i]);
+		} else {
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	for (const bench::BenchmarkEntry &entry : bench::Registry()) {
+		if (filter == nullptr || strstr(entry.name, filter) != nullptr) {
+			entry.function();
+		}
+	}
+
+	int failureCount = 0;
+
+	if (baselinePath != nullptr) {
+		std::map<std::string, bench::Result> baseline;
+		if (!bench::LoadBaseline(baselinePath, &baseline)) {
+			fprintf(stderr, "Failed to read the baseline %s\n", baselinePath);
+			return 2;
+		}
+
+		printf("\nCompared to %s:\n", baselinePath);
+		failureCount = bench::CompareToBaseline(baseline, maxSlowdown);
+	}
+
+	if (writeBaselinePath != nullptr && !bench::WriteBaseline(writeBaselinePath)) {
+		fprintf(stderr, "Failed to write the baseline %s\n", writeBaselinePath);
+		return 2;
+	}
+
+	return failureCount == 0 ? 0 : 1;
+}
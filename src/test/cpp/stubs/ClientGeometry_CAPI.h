@@ -0,0 +1,53 @@
+#pragma once
+// Stand-in for PSMoveService's ClientGeometry_CAPI.h, for the test harness. stub_client_geometry.cpp
+// is a port of the PSMoveService implementation, so it also serves as the reference the inline
+// PSMMath versions are tested against.
+
+typedef struct { float x, y, z; } PSMVector3f;
+typedef struct { int x, y, z; } PSMVector3i;
+typedef struct { float w, x, y, z; } PSMQuatf;
+
+// Basis vectors are stored as m[0] (x), m[1] (y) and m[2] (z)
+typedef struct { float m[3][3]; } PSMMatrix3f;
+
+typedef struct { PSMVector3f Position; PSMQuatf Orientation; } PSMPosef;
+
+extern const PSMVector3f *k_psm_float_vector3_zero;
+extern const PSMVector3f *k_psm_float_vector3_i;
+extern const PSMVector3f *k_psm_float_vector3_j;
+extern const PSMVector3f *k_psm_float_vector3_k;
+extern const PSMQuatf *k_psm_quaternion_identity;
+extern const PSMPosef *k_psm_pose_identity;
+
+PSMVector3f PSM_Vector3fAdd(const PSMVector3f *a, const PSMVector3f *b);
+PSMVector3f PSM_Vector3fSubtract(const PSMVector3f *a, const PSMVector3f *b);
+PSMVector3f PSM_Vector3fScale(const PSMVector3f *v, const float s);
+PSMVector3f PSM_Vector3fScaleAndAdd(const PSMVector3f *v, const float s, const PSMVector3f *b);
+PSMVector3f PSM_Vector3fNormalizeWithDefault(const PSMVector3f *v, const PSMVector3f *default_result);
+float PSM_Vector3fLength(const PSMVector3f *v);
+float PSM_Vector3fDot(const PSMVector3f *a, const PSMVector3f *b);
+PSMVector3f PSM_Vector3fCross(const PSMVector3f *a, const PSMVector3f *b);
+
+PSMQuatf PSM_QuatfCreate(float w, float x, float y, float z);
+PSMQuatf PSM_QuatfCreateFromAngles(const PSMVector3f *eulerAngles);
+PSMQuatf PSM_QuatfAdd(const PSMQuatf *a, const PSMQuatf *b);
+PSMQuatf PSM_QuatfScale(const PSMQuatf *q, const float s);
+PSMQuatf PSM_QuatfMultiply(const PSMQuatf *a, const PSMQuatf *b);
+PSMQuatf PSM_QuatfConcat(const PSMQuatf *first, const PSMQuatf *second);
+PSMVector3f PSM_QuatfRotateVector(const PSMQuatf *q, const PSMVector3f *v);
+PSMQuatf PSM_QuatfConjugate(const PSMQuatf *q);
+PSMQuatf PSM_QuatfInverse(const PSMQuatf *q);
+PSMQuatf PSM_QuatfNormalizeWithDefault(const PSMQuatf *q, const PSMQuatf *default_result);
+PSMQuatf PSM_QuatfSlerp(const PSMQuatf *a, const PSMQuatf *b, const float u);
+
+PSMMatrix3f PSM_Matrix3fCreate(const PSMVector3f *basis_x, const PSMVector3f *basis_y, const PSMVector3f *basis_z);
+PSMMatrix3f PSM_Matrix3fCreateFromQuatf(const PSMQuatf *q);
+PSMVector3f PSM_Matrix3fBasisX(const PSMMatrix3f *m);
+PSMVector3f PSM_Matrix3fBasisY(const PSMMatrix3f *m);
+PSMVector3f PSM_Matrix3fBasisZ(const PSMMatrix3f *m);
+
+PSMPosef PSM_PosefCreate(const PSMVector3f *position, const PSMQuatf *orientation);
+PSMPosef PSM_PosefInverse(const PSMPosef *pose);
+PSMPosef PSM_PosefConcat(const PSMPosef *first, const PSMPosef *second);
+PSMVector3f PSM_PosefTransformPoint(const PSMPosef *pose, const PSMVector3f *p);
+PSMVector3f PSM_PosefInverseTransformPoint(const PSMPosef *pose, const PSMVector3f *p);
@@ -0,0 +1,277 @@
+#pragma once
+// Stand-in for the parts of PSMoveService's PSMoveClient_CAPI.h the driver uses, for the test harness.
+// stub_psmoveclient.cpp plays the service (see stub_psmoveservice.h).
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ClientGeometry_CAPI.h"
+
+#define PSM_MAX_VIRTUAL_CONTROLLER_AXES 32
+#define PSM_MAX_VIRTUAL_CONTROLLER_BUTTONS 32
+#define PSM_DEFAULT_TIMEOUT 1000
+#define PSMOVESERVICE_MAX_CONTROLLER_COUNT 10
+#define PSMOVESERVICE_MAX_TRACKER_COUNT 8
+#define PSMOVESERVICE_CONTROLLER_SERIAL_LEN 18
+
+typedef int PSMControllerID;
+typedef int PSMRequestID;
+typedef void *PSMResponseHandle;
+typedef void *PSMRequestHandle;
+
+typedef enum {
+	PSMResult_Error = -1,
+	PSMResult_Success = 0,
+	PSMResult_Timeout = 1,
+	PSMResult_RequestSent = 2,
+	PSMResult_Canceled = 3,
+	PSMResult_NoData = 4
+} PSMResult;
+
+typedef enum {
+	PSMButtonState_UP = 0x00,
+	PSMButtonState_PRESSED = 0x01,
+	PSMButtonState_DOWN = 0x03,
+	PSMButtonState_RELEASED = 0x02
+} PSMButtonState;
+
+typedef enum {
+	PSMBattery_0 = 0,
+	PSMBattery_20 = 1,
+	PSMBattery_40 = 2,
+	PSMBattery_60 = 3,
+	PSMBattery_80 = 4,
+	PSMBattery_100 = 5,
+	PSMBattery_Charging = 0xEE,
+	PSMBattery_Charged = 0xEF
+} PSMBatteryState;
+
+typedef enum {
+	PSMControllerHand_Any = 0,
+	PSMControllerHand_Left = 1,
+	PSMControllerHand_Right = 2
+} PSMControllerHand;
+
+typedef enum {
+	PSMController_None = -1,
+	PSMController_Move,
+	PSMController_Navi,
+	PSMController_DualShock4,
+	PSMController_Virtual
+} PSMControllerType;
+
+typedef enum {
+	PSMControllerRumbleChannel_All,
+	PSMControllerRumbleChannel_Left,
+	PSMControllerRumbleChannel_Right
+} PSMControllerRumbleChannel;
+
+typedef enum {
+	PSMStreamFlags_defaultStreamOptions = 0x00,
+	PSMStreamFlags_includePositionData = 0x01,
+	PSMStreamFlags_includePhysicsData = 0x02,
+	PSMStreamFlags_includeRawSensorData = 0x04,
+	PSMStreamFlags_includeCalibratedSensorData = 0x08,
+	PSMStreamFlags_includeRawTrackerData = 0x10,
+	PSMStreamFlags_disableROI = 0x20
+} PSMControllerDataStreamFlags;
+
+typedef struct {
+	PSMVector3f LinearVelocityCmPerSec;
+	PSMVector3f LinearAccelerationCmPerSecSqr;
+	PSMVector3f AngularVelocityRadPerSec;
+	PSMVector3f AngularAccelerationRadPerSecSqr;
+	double TimeInSeconds;
+} PSMPhysicsData;
+
+typedef struct {
+	bool bIsTrackingEnabled;
+	bool bIsCurrentlyTracking;
+	bool bIsOrientationValid;
+	bool bIsPositionValid;
+	PSMPosef Pose;
+	PSMPhysicsData PhysicsData;
+	PSMButtonState TriangleButton;
+	PSMButtonState CircleButton;
+	PSMButtonState CrossButton;
+	PSMButtonState SquareButton;
+	PSMButtonState SelectButton;
+	PSMButtonState StartButton;
+	PSMButtonState PSButton;
+	PSMButtonState MoveButton;
+	PSMButtonState TriggerButton;
+	PSMBatteryState BatteryValue;
+	unsigned char TriggerValue;
+} PSMPSMove;
+
+typedef struct {
+	PSMButtonState L1Button;
+	PSMButtonState L2Button;
+	PSMButtonState L3Button;
+	PSMButtonState CircleButton;
+	PSMButtonState CrossButton;
+	PSMButtonState PSButton;
+	PSMButtonState TriggerButton;
+	PSMButtonState DPadUpButton;
+	PSMButtonState DPadRightButton;
+	PSMButtonState DPadDownButton;
+	PSMButtonState DPadLeftButton;
+	unsigned char TriggerValue;
+	unsigned char Stick_XAxis;
+	unsigned char Stick_YAxis;
+} PSMPSNavi;
+
+typedef struct {
+	bool bIsTrackingEnabled;
+	bool bIsCurrentlyTracking;
+	bool bIsOrientationValid;
+	bool bIsPositionValid;
+	PSMPosef Pose;
+	PSMPhysicsData PhysicsData;
+	PSMButtonState DPadUpButton;
+	PSMButtonState DPadDownButton;
+	PSMButtonState DPadLeftButton;
+	PSMButtonState DPadRightButton;
+	PSMButtonState SquareButton;
+	PSMButtonState CrossButton;
+	PSMButtonState CircleButton;
+	PSMButtonState TriangleButton;
+	PSMButtonState L1Button;
+	PSMButtonState R1Button;
+	PSMButtonState L2Button;
+	PSMButtonState R2Button;
+	PSMButtonState L3Button;
+	PSMButtonState R3Button;
+	PSMButtonState ShareButton;
+	PSMButtonState OptionsButton;
+	PSMButtonState PSButton;
+	PSMButtonState TrackPadButton;
+	float LeftAnalogX;
+	float LeftAnalogY;
+	float RightAnalogX;
+	float RightAnalogY;
+	float LeftTriggerValue;
+	float RightTriggerValue;
+} PSMDualShock4;
+
+typedef struct {
+	bool bIsTrackingEnabled;
+	bool bIsCurrentlyTracking;
+	bool bIsPositionValid;
+	int numAxes;
+	int numButtons;
+	unsigned char axisStates[PSM_MAX_VIRTUAL_CONTROLLER_AXES];
+	PSMButtonState buttonStates[PSM_MAX_VIRTUAL_CONTROLLER_BUTTONS];
+	PSMPosef Pose;
+	PSMPhysicsData PhysicsData;
+} PSMVirtualController;
+
+typedef struct {
+	PSMControllerID ControllerID;
+	PSMControllerType ControllerType;
+	PSMControllerHand ControllerHand;
+	union {
+		PSMPSMove PSMoveState;
+		PSMPSNavi PSNaviState;
+		PSMDualShock4 PSDS4State;
+		PSMVirtualController VirtualController;
+	} ControllerState;
+	bool bValid;
+	int OutputSequenceNum;
+	int InputSequenceNum;
+	bool IsConnected;
+	long long DataFrameLastReceivedTime;
+	float DataFrameAverageFPS;
+	int ListenerCount;
+} PSMController;
+
+typedef struct {
+	int tracker_id;
+	float tracker_hfov;
+	float tracker_vfov;
+	float tracker_znear;
+	float tracker_zfar;
+	PSMPosef tracker_pose;
+} PSMClientTrackerInfo;
+
+typedef struct {
+	PSMClientTrackerInfo trackers[PSMOVESERVICE_MAX_TRACKER_COUNT];
+	int count;
+} PSMTrackerList;
+
+typedef struct {
+	PSMControllerID controller_id[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+	PSMControllerType controller_type[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+	PSMControllerHand controller_hand[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+	char controller_serial[PSMOVESERVICE_MAX_CONTROLLER_COUNT][PSMOVESERVICE_CONTROLLER_SERIAL_LEN];
+	char parent_controller_serial[PSMOVESERVICE_MAX_CONTROLLER_COUNT][PSMOVESERVICE_CONTROLLER_SERIAL_LEN];
+	int count;
+} PSMControllerList;
+
+typedef struct {
+	char version_string[32];
+} PSMServiceVersion;
+
+typedef struct {
+	PSMRequestID request_id;
+	PSMResult result_code;
+	PSMResponseHandle opaque_request_handle;
+	PSMResponseHandle opaque_response_handle;
+	union {
+		PSMControllerList controller_list;
+		PSMTrackerList tracker_list;
+		PSMServiceVersion service_version;
+	} payload;
+	enum eResponsePayloadType {
+		_responsePayloadType_Empty,
+		_responsePayloadType_ControllerList,
+		_responsePayloadType_TrackerList,
+		_responsePayloadType_ServiceVersion
+	} payload_type;
+} PSMResponseMessage;
+
+typedef struct {
+	enum eEventType {
+		PSMEvent_connectedToService,
+		PSMEvent_failedToConnectToService,
+		PSMEvent_disconnectedFromService,
+		PSMEvent_opaqueServiceEvent,
+		PSMEvent_controllerListUpdated,
+		PSMEvent_trackerListUpdated,
+		PSMEvent_hmdListUpdated,
+		PSMEvent_systemButtonPressed
+	} event_type;
+} PSMEventMessage;
+
+typedef struct {
+	PSMResponseMessage response_data;
+	PSMEventMessage event_data;
+	enum eMessagePayloadType {
+		_messagePayloadType_Event,
+		_messagePayloadType_Response
+	} payload_type;
+} PSMMessage;
+
+typedef void (*PSMResponseCallback)(const PSMResponseMessage *response, void *userdata);
+
+PSMResult PSM_Initialize(const char *host, const char *port, int timeout_ms);
+PSMResult PSM_InitializeAsync(const char *host, const char *port);
+PSMResult PSM_Shutdown();
+bool PSM_GetIsInitialized();
+PSMResult PSM_Update();
+PSMResult PSM_UpdateNoPollMessages();
+bool PSM_WasSystemButtonPressed();
+PSMResult PSM_PollNextMessage(PSMMessage *message, size_t message_size);
+const char *PSM_GetClientVersionString();
+PSMResult PSM_GetServiceVersionStringAsync(PSMRequestID *out_request_id);
+PSMResult PSM_RegisterCallback(PSMRequestID request_id, PSMResponseCallback callback, void *callback_userdata);
+
+PSMResult PSM_GetControllerListAsync(PSMRequestID *out_request_id);
+PSMResult PSM_GetTrackerListAsync(PSMRequestID *out_request_id);
+PSMResult PSM_AllocateControllerListener(PSMControllerID controller_id);
+PSMResult PSM_FreeControllerListener(PSMControllerID controller_id);
+PSMController *PSM_GetController(PSMControllerID controller_id);
+PSMResult PSM_GetControllerPose(PSMControllerID controller_id, PSMPosef *out_pose);
+PSMResult PSM_StartControllerDataStreamAsync(PSMControllerID controller_id, unsigned int data_stream_flags, PSMRequestID *out_request_id);
+PSMResult PSM_StopControllerDataStreamAsync(PSMControllerID controller_id, PSMRequestID *out_request_id);
+PSMResult PSM_SetControllerRumble(PSMControllerID controller_id, PSMControllerRumbleChannel channel, float rumble_fraction);
+PSMResult PSM_ResetControllerOrientationAsync(PSMControllerID controller_id, const PSMQuatf *q_pose, PSMRequestID *out_request_id);
@@ -0,0 +1,3 @@
+#pragma once
+#define PSMOVESERVICE_DEFAULT_ADDRESS "localhost"
+#define PSMOVESERVICE_DEFAULT_PORT "9512"
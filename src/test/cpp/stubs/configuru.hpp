@@ -0,0 +1,183 @@
+#pragma once
+// Stand-in for the Configuru header used by the test harness. Holds configs in memory with the same
+// shallow (shared) copy semantics for objects as Configuru, which ControllerConfig relies on when it
+// edits "trackpad_mappings" through a copy. Reads back only the plain JSON that dump_file() writes.
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace configuru {
+	class Config {
+	public:
+		enum Type { Null, Bool, Int, Float, String, Object };
+
+		Config() : m_type(Null), m_int(0), m_float(0.0) {}
+		Config(bool value) : m_type(Bool), m_int(value ? 1 : 0), m_float(value ? 1.0 : 0.0) {}
+		Config(const char *value) : m_type(String), m_int(0), m_float(0.0), m_string(value) {}
+		Config(const std::string &value) : m_type(String), m_int(0), m_float(0.0), m_string(value) {}
+
+		template <typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+		Config(T value) : m_type(Int), m_int((int64_t)value), m_float((double)value) {}
+
+		template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+		Config(T value) : m_type(Float), m_int((int64_t)value), m_float((double)value) {}
+
+		Config(std::initializer_list<std::pair<std::string, Config> > values)
+			: m_type(Object), m_int(0), m_float(0.0), m_object(new std::map<std::string, Config>()) {
+			for (const std::pair<std::string, Config> &value : values) {
+				(*m_object)[value.first] = value.second;
+			}
+		}
+
+		static Config object() {
+			Config config;
+			config.m_type = Object;
+			config.m_object.reset(new std::map<std::string, Config>());
+			return config;
+		}
+
+		bool has_key(const std::string &key) const {
+			return m_type == Object && m_object->find(key) != m_object->end();
+		}
+
+		Config &operator[](const std::string &key) {
+			if (m_type != Object) {
+				*this = object();
+			}
+			return (*m_object)[key];
+		}
+
+		const Config &operator[](const std::string &key) const {
+			static const Config k_null;
+			if (!has_key(key))
+				return k_null;
+			return m_object->find(key)->second;
+		}
+
+		const std::string &as_string() const { return m_string; }
+
+		template <typename T>
+		T as() const { return as_impl((T *)nullptr); }
+
+		template <typename T>
+		T get_or(const std::string &key, const T &default_value) const {
+			return has_key(key) ? (*this)[key].as<T>() : default_value;
+		}
+
+		// Flat JSON, good enough to inspect what the driver saved
+		void write(FILE *file) const {
+			switch (m_type) {
+			case Null: fprintf(file, "null"); break;
+			case Bool: fprintf(file, m_int != 0 ? "true" : "false"); break;
+			case Int: fprintf(file, "%lld", (long long)m_int); break;
+			case Float: fprintf(file, "%.17g", m_float); break;
+			case String: fprintf(file, "\"%s\"", m_string.c_str()); break;
+			case Object:
+				{
+					fprintf(file, "{");
+					bool bFirst = true;
+					for (const auto &entry : *m_object) {
+						fprintf(file, "%s\"%s\": ", bFirst ? "" : ", ", entry.first.c_str());
+						entry.second.write(file);
+						bFirst = false;
+					}
+					fprintf(file, "}");
+				} break;
+			}
+		}
+
+	private:
+		bool as_impl(bool *) const { return m_int != 0; }
+		std::string as_impl(std::string *) const { return m_string; }
+		template <typename T>
+		T as_impl(T *) const { return m_type == Float ? (T)m_float : (T)m_int; }
+
+		Type m_type;
+		int64_t m_int;
+		double m_float;
+		std::string m_string;
+		std::shared_ptr<std::map<std::string, Config> > m_object;
+	};
+
+	struct FormatOptions {};
+	static const FormatOptions JSON = FormatOptions();
+
+	inline void dump_file(const std::string &path, const Config &config, const FormatOptions &) {
+		FILE *file = fopen(path.c_str(), "w");
+		if (file != nullptr) {
+			config.write(file);
+			fclose(file);
+		}
+	}
+
+	// Parses a value of the JSON written by Config::write(), advancing text past it
+	inline Config parse_value(const char *&text) {
+		while (isspace((unsigned char)*text)) ++text;
+
+		if (*text == '{') {
+			Config config = Config::object();
+			++text;
+			while (true) {
+				while (isspace((unsigned char)*text) || *text == ',') ++text;
+				if (*text != '"')
+					break;
+
+				const char *keyEnd = strchr(text + 1, '"');
+				if (keyEnd == nullptr)
+					break;
+				const std::string key(text + 1, keyEnd);
+				text = keyEnd + 1;
+				while (isspace((unsigned char)*text) || *text == ':') ++text;
+				config[key] = parse_value(text);
+			}
+			if (*text == '}') ++text;
+			return config;
+		} else if (*text == '"') {
+			const char *end = strchr(text + 1, '"');
+			const std::string value(text + 1, end != nullptr ? end : text + strlen(text));
+			text = end != nullptr ? end + 1 : text + strlen(text);
+			return Config(value);
+		} else if (strncmp(text, "true", 4) == 0) {
+			text += 4;
+			return Config(true);
+		} else if (strncmp(text, "false", 5) == 0) {
+			text += 5;
+			return Config(false);
+		} else if (strncmp(text, "null", 4) == 0) {
+			text += 4;
+			return Config();
+		}
+
+		char *end;
+		const double value = strtod(text, &end);
+		const bool bIsInteger = strcspn(text, ".eE,}") >= (size_t)(end - text);
+		text = end;
+		return bIsInteger ? Config((long long)value) : Config(value);
+	}
+
+	inline Config parse_file(const std::string &path, const FormatOptions &) {
+		FILE *file = fopen(path.c_str(), "r");
+		if (file == nullptr)
+			return Config::object();
+
+		std::string contents;
+		char buffer[4096];
+		size_t readSize;
+		while ((readSize = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			contents.append(buffer, readSize);
+		}
+		fclose(file);
+
+		const char *text = contents.c_str();
+		return parse_value(text);
+	}
+}
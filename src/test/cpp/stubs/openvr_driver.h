@@ -0,0 +1,257 @@
+#pragma once
+// Stand-in for the parts of the OpenVR driver API the driver uses, for the test harness. Declarations
+// follow openvr_driver.h; the host interfaces are implemented in stub_openvr.cpp and record what the
+// driver does with them (see stub_openvr_host.h).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace vr {
+
+	typedef uint32_t TrackedDeviceIndex_t;
+	typedef uint64_t PropertyContainerHandle_t;
+	typedef uint64_t VRInputComponentHandle_t;
+
+	static const uint32_t k_unMaxTrackedDeviceCount = 64;
+	static const TrackedDeviceIndex_t k_unTrackedDeviceIndex_Hmd = 0;
+	static const TrackedDeviceIndex_t k_unTrackedDeviceIndexInvalid = 0xFFFFFFFF;
+	static const PropertyContainerHandle_t k_ulInvalidPropertyContainer = 0;
+	static const VRInputComponentHandle_t k_ulInvalidInputComponentHandle = 0;
+
+	struct HmdQuaternion_t { double w, x, y, z; };
+	struct HmdMatrix34_t { float m[3][4]; };
+	struct HmdVector3_t { float v[3]; };
+
+	enum ETrackingResult {
+		TrackingResult_Uninitialized = 1,
+		TrackingResult_Calibrating_InProgress = 100,
+		TrackingResult_Calibrating_OutOfRange = 101,
+		TrackingResult_Running_OK = 200,
+		TrackingResult_Running_OutOfRange = 201,
+		TrackingResult_Fallback_RotationOnly = 300
+	};
+
+	enum ETrackedDeviceClass {
+		TrackedDeviceClass_Invalid = 0,
+		TrackedDeviceClass_HMD,
+		TrackedDeviceClass_Controller,
+		TrackedDeviceClass_GenericTracker,
+		TrackedDeviceClass_TrackingReference
+	};
+
+	enum ETrackedControllerRole {
+		TrackedControllerRole_Invalid = 0,
+		TrackedControllerRole_LeftHand,
+		TrackedControllerRole_RightHand
+	};
+
+	enum ETrackedPropertyError {
+		TrackedProp_Success = 0,
+		TrackedProp_UnknownProperty = 3,
+		TrackedProp_InvalidDevice = 4
+	};
+
+	enum EVRInitError {
+		VRInitError_None = 0,
+		VRInitError_Init_InterfaceNotFound = 105,
+		VRInitError_Driver_Failed = 200
+	};
+
+	enum EVRInputError {
+		VRInputError_None = 0,
+		VRInputError_InvalidHandle = 2,
+		VRInputError_InvalidParam = 3
+	};
+
+	enum EVRScalarType { VRScalarType_Absolute, VRScalarType_Relative };
+	enum EVRScalarUnits { VRScalarUnits_NormalizedOneSided, VRScalarUnits_NormalizedTwoSided };
+
+	enum EVRButtonId {
+		k_EButton_System = 0,
+		k_EButton_SteamVR_Touchpad = 32
+	};
+
+	inline uint64_t ButtonMaskFromId(EVRButtonId id) { return 1ull << id; }
+
+	enum ETrackedDeviceProperty {
+		Prop_TrackingSystemName_String,
+		Prop_ModelNumber_String,
+		Prop_SerialNumber_String,
+		Prop_RenderModelName_String,
+		Prop_WillDriftInYaw_Bool,
+		Prop_ManufacturerName_String,
+		Prop_HardwareRevision_Uint64,
+		Prop_FirmwareVersion_Uint64,
+		Prop_DeviceIsWireless_Bool,
+		Prop_DeviceIsCharging_Bool,
+		Prop_DeviceBatteryPercentage_Float,
+		Prop_Firmware_UpdateAvailable_Bool,
+		Prop_Firmware_ManualUpdate_Bool,
+		Prop_DeviceProvidesBatteryStatus_Bool,
+		Prop_DeviceCanPowerOff_Bool,
+		Prop_DeviceClass_Int32,
+		Prop_HasCamera_Bool,
+		Prop_Firmware_ForceUpdateRequired_Bool,
+		Prop_ContainsProximitySensor_Bool,
+		Prop_HasDisplayComponent_Bool,
+		Prop_ControllerRoleHint_Int32,
+		Prop_ControllerType_String,
+		Prop_LegacyInputProfile_String,
+		Prop_InputProfilePath_String,
+		Prop_FieldOfViewLeftDegrees_Float,
+		Prop_FieldOfViewRightDegrees_Float,
+		Prop_FieldOfViewTopDegrees_Float,
+		Prop_FieldOfViewBottomDegrees_Float,
+		Prop_TrackingRangeMinimumMeters_Float,
+		Prop_TrackingRangeMaximumMeters_Float,
+		Prop_ModeLabel_String,
+		Prop_NamedIconPathDeviceOff_String,
+		Prop_NamedIconPathDeviceSearching_String,
+		Prop_NamedIconPathDeviceSearchingAlert_String,
+		Prop_NamedIconPathDeviceReady_String,
+		Prop_NamedIconPathDeviceReadyAlert_String,
+		Prop_NamedIconPathDeviceNotReady_String,
+		Prop_NamedIconPathDeviceStandby_String,
+		Prop_NamedIconPathDeviceAlertLow_String
+	};
+
+	struct DriverPose_t {
+		double poseTimeOffset;
+		HmdQuaternion_t qWorldFromDriverRotation;
+		double vecWorldFromDriverTranslation[3];
+		HmdQuaternion_t qDriverFromHeadRotation;
+		double vecDriverFromHeadTranslation[3];
+		double vecPosition[3];
+		double vecVelocity[3];
+		double vecAcceleration[3];
+		HmdQuaternion_t qRotation;
+		double vecAngularVelocity[3];
+		double vecAngularAcceleration[3];
+		ETrackingResult result;
+		bool poseIsValid;
+		bool willDriftInYaw;
+		bool shouldApplyHeadModel;
+		bool deviceIsConnected;
+	};
+
+	struct TrackedDevicePose_t {
+		HmdMatrix34_t mDeviceToAbsoluteTracking;
+		HmdVector3_t vVelocity;
+		HmdVector3_t vAngularVelocity;
+		ETrackingResult eTrackingResult;
+		bool bPoseIsValid;
+		bool bDeviceIsConnected;
+	};
+
+	struct VREvent_HapticVibration_t {
+		uint64_t containerHandle;
+		uint64_t componentHandle;
+		float fDurationSeconds;
+		float fFrequency;
+		float fAmplitude;
+	};
+
+	union VREvent_Data_t {
+		VREvent_HapticVibration_t hapticVibration;
+	};
+
+	enum EVREventType {
+		VREvent_None = 0,
+		VREvent_TrackedDeviceActivated = 100,
+		VREvent_TrackedDeviceDeactivated = 101,
+		VREvent_TrackedDeviceUpdated = 102,
+		VREvent_Quit = 700,
+		VREvent_DriverRequestedQuit = 1100,
+		VREvent_Input_HapticVibration = 1700,
+		VREvent_VendorSpecific_Reserved_Start = 10000
+	};
+
+	struct VREvent_t {
+		uint32_t eventType;
+		TrackedDeviceIndex_t trackedDeviceIndex;
+		float eventAgeSeconds;
+		VREvent_Data_t data;
+	};
+
+	class ITrackedDeviceServerDriver {
+	public:
+		virtual EVRInitError Activate(TrackedDeviceIndex_t unObjectId) = 0;
+		virtual void Deactivate() = 0;
+		virtual void EnterStandby() = 0;
+		virtual void *GetComponent(const char *pchComponentNameAndVersion) = 0;
+		virtual void DebugRequest(const char *pchRequest, char *pchResponseBuffer, uint32_t unResponseBufferSize) = 0;
+		virtual DriverPose_t GetPose() = 0;
+	};
+
+	class IVRDriverContext;
+
+	class IVRDriverLog {
+	public:
+		virtual void Log(const char *pchLogMessage) = 0;
+	};
+
+	class IServerTrackedDeviceProvider {
+	public:
+		virtual EVRInitError Init(IVRDriverContext *pDriverContext) = 0;
+		virtual void Cleanup() = 0;
+		virtual const char * const *GetInterfaceVersions() = 0;
+		virtual void RunFrame() = 0;
+		virtual bool ShouldBlockStandbyMode() = 0;
+		virtual void EnterStandby() = 0;
+		virtual void LeaveStandby() = 0;
+	};
+
+	class IVRWatchdogProvider {
+	public:
+		virtual EVRInitError Init(IVRDriverContext *pDriverContext) = 0;
+		virtual void Cleanup() = 0;
+	};
+
+	class IVRServerDriverHost {
+	public:
+		virtual bool TrackedDeviceAdded(const char *pchDeviceSerialNumber, ETrackedDeviceClass eDeviceClass, ITrackedDeviceServerDriver *pDriver) = 0;
+		virtual void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const DriverPose_t &newPose, uint32_t unPoseStructSize) = 0;
+		virtual bool PollNextEvent(VREvent_t *pEvent, uint32_t uncbVREvent) = 0;
+		virtual void GetRawTrackedDevicePoses(float fPredictedSecondsFromNow, TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) = 0;
+	};
+
+	class IVRWatchdogHost {
+	public:
+		virtual void WatchdogWakeUp() = 0;
+	};
+
+	class IVRDriverInput {
+	public:
+		virtual EVRInputError CreateBooleanComponent(PropertyContainerHandle_t ulContainer, const char *pchName, VRInputComponentHandle_t *pHandle) = 0;
+		virtual EVRInputError UpdateBooleanComponent(VRInputComponentHandle_t ulComponent, bool bNewValue, double fTimeOffset) = 0;
+		virtual EVRInputError CreateScalarComponent(PropertyContainerHandle_t ulContainer, const char *pchName, VRInputComponentHandle_t *pHandle, EVRScalarType eType, EVRScalarUnits eUnits) = 0;
+		virtual EVRInputError UpdateScalarComponent(VRInputComponentHandle_t ulComponent, float fNewValue, double fTimeOffset) = 0;
+		virtual EVRInputError CreateHapticComponent(PropertyContainerHandle_t ulContainer, const char *pchName, VRInputComponentHandle_t *pHandle) = 0;
+	};
+
+	class CVRPropertyHelpers {
+	public:
+		PropertyContainerHandle_t TrackedDeviceToPropertyContainer(TrackedDeviceIndex_t nDevice, ETrackedPropertyError *peError = nullptr);
+		bool GetBoolProperty(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, ETrackedPropertyError *pError = nullptr);
+		ETrackedPropertyError SetBoolProperty(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, bool bNewValue);
+		ETrackedPropertyError SetStringProperty(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, const char *pchNewValue);
+		ETrackedPropertyError SetInt32Property(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, int32_t nNewValue);
+		ETrackedPropertyError SetUint64Property(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, uint64_t ulNewValue);
+		ETrackedPropertyError SetFloatProperty(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, float fNewValue);
+	};
+
+	IVRServerDriverHost *VRServerDriverHost();
+	IVRDriverInput *VRDriverInput();
+	CVRPropertyHelpers *VRProperties();
+	IVRDriverLog *VRDriverLog();
+	IVRWatchdogHost *VRWatchdogHost();
+
+	static const char * const IServerTrackedDeviceProvider_Version = "IServerTrackedDeviceProvider_004";
+	static const char * const IVRWatchdogProvider_Version = "IVRWatchdogProvider_001";
+	extern const char * const k_InterfaceVersions[];
+}
+
+#define VR_INIT_SERVER_DRIVER_CONTEXT(pContext)
+#define VR_INIT_WATCHDOG_DRIVER_CONTEXT(pContext)
+#define VR_CLEANUP_WATCHDOG_DRIVER_CONTEXT()
@@ -0,0 +1,235 @@
+// Port of PSMoveService's ClientGeometry_CAPI.cpp (the GLM calls written out), so the harness gets the
+// same results as the service's client library.
+
+#include "ClientGeometry_CAPI.h"
+#include <float.h>
+#include <math.h>
+
+static const float k_real_epsilon = FLT_EPSILON;
+
+static bool is_nearly_zero(float x) {
+	return fabsf(x) <= k_real_epsilon;
+}
+
+static const PSMVector3f g_psm_float_vector3_zero = { 0.f, 0.f, 0.f };
+static const PSMVector3f g_psm_float_vector3_i = { 1.f, 0.f, 0.f };
+static const PSMVector3f g_psm_float_vector3_j = { 0.f, 1.f, 0.f };
+static const PSMVector3f g_psm_float_vector3_k = { 0.f, 0.f, 1.f };
+static const PSMQuatf g_psm_quaternion_identity = { 1.f, 0.f, 0.f, 0.f };
+static const PSMPosef g_psm_pose_identity = { { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f, 0.f } };
+
+const PSMVector3f *k_psm_float_vector3_zero = &g_psm_float_vector3_zero;
+const PSMVector3f *k_psm_float_vector3_i = &g_psm_float_vector3_i;
+const PSMVector3f *k_psm_float_vector3_j = &g_psm_float_vector3_j;
+const PSMVector3f *k_psm_float_vector3_k = &g_psm_float_vector3_k;
+const PSMQuatf *k_psm_quaternion_identity = &g_psm_quaternion_identity;
+const PSMPosef *k_psm_pose_identity = &g_psm_pose_identity;
+
+//-- Vector3f --
+PSMVector3f PSM_Vector3fAdd(const PSMVector3f *a, const PSMVector3f *b) {
+	return PSMVector3f{ a->x + b->x, a->y + b->y, a->z + b->z };
+}
+
+PSMVector3f PSM_Vector3fSubtract(const PSMVector3f *a, const PSMVector3f *b) {
+	return PSMVector3f{ a->x - b->x, a->y - b->y, a->z - b->z };
+}
+
+PSMVector3f PSM_Vector3fScale(const PSMVector3f *v, const float s) {
+	return PSMVector3f{ v->x*s, v->y*s, v->z*s };
+}
+
+PSMVector3f PSM_Vector3fScaleAndAdd(const PSMVector3f *v, const float s, const PSMVector3f *b) {
+	return PSMVector3f{ v->x*s + b->x, v->y*s + b->y, v->z*s + b->z };
+}
+
+float PSM_Vector3fLength(const PSMVector3f *v) {
+	return sqrtf(v->x*v->x + v->y*v->y + v->z*v->z);
+}
+
+PSMVector3f PSM_Vector3fNormalizeWithDefault(const PSMVector3f *v, const PSMVector3f *default_result) {
+	const float length = PSM_Vector3fLength(v);
+
+	return is_nearly_zero(length) ? *default_result : PSMVector3f{ v->x / length, v->y / length, v->z / length };
+}
+
+float PSM_Vector3fDot(const PSMVector3f *a, const PSMVector3f *b) {
+	return a->x*b->x + a->y*b->y + a->z*b->z;
+}
+
+PSMVector3f PSM_Vector3fCross(const PSMVector3f *a, const PSMVector3f *b) {
+	return PSMVector3f{ a->y*b->z - b->y*a->z, a->z*b->x - b->z*a->x, a->x*b->y - b->x*a->y };
+}
+
+//-- Quatf --
+PSMQuatf PSM_QuatfCreate(float w, float x, float y, float z) {
+	return PSMQuatf{ w, x, y, z };
+}
+
+// x = bank, y = heading, z = attitude
+PSMQuatf PSM_QuatfCreateFromAngles(const PSMVector3f *eulerAngles) {
+	const float c1 = cosf(eulerAngles->y / 2.f);
+	const float s1 = sinf(eulerAngles->y / 2.f);
+	const float c2 = cosf(eulerAngles->z / 2.f);
+	const float s2 = sinf(eulerAngles->z / 2.f);
+	const float c3 = cosf(eulerAngles->x / 2.f);
+	const float s3 = sinf(eulerAngles->x / 2.f);
+	const float c1c2 = c1*c2;
+	const float s1s2 = s1*s2;
+
+	PSMQuatf q;
+	q.w = c1c2*c3 - s1s2*s3;
+	q.x = c1c2*s3 + s1s2*c3;
+	q.y = s1*c2*c3 + c1*s2*s3;
+	q.z = c1*s2*c3 - s1*c2*s3;
+	return q;
+}
+
+PSMQuatf PSM_QuatfAdd(const PSMQuatf *a, const PSMQuatf *b) {
+	return PSMQuatf{ a->w + b->w, a->x + b->x, a->y + b->y, a->z + b->z };
+}
+
+PSMQuatf PSM_QuatfScale(const PSMQuatf *q, const float s) {
+	return PSMQuatf{ q->w*s, q->x*s, q->y*s, q->z*s };
+}
+
+PSMQuatf PSM_QuatfMultiply(const PSMQuatf *a, const PSMQuatf *b) {
+	return PSMQuatf{
+		a->w*b->w - a->x*b->x - a->y*b->y - a->z*b->z,
+		a->w*b->x + a->x*b->w + a->y*b->z - a->z*b->y,
+		a->w*b->y - a->x*b->z + a->y*b->w + a->z*b->x,
+		a->w*b->z + a->x*b->y - a->y*b->x + a->z*b->w };
+}
+
+PSMQuatf PSM_QuatfConcat(const PSMQuatf *first, const PSMQuatf *second) {
+	return PSM_QuatfMultiply(second, first);
+}
+
+// q*v*q^-1 written out term by term
+PSMVector3f PSM_QuatfRotateVector(const PSMQuatf *q, const PSMVector3f *v) {
+	PSMVector3f result;
+	result.x = q->w*q->w*v->x + 2*q->y*q->w*v->z - 2*q->z*q->w*v->y + q->x*q->x*v->x + 2*q->y*q->x*v->y + 2*q->z*q->x*v->z - q->z*q->z*v->x - q->y*q->y*v->x;
+	result.y = 2*q->x*q->y*v->x + q->y*q->y*v->y + 2*q->z*q->y*v->z + 2*q->w*q->z*v->x - q->z*q->z*v->y + q->w*q->w*v->y - 2*q->x*q->w*v->z - q->x*q->x*v->y;
+	result.z = 2*q->x*q->z*v->x + 2*q->y*q->z*v->y + q->z*q->z*v->z - 2*q->w*q->y*v->x - q->y*q->y*v->z + 2*q->w*q->x*v->y - q->x*q->x*v->z + q->w*q->w*v->z;
+	return result;
+}
+
+PSMQuatf PSM_QuatfConjugate(const PSMQuatf *q) {
+	return PSMQuatf{ q->w, -q->x, -q->y, -q->z };
+}
+
+PSMQuatf PSM_QuatfInverse(const PSMQuatf *q) {
+	const float length_sqr = q->w*q->w + q->x*q->x + q->y*q->y + q->z*q->z;
+
+	return PSMQuatf{ q->w / length_sqr, -q->x / length_sqr, -q->y / length_sqr, -q->z / length_sqr };
+}
+
+PSMQuatf PSM_QuatfNormalizeWithDefault(const PSMQuatf *q, const PSMQuatf *default_result) {
+	const float length = sqrtf(q->w*q->w + q->x*q->x + q->y*q->y + q->z*q->z);
+
+	return is_nearly_zero(length) ? *default_result : PSMQuatf{ q->w / length, q->x / length, q->y / length, q->z / length };
+}
+
+PSMQuatf PSM_QuatfSlerp(const PSMQuatf *a, const PSMQuatf *b, const float u) {
+	float cos_theta = a->w*b->w + a->x*b->x + a->y*b->y + a->z*b->z;
+	PSMQuatf end = *b;
+
+	// Take the short way around
+	if (cos_theta < 0.f) {
+		cos_theta = -cos_theta;
+		end = PSM_QuatfScale(b, -1.f);
+	}
+
+	// Close enough to linear, which also avoids dividing by sin(theta) ~ 0
+	if (cos_theta > 1.f - k_real_epsilon) {
+		return PSMQuatf{
+			a->w + u*(end.w - a->w), a->x + u*(end.x - a->x), a->y + u*(end.y - a->y), a->z + u*(end.z - a->z) };
+	}
+
+	const float theta = acosf(cos_theta);
+	const float scale_a = sinf((1.f - u)*theta) / sinf(theta);
+	const float scale_b = sinf(u*theta) / sinf(theta);
+	return PSMQuatf{
+		scale_a*a->w + scale_b*end.w, scale_a*a->x + scale_b*end.x, scale_a*a->y + scale_b*end.y, scale_a*a->z + scale_b*end.z };
+}
+
+//-- Matrix3f --
+PSMMatrix3f PSM_Matrix3fCreate(const PSMVector3f *basis_x, const PSMVector3f *basis_y, const PSMVector3f *basis_z) {
+	PSMMatrix3f mat;
+	mat.m[0][0] = basis_x->x; mat.m[0][1] = basis_x->y; mat.m[0][2] = basis_x->z;
+	mat.m[1][0] = basis_y->x; mat.m[1][1] = basis_y->y; mat.m[1][2] = basis_y->z;
+	mat.m[2][0] = basis_z->x; mat.m[2][1] = basis_z->y; mat.m[2][2] = basis_z->z;
+	return mat;
+}
+
+// Like glm::mat3_cast, m[i] is the image of the i-th axis under the rotation
+PSMMatrix3f PSM_Matrix3fCreateFromQuatf(const PSMQuatf *q) {
+	const float qxx = q->x*q->x, qyy = q->y*q->y, qzz = q->z*q->z;
+	const float qxz = q->x*q->z, qxy = q->x*q->y, qyz = q->y*q->z;
+	const float qwx = q->w*q->x, qwy = q->w*q->y, qwz = q->w*q->z;
+
+	PSMMatrix3f mat;
+	mat.m[0][0] = 1.f - 2.f*(qyy + qzz);
+	mat.m[0][1] = 2.f*(qxy + qwz);
+	mat.m[0][2] = 2.f*(qxz - qwy);
+
+	mat.m[1][0] = 2.f*(qxy - qwz);
+	mat.m[1][1] = 1.f - 2.f*(qxx + qzz);
+	mat.m[1][2] = 2.f*(qyz + qwx);
+
+	mat.m[2][0] = 2.f*(qxz + qwy);
+	mat.m[2][1] = 2.f*(qyz - qwx);
+	mat.m[2][2] = 1.f - 2.f*(qxx + qyy);
+	return mat;
+}
+
+PSMVector3f PSM_Matrix3fBasisX(const PSMMatrix3f *m) {
+	return PSMVector3f{ m->m[0][0], m->m[0][1], m->m[0][2] };
+}
+
+PSMVector3f PSM_Matrix3fBasisY(const PSMMatrix3f *m) {
+	return PSMVector3f{ m->m[1][0], m->m[1][1], m->m[1][2] };
+}
+
+PSMVector3f PSM_Matrix3fBasisZ(const PSMMatrix3f *m) {
+	return PSMVector3f{ m->m[2][0], m->m[2][1], m->m[2][2] };
+}
+
+//-- Posef --
+PSMPosef PSM_PosefCreate(const PSMVector3f *position, const PSMQuatf *orientation) {
+	PSMPosef pose;
+	pose.Position = *position;
+	pose.Orientation = *orientation;
+	return pose;
+}
+
+PSMPosef PSM_PosefInverse(const PSMPosef *pose) {
+	const PSMQuatf inverse_orientation = PSM_QuatfConjugate(&pose->Orientation);
+	const PSMVector3f unrotated_position = PSM_QuatfRotateVector(&inverse_orientation, &pose->Position);
+
+	PSMPosef result;
+	result.Position = PSM_Vector3fScale(&unrotated_position, -1.f);
+	result.Orientation = inverse_orientation;
+	return result;
+}
+
+PSMPosef PSM_PosefConcat(const PSMPosef *first, const PSMPosef *second) {
+	const PSMVector3f rotated_position = PSM_QuatfRotateVector(&second->Orientation, &first->Position);
+
+	PSMPosef result;
+	result.Orientation = PSM_QuatfConcat(&first->Orientation, &second->Orientation);
+	result.Position = PSM_Vector3fAdd(&rotated_position, &second->Position);
+	return result;
+}
+
+PSMVector3f PSM_PosefTransformPoint(const PSMPosef *pose, const PSMVector3f *p) {
+	const PSMVector3f rotated_p = PSM_QuatfRotateVector(&pose->Orientation, p);
+
+	return PSM_Vector3fAdd(&rotated_p, &pose->Position);
+}
+
+PSMVector3f PSM_PosefInverseTransformPoint(const PSMPosef *pose, const PSMVector3f *p) {
+	const PSMQuatf inverse_orientation = PSM_QuatfConjugate(&pose->Orientation);
+	const PSMVector3f unrotated_p = PSM_Vector3fSubtract(p, &pose->Position);
+
+	return PSM_QuatfRotateVector(&inverse_orientation, &unrotated_p);
+}
@@ -0,0 +1,263 @@
+#include "stub_openvr_host.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <map>
+#include <utility>
+
+namespace vr {
+	const char * const k_InterfaceVersions[] = {
+		IServerTrackedDeviceProvider_Version,
+		IVRWatchdogProvider_Version,
+		nullptr
+	};
+}
+
+namespace stub {
+
+	struct InputComponent {
+		vr::TrackedDeviceIndex_t deviceIndex;
+		std::string path;
+		bool bValue;
+		float fValue;
+	};
+
+	static std::vector<vr::ITrackedDeviceServerDriver *> s_devices;
+	static std::vector<vr::DriverPose_t> s_lastPoses;
+	static unsigned long long s_nPoseUpdateCount = 0;
+	static std::deque<vr::VREvent_t> s_events;
+	static std::vector<InputComponent> s_components;
+	static bool s_bHasHMD = false;
+	static PSMPosef s_hmdPose;
+	static bool s_bLogToStderr = getenv("STUB_VR_LOG") != nullptr;
+
+	// Property containers are the device index + 1, so 0 stays invalid
+	static vr::TrackedDeviceIndex_t ContainerToDeviceIndex(vr::PropertyContainerHandle_t container) {
+		return (vr::TrackedDeviceIndex_t)(container - 1);
+	}
+
+	static bool IsKnownDevice(vr::TrackedDeviceIndex_t deviceIndex) {
+		return (deviceIndex == vr::k_unTrackedDeviceIndex_Hmd) ? s_bHasHMD : deviceIndex <= s_devices.size();
+	}
+
+	static vr::VRInputComponentHandle_t AddComponent(vr::PropertyContainerHandle_t container, const char *name) {
+		InputComponent component;
+		component.deviceIndex = ContainerToDeviceIndex(container);
+		component.path = name;
+		component.bValue = false;
+		component.fValue = 0.f;
+		s_components.push_back(component);
+
+		// Handles start at 1, the index into s_components + 1
+		return (vr::VRInputComponentHandle_t)s_components.size();
+	}
+
+	static InputComponent *FindComponent(vr::VRInputComponentHandle_t handle) {
+		return (handle >= 1 && handle <= s_components.size()) ? &s_components[(size_t)handle - 1] : nullptr;
+	}
+
+	class StubServerDriverHost : public vr::IVRServerDriverHost {
+	public:
+		bool TrackedDeviceAdded(const char * /*pchDeviceSerialNumber*/, vr::ETrackedDeviceClass /*eDeviceClass*/, vr::ITrackedDeviceServerDriver *pDriver) override {
+			s_devices.push_back(pDriver);
+			s_lastPoses.resize(s_devices.size() + 1);
+
+			// SteamVR activates the device a little later, doing it straight away is close enough
+			pDriver->Activate((vr::TrackedDeviceIndex_t)s_devices.size());
+			return true;
+		}
+
+		void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t &newPose, uint32_t /*unPoseStructSize*/) override {
+			if (unWhichDevice < s_lastPoses.size()) {
+				s_lastPoses[unWhichDevice] = newPose;
+			}
+			++s_nPoseUpdateCount;
+		}
+
+		bool PollNextEvent(vr::VREvent_t *pEvent, uint32_t /*uncbVREvent*/) override {
+			if (s_events.empty())
+				return false;
+
+			*pEvent = s_events.front();
+			s_events.pop_front();
+			return true;
+		}
+
+		void GetRawTrackedDevicePoses(float /*fPredictedSecondsFromNow*/, vr::TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override {
+			memset(pTrackedDevicePoseArray, 0, sizeof(vr::TrackedDevicePose_t) * unTrackedDevicePoseArrayCount);
+
+			if (unTrackedDevicePoseArrayCount > 0 && s_bHasHMD) {
+				vr::TrackedDevicePose_t &hmdPose = pTrackedDevicePoseArray[vr::k_unTrackedDeviceIndex_Hmd];
+				const PSMMatrix3f basis = PSM_Matrix3fCreateFromQuatf(&s_hmdPose.Orientation);
+				const PSMVector3f axes[3] = { PSM_Matrix3fBasisX(&basis), PSM_Matrix3fBasisY(&basis), PSM_Matrix3fBasisZ(&basis) };
+
+				// OpenVR matrices are row major, the basis vectors are their columns
+				for (int column = 0; column < 3; ++column) {
+					hmdPose.mDeviceToAbsoluteTracking.m[0][column] = axes[column].x;
+					hmdPose.mDeviceToAbsoluteTracking.m[1][column] = axes[column].y;
+					hmdPose.mDeviceToAbsoluteTracking.m[2][column] = axes[column].z;
+				}
+				hmdPose.mDeviceToAbsoluteTracking.m[0][3] = s_hmdPose.Position.x;
+				hmdPose.mDeviceToAbsoluteTracking.m[1][3] = s_hmdPose.Position.y;
+				hmdPose.mDeviceToAbsoluteTracking.m[2][3] = s_hmdPose.Position.z;
+				hmdPose.eTrackingResult = vr::TrackingResult_Running_OK;
+				hmdPose.bPoseIsValid = true;
+				hmdPose.bDeviceIsConnected = true;
+			}
+		}
+	};
+
+	class StubDriverInput : public vr::IVRDriverInput {
+	public:
+		vr::EVRInputError CreateBooleanComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+			*pHandle = AddComponent(ulContainer, pchName);
+			return vr::VRInputError_None;
+		}
+
+		vr::EVRInputError UpdateBooleanComponent(vr::VRInputComponentHandle_t ulComponent, bool bNewValue, double /*fTimeOffset*/) override {
+			InputComponent *component = FindComponent(ulComponent);
+			if (component == nullptr)
+				return vr::VRInputError_InvalidHandle;
+
+			component->bValue = bNewValue;
+			return vr::VRInputError_None;
+		}
+
+		vr::EVRInputError CreateScalarComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle, vr::EVRScalarType /*eType*/, vr::EVRScalarUnits /*eUnits*/) override {
+			*pHandle = AddComponent(ulContainer, pchName);
+			return vr::VRInputError_None;
+		}
+
+		vr::EVRInputError UpdateScalarComponent(vr::VRInputComponentHandle_t ulComponent, float fNewValue, double /*fTimeOffset*/) override {
+			InputComponent *component = FindComponent(ulComponent);
+			if (component == nullptr)
+				return vr::VRInputError_InvalidHandle;
+
+			component->fValue = fNewValue;
+			return vr::VRInputError_None;
+		}
+
+		vr::EVRInputError CreateHapticComponent(vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle) override {
+			*pHandle = AddComponent(ulContainer, pchName);
+			return vr::VRInputError_None;
+		}
+	};
+
+	class StubDriverLog : public vr::IVRDriverLog {
+	public:
+		void Log(const char *pchLogMessage) override {
+			if (s_bLogToStderr) {
+				fputs(pchLogMessage, stderr);
+			}
+		}
+	};
+
+	class StubWatchdogHost : public vr::IVRWatchdogHost {
+	public:
+		void WatchdogWakeUp() override {
+		}
+	};
+
+	static StubServerDriverHost s_serverDriverHost;
+	static StubDriverInput s_driverInput;
+	static vr::CVRPropertyHelpers s_properties;
+	static StubDriverLog s_driverLog;
+	static StubWatchdogHost s_watchdogHost;
+
+	void VRReset() {
+		s_devices.clear();
+		s_lastPoses.clear();
+		s_nPoseUpdateCount = 0;
+		s_events.clear();
+		s_components.clear();
+		s_bHasHMD = false;
+	}
+
+	const std::vector<vr::ITrackedDeviceServerDriver *> &VRDevices() {
+		return s_devices;
+	}
+
+	void VRSetHMDPose(const PSMPosef &pose) {
+		s_bHasHMD = true;
+		s_hmdPose = pose;
+	}
+
+	void VRRemoveHMD() {
+		s_bHasHMD = false;
+	}
+
+	void VRQueueEvent(const vr::VREvent_t &event) {
+		s_events.push_back(event);
+	}
+
+	vr::VRInputComponentHandle_t VRFindComponent(vr::TrackedDeviceIndex_t deviceIndex, const char *path) {
+		for (size_t index = 0; index < s_components.size(); ++index) {
+			if (s_components[index].deviceIndex == deviceIndex && s_components[index].path == path)
+				return (vr::VRInputComponentHandle_t)(index + 1);
+		}
+
+		return vr::k_ulInvalidInputComponentHandle;
+	}
+
+	bool VRGetBooleanComponent(vr::VRInputComponentHandle_t handle) {
+		const InputComponent *component = FindComponent(handle);
+		return component != nullptr && component->bValue;
+	}
+
+	float VRGetScalarComponent(vr::VRInputComponentHandle_t handle) {
+		const InputComponent *component = FindComponent(handle);
+		return component != nullptr ? component->fValue : 0.f;
+	}
+
+	vr::DriverPose_t VRGetLastPose(vr::TrackedDeviceIndex_t deviceIndex) {
+		vr::DriverPose_t pose;
+		memset(&pose, 0, sizeof(pose));
+
+		return deviceIndex < s_lastPoses.size() ? s_lastPoses[deviceIndex] : pose;
+	}
+
+	unsigned long long VRGetPoseUpdateCount() {
+		return s_nPoseUpdateCount;
+	}
+
+	void VRSetLogToStderr(bool bEnabled) {
+		s_bLogToStderr = bEnabled;
+	}
+}
+
+namespace vr {
+	IVRServerDriverHost *VRServerDriverHost() { return &stub::s_serverDriverHost; }
+	IVRDriverInput *VRDriverInput() { return &stub::s_driverInput; }
+	CVRPropertyHelpers *VRProperties() { return &stub::s_properties; }
+	IVRDriverLog *VRDriverLog() { return &stub::s_driverLog; }
+	IVRWatchdogHost *VRWatchdogHost() { return &stub::s_watchdogHost; }
+
+	PropertyContainerHandle_t CVRPropertyHelpers::TrackedDeviceToPropertyContainer(TrackedDeviceIndex_t nDevice, ETrackedPropertyError *peError) {
+		const bool bKnown = stub::IsKnownDevice(nDevice);
+		if (peError != nullptr) {
+			*peError = bKnown ? TrackedProp_Success : TrackedProp_InvalidDevice;
+		}
+
+		return bKnown ? (PropertyContainerHandle_t)nDevice + 1 : k_ulInvalidPropertyContainer;
+	}
+
+	// Only the HMD has a display, every other property reads as unknown
+	bool CVRPropertyHelpers::GetBoolProperty(PropertyContainerHandle_t ulContainerHandle, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) {
+		const bool bIsHMDDisplay =
+			prop == Prop_HasDisplayComponent_Bool &&
+			stub::s_bHasHMD &&
+			stub::ContainerToDeviceIndex(ulContainerHandle) == k_unTrackedDeviceIndex_Hmd;
+
+		if (pError != nullptr) {
+			*pError = (prop == Prop_HasDisplayComponent_Bool) ? TrackedProp_Success : TrackedProp_UnknownProperty;
+		}
+
+		return bIsHMDDisplay;
+	}
+
+	ETrackedPropertyError CVRPropertyHelpers::SetBoolProperty(PropertyContainerHandle_t, ETrackedDeviceProperty, bool) { return TrackedProp_Success; }
+	ETrackedPropertyError CVRPropertyHelpers::SetStringProperty(PropertyContainerHandle_t, ETrackedDeviceProperty, const char *) { return TrackedProp_Success; }
+	ETrackedPropertyError CVRPropertyHelpers::SetInt32Property(PropertyContainerHandle_t, ETrackedDeviceProperty, int32_t) { return TrackedProp_Success; }
+	ETrackedPropertyError CVRPropertyHelpers::SetUint64Property(PropertyContainerHandle_t, ETrackedDeviceProperty, uint64_t) { return TrackedProp_Success; }
+	ETrackedPropertyError CVRPropertyHelpers::SetFloatProperty(PropertyContainerHandle_t, ETrackedDeviceProperty, float) { return TrackedProp_Success; }
+}
@@ -0,0 +1,37 @@
+#pragma once
+// Test side of the stubbed OpenVR host: what the tests feed the driver (HMD pose, events) and what
+// they read back (devices, input components, published poses).
+
+#include "openvr_driver.h"
+#include "ClientGeometry_CAPI.h"
+#include <string>
+#include <vector>
+
+namespace stub {
+
+	// Forgets every device, component, event and pose. Call between tests that share a process.
+	void VRReset();
+
+	// Devices the driver added, indexed by tracked device index - 1 (index 0 is the HMD)
+	const std::vector<vr::ITrackedDeviceServerDriver *> &VRDevices();
+
+	// Puts an HMD at index 0 with the given pose in meters, or removes it
+	void VRSetHMDPose(const PSMPosef &pose);
+	void VRRemoveHMD();
+
+	// Events returned by the next PollNextEvent() calls, in order
+	void VRQueueEvent(const vr::VREvent_t &event);
+
+	// Handle of the input component the device at deviceIndex created under the given path, or
+	// vr::k_ulInvalidInputComponentHandle
+	vr::VRInputComponentHandle_t VRFindComponent(vr::TrackedDeviceIndex_t deviceIndex, const char *path);
+	bool VRGetBooleanComponent(vr::VRInputComponentHandle_t handle);
+	float VRGetScalarComponent(vr::VRInputComponentHandle_t handle);
+
+	// Last pose published for the device and the number of poses published for all devices
+	vr::DriverPose_t VRGetLastPose(vr::TrackedDeviceIndex_t deviceIndex);
+	unsigned long long VRGetPoseUpdateCount();
+
+	// Log lines are dropped unless this is set (or the STUB_VR_LOG environment variable is)
+	void VRSetLogToStderr(bool bEnabled);
+}
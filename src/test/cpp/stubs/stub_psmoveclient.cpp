@@ -0,0 +1,354 @@
+// Plays PSMoveService for the driver: connecting succeeds straight away, requests are answered on the
+// next update and controller state is whatever the test put into it.
+
+#include "stub_psmoveservice.h"
+#include <string.h>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace stub {
+
+	static const char *k_szClientVersion = "0.9-alpha8.9.0";
+
+	struct StubControllerEntry {
+		std::unique_ptr<PSMController> state;
+		char serial[PSMOVESERVICE_CONTROLLER_SERIAL_LEN];
+		char parentSerial[PSMOVESERVICE_CONTROLLER_SERIAL_LEN];
+		int streamFlags;
+	};
+
+	struct PendingResponse {
+		PSMResponseMessage response;
+		PSMResponseCallback callback;
+		void *userdata;
+	};
+
+	static bool s_bInitialized = false;
+	static bool s_bConnected = false;
+	static PSMRequestID s_nextRequestId = 1;
+	static std::vector<StubControllerEntry> s_controllers;
+	static std::deque<PSMMessage> s_messages;
+	static std::deque<PendingResponse> s_pendingResponses;
+	static std::vector<PSMRumbleCommand> s_rumbleCommands;
+	static std::vector<PSMCommand> s_commandLog;
+
+	static StubControllerEntry *FindController(PSMControllerID controllerId) {
+		for (StubControllerEntry &entry : s_controllers) {
+			if (entry.state->ControllerID == controllerId)
+				return &entry;
+		}
+
+		return nullptr;
+	}
+
+	static void QueueEvent(PSMEventMessage::eEventType eventType) {
+		PSMMessage message;
+		memset(&message, 0, sizeof(message));
+		message.payload_type = PSMMessage::_messagePayloadType_Event;
+		message.event_data.event_type = eventType;
+		s_messages.push_back(message);
+	}
+
+	static void LogCommand(ePSMCommandType type, PSMControllerID controllerId) {
+		PSMCommand command;
+		memset(&command, 0, sizeof(command));
+		command.type = type;
+		command.controllerId = controllerId;
+		s_commandLog.push_back(command);
+	}
+
+	// The response is delivered on the next update, to a registered callback if there is one by then
+	static PSMResponseMessage &QueueResponse(PSMResponseMessage::eResponsePayloadType payloadType, PSMRequestID *out_request_id) {
+		PendingResponse pending;
+		memset(&pending.response, 0, sizeof(pending.response));
+		pending.response.request_id = s_nextRequestId++;
+		pending.response.result_code = PSMResult_Success;
+		pending.response.payload_type = payloadType;
+		pending.callback = nullptr;
+		pending.userdata = nullptr;
+		s_pendingResponses.push_back(pending);
+
+		if (out_request_id != nullptr) {
+			*out_request_id = pending.response.request_id;
+		}
+
+		return s_pendingResponses.back().response;
+	}
+
+	void PSMReset() {
+		s_bInitialized = false;
+		s_bConnected = false;
+		s_controllers.clear();
+		s_messages.clear();
+		s_pendingResponses.clear();
+		s_rumbleCommands.clear();
+		s_commandLog.clear();
+	}
+
+	PSMController *PSMAddController(
+		PSMControllerID controllerId,
+		PSMControllerType controllerType,
+		PSMControllerHand controllerHand,
+		const char *serial,
+		const char *parentSerial) {
+		StubControllerEntry entry;
+		entry.state.reset(new PSMController());
+		memset(entry.state.get(), 0, sizeof(PSMController));
+		entry.state->ControllerID = controllerId;
+		entry.state->ControllerType = controllerType;
+		entry.state->ControllerHand = controllerHand;
+		entry.state->bValid = true;
+		entry.state->IsConnected = true;
+		entry.state->DataFrameAverageFPS = 60.f;
+		strncpy(entry.serial, serial, sizeof(entry.serial) - 1);
+		entry.serial[sizeof(entry.serial) - 1] = '\0';
+		strncpy(entry.parentSerial, parentSerial, sizeof(entry.parentSerial) - 1);
+		entry.parentSerial[sizeof(entry.parentSerial) - 1] = '\0';
+		entry.streamFlags = -1;
+
+		PSMController *state = entry.state.get();
+		s_controllers.push_back(std::move(entry));
+
+		if (s_bConnected) {
+			QueueEvent(PSMEventMessage::PSMEvent_controllerListUpdated);
+		}
+
+		return state;
+	}
+
+	void PSMPublishFrame(PSMControllerID controllerId) {
+		StubControllerEntry *entry = FindController(controllerId);
+		if (entry != nullptr) {
+			++entry->state->OutputSequenceNum;
+			entry->state->DataFrameLastReceivedTime =
+				std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	}
+
+	int PSMGetStreamFlags(PSMControllerID controllerId) {
+		const StubControllerEntry *entry = FindController(controllerId);
+		return entry != nullptr ? entry->streamFlags : -1;
+	}
+
+	const std::vector<PSMRumbleCommand> &PSMRumbleCommands() {
+		return s_rumbleCommands;
+	}
+
+	void PSMClearRumbleCommands() {
+		s_rumbleCommands.clear();
+	}
+
+	const std::vector<PSMCommand> &PSMCommandLog() {
+		return s_commandLog;
+	}
+
+	void PSMClearCommandLog() {
+		s_commandLog.clear();
+	}
+}
+
+using namespace stub;
+
+PSMResult PSM_Initialize(const char * /*host*/, const char * /*port*/, int /*timeout_ms*/) {
+	s_bInitialized = true;
+	s_bConnected = true;
+	return PSMResult_Success;
+}
+
+PSMResult PSM_InitializeAsync(const char * /*host*/, const char * /*port*/) {
+	s_bInitialized = true;
+	s_bConnected = true;
+	QueueEvent(PSMEventMessage::PSMEvent_connectedToService);
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_Shutdown() {
+	s_bInitialized = false;
+	s_bConnected = false;
+	s_messages.clear();
+	s_pendingResponses.clear();
+	for (StubControllerEntry &entry : s_controllers) {
+		entry.streamFlags = -1;
+		entry.state->ListenerCount = 0;
+	}
+	return PSMResult_Success;
+}
+
+bool PSM_GetIsInitialized() {
+	return s_bInitialized;
+}
+
+PSMResult PSM_UpdateNoPollMessages() {
+	// Nothing to answer on most frames; the swap below would allocate a deque every update
+	if (s_pendingResponses.empty())
+		return s_bConnected ? PSMResult_Success : PSMResult_Error;
+
+	// Callbacks may send new requests, those are answered on the next update
+	std::deque<PendingResponse> responses;
+	responses.swap(s_pendingResponses);
+
+	for (const PendingResponse &pending : responses) {
+		if (pending.callback != nullptr) {
+			pending.callback(&pending.response, pending.userdata);
+		} else {
+			PSMMessage message;
+			memset(&message, 0, sizeof(message));
+			message.payload_type = PSMMessage::_messagePayloadType_Response;
+			message.response_data = pending.response;
+			s_messages.push_back(message);
+		}
+	}
+
+	return s_bConnected ? PSMResult_Success : PSMResult_Error;
+}
+
+PSMResult PSM_Update() {
+	return PSM_UpdateNoPollMessages();
+}
+
+bool PSM_WasSystemButtonPressed() {
+	return false;
+}
+
+PSMResult PSM_PollNextMessage(PSMMessage *message, size_t /*message_size*/) {
+	if (s_messages.empty())
+		return PSMResult_NoData;
+
+	*message = s_messages.front();
+	s_messages.pop_front();
+	return PSMResult_Success;
+}
+
+const char *PSM_GetClientVersionString() {
+	return k_szClientVersion;
+}
+
+PSMResult PSM_GetServiceVersionStringAsync(PSMRequestID *out_request_id) {
+	PSMResponseMessage &response = QueueResponse(PSMResponseMessage::_responsePayloadType_ServiceVersion, out_request_id);
+	strncpy(response.payload.service_version.version_string, k_szClientVersion, sizeof(response.payload.service_version.version_string) - 1);
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_RegisterCallback(PSMRequestID request_id, PSMResponseCallback callback, void *callback_userdata) {
+	for (PendingResponse &pending : s_pendingResponses) {
+		if (pending.response.request_id == request_id) {
+			pending.callback = callback;
+			pending.userdata = callback_userdata;
+			return PSMResult_Success;
+		}
+	}
+
+	return PSMResult_Error;
+}
+
+PSMResult PSM_GetControllerListAsync(PSMRequestID *out_request_id) {
+	PSMResponseMessage &response = QueueResponse(PSMResponseMessage::_responsePayloadType_ControllerList, out_request_id);
+	PSMControllerList &list = response.payload.controller_list;
+
+	for (const StubControllerEntry &entry : s_controllers) {
+		if (list.count >= PSMOVESERVICE_MAX_CONTROLLER_COUNT)
+			break;
+
+		list.controller_id[list.count] = entry.state->ControllerID;
+		list.controller_type[list.count] = entry.state->ControllerType;
+		list.controller_hand[list.count] = entry.state->ControllerHand;
+		memcpy(list.controller_serial[list.count], entry.serial, sizeof(entry.serial));
+		memcpy(list.parent_controller_serial[list.count], entry.parentSerial, sizeof(entry.parentSerial));
+		++list.count;
+	}
+
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_GetTrackerListAsync(PSMRequestID *out_request_id) {
+	QueueResponse(PSMResponseMessage::_responsePayloadType_TrackerList, out_request_id);
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_AllocateControllerListener(PSMControllerID controller_id) {
+	StubControllerEntry *entry = FindController(controller_id);
+	if (entry == nullptr)
+		return PSMResult_Error;
+
+	++entry->state->ListenerCount;
+	return PSMResult_Success;
+}
+
+PSMResult PSM_FreeControllerListener(PSMControllerID controller_id) {
+	StubControllerEntry *entry = FindController(controller_id);
+	if (entry == nullptr || entry->state->ListenerCount <= 0)
+		return PSMResult_Error;
+
+	--entry->state->ListenerCount;
+	return PSMResult_Success;
+}
+
+PSMController *PSM_GetController(PSMControllerID controller_id) {
+	StubControllerEntry *entry = FindController(controller_id);
+	return entry != nullptr ? entry->state.get() : nullptr;
+}
+
+PSMResult PSM_GetControllerPose(PSMControllerID controller_id, PSMPosef *out_pose) {
+	const PSMController *controller = PSM_GetController(controller_id);
+	if (controller == nullptr)
+		return PSMResult_Error;
+
+	switch (controller->ControllerType) {
+	case PSMController_Move:
+		*out_pose = controller->ControllerState.PSMoveState.Pose;
+		return PSMResult_Success;
+	case PSMController_DualShock4:
+		*out_pose = controller->ControllerState.PSDS4State.Pose;
+		return PSMResult_Success;
+	case PSMController_Virtual:
+		*out_pose = controller->ControllerState.VirtualController.Pose;
+		return PSMResult_Success;
+	default:
+		return PSMResult_Error;
+	}
+}
+
+PSMResult PSM_StartControllerDataStreamAsync(PSMControllerID controller_id, unsigned int data_stream_flags, PSMRequestID *out_request_id) {
+	StubControllerEntry *entry = FindController(controller_id);
+	if (entry == nullptr)
+		return PSMResult_Error;
+
+	entry->streamFlags = (int)data_stream_flags;
+	LogCommand(PSMCommand_StartStream, controller_id);
+	s_commandLog.back().streamFlags = data_stream_flags;
+	QueueResponse(PSMResponseMessage::_responsePayloadType_Empty, out_request_id);
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_StopControllerDataStreamAsync(PSMControllerID controller_id, PSMRequestID *out_request_id) {
+	StubControllerEntry *entry = FindController(controller_id);
+	if (entry == nullptr)
+		return PSMResult_Error;
+
+	entry->streamFlags = -1;
+	LogCommand(PSMCommand_StopStream, controller_id);
+	QueueResponse(PSMResponseMessage::_responsePayloadType_Empty, out_request_id);
+	return PSMResult_RequestSent;
+}
+
+PSMResult PSM_SetControllerRumble(PSMControllerID controller_id, PSMControllerRumbleChannel channel, float rumble_fraction) {
+	PSMRumbleCommand command;
+	command.controllerId = controller_id;
+	command.channel = channel;
+	command.rumbleFraction = rumble_fraction;
+	command.sendTime = std::chrono::high_resolution_clock::now();
+	s_rumbleCommands.push_back(command);
+
+	LogCommand(PSMCommand_Rumble, controller_id);
+	s_commandLog.back().channel = channel;
+	s_commandLog.back().rumbleFraction = rumble_fraction;
+	return PSMResult_Success;
+}
+
+PSMResult PSM_ResetControllerOrientationAsync(PSMControllerID controller_id, const PSMQuatf *q_pose, PSMRequestID *out_request_id) {
+	LogCommand(PSMCommand_ResetOrientation, controller_id);
+	s_commandLog.back().orientation = q_pose != nullptr ? *q_pose : *k_psm_quaternion_identity;
+	QueueResponse(PSMResponseMessage::_responsePayloadType_Empty, out_request_id);
+	return PSMResult_RequestSent;
+}
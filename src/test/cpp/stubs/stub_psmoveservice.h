@@ -0,0 +1,59 @@
+#pragma once
+// Test side of the stubbed PSMoveService client: the controllers the "service" reports, their state
+// and the commands the driver sent it.
+
+#include "PSMoveClient_CAPI.h"
+#include <chrono>
+#include <vector>
+
+namespace stub {
+
+	struct PSMRumbleCommand {
+		PSMControllerID controllerId;
+		PSMControllerRumbleChannel channel;
+		float rumbleFraction;
+		std::chrono::time_point<std::chrono::high_resolution_clock> sendTime;
+	};
+
+	enum ePSMCommandType {
+		PSMCommand_Rumble,
+		PSMCommand_ResetOrientation,
+		PSMCommand_StartStream,
+		PSMCommand_StopStream
+	};
+
+	// One command call as PSMoveService received it; only the fields of its type are filled in
+	struct PSMCommand {
+		ePSMCommandType type;
+		PSMControllerID controllerId;
+		PSMControllerRumbleChannel channel;
+		float rumbleFraction;
+		PSMQuatf orientation;
+		unsigned int streamFlags;
+	};
+
+	// Forgets every controller, message and recorded command. Call between tests that share a process.
+	void PSMReset();
+
+	// Adds a controller to the list the service reports once the driver connects. Its state can be
+	// changed through the returned pointer, which PSM_GetController() also hands out.
+	PSMController *PSMAddController(
+		PSMControllerID controllerId,
+		PSMControllerType controllerType,
+		PSMControllerHand controllerHand,
+		const char *serial,
+		const char *parentSerial = "");
+
+	// Pretends a new data frame arrived: bumps the output sequence number and the receive time
+	void PSMPublishFrame(PSMControllerID controllerId);
+
+	// Data stream flags the driver started streaming the controller with, or -1 when not streaming
+	int PSMGetStreamFlags(PSMControllerID controllerId);
+
+	const std::vector<PSMRumbleCommand> &PSMRumbleCommands();
+	void PSMClearRumbleCommands();
+
+	// Every rumble, orientation reset and stream start/stop the driver sent, in the order it sent them
+	const std::vector<PSMCommand> &PSMCommandLog();
+	void PSMClearCommandLog();
+}
@@ -0,0 +1,102 @@
+#include "driver_harness.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#error The driver harness needs a POSIX HOME directory to redirect the config files
+#else
+#include <unistd.h>
+#endif
+
+namespace test {
+
+	static std::string CreateTemporaryHome() {
+		const char *tmpdir = getenv("TMPDIR");
+		std::string pattern = std::string(tmpdir != nullptr ? tmpdir : "/tmp") + "/psmove_bridge_test_XXXXXX";
+
+		if (mkdtemp(&pattern[0]) == nullptr) {
+			fprintf(stderr, "DriverHarness - failed to create a temporary home directory\n");
+			abort();
+		}
+
+		return pattern;
+	}
+
+	DriverHarness::DriverHarness(std::function<void(steamvrbridge::ServerDriverConfig &)> configure)
+		: m_homeDirectory(CreateTemporaryHome())
+		, m_server(nullptr) {
+		stub::VRReset();
+		stub::PSMReset();
+
+		setenv("HOME", m_homeDirectory.c_str(), 1);
+
+		steamvrbridge::ServerDriverConfig config;
+		config.auto_launch_psmove_service = false;
+		config.has_calibrated_world_from_driver_pose = true;
+		config.async_logging = false;
+		if (configure) {
+			configure(config);
+		}
+		config.save();
+	}
+
+	DriverHarness::~DriverHarness() {
+		if (m_server != nullptr) {
+			m_server->Cleanup();
+			delete m_server;
+		}
+
+		stub::VRReset();
+		stub::PSMReset();
+
+		for (const std::string &path : m_writtenConfigFiles) {
+			remove(path.c_str());
+		}
+
+		const std::string command = "rm -rf '" + m_homeDirectory + "'";
+		if (system(command.c_str()) != 0) {
+			fprintf(stderr, "DriverHarness - failed to remove %s\n", m_homeDirectory.c_str());
+		}
+	}
+
+	void DriverHarness::WriteConfigFile(const std::string &fnamebase, const std::string &json) {
+		// Same directory the driver reads from, which is /etc rather than HOME when run as root. The
+		// server config saved by the constructor created it.
+		const std::string path = steamvrbridge::Utils::Path_GetHomeDirectory() + "/PSMoveSteamVRBridge/" + fnamebase + ".json";
+		FILE *file = fopen(path.c_str(), "w");
+
+		if (file == nullptr) {
+			fprintf(stderr, "DriverHarness - failed to write %s\n", path.c_str());
+			return;
+		}
+
+		fputs(json.c_str(), file);
+		fclose(file);
+		m_writtenConfigFiles.push_back(path);
+	}
+
+	bool DriverHarness::Start() {
+		m_server = steamvrbridge::CServerDriver_PSMoveService::getInstance();
+		return m_server->Init(nullptr) == vr::VRInitError_None;
+	}
+
+	void DriverHarness::RunFrame() {
+		m_server->RunFrame();
+	}
+
+	void DriverHarness::RunFrames(int frameCount) {
+		for (int i = 0; i < frameCount; ++i) {
+			m_server->RunFrame();
+		}
+	}
+
+	bool DriverHarness::RunUntilDeviceCount(size_t deviceCount, int maxFrameCount) {
+		for (int i = 0; i < maxFrameCount && stub::VRDevices().size() < deviceCount; ++i) {
+			m_server->RunFrame();
+		}
+
+		return stub::VRDevices().size() >= deviceCount;
+	}
+}
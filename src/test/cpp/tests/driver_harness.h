@@ -0,0 +1,43 @@
+#pragma once
+// Runs the real server driver against the stubbed OpenVR host and PSMoveService client.
+// HOME is pointed at a fresh temporary directory first, so the driver's config files never touch
+// the user's own PSMoveSteamVRBridge folder.
+
+#include "server_driver.h"
+#include "stub_openvr_host.h"
+#include "stub_psmoveservice.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace test {
+
+	class DriverHarness {
+	public:
+		// configure can change the server config before the driver loads it. By default the harness
+		// doesn't launch PSMoveService and reports a calibrated tracking space (no monitor launch).
+		explicit DriverHarness(std::function<void(steamvrbridge::ServerDriverConfig &)> configure = nullptr);
+		~DriverHarness();
+
+		// Connects to the stub service. Add the stub controllers before calling this.
+		bool Start();
+
+		void RunFrame();
+		void RunFrames(int frameCount);
+
+		// Runs frames until the driver has added deviceCount devices, returns false if it never does
+		bool RunUntilDeviceCount(size_t deviceCount, int maxFrameCount = 10);
+
+		// Writes a config file the driver loads on activation, e.g. "psmove_<serial>" for a PSMove, and
+		// removes it again on destruction. Call before Start().
+		void WriteConfigFile(const std::string &fnamebase, const std::string &json);
+
+		steamvrbridge::CServerDriver_PSMoveService *Server() const { return m_server; }
+		const std::string &HomeDirectory() const { return m_homeDirectory; }
+
+	private:
+		std::string m_homeDirectory;
+		std::vector<std::string> m_writtenConfigFiles;
+		steamvrbridge::CServerDriver_PSMoveService *m_server;
+	};
+}
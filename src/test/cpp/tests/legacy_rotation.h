@@ -0,0 +1,121 @@
+#pragma once
+// The rotation conversions as they were before they were made branch-free, kept verbatim as the
+// reference the current ones are tested and benchmarked against.
+
+#include "ClientGeometry_CAPI.h"
+#include "openvr_driver.h"
+#include <math.h>
+
+namespace legacy {
+
+	inline PSMQuatf ExtractHMDYawQuaternion(const PSMQuatf &q) {
+		// Convert the quaternion to a basis matrix
+		const PSMMatrix3f hmd_orientation = PSM_Matrix3fCreateFromQuatf(&q);
+
+		// Extract the forward (z-axis) vector from the basis
+		const PSMVector3f forward = PSM_Matrix3fBasisZ(&hmd_orientation);
+		PSMVector3f forward2d = { forward.x, 0.f, forward.z };
+		forward2d = PSM_Vector3fNormalizeWithDefault(&forward2d, k_psm_float_vector3_k);
+
+		// Compute the yaw angle (amount the z-axis has been rotated to it's current facing)
+		const float cos_yaw = PSM_Vector3fDot(&forward, k_psm_float_vector3_k);
+		float half_yaw = acosf(fminf(fmaxf(cos_yaw, -1.f), 1.f)) / 2.f;
+
+		// Flip the sign of the yaw angle depending on if forward2d is to the left or right of global forward
+		PSMVector3f yaw_axis = PSM_Vector3fCross(k_psm_float_vector3_k, &forward2d);
+		if (PSM_Vector3fDot(&yaw_axis, k_psm_float_vector3_j) < 0) {
+			half_yaw = -half_yaw;
+		}
+
+		// Convert this yaw rotation back into a quaternion
+		PSMQuatf yaw_quaternion =
+			PSM_QuatfCreate(
+			cosf(half_yaw), // w = cos(theta/2)
+			0.f, sinf(half_yaw), 0.f); // (x, y, z) = sin(theta/2)*axis, where axis = (0, 1, 0)
+
+		return yaw_quaternion;
+	}
+
+	inline PSMQuatf ExtractPSMoveYawQuaternion(const PSMQuatf &q) {
+		// Convert the quaternion to a basis matrix
+		const PSMMatrix3f psmove_basis = PSM_Matrix3fCreateFromQuatf(&q);
+
+		// Extract the forward (negative z-axis) vector from the basis
+		const PSMVector3f global_forward = { 0.f, 0.f, -1.f };
+		const PSMVector3f &forward = PSM_Matrix3fBasisY(&psmove_basis);
+		PSMVector3f forward2d = { forward.x, 0.f, forward.z };
+		forward2d = PSM_Vector3fNormalizeWithDefault(&forward2d, &global_forward);
+
+		// Compute the yaw angle (amount the z-axis has been rotated to it's current facing)
+		const float cos_yaw = PSM_Vector3fDot(&forward, &global_forward);
+		float yaw = acosf(fminf(fmaxf(cos_yaw, -1.f), 1.f));
+
+		// Flip the sign of the yaw angle depending on if forward2d is to the left or right of global forward
+		const PSMVector3f &global_up = *k_psm_float_vector3_j;
+		PSMVector3f yaw_axis = PSM_Vector3fCross(&global_forward, &forward2d);
+		if (PSM_Vector3fDot(&yaw_axis, &global_up) < 0) {
+			yaw = -yaw;
+		}
+
+		// Convert this yaw rotation back into a quaternion
+		PSMVector3f eulerPitch = { (float)1.57079632679489661923, 0.f, 0.f }; // pitch 90 up first
+		PSMVector3f eulerYaw = { 0, yaw, 0 };
+		PSMQuatf quatPitch = PSM_QuatfCreateFromAngles(&eulerPitch);
+		PSMQuatf quatYaw = PSM_QuatfCreateFromAngles(&eulerYaw);
+		PSMQuatf yaw_quaternion =
+			PSM_QuatfConcat(
+			&quatPitch, // pitch 90 up first
+			&quatYaw); // Then apply the yaw
+
+		return yaw_quaternion;
+	}
+
+	// From: http://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+	// a[i] is row i of the rotation matrix
+	template <typename Matrix>
+	inline PSMQuatf MatrixRowsToPSMQuatf(const Matrix &a) {
+		PSMQuatf q;
+
+		const float trace = a[0][0] + a[1][1] + a[2][2];
+
+		if (trace > 0) {
+			const float s = 0.5f / sqrtf(trace + 1.0f);
+
+			q.w = 0.25f / s;
+			q.x = (a[2][1] - a[1][2]) * s;
+			q.y = (a[0][2] - a[2][0]) * s;
+			q.z = (a[1][0] - a[0][1]) * s;
+		} else {
+			if (a[0][0] > a[1][1] && a[0][0] > a[2][2]) {
+				const float s = 2.0f * sqrtf(1.0f + a[0][0] - a[1][1] - a[2][2]);
+
+				q.w = (a[2][1] - a[1][2]) / s;
+				q.x = 0.25f * s;
+				q.y = (a[0][1] + a[1][0]) / s;
+				q.z = (a[0][2] + a[2][0]) / s;
+			} else if (a[1][1] > a[2][2]) {
+				const float s = 2.0f * sqrtf(1.0f + a[1][1] - a[0][0] - a[2][2]);
+
+				q.w = (a[0][2] - a[2][0]) / s;
+				q.x = (a[0][1] + a[1][0]) / s;
+				q.y = 0.25f * s;
+				q.z = (a[1][2] + a[2][1]) / s;
+			} else {
+				const float s = 2.0f * sqrtf(1.0f + a[2][2] - a[0][0] - a[1][1]);
+
+				q.w = (a[1][0] - a[0][1]) / s;
+				q.x = (a[0][2] + a[2][0]) / s;
+				q.y = (a[1][2] + a[2][1]) / s;
+				q.z = 0.25f * s;
+			}
+		}
+
+		q = PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity);
+
+		return q;
+	}
+
+	inline PSMQuatf openvrMatrixExtractPSMQuatf(const vr::HmdMatrix34_t &openVRTransform) {
+		return MatrixRowsToPSMQuatf(openVRTransform.m);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Minimal test framework for the driver tests: TEST_CASE registers a function, CHECK/CHECK_NEAR
+// record failures and keep going, test_main.cpp runs everything and returns the failure count.
+
+#include <math.h>
+#include <stdio.h>
+
+namespace test {
+
+	typedef void(*TestFunction)();
+
+	struct Registrar {
+		Registrar(const char *name, TestFunction function);
+	};
+
+	// Records a failed check; returns the condition so callers can bail out of a test early
+	bool Check(bool bCondition, const char *expression, const char *file, int line);
+	bool CheckNear(double actual, double expected, double tolerance, const char *expression, const char *file, int line);
+
+	// Deterministic random numbers, so failures reproduce
+	void SeedRandom(unsigned int seed);
+	float RandomFloat(float min, float max);
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static test::Registrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(condition) test::Check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) \
+	test::CheckNear((actual), (expected), (tolerance), #actual " ~= " #expected, __FILE__, __LINE__)
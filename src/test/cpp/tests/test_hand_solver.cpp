@@ -0,0 +1,278 @@
+// CRadialHandOrientationSolver on known hand positions and on the degenerate ones: the hand straight
+// above or below the shoulder, where pointing leaves no horizontal right vector, and the hand sitting
+// on the shoulder, where there is nothing to point along.
+
+#include "test_common.h"
+#include "facing_handsolver.h"
+#include "psm_math.h"
+#include "utils.h"
+
+using namespace steamvrbridge;
+
+static const float k_fNeckLength = 0.2f;
+static const float k_fHalfShoulderLength = 0.2f;
+
+// Rotated basis vectors are unit length, a few float roundings off
+static const double k_tolerance = 1e-5;
+
+static const PSMVector3f k_localRight = { 1.f, 0.f, 0.f };
+static const PSMVector3f k_localUp = { 0.f, 1.f, 0.f };
+static const PSMVector3f k_localForward = { 0.f, 0.f, -1.f };
+
+static PSMPosef HMDPose(float yawRadians) {
+	const PSMVector3f angles = { 0.f, yawRadians, 0.f };
+	PSMPosef pose;
+	pose.Position = { 0.f, 1.7f, 0.f };
+	pose.Orientation = PSM_QuatfCreateFromAngles(&angles);
+	return pose;
+}
+
+static PSMQuatf Solve(vr::ETrackedControllerRole hand, const PSMPosef &hmdPose, const PSMVector3f &handLocation) {
+	CRadialHandOrientationSolver solver(hand, k_fNeckLength, k_fHalfShoulderLength);
+	return solver.solveHandOrientation(hmdPose, handLocation);
+}
+
+static void CheckVector(const PSMVector3f &actual, const PSMVector3f &expected) {
+	CHECK_NEAR(actual.x, expected.x, k_tolerance);
+	CHECK_NEAR(actual.y, expected.y, k_tolerance);
+	CHECK_NEAR(actual.z, expected.z, k_tolerance);
+}
+
+// The orientation must carry the controller's local axes onto the given world directions
+static void CheckAxes(const PSMQuatf &q, const PSMVector3f &right, const PSMVector3f &up, const PSMVector3f &forward) {
+	CHECK_NEAR(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z, 1.0, k_tolerance);
+	CheckVector(PSM_QuatfRotateVector(&q, &k_localRight), right);
+	CheckVector(PSM_QuatfRotateVector(&q, &k_localUp), up);
+	CheckVector(PSM_QuatfRotateVector(&q, &k_localForward), forward);
+}
+
+TEST_CASE(hand_in_front_of_shoulder) {
+	// The right shoulder is at (0.2, 1.5, 0)
+	const PSMVector3f hand = { 0.2f, 1.5f, -0.6f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	CHECK_NEAR(q.w, 1.0, k_tolerance);
+	CheckAxes(q, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, -1.f });
+}
+
+TEST_CASE(hand_out_to_the_right) {
+	const PSMVector3f hand = { 0.8f, 1.5f, 0.f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	// -90 degrees about +y turns forward (-z) to +x
+	CHECK_NEAR(q.w, 0.70710678, k_tolerance);
+	CHECK_NEAR(q.x, 0.0, k_tolerance);
+	CHECK_NEAR(q.y, -0.70710678, k_tolerance);
+	CHECK_NEAR(q.z, 0.0, k_tolerance);
+	CheckAxes(q, { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f });
+}
+
+TEST_CASE(hand_out_to_the_left) {
+	// The left shoulder is at (-0.2, 1.5, 0)
+	const PSMVector3f hand = { -0.8f, 1.5f, 0.f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_LeftHand, HMDPose(0.f), hand);
+
+	CheckAxes(q, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f }, { -1.f, 0.f, 0.f });
+}
+
+TEST_CASE(hand_forward_and_down) {
+	const PSMVector3f hand = { 0.2f, 1.0f, -0.5f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	// Pitched 45 degrees down, up tilts forward
+	const float s = 0.70710678f;
+	CheckAxes(q, { 1.f, 0.f, 0.f }, { 0.f, s, -s }, { 0.f, -s, -s });
+}
+
+TEST_CASE(random_hands_point_from_the_shoulder) {
+	for (int i = 0; i < 500; ++i) {
+		const PSMPosef hmdPose = HMDPose(test::RandomFloat(-3.14159f, 3.14159f));
+		const PSMVector3f hand = { test::RandomFloat(-1.f, 1.f), test::RandomFloat(0.5f, 2.5f), test::RandomFloat(-1.f, 1.f) };
+		const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, hmdPose, hand);
+
+		// Shoulder: 0.2 to the right of the head along its yaw, 0.2 below it
+		const PSMVector3f shoulderOffset = { k_fHalfShoulderLength, -k_fNeckLength, 0.f };
+		const PSMVector3f rotatedOffset = PSM_QuatfRotateVector(&hmdPose.Orientation, &shoulderOffset);
+		const PSMVector3f shoulder = PSM_Vector3fAdd(&hmdPose.Position, &rotatedOffset);
+		const PSMVector3f toHand = PSM_Vector3fSubtract(&hand, &shoulder);
+
+		// Closer in, float rounding in placing the shoulder swings the direction more than the tolerance
+		if (PSM_Vector3fLength(&toHand) < 0.1f)
+			continue;
+		const PSMVector3f expectedForward = PSM_Vector3fNormalizeWithDefault(&toHand, k_psm_float_vector3_zero);
+
+		const PSMVector3f forward = PSM_QuatfRotateVector(&q, &k_localForward);
+		const PSMVector3f up = PSM_QuatfRotateVector(&q, &k_localUp);
+		const PSMVector3f right = PSM_QuatfRotateVector(&q, &k_localRight);
+
+		CheckVector(forward, expectedForward);
+		// Right stays horizontal and up leans towards world up
+		CHECK_NEAR(right.y, 0.0, k_tolerance);
+		CHECK(up.y >= 0.f);
+	}
+}
+
+TEST_CASE(hand_straight_above_shoulder) {
+	const PSMVector3f hand = { 0.2f, 2.2f, 0.f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	// Right falls back to the body's right, up then points backwards
+	CheckAxes(q, { 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f });
+}
+
+TEST_CASE(hand_straight_below_shoulder) {
+	const PSMVector3f hand = { 0.2f, 0.8f, 0.f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	CheckAxes(q, { 1.f, 0.f, 0.f }, { 0.f, 0.f, -1.f }, { 0.f, -1.f, 0.f });
+}
+
+TEST_CASE(hand_above_shoulder_of_turned_body) {
+	// Body turned 90 degrees left: its right is -z
+	const PSMVector3f hand = { 0.f, 2.2f, -0.2f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(1.5707963f), hand);
+
+	CheckAxes(q, { 0.f, 0.f, -1.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f });
+}
+
+TEST_CASE(hand_on_shoulder) {
+	// Nothing to point along, the hand faces the way the body does
+	const PSMVector3f hand = { 0.2f, 1.5f, 0.f };
+	const PSMQuatf q = Solve(vr::TrackedControllerRole_RightHand, HMDPose(0.f), hand);
+
+	CheckAxes(q, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, -1.f });
+}
+
+TEST_CASE(psm_matrix_columns_are_basis_vectors) {
+	// Utils::psmMatrix3fToPSMQuatf must agree with PSM_Matrix3fCreateFromQuatf
+	for (int i = 0; i < 500; ++i) {
+		PSMQuatf q = { test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f) };
+		q = PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity);
+		if (q.w < 0.f)
+			q = PSM_QuatfScale(&q, -1.f);
+
+		const PSMMatrix3f m = PSM_Matrix3fCreateFromQuatf(&q);
+		const PSMQuatf result = Utils::psmMatrix3fToPSMQuatf(m);
+
+		CHECK_NEAR(result.w, q.w, 1e-5);
+		CHECK_NEAR(result.x, q.x, 1e-5);
+		CHECK_NEAR(result.y, q.y, 1e-5);
+		CHECK_NEAR(result.z, q.z, 1e-5);
+	}
+}
+
+// Counts the solves that reach the wrapped solver
+class CountingSolver : public IHandOrientationSolver {
+public:
+	CountingSolver(int *solveCount) : m_solveCount(solveCount) {}
+
+	PSMQuatf solveHandOrientation(const PSMPosef &hmdPose, const PSMVector3f & /*handLocation*/) override {
+		++*m_solveCount;
+		return hmdPose.Orientation;
+	}
+
+private:
+	int *m_solveCount;
+};
+
+TEST_CASE(cache_reuses_result_while_inputs_hold) {
+	int solveCount = 0;
+	CachedHandOrientationSolver cache(new CountingSolver(&solveCount));
+	const PSMPosef hmdPose = HMDPose(0.3f);
+	const PSMVector3f hand = { 0.3f, 1.2f, -0.4f };
+
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+
+	CHECK(solveCount == 1);
+	CHECK(cache.getHitCount() == 2);
+	CHECK(cache.getMissCount() == 1);
+}
+
+TEST_CASE(cache_ignores_hmd_jitter_below_epsilon) {
+	int solveCount = 0;
+	CachedHandOrientationSolver cache(new CountingSolver(&solveCount));
+	const PSMVector3f hand = { 0.3f, 1.2f, -0.4f };
+
+	// 0.1mm and 0.02 degrees of tracking noise
+	PSMPosef hmdPose = HMDPose(0.3f);
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+	hmdPose.Position.x += 0.0001f;
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+	hmdPose = HMDPose(0.3f + 0.02f / 57.2957795f);
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+
+	CHECK(solveCount == 1);
+}
+
+TEST_CASE(cache_solves_again_when_an_input_changes) {
+	int solveCount = 0;
+	CachedHandOrientationSolver cache(new CountingSolver(&solveCount));
+	const PSMVector3f hand = { 0.3f, 1.2f, -0.4f };
+	PSMPosef hmdPose = HMDPose(0.3f);
+
+	cache.solveHandOrientation(1, 0, hmdPose, hand);
+	CHECK(solveCount == 1);
+
+	// New optical sample
+	cache.solveHandOrientation(2, 0, hmdPose, hand);
+	CHECK(solveCount == 2);
+
+	// Recalibrated tracking space
+	cache.solveHandOrientation(2, 1, hmdPose, hand);
+	CHECK(solveCount == 3);
+
+	// Head moved 1mm
+	hmdPose.Position.y += 0.001f;
+	cache.solveHandOrientation(2, 1, hmdPose, hand);
+	CHECK(solveCount == 4);
+
+	// Head turned half a degree
+	hmdPose.Orientation = HMDPose(0.3f + 0.5f / 57.2957795f).Orientation;
+	cache.solveHandOrientation(2, 1, hmdPose, hand);
+	CHECK(solveCount == 5);
+
+	cache.invalidate();
+	cache.solveHandOrientation(2, 1, hmdPose, hand);
+	CHECK(solveCount == 6);
+}
+
+TEST_CASE(cache_slow_drift_adds_up) {
+	int solveCount = 0;
+	CachedHandOrientationSolver cache(new CountingSolver(&solveCount));
+	const PSMVector3f hand = { 0.3f, 1.2f, -0.4f };
+	PSMPosef hmdPose = HMDPose(0.f);
+
+	// 0.1mm per call never exceeds the epsilon from one call to the next, but does from the last solve
+	for (int i = 0; i < 20; ++i) {
+		cache.solveHandOrientation(1, 0, hmdPose, hand);
+		hmdPose.Position.x += 0.0001f;
+	}
+
+	CHECK(solveCount >= 3);
+}
+
+TEST_CASE(cache_hit_rate_with_upsampled_frames) {
+	// 60Hz optical samples, 90Hz frames that all ask for an orientation (upsampling on), HMD held
+	// still apart from tracking noise: one frame in three reuses the orientation of its sample
+	int solveCount = 0;
+	CachedHandOrientationSolver cache(new CountingSolver(&solveCount));
+	const PSMVector3f hand = { 0.3f, 1.2f, -0.4f };
+
+	const int frameCount = 900;
+	for (int frame = 0; frame < frameCount; ++frame) {
+		const int sequenceNum = frame * 60 / 90;
+
+		PSMPosef hmdPose = HMDPose(0.3f);
+		hmdPose.Position.x += test::RandomFloat(-0.0001f, 0.0001f);
+		hmdPose.Position.y += test::RandomFloat(-0.0001f, 0.0001f);
+
+		cache.solveHandOrientation(sequenceNum, 0, hmdPose, hand);
+	}
+
+	const float hitRate = (float)cache.getHitCount() / (float)frameCount;
+	printf("  hand orientation cache hit rate at 60Hz samples, 90Hz frames: %.1f%%\n", 100.f * hitRate);
+	CHECK_NEAR(hitRate, 1.0 / 3.0, 0.01);
+	CHECK(cache.getHitCount() + cache.getMissCount() == (unsigned int)frameCount);
+}
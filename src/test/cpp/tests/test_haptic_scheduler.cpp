@@ -0,0 +1,248 @@
+// HapticScheduler pulses on a made up timeline, DualMotorHapticMixer splitting them between the
+// DS4's two motors by frequency, and the latency a controller reports for the events it sent on.
+
+#include "test_common.h"
+#include "controller.h"
+#include "driver_harness.h"
+#include "haptic_scheduler.h"
+#include <string.h>
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const float k_fLevel = 1.f / 255.f;
+
+static vr::VREvent_HapticVibration_t Vibration(float durationSeconds, float frequency, float amplitude) {
+	vr::VREvent_HapticVibration_t vibration = {};
+	vibration.fDurationSeconds = durationSeconds;
+	vibration.fFrequency = frequency;
+	vibration.fAmplitude = amplitude;
+	return vibration;
+}
+
+static Clock::time_point After(const Clock::time_point &start, int milliseconds) {
+	return start + std::chrono::milliseconds(milliseconds);
+}
+
+// Motor value of a pulse at the given amplitude, once the noticeable minimum is added
+static float PulseStrength(float amplitude) {
+	return 0.35f + 0.65f*amplitude;
+}
+
+TEST_CASE(update_only_reports_changes) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+	float value = -1.f;
+
+	CHECK(!scheduler.Update(t0, &value));
+
+	scheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	CHECK(scheduler.Update(t0, &value));
+	CHECK_NEAR(value, 1.f, k_fLevel);
+
+	// Steady for the rest of the pulse
+	CHECK(!scheduler.Update(After(t0, 10), &value));
+	CHECK(!scheduler.Update(After(t0, 990), &value));
+
+	CHECK(scheduler.Update(After(t0, 1010), &value));
+	CHECK(value == 0.f);
+	CHECK(!scheduler.Update(After(t0, 1020), &value));
+	CHECK(!scheduler.HasActivePulses());
+}
+
+TEST_CASE(slow_pulses_are_modulated) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+
+	// 10Hz: on for the first 50ms of every 100ms
+	scheduler.Queue(Vibration(1.f, 10.f, 1.f), t0);
+	CHECK_NEAR(scheduler.Evaluate(After(t0, 10)), 1.f, 1e-6);
+	CHECK(scheduler.Evaluate(After(t0, 60)) == 0.f);
+	CHECK_NEAR(scheduler.Evaluate(After(t0, 110)), 1.f, 1e-6);
+	CHECK(scheduler.Evaluate(After(t0, 160)) == 0.f);
+}
+
+TEST_CASE(fast_pulses_are_steady) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+
+	scheduler.Queue(Vibration(1.f, 160.f, 1.f), t0);
+	for (int milliseconds = 0; milliseconds < 1000; milliseconds += 7) {
+		CHECK_NEAR(scheduler.Evaluate(After(t0, milliseconds)), 1.f, 1e-6);
+	}
+}
+
+TEST_CASE(legacy_pulses_scale_with_their_duration) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+
+	// TriggerHapticPulse(2500us): half strength, stretched to the shortest pulse that can be felt
+	scheduler.Queue(Vibration(0.0025f, 0.f, 1.f), t0);
+	CHECK_NEAR(scheduler.Evaluate(t0), PulseStrength(0.5f), 1e-6);
+	CHECK_NEAR(scheduler.Evaluate(After(t0, 15)), PulseStrength(0.5f), 1e-6);
+	CHECK(scheduler.Evaluate(After(t0, 25)) == 0.f);
+}
+
+TEST_CASE(zero_amplitude_stops_everything) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+	float value = -1.f;
+
+	scheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	scheduler.Queue(Vibration(2.f, 0.f, 0.5f), t0);
+	CHECK(scheduler.Update(t0, &value));
+
+	scheduler.Queue(Vibration(1.f, 0.f, 0.f), After(t0, 10));
+	CHECK(scheduler.Update(After(t0, 10), &value));
+	CHECK(value == 0.f);
+	CHECK(!scheduler.HasActivePulses());
+}
+
+TEST_CASE(overflow_replaces_the_pulse_ending_first) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+
+	// A full timeline: the strongest pulse ends first
+	scheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	for (int i = 1; i < 8; ++i) {
+		scheduler.Queue(Vibration(1.f + i, 0.f, 0.2f), t0);
+	}
+	CHECK_NEAR(scheduler.Evaluate(t0), 1.f, 1e-6);
+
+	scheduler.Queue(Vibration(0.5f, 0.f, 0.5f), t0);
+	CHECK_NEAR(scheduler.Evaluate(After(t0, 250)), PulseStrength(0.5f), 1e-6);
+	CHECK_NEAR(scheduler.Evaluate(After(t0, 750)), PulseStrength(0.2f), 1e-6);
+}
+
+TEST_CASE(pending_event_arrival_is_taken_once) {
+	HapticScheduler scheduler;
+	const Clock::time_point t0 = Clock::now();
+	Clock::time_point arrival;
+
+	CHECK(!scheduler.TakePendingEventArrival(&arrival));
+
+	// The oldest event behind the change is the one measured
+	scheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	scheduler.Queue(Vibration(1.f, 0.f, 0.5f), After(t0, 5));
+	CHECK(scheduler.TakePendingEventArrival(&arrival));
+	CHECK(arrival == t0);
+	CHECK(!scheduler.TakePendingEventArrival(&arrival));
+}
+
+TEST_CASE(bands_cross_over_by_frequency) {
+	const Clock::time_point t0 = Clock::now();
+	float low, high;
+
+	// At or below 50Hz only the heavy motor, at or above 200Hz only the light one
+	HapticScheduler lowScheduler;
+	lowScheduler.Queue(Vibration(1.f, 40.f, 1.f), t0);
+	lowScheduler.EvaluateBands(t0, &low, &high);
+	CHECK_NEAR(low, 1.f, 1e-6);
+	CHECK(high == 0.f);
+
+	HapticScheduler highScheduler;
+	highScheduler.Queue(Vibration(1.f, 320.f, 1.f), t0);
+	highScheduler.EvaluateBands(t0, &low, &high);
+	CHECK(low == 0.f);
+	CHECK_NEAR(high, 1.f, 1e-6);
+
+	// 100Hz is halfway across on a log scale
+	HapticScheduler middleScheduler;
+	middleScheduler.Queue(Vibration(1.f, 100.f, 1.f), t0);
+	middleScheduler.EvaluateBands(t0, &low, &high);
+	CHECK_NEAR(low, 0.5f, 1e-5);
+	CHECK_NEAR(high, 0.5f, 1e-5);
+
+	// No frequency drives both
+	HapticScheduler anyScheduler;
+	anyScheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	anyScheduler.EvaluateBands(t0, &low, &high);
+	CHECK_NEAR(low, 1.f, 1e-6);
+	CHECK_NEAR(high, 1.f, 1e-6);
+}
+
+TEST_CASE(mixer_reports_each_motor_on_change) {
+	HapticScheduler leftScheduler;
+	HapticScheduler rightScheduler;
+	HapticScheduler *const schedulers[2] = { &leftScheduler, &rightScheduler };
+	DualMotorHapticMixer mixer;
+	DualMotorHapticMixer::Output output;
+	const Clock::time_point t0 = Clock::now();
+
+	CHECK(!mixer.Update(schedulers, 2, t0, &output));
+
+	// A low rumble on one component and a high buzz on the other each reach only their motor
+	leftScheduler.Queue(Vibration(1.f, 40.f, 1.f), t0);
+	CHECK(mixer.Update(schedulers, 2, t0, &output));
+	CHECK(output.bLowFrequencyChanged && !output.bHighFrequencyChanged);
+	CHECK_NEAR(output.lowFrequencyValue, 1.f, k_fLevel);
+	CHECK(output.bHasEventArrival && output.eventArrivalTime == t0);
+
+	rightScheduler.Queue(Vibration(0.5f, 320.f, 1.f), After(t0, 10));
+	CHECK(mixer.Update(schedulers, 2, After(t0, 10), &output));
+	CHECK(!output.bLowFrequencyChanged && output.bHighFrequencyChanged);
+	CHECK_NEAR(output.highFrequencyValue, 1.f, k_fLevel);
+
+	// Nothing changes until the buzz ends
+	CHECK(!mixer.Update(schedulers, 2, After(t0, 20), &output));
+	CHECK(!output.bHasEventArrival);
+
+	CHECK(mixer.Update(schedulers, 2, After(t0, 520), &output));
+	CHECK(!output.bLowFrequencyChanged && output.bHighFrequencyChanged);
+	CHECK(output.highFrequencyValue == 0.f);
+	CHECK_NEAR(output.lowFrequencyValue, 1.f, k_fLevel);
+	CHECK(!output.bHasEventArrival);
+}
+
+TEST_CASE(mixer_drops_the_arrival_of_events_that_change_nothing) {
+	HapticScheduler scheduler;
+	HapticScheduler *const schedulers[1] = { &scheduler };
+	DualMotorHapticMixer mixer;
+	DualMotorHapticMixer::Output output;
+	const Clock::time_point t0 = Clock::now();
+
+	scheduler.Queue(Vibration(1.f, 0.f, 1.f), t0);
+	CHECK(mixer.Update(schedulers, 1, t0, &output));
+
+	// A weaker overlapping pulse doesn't change the output, and isn't measured later either
+	scheduler.Queue(Vibration(1.f, 0.f, 0.2f), After(t0, 10));
+	CHECK(!mixer.Update(schedulers, 1, After(t0, 10), &output));
+	CHECK(mixer.Update(schedulers, 1, After(t0, 1005), &output));
+	CHECK(!output.bHasEventArrival);
+}
+
+TEST_CASE(controller_answers_the_haptic_latency_request) {
+	test::DriverHarness harness([](ServerDriverConfig &config) { config.log_update_timing = true; });
+	stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:11:22:33:44:55");
+
+	CHECK(harness.Start());
+	if (!CHECK(harness.RunUntilDeviceCount(1)))
+		return;
+
+	// The stream start response creates the haptic components
+	stub::PSMPublishFrame(0);
+	harness.RunFrames(3);
+
+	Controller *controller = dynamic_cast<Controller *>(stub::VRDevices()[0]);
+	if (!CHECK(controller != nullptr && controller->HasHapticState(k_PSMHapticID_Rumble)))
+		return;
+
+	char response[512];
+	controller->DebugRequest("haptic_latency", response, sizeof(response));
+	CHECK(strcmp(response, "no haptic events") == 0);
+
+	vr::VREvent_t event = {};
+	event.eventType = vr::VREvent_Input_HapticVibration;
+	event.data.hapticVibration = Vibration(1.f, 0.f, 1.f);
+	event.data.hapticVibration.componentHandle = controller->GetHapticState(k_PSMHapticID_Rumble)->hapticComponentHandle;
+	stub::VRQueueEvent(event);
+	harness.RunFrame();
+
+	controller->DebugRequest("haptic_latency", response, sizeof(response));
+	CHECK(strstr(response, " us max over 1 events (") != nullptr);
+
+	// Everything else still goes to the shared requests
+	controller->DebugRequest("dump_frame_profile", response, sizeof(response));
+	CHECK(strcmp(response, "frame_profiler is not enabled") == 0);
+}
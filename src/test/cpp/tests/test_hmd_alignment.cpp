@@ -0,0 +1,151 @@
+// HMDAlignmentSolver on synthetic samples made from a known world-from-driver transform: the yaw and
+// translation fit from spread out samples, the averaged one-shot alignment when the controller is
+// held still, and inputs that can't be fitted.
+
+#include "test_common.h"
+#include "constants.h"
+#include "hmd_alignment.h"
+#include "psm_math.h"
+#include "settings_util.h"
+#include "utils.h"
+#include <cmath>
+
+using namespace steamvrbridge;
+
+static const double k_pi = 3.14159265358979323846;
+
+// Controller held upright 10cm in front of the HMD
+static HMDAlignmentParams HeldParams() {
+	HMDAlignmentParams params;
+	params.controllerOrientationInHmdSpace = *k_psm_quaternion_identity;
+	params.controllerLocalOffsetFromHmdPosition = PSMVector3f{ 0.f, 0.f, -0.1f };
+	params.useControllerOrientation = false;
+	return params;
+}
+
+static PSMQuatf YawQuaternion(float yawRadians) {
+	return PSMMath::QuatfCreate(cosf(0.5f*yawRadians), 0.f, sinf(0.5f*yawRadians), 0.f);
+}
+
+// The sample the controller would report for the given HMD pose if driver space were world space
+// moved by worldFromDriver
+static HMDAlignmentSample MakeSample(const PSMPosef &hmdPoseMeters, const PSMPosef &worldFromDriver, const HMDAlignmentParams &params) {
+	const PSMVector3f world = Utils::GetExpectedControllerWorldPose(
+		params.controllerOrientationInHmdSpace, params.controllerLocalOffsetFromHmdPosition, hmdPoseMeters).Position;
+	const PSMVector3f driver = PSMMath::PosefInverseTransformPoint(worldFromDriver, world);
+
+	HMDAlignmentSample sample;
+	sample.hmdPoseMeters = hmdPoseMeters;
+	sample.controllerPose = PSMMath::PosefCreate(PSMMath::Vector3fScale(driver, 1.f / k_fScalePSMoveAPIToMeters), *k_psm_quaternion_identity);
+	return sample;
+}
+
+// q and -q are the same rotation
+static double RotationDistance(const PSMQuatf &a, const PSMQuatf &b) {
+	return 1.0 - fabs((double)a.w*b.w + (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z);
+}
+
+TEST_CASE(recovers_yaw_and_translation_from_spread_samples) {
+	const HMDAlignmentParams params = HeldParams();
+	const PSMPosef worldFromDriver = PSMMath::PosefCreate(PSMVector3f{ 1.2f, 0.4f, -2.f }, YawQuaternion((float)(0.7*k_pi)));
+
+	// The HMD walked around a 30cm circle, turning as it goes
+	HMDAlignmentSample samples[12];
+	for (int i = 0; i < 12; ++i) {
+		const float angle = (float)(2.0*k_pi*i / 12.0);
+		const PSMPosef hmdPose = PSMMath::PosefCreate(
+			PSMVector3f{ 0.3f*cosf(angle), 1.7f, 0.3f*sinf(angle) }, YawQuaternion(0.5f*angle));
+		samples[i] = MakeSample(hmdPose, worldFromDriver, params);
+	}
+
+	HMDAlignmentResult result;
+	if (!CHECK(HMDAlignmentSolver::Solve(samples, 12, params, &result)))
+		return;
+
+	CHECK(result.bRotationFromPositions);
+	CHECK(result.sampleCount == 12);
+	CHECK_NEAR(RotationDistance(result.worldFromDriverPose.Orientation, worldFromDriver.Orientation), 0.0, 1e-6);
+	CHECK_NEAR(result.worldFromDriverPose.Position.x, worldFromDriver.Position.x, 1e-4);
+	CHECK_NEAR(result.worldFromDriverPose.Position.y, worldFromDriver.Position.y, 1e-4);
+	CHECK_NEAR(result.worldFromDriverPose.Position.z, worldFromDriver.Position.z, 1e-4);
+	CHECK_NEAR(result.rmsErrorMeters, 0.0, 1e-4);
+}
+
+TEST_CASE(averages_the_one_shot_alignment_when_held_still) {
+	const HMDAlignmentParams params = HeldParams();
+	const PSMPosef worldFromDriver = PSMMath::PosefCreate(PSMVector3f{ -0.5f, 0.f, 0.8f }, YawQuaternion(0.3f));
+	const PSMPosef hmdPose = PSMMath::PosefCreate(PSMVector3f{ 0.2f, 1.6f, -0.4f }, YawQuaternion(-0.4f));
+
+	// A few mm of tracking noise, well under the spread the rotation fit needs
+	test::SeedRandom(1234);
+	HMDAlignmentSample samples[30];
+	for (int i = 0; i < 30; ++i) {
+		samples[i] = MakeSample(hmdPose, worldFromDriver, params);
+		samples[i].controllerPose.Position.x += test::RandomFloat(-0.3f, 0.3f);
+		samples[i].controllerPose.Position.z += test::RandomFloat(-0.3f, 0.3f);
+	}
+
+	HMDAlignmentResult result;
+	if (!CHECK(HMDAlignmentSolver::Solve(samples, 30, params, &result)))
+		return;
+
+	CHECK(!result.bRotationFromPositions);
+
+	// Noise only moves the positions, so every one-shot rotation is the same
+	const PSMPosef oneShot = Utils::ComputeWorldFromDriverPose(
+		params.controllerOrientationInHmdSpace, params.controllerLocalOffsetFromHmdPosition,
+		samples[0].controllerPose, samples[0].hmdPoseMeters, params.useControllerOrientation);
+	CHECK_NEAR(RotationDistance(result.worldFromDriverPose.Orientation, oneShot.Orientation), 0.0, 1e-6);
+
+	// The translation still fits the centroids for that rotation
+	CHECK(result.rmsErrorMeters < 0.005f);
+}
+
+TEST_CASE(rejects_an_empty_sample_set) {
+	HMDAlignmentResult result;
+	CHECK(!HMDAlignmentSolver::Solve(nullptr, 0, HeldParams(), &result));
+}
+
+TEST_CASE(two_samples_never_fit_the_rotation) {
+	const HMDAlignmentParams params = HeldParams();
+	const PSMPosef worldFromDriver = PSMMath::PosefCreate(PSMVector3f{ 0.f, 0.f, 0.f }, YawQuaternion(1.f));
+
+	// Far apart, but two points can't tell a rotation fit from noise
+	HMDAlignmentSample samples[2] = {
+		MakeSample(PSMMath::PosefCreate(PSMVector3f{ -1.f, 1.7f, 0.f }, *k_psm_quaternion_identity), worldFromDriver, params),
+		MakeSample(PSMMath::PosefCreate(PSMVector3f{ 1.f, 1.7f, 0.f }, *k_psm_quaternion_identity), worldFromDriver, params)
+	};
+
+	HMDAlignmentResult result;
+	if (!CHECK(HMDAlignmentSolver::Solve(samples, 2, params, &result)))
+		return;
+
+	CHECK(!result.bRotationFromPositions);
+	CHECK(result.sampleCount == 2);
+}
+
+TEST_CASE(coincident_samples_give_a_finite_fit) {
+	const HMDAlignmentParams params = HeldParams();
+	const PSMPosef hmdPose = PSMMath::PosefCreate(PSMVector3f{ 0.f, 1.7f, 0.f }, *k_psm_quaternion_identity);
+
+	// Identical samples: no spread at all and no covariance to fit a yaw from
+	HMDAlignmentSample samples[5];
+	for (int i = 0; i < 5; ++i) {
+		samples[i] = MakeSample(hmdPose, *k_psm_pose_identity, params);
+	}
+
+	HMDAlignmentResult result;
+	if (!CHECK(HMDAlignmentSolver::Solve(samples, 5, params, &result)))
+		return;
+
+	const PSMPosef &pose = result.worldFromDriverPose;
+	CHECK(!result.bRotationFromPositions);
+	CHECK(std::isfinite(pose.Orientation.w) && std::isfinite(pose.Orientation.x) && std::isfinite(pose.Orientation.y) && std::isfinite(pose.Orientation.z));
+	CHECK(std::isfinite(pose.Position.x) && std::isfinite(pose.Position.y) && std::isfinite(pose.Position.z));
+	CHECK_NEAR(result.rmsErrorMeters, 0.0, 1e-4);
+}
+
+TEST_CASE(multi_sample_alignment_is_opt_in) {
+	const ServerDriverConfig config;
+	CHECK(config.hmd_alignment_sample_count == 1);
+}
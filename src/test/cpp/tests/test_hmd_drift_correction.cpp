@@ -0,0 +1,165 @@
+// HMDDriftCorrector with a stub controller mounted on a stub HMD that slowly walks a circle: the
+// controller's offset from the HMD is learned first, then a drift between the two tracking spaces is
+// corrected once fitting it pays off, and drift below the improvement threshold is left alone.
+
+#include "test_common.h"
+#include "constants.h"
+#include "hmd_drift_correction.h"
+#include "hmd_pose_cache.h"
+#include "psm_command_queue.h"
+#include "psm_math.h"
+#include "settings_util.h"
+#include "stub_openvr_host.h"
+#include "stub_psmoveservice.h"
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const double k_pi = 3.14159265358979323846;
+static const PSMControllerID k_controllerId = 5;
+
+// Where the controller is mounted in the HMD's local frame
+static const PSMVector3f k_leverArm = { 0.f, 0.1f, 0.05f };
+
+// The first pair needs a previous sample, so the lever arm is learned after this many frames
+static const int k_nLeverArmFrames = 61;
+
+static PSMQuatf YawQuaternion(float yawRadians) {
+	return PSMMath::QuatfCreate(cosf(0.5f*yawRadians), 0.f, sinf(0.5f*yawRadians), 0.f);
+}
+
+/* A controller on the HMD feeding a drift corrector at 60Hz. The HMD walks a 30cm circle every 20s while
+turning, slow enough that every pair passes the speed check, and the controller reports where the HMD
+would put it with driver space moved by the given drift.*/
+class DriftRig {
+public:
+	DriftRig()
+		: m_corrector(m_commands)
+		, m_startTime(Clock::now())
+		, m_nFrame(0) {
+		stub::VRReset();
+		stub::PSMReset();
+
+		m_controller = stub::PSMAddController(k_controllerId, PSMController_Move, PSMControllerHand_Any, "00:00:00:00:00:05");
+		m_controller->ControllerState.PSMoveState.bIsCurrentlyTracking = true;
+		m_controller->ControllerState.PSMoveState.bIsPositionValid = true;
+		m_controller->ControllerState.PSMoveState.Pose.Orientation = *k_psm_quaternion_identity;
+
+		m_config.continuous_hmd_alignment = true;
+		m_config.has_calibrated_world_from_driver_pose = true;
+		m_config.world_from_driver_pose = *k_psm_pose_identity;
+		m_config.drift_correction_time_constant_seconds = 2.f;
+		m_config.drift_correction_min_improvement_meters = 0.005f;
+		m_config.drift_correction_min_interval_seconds = 5.f;
+
+		m_corrector.Attach(k_controllerId, "00:00:00:00:00:05");
+	}
+
+	// Runs one frame; returns true with the corrected world-from-driver pose when the corrector applied one
+	bool Step(const PSMPosef &worldFromDriverDrift, PSMPosef *out_world_from_driver_pose) {
+		const double seconds = m_nFrame / 60.0;
+		const float angle = (float)(2.0*k_pi*seconds / 20.0);
+		m_hmdPose = PSMMath::PosefCreate(PSMVector3f{ 0.3f*cosf(angle), 1.7f, 0.3f*sinf(angle) }, YawQuaternion(0.5f*angle));
+		stub::VRSetHMDPose(m_hmdPose);
+		m_hmdPoseCache.BeginFrame();
+
+		const PSMVector3f driver = PSMMath::PosefInverseTransformPoint(worldFromDriverDrift, GetControllerWorldPosition());
+		m_controller->ControllerState.PSMoveState.Pose.Position = PSMMath::Vector3fScale(driver, 1.f / k_fScalePSMoveAPIToMeters);
+		stub::PSMPublishFrame(k_controllerId);
+
+		const Clock::time_point now = m_startTime + std::chrono::microseconds(16667 * m_nFrame);
+		++m_nFrame;
+
+		return m_corrector.Update(m_config, m_hmdPoseCache, now, out_world_from_driver_pose);
+	}
+
+	PSMVector3f GetControllerWorldPosition() const {
+		return PSMMath::PosefTransformPoint(m_hmdPose, k_leverArm);
+	}
+
+	ServerDriverConfig m_config;
+	PSMCommandQueue m_commands;
+	HMDDriftCorrector m_corrector;
+
+private:
+	HMDPoseCache m_hmdPoseCache;
+	PSMController *m_controller;
+	Clock::time_point m_startTime;
+	int m_nFrame;
+	PSMPosef m_hmdPose;
+};
+
+TEST_CASE(learns_the_lever_arm_then_corrects_drift) {
+	DriftRig rig;
+	PSMPosef worldFromDriver;
+
+	for (int i = 0; i < k_nLeverArmFrames; ++i) {
+		CHECK(!rig.Step(*k_psm_pose_identity, &worldFromDriver));
+	}
+
+	// PSMoveService's space turns by 3 degrees and slides by 5cm
+	const PSMPosef drift = PSMMath::PosefCreate(PSMVector3f{ 0.03f, 0.f, -0.04f }, YawQuaternion((float)(3.0*k_pi / 180.0)));
+
+	bool bIsCorrected = false;
+	for (int i = 0; i < 60 * 20 && !bIsCorrected; ++i) {
+		bIsCorrected = rig.Step(drift, &worldFromDriver);
+	}
+	if (!CHECK(bIsCorrected))
+		return;
+
+	CHECK(rig.m_corrector.GetAppliedCorrectionCount() == 1);
+
+	// The corrected transform undoes the drift near the tracked area and a couple of meters away
+	const PSMVector3f nearPoint = rig.GetControllerWorldPosition();
+	const PSMVector3f farPoint = { 2.f, 1.f, -2.f };
+	for (const PSMVector3f &world : { nearPoint, farPoint }) {
+		const PSMVector3f corrected = PSMMath::PosefTransformPoint(worldFromDriver, PSMMath::PosefInverseTransformPoint(drift, world));
+		CHECK_NEAR(corrected.x, world.x, 0.005);
+		CHECK_NEAR(corrected.y, world.y, 0.005);
+		CHECK_NEAR(corrected.z, world.z, 0.005);
+	}
+
+	// Once the config has the correction there is nothing left to fix
+	rig.m_config.world_from_driver_pose = worldFromDriver;
+	for (int i = 0; i < 60 * 20; ++i) {
+		CHECK(!rig.Step(drift, &worldFromDriver));
+	}
+	CHECK(rig.m_corrector.GetAppliedCorrectionCount() == 1);
+}
+
+TEST_CASE(ignores_drift_below_the_improvement_threshold) {
+	DriftRig rig;
+	PSMPosef worldFromDriver;
+
+	for (int i = 0; i < k_nLeverArmFrames; ++i) {
+		rig.Step(*k_psm_pose_identity, &worldFromDriver);
+	}
+
+	// 3mm is less than the 5mm the RMS error has to improve by
+	const PSMPosef drift = PSMMath::PosefCreate(PSMVector3f{ 0.003f, 0.f, 0.f }, *k_psm_quaternion_identity);
+	for (int i = 0; i < 60 * 30; ++i) {
+		CHECK(!rig.Step(drift, &worldFromDriver));
+	}
+	CHECK(rig.m_corrector.GetAppliedCorrectionCount() == 0);
+
+	// The same drift is worth correcting with a lower threshold
+	rig.m_config.drift_correction_min_improvement_meters = 0.001f;
+	bool bIsCorrected = false;
+	for (int i = 0; i < 60 * 10 && !bIsCorrected; ++i) {
+		bIsCorrected = rig.Step(drift, &worldFromDriver);
+	}
+	CHECK(bIsCorrected);
+}
+
+TEST_CASE(disabled_without_continuous_alignment) {
+	DriftRig rig;
+	PSMPosef worldFromDriver;
+	rig.m_config.continuous_hmd_alignment = false;
+
+	const PSMPosef drift = PSMMath::PosefCreate(PSMVector3f{ 0.1f, 0.f, 0.f }, *k_psm_quaternion_identity);
+	for (int i = 0; i < 60 * 20; ++i) {
+		CHECK(!rig.Step(i < k_nLeverArmFrames ? *k_psm_pose_identity : drift, &worldFromDriver));
+	}
+	CHECK(rig.m_corrector.GetAppliedCorrectionCount() == 0);
+}
@@ -0,0 +1,72 @@
+#include "test_common.h"
+#include <random>
+#include <vector>
+
+namespace test {
+
+	struct TestEntry {
+		const char *name;
+		TestFunction function;
+	};
+
+	static std::vector<TestEntry> &Registry() {
+		static std::vector<TestEntry> s_registry;
+		return s_registry;
+	}
+
+	static std::mt19937 s_random;
+	static int s_failureCount = 0;
+
+	Registrar::Registrar(const char *name, TestFunction function) {
+		TestEntry entry = { name, function };
+		Registry().push_back(entry);
+	}
+
+	bool Check(bool bCondition, const char *expression, const char *file, int line) {
+		if (!bCondition) {
+			fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+			++s_failureCount;
+		}
+
+		return bCondition;
+	}
+
+	bool CheckNear(double actual, double expected, double tolerance, const char *expression, const char *file, int line) {
+		// Written so that a NaN fails the check
+		const bool bNear = fabs(actual - expected) <= tolerance;
+		if (!bNear) {
+			fprintf(stderr, "%s(%d): CHECK_NEAR failed: %s (%.9g vs %.9g, tolerance %g)\n",
+				file, line, expression, actual, expected, tolerance);
+			++s_failureCount;
+		}
+
+		return bNear;
+	}
+
+	void SeedRandom(unsigned int seed) {
+		s_random.seed(seed);
+	}
+
+	float RandomFloat(float min, float max) {
+		return std::uniform_real_distribution<float>(min, max)(s_random);
+	}
+}
+
+int main() {
+	int failedTestCount = 0;
+
+	for (const test::TestEntry &entry : test::Registry()) {
+		const int failuresBefore = test::s_failureCount;
+
+		test::SeedRandom(1234);
+		entry.function();
+
+		const bool bPassed = test::s_failureCount == failuresBefore;
+		printf("[%s] %s\n", bPassed ? "PASS" : "FAIL", entry.name);
+		if (!bPassed)
+			++failedTestCount;
+	}
+
+	printf("%d of %d tests failed\n", failedTestCount, (int)test::Registry().size());
+	return failedTestCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// OcclusionPolicy through an occlusion: holding the last position, coasting on a decaying velocity,
+// giving up after the timeout and blending out the jump once tracking returns.
+
+#include "test_common.h"
+#include "occlusion_policy.h"
+#include "settings_util.h"
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const PSMPosef k_trackedPose = { { 10.f, 100.f, -20.f }, { 1.f, 0.f, 0.f, 0.f } };
+
+// The defaults: hold for 0.5s, coast for the first 0.1s at a decay rate of 10/s, blend over 0.15s
+static ServerDriverConfig OcclusionConfig() {
+	ServerDriverConfig config;
+	config.occlusion_timeout_seconds = 0.5f;
+	config.occlusion_dead_reckoning_seconds = 0.1f;
+	config.occlusion_velocity_decay_rate = 10.f;
+	config.occlusion_recovery_blend_seconds = 0.15f;
+	return config;
+}
+
+static Clock::time_point After(const Clock::time_point &start, int milliseconds) {
+	return start + std::chrono::milliseconds(milliseconds);
+}
+
+// Applies one sample; the pose it reports goes to out_pose
+static bool ApplySample(
+	OcclusionPolicy &policy,
+	const PSMPosef &rawPose,
+	const PSMPhysicsData *physics,
+	bool bIsPositionValid,
+	const Clock::time_point &now,
+	const ServerDriverConfig &config,
+	PSMPosef *out_pose,
+	bool *out_bIsOccluded) {
+	return policy.Apply(rawPose, physics, bIsPositionValid, true, now, config, out_pose, out_bIsOccluded);
+}
+
+TEST_CASE(holds_the_last_position_until_the_timeout) {
+	const ServerDriverConfig config = OcclusionConfig();
+	OcclusionPolicy policy;
+	const Clock::time_point t0 = Clock::now();
+	PSMPosef pose;
+	bool bIsOccluded;
+
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, true, t0, config, &pose, &bIsOccluded));
+	CHECK(!bIsOccluded);
+
+	// PSMoveService keeps reporting some position while the bulb is hidden
+	PSMPosef lostPose = k_trackedPose;
+	lostPose.Position.x = 500.f;
+
+	CHECK(ApplySample(policy, lostPose, nullptr, false, After(t0, 16), config, &pose, &bIsOccluded));
+	CHECK(bIsOccluded && policy.IsOccluded());
+	CHECK(pose.Position.x == k_trackedPose.Position.x);
+
+	CHECK(ApplySample(policy, lostPose, nullptr, false, After(t0, 400), config, &pose, &bIsOccluded));
+	CHECK(pose.Position.x == k_trackedPose.Position.x);
+
+	CHECK(!ApplySample(policy, lostPose, nullptr, false, After(t0, 600), config, &pose, &bIsOccluded));
+}
+
+TEST_CASE(coasts_on_a_decaying_velocity) {
+	const ServerDriverConfig config = OcclusionConfig();
+	OcclusionPolicy policy;
+	const Clock::time_point t0 = Clock::now();
+	PSMPosef pose;
+	bool bIsOccluded;
+
+	PSMPhysicsData physics = {};
+	physics.LinearVelocityCmPerSec.x = 100.f;
+	CHECK(ApplySample(policy, k_trackedPose, &physics, true, t0, config, &pose, &bIsOccluded));
+
+	// d(t) = v0 * (1 - e^(-k*t)) / k from the start of the occlusion
+	const Clock::time_point occlusionStart = After(t0, 16);
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, false, occlusionStart, config, &pose, &bIsOccluded));
+	CHECK_NEAR(pose.Position.x, k_trackedPose.Position.x, 1e-4);
+
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, false, After(occlusionStart, 50), config, &pose, &bIsOccluded));
+	CHECK_NEAR(pose.Position.x, k_trackedPose.Position.x + 100.f*(1.f - expf(-0.5f))/10.f, 1e-3);
+
+	// Stopped once the dead reckoning window is over
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, false, After(occlusionStart, 300), config, &pose, &bIsOccluded));
+	CHECK_NEAR(pose.Position.x, k_trackedPose.Position.x + 100.f*(1.f - expf(-1.f))/10.f, 1e-3);
+}
+
+TEST_CASE(blends_out_the_jump_when_tracking_returns) {
+	const ServerDriverConfig config = OcclusionConfig();
+	OcclusionPolicy policy;
+	const Clock::time_point t0 = Clock::now();
+	PSMPosef pose;
+	bool bIsOccluded;
+
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, true, t0, config, &pose, &bIsOccluded));
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, false, After(t0, 16), config, &pose, &bIsOccluded));
+
+	// Found again 10cm away from where it was held
+	PSMPosef foundPose = k_trackedPose;
+	foundPose.Position.x += 10.f;
+	const Clock::time_point foundTime = After(t0, 200);
+
+	CHECK(ApplySample(policy, foundPose, nullptr, true, foundTime, config, &pose, &bIsOccluded));
+	CHECK(!bIsOccluded && policy.IsRecovering());
+	CHECK_NEAR(pose.Position.x, k_trackedPose.Position.x, 1e-4);
+
+	CHECK(ApplySample(policy, foundPose, nullptr, true, After(foundTime, 75), config, &pose, &bIsOccluded));
+	CHECK_NEAR(pose.Position.x, k_trackedPose.Position.x + 5.f, 1e-3);
+
+	CHECK(ApplySample(policy, foundPose, nullptr, true, After(foundTime, 160), config, &pose, &bIsOccluded));
+	CHECK(!policy.IsRecovering());
+	CHECK(pose.Position.x == foundPose.Position.x);
+}
+
+TEST_CASE(no_blend_after_the_timeout) {
+	const ServerDriverConfig config = OcclusionConfig();
+	OcclusionPolicy policy;
+	const Clock::time_point t0 = Clock::now();
+	PSMPosef pose;
+	bool bIsOccluded;
+
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, true, t0, config, &pose, &bIsOccluded));
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, false, After(t0, 16), config, &pose, &bIsOccluded));
+	CHECK(!ApplySample(policy, k_trackedPose, nullptr, false, After(t0, 700), config, &pose, &bIsOccluded));
+
+	// The pose was already reported invalid, so there is no held position to blend from
+	PSMPosef foundPose = k_trackedPose;
+	foundPose.Position.x += 10.f;
+	CHECK(ApplySample(policy, foundPose, nullptr, true, After(t0, 716), config, &pose, &bIsOccluded));
+	CHECK(!policy.IsRecovering());
+	CHECK(pose.Position.x == foundPose.Position.x);
+}
+
+TEST_CASE(disabled_or_without_imu_drops_the_pose) {
+	ServerDriverConfig config = OcclusionConfig();
+	const Clock::time_point t0 = Clock::now();
+	PSMPosef pose;
+	bool bIsOccluded;
+
+	config.occlusion_timeout_seconds = 0.f;
+	OcclusionPolicy disabledPolicy;
+	CHECK(ApplySample(disabledPolicy, k_trackedPose, nullptr, true, t0, config, &pose, &bIsOccluded));
+	CHECK(!ApplySample(disabledPolicy, k_trackedPose, nullptr, false, After(t0, 16), config, &pose, &bIsOccluded));
+
+	config = OcclusionConfig();
+	OcclusionPolicy policy;
+	CHECK(ApplySample(policy, k_trackedPose, nullptr, true, t0, config, &pose, &bIsOccluded));
+	CHECK(!policy.Apply(k_trackedPose, nullptr, false, false, After(t0, 16), config, &pose, &bIsOccluded));
+	CHECK(!policy.IsOccluded());
+}
@@ -0,0 +1,125 @@
+// PoseBatch::Flush() against PoseBatch::TransformPoseScalar() on randomized poses. Batch sizes cover
+// full SSE registers, every scalar tail length and the overflow path past k_nMaxBatchSize. The same
+// file is built against the scalar kernel (POSE_BATCH_USE_SSE=0) as test_pose_batch_scalar.
+
+#include "test_common.h"
+#include "pose_batch.h"
+#include "pose_publisher.h"
+#include "psm_math.h"
+#include "stub_openvr_host.h"
+#include <vector>
+
+using namespace steamvrbridge;
+
+// The batch folds the two extend rotations into rotation matrix columns, the scalar path rotates
+// vectors by the quaternion. Both are a handful of float operations on values of a few meters.
+static const double k_positionToleranceMeters = 1e-5;
+
+// Orientation is only ever copied or negated, so both paths have to agree exactly
+static const double k_orientationTolerance = 0.0;
+
+struct BatchInput {
+	PSMPosef rawPose;
+	float extendY;
+	float extendZ;
+	bool bRotateZ90;
+};
+
+static BatchInput RandomInput() {
+	BatchInput input;
+
+	// PSM units are centimeters
+	input.rawPose.Position = { test::RandomFloat(-300.f, 300.f), test::RandomFloat(-50.f, 250.f), test::RandomFloat(-300.f, 300.f) };
+
+	PSMQuatf q = { test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f) };
+	input.rawPose.Orientation = PSMMath::QuatfNormalizeWithDefault(q, *k_psm_quaternion_identity);
+
+	// Most controllers don't extend at all, which the scalar path special cases
+	input.extendY = test::RandomFloat(0.f, 1.f) < 0.3f ? 0.f : test::RandomFloat(-0.3f, 0.3f);
+	input.extendZ = test::RandomFloat(0.f, 1.f) < 0.3f ? 0.f : test::RandomFloat(-0.3f, 0.3f);
+	input.bRotateZ90 = test::RandomFloat(0.f, 1.f) < 0.5f;
+
+	return input;
+}
+
+static void CheckBatchMatchesScalar(int batchSize) {
+	std::vector<BatchInput> inputs;
+	std::vector<vr::DriverPose_t> batchPoses(batchSize);
+	std::vector<PosePublisher> publishers(batchSize);
+
+	PoseBatch *batch = new PoseBatch();
+	batch->Reset();
+
+	for (int i = 0; i < batchSize; ++i) {
+		inputs.push_back(RandomInput());
+
+		const BatchInput &input = inputs.back();
+		batch->Enqueue(input.rawPose, input.extendY, input.extendZ, input.bRotateZ90, (vr::TrackedDeviceIndex_t)(i + 1), &batchPoses[i], &publishers[i]);
+	}
+
+	batch->Flush();
+	CHECK(batch->GetPendingCount() == 0);
+
+	for (int i = 0; i < batchSize; ++i) {
+		const BatchInput &input = inputs[i];
+
+		vr::DriverPose_t reference = {};
+		PoseBatch::TransformPoseScalar(input.rawPose, input.extendY, input.extendZ, input.bRotateZ90, &reference);
+
+		const vr::DriverPose_t &pose = batchPoses[i];
+		bool bOk = true;
+		for (int axis = 0; axis < 3; ++axis) {
+			bOk &= CHECK_NEAR(pose.vecPosition[axis], reference.vecPosition[axis], k_positionToleranceMeters);
+		}
+		bOk &= CHECK_NEAR(pose.qRotation.w, reference.qRotation.w, k_orientationTolerance);
+		bOk &= CHECK_NEAR(pose.qRotation.x, reference.qRotation.x, k_orientationTolerance);
+		bOk &= CHECK_NEAR(pose.qRotation.y, reference.qRotation.y, k_orientationTolerance);
+		bOk &= CHECK_NEAR(pose.qRotation.z, reference.qRotation.z, k_orientationTolerance);
+
+		if (!bOk) {
+			fprintf(stderr, "  batch size %d, entry %d\n", batchSize, i);
+		}
+	}
+
+	delete batch;
+}
+
+TEST_CASE(single_pose) {
+	CheckBatchMatchesScalar(1);
+}
+
+TEST_CASE(scalar_tail_lengths) {
+	// 1 to 3 left over after zero, one and two full SSE registers
+	const int sizes[] = { 2, 3, 5, 6, 7, 9, 10, 11 };
+	for (int size : sizes) {
+		CheckBatchMatchesScalar(size);
+	}
+}
+
+TEST_CASE(full_sse_registers) {
+	const int sizes[] = { 4, 8, 16, 32 };
+	for (int size : sizes) {
+		CheckBatchMatchesScalar(size);
+	}
+}
+
+TEST_CASE(full_batch) {
+	CheckBatchMatchesScalar(PoseBatch::k_nMaxBatchSize);
+}
+
+TEST_CASE(overflowing_batch) {
+	// Entries past k_nMaxBatchSize are transformed and posted straight from Enqueue()
+	CheckBatchMatchesScalar(PoseBatch::k_nMaxBatchSize + 3);
+}
+
+TEST_CASE(many_random_batches) {
+	for (int iteration = 0; iteration < 200; ++iteration) {
+		CheckBatchMatchesScalar(1 + (int)test::RandomFloat(0.f, (float)PoseBatch::k_nMaxBatchSize - 0.01f));
+	}
+}
+
+TEST_CASE(posts_every_pose) {
+	const unsigned long long updatesBefore = stub::VRGetPoseUpdateCount();
+	CheckBatchMatchesScalar(7);
+	CHECK(stub::VRGetPoseUpdateCount() - updatesBefore == 7);
+}
@@ -0,0 +1,152 @@
+// PoseHistory prediction with and without physics, and which physics and validity the controllers record.
+
+#include "test_common.h"
+#include "driver_harness.h"
+#include "pose_history.h"
+#include "trackable_device.h"
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const PSMPosef k_identityPose = { { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f, 0.f } };
+
+static PSMPhysicsData MovingPhysics(float velocityX) {
+	PSMPhysicsData physics = {};
+	physics.LinearVelocityCmPerSec.x = velocityX;
+	physics.TimeInSeconds = 1.0;
+	return physics;
+}
+
+TEST_CASE(streamed_physics_needs_the_stream_flag) {
+	const PSMPhysicsData physics = MovingPhysics(100.f);
+
+	CHECK(GetStreamedPhysics(PSMStreamFlags_includePositionData, physics) == nullptr);
+	CHECK(GetStreamedPhysics(PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData, physics) == &physics);
+}
+
+TEST_CASE(streamed_physics_ignores_empty_data) {
+	const PSMPhysicsData physics = {};
+
+	CHECK(GetStreamedPhysics(PSMStreamFlags_includePositionData | PSMStreamFlags_includePhysicsData, physics) == nullptr);
+}
+
+TEST_CASE(extrapolates_from_physics) {
+	PoseHistory history;
+	const Clock::time_point t0 = Clock::now();
+	const PSMPhysicsData physics = MovingPhysics(100.f);
+
+	// Samples that don't move at all; only the physics says the device does
+	history.Push(k_identityPose, &physics, true, true, 1, t0);
+	history.Push(k_identityPose, &physics, true, true, 2, t0 + std::chrono::milliseconds(16));
+
+	PSMPosef predicted;
+	float unpredictedSecs;
+	CHECK(history.ExtrapolatePose(t0 + std::chrono::milliseconds(26), 0.1f, &predicted, &unpredictedSecs));
+	CHECK_NEAR(predicted.Position.x, 1.f, 1e-3);
+	CHECK_NEAR(unpredictedSecs, 0.f, 1e-6);
+}
+
+TEST_CASE(extrapolates_from_samples_without_physics) {
+	PoseHistory history;
+	const Clock::time_point t0 = Clock::now();
+
+	// 1 cm per 10 ms = 100 cm/s
+	PSMPosef pose = k_identityPose;
+	history.Push(pose, nullptr, true, true, 1, t0);
+	pose.Position.x = 1.f;
+	history.Push(pose, nullptr, true, true, 2, t0 + std::chrono::milliseconds(10));
+
+	PoseHistorySample latest;
+	CHECK(history.GetLatestSample(&latest));
+	CHECK(!latest.bHasPhysics);
+
+	PSMPosef predicted;
+	float unpredictedSecs;
+	CHECK(history.ExtrapolatePose(t0 + std::chrono::milliseconds(15), 0.1f, &predicted, &unpredictedSecs));
+	CHECK_NEAR(predicted.Position.x, 1.5f, 1e-3);
+}
+
+TEST_CASE(fallback_needs_two_samples) {
+	PoseHistory history;
+	history.Push(k_identityPose, nullptr, true, true, 1, Clock::now());
+
+	PSMPosef predicted;
+	float unpredictedSecs;
+	CHECK(!history.ExtrapolatePose(Clock::now(), 0.1f, &predicted, &unpredictedSecs));
+}
+
+TEST_CASE(fallback_needs_a_valid_previous_sample) {
+	PoseHistory history;
+	const Clock::time_point t0 = Clock::now();
+
+	// Motion toward a rejected sample isn't motion
+	PSMPosef pose = k_identityPose;
+	pose.Position.x = 100.f;
+	history.Push(pose, nullptr, false, true, 1, t0);
+	history.Push(k_identityPose, nullptr, true, true, 2, t0 + std::chrono::milliseconds(10));
+
+	PSMPosef predicted;
+	float unpredictedSecs;
+	CHECK(!history.ExtrapolatePose(t0 + std::chrono::milliseconds(15), 0.1f, &predicted, &unpredictedSecs));
+}
+
+static bool LatestSampleHasPhysics(const PSMPhysicsData &physics) {
+	test::DriverHarness harness;
+
+	PSMController *controller = stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:11:22:33:44:55");
+	controller->ControllerState.PSMoveState.bIsTrackingEnabled = true;
+	controller->ControllerState.PSMoveState.bIsCurrentlyTracking = true;
+	controller->ControllerState.PSMoveState.bIsPositionValid = true;
+	controller->ControllerState.PSMoveState.bIsOrientationValid = true;
+	controller->ControllerState.PSMoveState.Pose = k_identityPose;
+	controller->ControllerState.PSMoveState.PhysicsData = physics;
+
+	CHECK(harness.Start());
+	if (!CHECK(harness.RunUntilDeviceCount(1)))
+		return false;
+
+	stub::PSMPublishFrame(0);
+	harness.RunFrames(2);
+
+	const TrackableDevice *device = dynamic_cast<const TrackableDevice *>(stub::VRDevices()[0]);
+	PoseHistorySample latest = {};
+	CHECK(device != nullptr && device->GetPoseHistory().GetLatestSample(&latest));
+	return latest.bHasPhysics;
+}
+
+TEST_CASE(controller_records_streamed_physics) {
+	CHECK(LatestSampleHasPhysics(MovingPhysics(10.f)));
+}
+
+TEST_CASE(controller_drops_empty_physics) {
+	CHECK(!LatestSampleHasPhysics(PSMPhysicsData()));
+}
+
+TEST_CASE(controller_records_outliers_as_invalid) {
+	test::DriverHarness harness;
+
+	PSMController *controller = stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:11:22:33:44:55");
+	PSMPSMove &view = controller->ControllerState.PSMoveState;
+	view.bIsTrackingEnabled = view.bIsCurrentlyTracking = true;
+	view.bIsPositionValid = view.bIsOrientationValid = true;
+	view.Pose = k_identityPose;
+
+	CHECK(harness.Start());
+	if (!CHECK(harness.RunUntilDeviceCount(1)))
+		return;
+
+	stub::PSMPublishFrame(0);
+	harness.RunFrames(2);
+
+	// PSMoveService reports a valid position 10m away a frame later
+	view.Pose.Position.x = 1000.f;
+	stub::PSMPublishFrame(0);
+	harness.RunFrames(1);
+
+	const TrackableDevice *device = dynamic_cast<const TrackableDevice *>(stub::VRDevices()[0]);
+	PoseHistorySample latest = {};
+	CHECK(device != nullptr && device->GetPoseHistory().GetLatestSample(&latest));
+	CHECK(!latest.bIsPositionValid);
+	CHECK(latest.bIsOrientationValid);
+}
@@ -0,0 +1,99 @@
+// PoseOutlierGate on a fast but real hand swing sampled at 60Hz and picked up by 90Hz and 120Hz
+// driver frames, plus a real tracking glitch.
+
+#include "test_common.h"
+#include "pose_outlier_gate.h"
+#include "settings_util.h"
+
+using namespace steamvrbridge;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const float k_fSampleRate = 60.f;
+
+// x(t) = A sin(wt) peaks at A*w = 4 m/s and A*w^2 = 40 m/s^2, a fast swing well inside the limits
+static const float k_fSwingAmplitudeCm = 40.f;
+static const float k_fSwingRadPerSec = 10.f;
+
+static ServerDriverConfig GateConfig(float maxAcceleration) {
+	ServerDriverConfig config;
+	config.outlier_max_speed_meters_per_sec = 15.f;
+	config.outlier_max_acceleration_meters_per_sec_sqr = maxAcceleration;
+	return config;
+}
+
+// Runs driver frames at frameRate for two seconds. Each frame passes the newest 60Hz sample to the
+// gate if it hasn't seen it yet, like the controllers do. Returns the number of rejected samples.
+static int RunSwing(float frameRate, float gateSampleRate, const ServerDriverConfig &config) {
+	PoseOutlierGate gate;
+	const Clock::time_point start = Clock::now();
+
+	int lastSequenceNum = -1;
+	for (int frame = 0; frame < (int)(2.f * frameRate); ++frame) {
+		const double frameSecs = frame / (double)frameRate;
+		const int sequenceNum = (int)(frameSecs * k_fSampleRate + 1e-6);
+		if (sequenceNum == lastSequenceNum)
+			continue;
+		lastSequenceNum = sequenceNum;
+
+		const float sampleSecs = sequenceNum / k_fSampleRate;
+		const PSMVector3f position = { k_fSwingAmplitudeCm * sinf(k_fSwingRadPerSec * sampleSecs), 100.f, 0.f };
+		const Clock::time_point now = start + std::chrono::microseconds((long long)(frameSecs * 1e6));
+
+		gate.Accept(position, sequenceNum, gateSampleRate, now, config);
+	}
+
+	return gate.GetRejectedSampleCount();
+}
+
+TEST_CASE(acceleration_check_is_off_by_default) {
+	const ServerDriverConfig config;
+	CHECK(config.outlier_max_acceleration_meters_per_sec_sqr == 0.f);
+}
+
+TEST_CASE(fast_swing_passes_at_90hz_frames) {
+	CHECK(RunSwing(90.f, k_fSampleRate, GateConfig(250.f)) == 0);
+}
+
+TEST_CASE(fast_swing_passes_at_120hz_frames) {
+	CHECK(RunSwing(120.f, k_fSampleRate, GateConfig(250.f)) == 0);
+}
+
+TEST_CASE(arrival_time_jitter_rejects_the_same_swing) {
+	// What the gate did before it used the sample cadence: 60Hz samples picked up by 90Hz frames
+	// arrive 11 or 22 ms apart, which doubles or halves the apparent speed from one sample to the next
+	CHECK(RunSwing(90.f, 0.f, GateConfig(250.f)) > 0);
+}
+
+TEST_CASE(single_sample_jump_is_rejected) {
+	const ServerDriverConfig config = GateConfig(0.f);
+	PoseOutlierGate gate;
+	const Clock::time_point start = Clock::now();
+
+	for (int sequenceNum = 0; sequenceNum < 10; ++sequenceNum) {
+		// The wrong blob for one sample, 1m away
+		const float x = sequenceNum == 5 ? 100.f : 0.f;
+		const PSMVector3f position = { x, 100.f, 0.f };
+		const Clock::time_point now = start + std::chrono::milliseconds(sequenceNum * 16);
+
+		const bool bAccepted = gate.Accept(position, sequenceNum, k_fSampleRate, now, config);
+		CHECK(bAccepted == (sequenceNum != 5));
+	}
+
+	CHECK(gate.GetRejectedSampleCount() == 1);
+}
+
+TEST_CASE(skipped_samples_widen_the_interval) {
+	const ServerDriverConfig config = GateConfig(0.f);
+	PoseOutlierGate gate;
+	const Clock::time_point start = Clock::now();
+
+	// 10cm in 5 samples (83ms) is 1.2m/s; judged as one sample apart it would be 6m/s, and a
+	// single frame apart at 90Hz it would be 9m/s. Both are fine, 30cm in one 60Hz sample is not.
+	const PSMVector3f first = { 0.f, 100.f, 0.f };
+	const PSMVector3f later = { 10.f, 100.f, 0.f };
+	const PSMVector3f jump = { 40.f, 100.f, 0.f };
+	CHECK(gate.Accept(first, 10, k_fSampleRate, start, config));
+	CHECK(gate.Accept(later, 15, k_fSampleRate, start + std::chrono::milliseconds(11), config));
+	CHECK(!gate.Accept(jump, 16, k_fSampleRate, start + std::chrono::milliseconds(22), config));
+}
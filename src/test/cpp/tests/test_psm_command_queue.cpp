@@ -0,0 +1,177 @@
+// PSMCommandQueue coalescing and flush order, read back from the calls the stub PSMoveService got.
+
+#include "test_common.h"
+#include "psm_command_queue.h"
+#include "stub_psmoveservice.h"
+
+using namespace steamvrbridge;
+
+static const PSMQuatf k_resetOrientation = { 0.f, 1.f, 0.f, 0.f };
+
+// Two controllers the stream commands can be sent to, and an empty command log
+static void ResetService() {
+	stub::PSMReset();
+	stub::PSMAddController(0, PSMController_Move, PSMControllerHand_Right, "00:00:00:00:00:01");
+	stub::PSMAddController(1, PSMController_DualShock4, PSMControllerHand_Left, "00:00:00:00:00:02");
+}
+
+static bool IsRumble(const stub::PSMCommand &command, PSMControllerID controllerId, PSMControllerRumbleChannel channel, float rumbleFraction) {
+	return command.type == stub::PSMCommand_Rumble && command.controllerId == controllerId &&
+		command.channel == channel && command.rumbleFraction == rumbleFraction;
+}
+
+TEST_CASE(sends_immediately_outside_a_frame) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.5f);
+	CHECK(stub::PSMCommandLog().size() == 1);
+	queue.ResetControllerOrientation(0, k_resetOrientation);
+	CHECK(stub::PSMCommandLog().size() == 2);
+	queue.StartControllerDataStream(0, PSMStreamFlags_includePositionData, nullptr, nullptr);
+	CHECK(stub::PSMCommandLog().size() == 3);
+	queue.StopControllerDataStream(0);
+	CHECK(stub::PSMCommandLog().size() == 4);
+
+	// Back to immediate once a frame has been flushed
+	queue.BeginFrame();
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.25f);
+	CHECK(stub::PSMCommandLog().size() == 4);
+	queue.Flush();
+	CHECK(stub::PSMCommandLog().size() == 5);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.f);
+	CHECK(stub::PSMCommandLog().size() == 6);
+}
+
+TEST_CASE(keeps_the_newest_rumble_per_channel) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Left, 0.1f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Right, 0.2f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Left, 0.7f);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 2))
+		return;
+	CHECK(IsRumble(log[0], 0, PSMControllerRumbleChannel_Left, 0.7f));
+	CHECK(IsRumble(log[1], 0, PSMControllerRumbleChannel_Right, 0.2f));
+}
+
+TEST_CASE(all_overrides_queued_left_and_right) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Left, 0.3f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Right, 0.4f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.5f);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 1))
+		return;
+	CHECK(IsRumble(log[0], 0, PSMControllerRumbleChannel_All, 0.5f));
+}
+
+TEST_CASE(single_channel_after_all_has_the_final_say) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.5f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Right, 0.f);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 2))
+		return;
+	CHECK(IsRumble(log[0], 0, PSMControllerRumbleChannel_All, 0.5f));
+	CHECK(IsRumble(log[1], 0, PSMControllerRumbleChannel_Right, 0.f));
+}
+
+TEST_CASE(stop_drops_a_queued_start) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.StartControllerDataStream(0, PSMStreamFlags_includePositionData, nullptr, nullptr);
+	queue.StopControllerDataStream(0);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 1))
+		return;
+	CHECK(log[0].type == stub::PSMCommand_StopStream && log[0].controllerId == 0);
+	CHECK(stub::PSMGetStreamFlags(0) == -1);
+}
+
+TEST_CASE(start_after_stop_wins) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.StopControllerDataStream(0);
+	queue.StartControllerDataStream(0, PSMStreamFlags_includePhysicsData, nullptr, nullptr);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 1))
+		return;
+	CHECK(log[0].type == stub::PSMCommand_StartStream && log[0].streamFlags == PSMStreamFlags_includePhysicsData);
+}
+
+TEST_CASE(keeps_the_newest_orientation_reset) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.ResetControllerOrientation(0, *k_psm_quaternion_identity);
+	queue.ResetControllerOrientation(0, k_resetOrientation);
+	queue.Flush();
+
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 1))
+		return;
+	CHECK(log[0].type == stub::PSMCommand_ResetOrientation && log[0].orientation.x == 1.f);
+}
+
+TEST_CASE(flushes_controllers_in_order_and_commands_by_kind) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	// Controller 1 is queued first; controller 0's commands are queued in the reverse of their flush order
+	queue.BeginFrame();
+	queue.StopControllerDataStream(1);
+	queue.SetControllerRumble(1, PSMControllerRumbleChannel_Left, 0.6f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_Right, 0.3f);
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.9f);
+	queue.ResetControllerOrientation(0, k_resetOrientation);
+	queue.StartControllerDataStream(0, PSMStreamFlags_includePositionData, nullptr, nullptr);
+	queue.Flush();
+
+	// Per controller: stream start, orientation reset, both channels, single channels, stream stop
+	const std::vector<stub::PSMCommand> &log = stub::PSMCommandLog();
+	if (!CHECK(log.size() == 5))
+		return;
+	CHECK(IsRumble(log[0], 1, PSMControllerRumbleChannel_Left, 0.6f));
+	CHECK(log[1].type == stub::PSMCommand_StopStream && log[1].controllerId == 1);
+	CHECK(log[2].type == stub::PSMCommand_StartStream && log[2].controllerId == 0);
+	CHECK(log[3].type == stub::PSMCommand_ResetOrientation && log[3].controllerId == 0);
+	CHECK(IsRumble(log[4], 0, PSMControllerRumbleChannel_All, 0.9f));
+}
+
+TEST_CASE(clear_drops_the_frame) {
+	ResetService();
+	PSMCommandQueue queue;
+
+	queue.BeginFrame();
+	queue.SetControllerRumble(0, PSMControllerRumbleChannel_All, 0.5f);
+	queue.StartControllerDataStream(0, PSMStreamFlags_includePositionData, nullptr, nullptr);
+	queue.Clear();
+	queue.Flush();
+
+	CHECK(stub::PSMCommandLog().empty());
+}
@@ -0,0 +1,185 @@
+// PSMMath against the PSM_* C API it stands in for (stub_client_geometry.cpp ports the service's
+// implementation). Results may differ by rounding only, since the rotation is evaluated differently.
+
+#include "test_common.h"
+#include "psm_math.h"
+
+using namespace steamvrbridge;
+
+static const int k_nRandomCount = 1000;
+
+// Everything that doesn't need sqrt or trig has to stay usable in constant expressions
+static_assert(PSMMath::Vector3fDot(PSMMath::Vector3fCross(PSMVector3f{ 1.f, 0.f, 0.f }, PSMVector3f{ 0.f, 1.f, 0.f }), PSMVector3f{ 0.f, 0.f, 1.f }) == 1.f,
+	"PSMMath vector helpers must be constexpr");
+static_assert(PSMMath::PosefTransformPoint(PSMPosef{ { 1.f, 2.f, 3.f }, { 1.f, 0.f, 0.f, 0.f } }, PSMVector3f{ 1.f, 1.f, 1.f }).z == 4.f,
+	"PSMMath pose helpers must be constexpr");
+
+static PSMVector3f RandomVector(float range) {
+	return PSMVector3f{ test::RandomFloat(-range, range), test::RandomFloat(-range, range), test::RandomFloat(-range, range) };
+}
+
+static PSMQuatf RandomRotation() {
+	PSMQuatf q;
+	float lengthSqr;
+	do {
+		q = PSMQuatf{ test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f), test::RandomFloat(-1.f, 1.f) };
+		lengthSqr = q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z;
+	} while (lengthSqr < 0.01f || lengthSqr > 1.f);
+
+	return PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity);
+}
+
+static PSMPosef RandomPose() {
+	return PSMPosef{ RandomVector(5.f), RandomRotation() };
+}
+
+static bool CheckVectorNear(const PSMVector3f &actual, const PSMVector3f &expected, float tolerance) {
+	return CHECK_NEAR(actual.x, expected.x, tolerance)
+		&& CHECK_NEAR(actual.y, expected.y, tolerance)
+		&& CHECK_NEAR(actual.z, expected.z, tolerance);
+}
+
+static bool CheckQuatNear(const PSMQuatf &actual, const PSMQuatf &expected, float tolerance) {
+	return CHECK_NEAR(actual.w, expected.w, tolerance)
+		&& CHECK_NEAR(actual.x, expected.x, tolerance)
+		&& CHECK_NEAR(actual.y, expected.y, tolerance)
+		&& CHECK_NEAR(actual.z, expected.z, tolerance);
+}
+
+TEST_CASE(vector_arithmetic_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMVector3f a = RandomVector(10.f);
+		const PSMVector3f b = RandomVector(10.f);
+		const float s = test::RandomFloat(-4.f, 4.f);
+
+		if (!CheckVectorNear(PSMMath::Vector3fAdd(a, b), PSM_Vector3fAdd(&a, &b), 0.f)
+			|| !CheckVectorNear(PSMMath::Vector3fSubtract(a, b), PSM_Vector3fSubtract(&a, &b), 0.f)
+			|| !CheckVectorNear(PSMMath::Vector3fScale(a, s), PSM_Vector3fScale(&a, s), 0.f)
+			|| !CheckVectorNear(PSMMath::Vector3fScaleAndAdd(a, s, b), PSM_Vector3fScaleAndAdd(&a, s, &b), 1e-5f)
+			|| !CheckVectorNear(PSMMath::Vector3fCross(a, b), PSM_Vector3fCross(&a, &b), 1e-4f)
+			|| !CHECK_NEAR(PSMMath::Vector3fDot(a, b), PSM_Vector3fDot(&a, &b), 1e-4f)
+			|| !CHECK_NEAR(PSMMath::Vector3fLength(a), PSM_Vector3fLength(&a), 1e-5f))
+			return;
+	}
+}
+
+TEST_CASE(vector_normalize_matches_capi) {
+	const PSMVector3f fallback = { 0.f, 0.f, -1.f };
+
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMVector3f v = RandomVector(10.f);
+		if (!CheckVectorNear(PSMMath::Vector3fNormalizeWithDefault(v, fallback), PSM_Vector3fNormalizeWithDefault(&v, &fallback), 1e-6f))
+			return;
+	}
+
+	// Both sides of the zero length threshold
+	const float lengths[] = { 0.f, 1e-8f, FLT_EPSILON, 2.f*FLT_EPSILON, 1e-6f, 1e-3f };
+	for (float length : lengths) {
+		const PSMVector3f v = { length, 0.f, 0.f };
+		CheckVectorNear(PSMMath::Vector3fNormalizeWithDefault(v, fallback), PSM_Vector3fNormalizeWithDefault(&v, &fallback), 1e-6f);
+	}
+}
+
+TEST_CASE(quat_create_from_angles_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMVector3f angles = RandomVector(3.14159265f);
+		if (!CheckQuatNear(PSMMath::QuatfCreateFromAngles(angles), PSM_QuatfCreateFromAngles(&angles), 1e-6f))
+			return;
+	}
+}
+
+TEST_CASE(quat_concat_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMQuatf a = RandomRotation();
+		const PSMQuatf b = RandomRotation();
+
+		if (!CheckQuatNear(PSMMath::QuatfMultiply(a, b), PSM_QuatfMultiply(&a, &b), 1e-6f)
+			|| !CheckQuatNear(PSMMath::QuatfConcat(a, b), PSM_QuatfConcat(&a, &b), 1e-6f))
+			return;
+	}
+}
+
+TEST_CASE(quat_rotate_vector_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMQuatf q = RandomRotation();
+		const PSMVector3f v = RandomVector(10.f);
+
+		if (!CheckVectorNear(PSMMath::QuatfRotateVector(q, v), PSM_QuatfRotateVector(&q, &v), 1e-5f))
+			return;
+	}
+
+	// Axis aligned half turns, where the two evaluations round differently
+	const PSMQuatf halfTurns[] = { { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 1.f } };
+	const PSMVector3f v = { 1.f, 2.f, 3.f };
+	for (const PSMQuatf &q : halfTurns) {
+		CheckVectorNear(PSMMath::QuatfRotateVector(q, v), PSM_QuatfRotateVector(&q, &v), 1e-6f);
+	}
+}
+
+TEST_CASE(quat_conjugate_is_capi_inverse) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMQuatf q = RandomRotation();
+		if (!CheckQuatNear(PSMMath::QuatfConjugate(q), PSM_QuatfInverse(&q), 1e-6f))
+			return;
+	}
+}
+
+TEST_CASE(quat_normalize_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMQuatf q = { test::RandomFloat(-2.f, 2.f), test::RandomFloat(-2.f, 2.f), test::RandomFloat(-2.f, 2.f), test::RandomFloat(-2.f, 2.f) };
+		if (!CheckQuatNear(PSMMath::QuatfNormalizeWithDefault(q, *k_psm_quaternion_identity), PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity), 1e-6f))
+			return;
+	}
+
+	const float lengths[] = { 0.f, 1e-8f, FLT_EPSILON, 2.f*FLT_EPSILON, 1e-6f, 1e-3f };
+	for (float length : lengths) {
+		const PSMQuatf q = { 0.f, 0.f, length, 0.f };
+		CheckQuatNear(PSMMath::QuatfNormalizeWithDefault(q, *k_psm_quaternion_identity), PSM_QuatfNormalizeWithDefault(&q, k_psm_quaternion_identity), 1e-6f);
+	}
+}
+
+TEST_CASE(pose_concat_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMPosef first = RandomPose();
+		const PSMPosef second = RandomPose();
+		const PSMPosef actual = PSMMath::PosefConcat(first, second);
+		const PSMPosef expected = PSM_PosefConcat(&first, &second);
+
+		if (!CheckVectorNear(actual.Position, expected.Position, 1e-5f)
+			|| !CheckQuatNear(actual.Orientation, expected.Orientation, 1e-6f))
+			return;
+	}
+}
+
+TEST_CASE(pose_inverse_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMPosef pose = RandomPose();
+		const PSMPosef actual = PSMMath::PosefInverse(pose);
+		const PSMPosef expected = PSM_PosefInverse(&pose);
+
+		if (!CheckVectorNear(actual.Position, expected.Position, 1e-5f)
+			|| !CheckQuatNear(actual.Orientation, expected.Orientation, 0.f))
+			return;
+
+		// And it really undoes the pose
+		const PSMPosef identity = PSMMath::PosefConcat(pose, actual);
+		if (!CheckVectorNear(identity.Position, PSMVector3f{ 0.f, 0.f, 0.f }, 1e-5f)
+			|| !CHECK_NEAR(fabsf(identity.Orientation.w), 1.f, 1e-6f))
+			return;
+	}
+}
+
+TEST_CASE(pose_transform_point_matches_capi) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const PSMPosef pose = RandomPose();
+		const PSMVector3f p = RandomVector(5.f);
+
+		if (!CheckVectorNear(PSMMath::PosefTransformPoint(pose, p), PSM_PosefTransformPoint(&pose, &p), 1e-5f)
+			|| !CheckVectorNear(PSMMath::PosefInverseTransformPoint(pose, p), PSM_PosefInverseTransformPoint(&pose, &p), 1e-5f))
+			return;
+
+		const PSMVector3f roundTrip = PSMMath::PosefInverseTransformPoint(pose, PSMMath::PosefTransformPoint(pose, p));
+		if (!CheckVectorNear(roundTrip, p, 1e-5f))
+			return;
+	}
+}
@@ -0,0 +1,324 @@
+// The branch-free matrix to quaternion conversion and yaw extraction in Utils, against the legacy
+// branchy versions (legacy_rotation.h) and against double precision ground truth. The interesting
+// inputs are rotations near 180 degrees, where the matrix trace approaches -1 and acos loses its
+// precision, and pitches of +/-90 degrees (gimbal lock).
+
+#include "test_common.h"
+#include "legacy_rotation.h"
+#include "utils.h"
+
+using namespace steamvrbridge;
+
+static const int k_nRandomCount = 2000;
+static const double k_pi = 3.14159265358979323846;
+
+// A handful of float roundings on unit length values
+static const double k_tolerance = 2e-6;
+
+// acos near +/-1 only keeps about half the float mantissa
+static const double k_legacyYawTolerance = 1e-3;
+
+struct QuatD {
+	double w, x, y, z;
+};
+
+static QuatD ToDouble(const PSMQuatf &q) {
+	return QuatD{ q.w, q.x, q.y, q.z };
+}
+
+static QuatD AxisAngle(double x, double y, double z, double angle) {
+	const double length = sqrt(x*x + y*y + z*z);
+	const double s = sin(0.5*angle) / length;
+	return QuatD{ cos(0.5*angle), x*s, y*s, z*s };
+}
+
+// Hamilton product a*b: b first, then a
+static QuatD Multiply(const QuatD &a, const QuatD &b) {
+	return QuatD{
+		a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+		a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+		a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+		a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w };
+}
+
+static PSMQuatf ToFloat(const QuatD &q) {
+	return PSMQuatf{ (float)q.w, (float)q.x, (float)q.y, (float)q.z };
+}
+
+static QuatD RandomRotation() {
+	double w, x, y, z, lengthSqr;
+	do {
+		w = test::RandomFloat(-1.f, 1.f);
+		x = test::RandomFloat(-1.f, 1.f);
+		y = test::RandomFloat(-1.f, 1.f);
+		z = test::RandomFloat(-1.f, 1.f);
+		lengthSqr = w*w + x*x + y*y + z*z;
+	} while (lengthSqr < 0.01 || lengthSqr > 1.0);
+
+	const double inv_length = 1.0 / sqrt(lengthSqr);
+	return QuatD{ w*inv_length, x*inv_length, y*inv_length, z*inv_length };
+}
+
+// Rotation matrix of a unit quaternion, r[i] is row i
+static void RotationRows(const QuatD &q, double r[3][3]) {
+	r[0][0] = 1.0 - 2.0*(q.y*q.y + q.z*q.z); r[0][1] = 2.0*(q.x*q.y - q.w*q.z); r[0][2] = 2.0*(q.x*q.z + q.w*q.y);
+	r[1][0] = 2.0*(q.x*q.y + q.w*q.z); r[1][1] = 1.0 - 2.0*(q.x*q.x + q.z*q.z); r[1][2] = 2.0*(q.y*q.z - q.w*q.x);
+	r[2][0] = 2.0*(q.x*q.z - q.w*q.y); r[2][1] = 2.0*(q.y*q.z + q.w*q.x); r[2][2] = 1.0 - 2.0*(q.x*q.x + q.y*q.y);
+}
+
+static vr::HmdMatrix34_t OpenVRMatrix(const QuatD &q) {
+	double r[3][3];
+	RotationRows(q, r);
+
+	vr::HmdMatrix34_t m;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			m.m[i][j] = (float)r[i][j];
+		}
+		m.m[i][3] = 0.5f * i;
+	}
+	return m;
+}
+
+// PSM matrices hold the basis vectors, so m[i] is column i
+static PSMMatrix3f PSMMatrix(const QuatD &q) {
+	double r[3][3];
+	RotationRows(q, r);
+
+	PSMMatrix3f m;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			m.m[i][j] = (float)r[j][i];
+		}
+	}
+	return m;
+}
+
+// q and -q are the same rotation
+static bool CheckSameRotation(const PSMQuatf &actual, const QuatD &expected, double tolerance) {
+	const double dot = actual.w*expected.w + actual.x*expected.x + actual.y*expected.y + actual.z*expected.z;
+	const double sign = dot < 0.0 ? -1.0 : 1.0;
+
+	return CHECK_NEAR(actual.w, sign*expected.w, tolerance)
+		&& CHECK_NEAR(actual.x, sign*expected.x, tolerance)
+		&& CHECK_NEAR(actual.y, sign*expected.y, tolerance)
+		&& CHECK_NEAR(actual.z, sign*expected.z, tolerance);
+}
+
+static bool CheckQuatNear(const PSMQuatf &actual, const QuatD &expected, double tolerance) {
+	return CHECK_NEAR(actual.w, expected.w, tolerance)
+		&& CHECK_NEAR(actual.x, expected.x, tolerance)
+		&& CHECK_NEAR(actual.y, expected.y, tolerance)
+		&& CHECK_NEAR(actual.z, expected.z, tolerance);
+}
+
+// Both conversions for one rotation, against the ground truth and with the sign fixed to w >= 0
+static bool CheckConversions(const QuatD &q) {
+	const PSMQuatf fromOpenVR = Utils::openvrMatrixExtractPSMQuatf(OpenVRMatrix(q));
+	const PSMQuatf fromPSM = Utils::psmMatrix3fToPSMQuatf(PSMMatrix(q));
+
+	return CheckSameRotation(fromOpenVR, q, k_tolerance)
+		&& CheckSameRotation(fromPSM, q, k_tolerance)
+		&& CHECK(fromOpenVR.w >= 0.f)
+		&& CHECK(fromPSM.w >= 0.f);
+}
+
+static QuatD YawAboutY(double yaw) {
+	return QuatD{ cos(0.5*yaw), 0.0, sin(0.5*yaw), 0.0 };
+}
+
+// Pitch 90 up first, then the yaw
+static QuatD PSMoveYaw(double yaw) {
+	return Multiply(YawAboutY(yaw), AxisAngle(1, 0, 0, 0.5*k_pi));
+}
+
+// Length of the horizontal part of a basis column, below which the heading it gives is ill conditioned
+static double HorizontalLength(const QuatD &q, int column) {
+	double r[3][3];
+	RotationRows(q, r);
+	return sqrt(r[0][column]*r[0][column] + r[2][column]*r[2][column]);
+}
+
+// Ground truth for the HMD yaw in double precision: the heading of the z-axis projected onto the floor
+static QuatD HMDYawTruth(const QuatD &q) {
+	double r[3][3];
+	RotationRows(q, r);
+	return YawAboutY(atan2(r[0][2], r[2][2]));
+}
+
+// Ground truth for the PSMove yaw: the heading of the y-axis from the global forward (negative z-axis)
+static QuatD PSMoveYawTruth(const QuatD &q) {
+	double r[3][3];
+	RotationRows(q, r);
+	return PSMoveYaw(atan2(-r[0][1], -r[2][1]));
+}
+
+//-- Matrix to quaternion --
+TEST_CASE(matrix_conversion_matches_ground_truth) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		if (!CheckConversions(RandomRotation()))
+			return;
+	}
+}
+
+TEST_CASE(matrix_conversion_agrees_with_legacy) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const QuatD q = RandomRotation();
+		const vr::HmdMatrix34_t openVRMatrix = OpenVRMatrix(q);
+
+		const PSMQuatf legacyQuat = legacy::openvrMatrixExtractPSMQuatf(openVRMatrix);
+		if (!CheckSameRotation(Utils::openvrMatrixExtractPSMQuatf(openVRMatrix), ToDouble(legacyQuat), k_tolerance))
+			return;
+	}
+}
+
+TEST_CASE(matrix_conversion_with_trace_near_minus_one) {
+	// Half turns and rotations just short of them, about random and axis aligned axes: the w pivot
+	// vanishes and one of the x, y, z pivots has to take over
+	const double epsilons[] = { 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 0.0 };
+	const double axes[][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 1, 0 }, { 0, 1, -1 }, { 1, 1, 1 } };
+
+	for (double epsilon : epsilons) {
+		for (const double *axis : axes) {
+			if (!CheckConversions(AxisAngle(axis[0], axis[1], axis[2], k_pi - epsilon))
+				|| !CheckConversions(AxisAngle(axis[0], axis[1], axis[2], -(k_pi - epsilon))))
+				return;
+		}
+
+		for (int i = 0; i < 100; ++i) {
+			const QuatD axis = RandomRotation();
+			if (!CheckConversions(AxisAngle(axis.x, axis.y, axis.z, k_pi - epsilon)))
+				return;
+		}
+	}
+}
+
+TEST_CASE(matrix_conversion_at_gimbal_lock) {
+	// Attitude of +/-90 degrees, where heading and bank turn about the same axis
+	for (int i = 0; i < 200; ++i) {
+		const float heading = test::RandomFloat(-3.14159265f, 3.14159265f);
+		const float bank = test::RandomFloat(-3.14159265f, 3.14159265f);
+
+		for (float attitude : { 1.57079633f, -1.57079633f }) {
+			const PSMVector3f angles = { bank, heading, attitude };
+			if (!CheckConversions(ToDouble(PSM_QuatfCreateFromAngles(&angles))))
+				return;
+		}
+	}
+}
+
+TEST_CASE(matrix_conversion_of_identity_and_zero) {
+	CheckConversions(QuatD{ 1.0, 0.0, 0.0, 0.0 });
+
+	// Not a rotation, but must not produce NaNs
+	PSMMatrix3f zero = {};
+	const PSMQuatf q = Utils::psmMatrix3fToPSMQuatf(zero);
+	CHECK(q.w == 1.f && q.x == 0.f && q.y == 0.f && q.z == 0.f);
+}
+
+//-- Yaw extraction --
+TEST_CASE(hmd_yaw_matches_ground_truth) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const QuatD q = RandomRotation();
+		if (HorizontalLength(q, 2) < 0.05)
+			continue;
+
+		if (!CheckQuatNear(Utils::ExtractHMDYawQuaternion(ToFloat(q)), HMDYawTruth(q), k_tolerance))
+			return;
+	}
+}
+
+TEST_CASE(psmove_yaw_matches_ground_truth) {
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const QuatD q = RandomRotation();
+		if (HorizontalLength(q, 1) < 0.05)
+			continue;
+
+		if (!CheckQuatNear(Utils::ExtractPSMoveYawQuaternion(ToFloat(q)), PSMoveYawTruth(q), k_tolerance))
+			return;
+	}
+}
+
+TEST_CASE(yaw_agrees_with_legacy_when_level) {
+	// With the forward axis level the projected and the unprojected forward give the same yaw. Any roll
+	// about the forward axis is allowed.
+	for (int i = 0; i < k_nRandomCount; ++i) {
+		const QuatD heading = YawAboutY(test::RandomFloat(-3.14159265f, 3.14159265f));
+
+		const QuatD hmd = Multiply(heading, AxisAngle(0, 0, 1, test::RandomFloat(-3.14159265f, 3.14159265f)));
+		if (!CheckQuatNear(Utils::ExtractHMDYawQuaternion(ToFloat(hmd)), ToDouble(legacy::ExtractHMDYawQuaternion(ToFloat(hmd))), k_legacyYawTolerance))
+			return;
+
+		// A level PSMove points its y-axis along the global forward
+		const QuatD psmove = Multiply(heading, Multiply(AxisAngle(1, 0, 0, -0.5*k_pi), AxisAngle(0, 1, 0, test::RandomFloat(-3.14159265f, 3.14159265f))));
+		if (!CheckQuatNear(Utils::ExtractPSMoveYawQuaternion(ToFloat(psmove)), ToDouble(legacy::ExtractPSMoveYawQuaternion(ToFloat(psmove))), k_legacyYawTolerance))
+			return;
+	}
+}
+
+TEST_CASE(yaw_ignores_pitch) {
+	// Looking up or down, or pointing the controller up or down, doesn't turn the body. The unprojected
+	// forward vector overstated the yaw by up to the pitch angle here.
+	const double pitches[] = { -1.5, -1.0, -0.5, -0.1, 0.1, 0.5, 1.0, 1.5 };
+
+	for (int i = 0; i < 100; ++i) {
+		const double yaw = test::RandomFloat(-3.14159265f, 3.14159265f);
+
+		for (double pitch : pitches) {
+			const QuatD hmd = Multiply(YawAboutY(yaw), AxisAngle(1, 0, 0, pitch));
+			if (!CheckQuatNear(Utils::ExtractHMDYawQuaternion(ToFloat(hmd)), YawAboutY(yaw), k_tolerance))
+				return;
+
+			const QuatD psmove = Multiply(YawAboutY(yaw), AxisAngle(1, 0, 0, pitch - 0.5*k_pi));
+			if (!CheckQuatNear(Utils::ExtractPSMoveYawQuaternion(ToFloat(psmove)), PSMoveYaw(yaw), k_tolerance))
+				return;
+		}
+	}
+}
+
+TEST_CASE(yaw_near_half_turn) {
+	// Facing backwards, where the half-angle vector of the heading cancels
+	const double epsilons[] = { 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 0.0 };
+
+	for (double epsilon : epsilons) {
+		for (double sign : { 1.0, -1.0 }) {
+			const QuatD hmd = Multiply(YawAboutY(sign*(k_pi - epsilon)), AxisAngle(1, 0, 0, 0.3));
+			if (!CheckQuatNear(Utils::ExtractHMDYawQuaternion(ToFloat(hmd)), HMDYawTruth(hmd), k_tolerance))
+				return;
+
+			// PSMove pointing backwards along +Z
+			const QuatD psmove = Multiply(YawAboutY(sign*(k_pi - epsilon)), AxisAngle(1, 0, 0, -0.5*k_pi + 0.3));
+			if (!CheckQuatNear(Utils::ExtractPSMoveYawQuaternion(ToFloat(psmove)), PSMoveYawTruth(psmove), k_tolerance))
+				return;
+		}
+	}
+}
+
+TEST_CASE(yaw_at_gimbal_lock) {
+	// With the forward axis vertical the heading comes from the adjacent axis, and continues the heading
+	// the device had on its way up or down
+	for (int i = 0; i < 100; ++i) {
+		const double yaw = test::RandomFloat(-3.14159265f, 3.14159265f);
+
+		for (double pitch : { 0.5*k_pi, -0.5*k_pi }) {
+			// Exactly vertical, and just short of the fallback threshold from both sides
+			for (double offset : { 0.0, 1e-4, -1e-4, 2e-3, -2e-3 }) {
+				const QuatD hmd = Multiply(YawAboutY(yaw), AxisAngle(1, 0, 0, pitch + offset));
+				const QuatD psmove = Multiply(YawAboutY(yaw), AxisAngle(1, 0, 0, pitch - 0.5*k_pi + offset));
+
+				// Past vertical the device is upside down and faces the other way, once the forward axis
+				// leaves the ~1e-3 rad cone where the fallback axis supplies the heading
+				const bool bIsPastVertical = fabs(pitch + offset) > 0.5*k_pi + 1e-3;
+				const double expectedYaw = bIsPastVertical ? yaw + k_pi : yaw;
+				const QuatD expectedHMD = YawAboutY(expectedYaw);
+				const QuatD expectedPSMove = PSMoveYaw(expectedYaw);
+
+				// Close to vertical the float forward vector has little horizontal length left to read
+				// the heading from
+				if (!CheckSameRotation(Utils::ExtractHMDYawQuaternion(ToFloat(hmd)), expectedHMD, 1e-3)
+					|| !CheckSameRotation(Utils::ExtractPSMoveYawQuaternion(ToFloat(psmove)), expectedPSMove, 1e-3))
+					return;
+			}
+		}
+	}
+}
@@ -0,0 +1,91 @@
+// TraceLog files decoded by the real trace_decoder: every argument type round trips, and a call site
+// whose format record was dropped never leaves events behind that can't be decoded.
+
+#include "test_common.h"
+#include "trace_log.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace steamvrbridge;
+
+static const std::string k_tracePath = std::string(TRACE_TEST_DIR) + "/test_trace_log.trace";
+
+// The decoder's output, without the timestamps in front of the events
+static std::vector<std::string> DecodeTrace() {
+	std::vector<std::string> lines;
+
+	const std::string command = std::string("\"") + TRACE_DECODER_PATH + "\" \"" + k_tracePath + "\"";
+	FILE *pipe = popen(command.c_str(), "r");
+	if (!CHECK(pipe != nullptr))
+		return lines;
+
+	char buffer[1024];
+	while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+		std::string line(buffer);
+		if (!line.empty() && line.back() == '\n')
+			line.pop_back();
+
+		const size_t timestampEnd = line.find("] ");
+		lines.push_back(line[0] == '[' && timestampEnd != std::string::npos ? line.substr(timestampEnd + 2) : line);
+	}
+
+	CHECK(pclose(pipe) == 0);
+	return lines;
+}
+
+TEST_CASE(every_argument_type_round_trips) {
+	if (!CHECK(TraceLog::Open(k_tracePath, 64 * 1024)))
+		return;
+
+	const PSMVector3f vector = { 1.5f, -2.25f, 3.f };
+	const PSMQuatf quat = { 1.f, 0.f, -0.5f, 0.25f };
+	const PSMPosef pose = { { 10.f, 20.f, 30.f }, { 0.5f, 0.5f, -0.5f, 0.5f } };
+
+	static TraceFormat s_scalarTrace("int {} uint {} int64 {} bool {} {} float {} double {}");
+	static TraceFormat s_geometryTrace("vector {} quat {} pose {}");
+	static TraceFormat s_noArgsTrace("no arguments");
+
+	TraceLog::Record(s_scalarTrace, -42, 4000000000u, -5000000000ll, true, false, 0.5f, -1.25);
+	TraceLog::Record(s_geometryTrace, vector, quat, pose);
+	TraceLog::Record(s_noArgsTrace);
+
+	// The second time a call site records it reuses its format record
+	TraceLog::Record(s_scalarTrace, 7, 8u, 9ll, false, true, -0.5f, 2.5);
+	TraceLog::Close();
+
+	const std::vector<std::string> lines = DecodeTrace();
+	if (!CHECK(lines.size() == 6))
+		return;
+
+	CHECK(lines[1] == "int -42 uint 4000000000 int64 -5000000000 bool true false float 0.500000 double -1.250000");
+	CHECK(lines[2] == "vector (1.500000, -2.250000, 3.000000) quat (w=1.000000, x=0.000000, y=-0.500000, z=0.250000) "
+		"pose [pos (10.000000, 20.000000, 30.000000), rot (w=0.500000, x=0.500000, y=-0.500000, z=0.500000)]");
+	CHECK(lines[3] == "no arguments");
+	CHECK(lines[4] == "int 7 uint 8 int64 9 bool false true float -0.500000 double 2.500000");
+	CHECK(lines[5] == "4 events, 0 records dropped");
+}
+
+TEST_CASE(dropped_format_record_drops_its_events) {
+	if (!CHECK(TraceLog::Open(k_tracePath, 64 * 1024)))
+		return;
+
+	// Too long for a record; the event itself would still fit
+	static const std::string s_hugeFormat(70000, 'x');
+	static TraceFormat s_hugeTrace(s_hugeFormat.c_str());
+	static TraceFormat s_smallTrace("small {}");
+
+	TraceLog::Record(s_hugeTrace);
+	TraceLog::Record(s_smallTrace, 1);
+	TraceLog::Record(s_hugeTrace);
+	TraceLog::Close();
+
+	const std::vector<std::string> lines = DecodeTrace();
+	if (!CHECK(lines.size() == 3))
+		return;
+
+	CHECK(lines[1] == "small 1");
+	CHECK(lines[2] == "1 events, 4 records dropped");
+
+	remove(k_tracePath.c_str());
+}